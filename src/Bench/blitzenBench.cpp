@@ -0,0 +1,404 @@
+// Repeatable CPU benchmarks for the parts of the engine that need no window or device: asset import, mesh processing,
+// containers and math. Results are JSON (stdout, or the --output file), so throughput can be tracked per commit.
+// BlitzenBench [--iterations <n>] [--output <file.json>] [--gltf <scene.gltf>]... [mesh.obj]...
+#define CGLTF_IMPLEMENTATION
+#include "Renderer/Resources/Scene/blitScene.h"
+#include "BlitCL/blitHashMap.h"
+#include "Platform/Filesystem/blitCFILE.h"
+#include "Meshoptimizer/meshoptimizer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace BlitzenBench
+{
+    constexpr uint32_t Ce_DefaultIterations = 5;
+    constexpr const char* Ce_DefaultObjAssets[] = { "Assets/Meshes/kitten.obj", "Assets/Meshes/bunny.obj", "Assets/Meshes/dragon.obj" };
+
+    constexpr uint32_t Ce_ContainerElementCount = 1 << 20;
+    constexpr uint32_t Ce_HashMapElementCount = 1 << 12;
+    constexpr uint32_t Ce_MathElementCount = 1 << 18;
+
+    struct BenchResult
+    {
+        std::string name;
+        std::string asset;
+        uint32_t iterations;
+        uint64_t items;
+
+        double minMs;
+        double medianMs;
+        double meanMs;
+    };
+
+    // Results are folded into this, so that the compiler cannot drop the measured work
+    static volatile uint64_t s_sink = 0;
+
+    // setup runs before every iteration and is not timed, so that each iteration starts from the same input
+    template<typename SETUP, typename WORK>
+    static void Measure(std::vector<BenchResult>& results, uint32_t iterations, const char* name, const char* asset, uint64_t items,
+        SETUP setup, WORK work)
+    {
+        std::vector<double> times;
+        times.reserve(iterations);
+        for (uint32_t i = 0; i < iterations; ++i)
+        {
+            setup();
+            auto start{ std::chrono::steady_clock::now() };
+            work();
+            auto end{ std::chrono::steady_clock::now() };
+            times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+        }
+
+        double sum{ 0.0 };
+        for (auto t : times)
+        {
+            sum += t;
+        }
+        std::sort(times.begin(), times.end());
+
+        results.push_back({ name, asset, iterations, items, times.front(), times[times.size() / 2], sum / double(times.size()) });
+        BLIT_INFO("%s %s: %.3f ms (min %.3f ms)", name, asset, results.back().medianMs, results.back().minMs);
+    }
+
+    template<typename T>
+    static void CopyArray(BlitCL::DynamicArray<T>& dst, const BlitCL::DynamicArray<T>& src)
+    {
+        dst.Resize(src.GetSize());
+        std::copy(src.Data(), src.Data() + src.GetSize(), dst.Data());
+    }
+
+    // Every stage of LoadObjSurfaces, each on the output of the previous one. The cooked mesh cache is not involved
+    static bool BenchObjPipeline(std::vector<BenchResult>& results, uint32_t iterations, const char* path)
+    {
+        using namespace BlitzenEngine;
+
+        BlitCL::DynamicArray<Vertex> triangleVertices;
+        if (!LoadObjTriangleVertices(path, triangleVertices))
+        {
+            BLIT_ERROR("Failed to parse %s", path);
+            return false;
+        }
+        auto indexCount{ triangleVertices.GetSize() };
+        auto triangleCount{ uint64_t(indexCount / 3) };
+
+        Measure(results, iterations, "objParse", path, triangleCount, [] {}, [&]
+        {
+            BlitCL::DynamicArray<Vertex> parsed;
+            LoadObjTriangleVertices(path, parsed);
+            s_sink += parsed.GetSize();
+        });
+
+        BlitCL::DynamicArray<uint32_t> remap{ indexCount };
+        BlitCL::DynamicArray<Vertex> vertices;
+        BlitCL::DynamicArray<uint32_t> indices{ indexCount };
+        Measure(results, iterations, "vertexRemap", path, triangleCount, [] {}, [&]
+        {
+            auto vertexCount{ meshopt_generateVertexRemap(remap.Data(), nullptr, indexCount, triangleVertices.Data(), indexCount, sizeof(Vertex)) };
+            vertices.Resize(vertexCount);
+            meshopt_remapVertexBuffer(vertices.Data(), triangleVertices.Data(), indexCount, sizeof(Vertex), remap.Data());
+            meshopt_remapIndexBuffer(indices.Data(), nullptr, indexCount, remap.Data());
+        });
+        GenerateTangents(vertices, indices);
+
+        BlitCL::DynamicArray<uint32_t> optimizedIndices;
+        Measure(results, iterations, "vertexCacheOptimize", path, triangleCount, [] {}, [&]
+        {
+            optimizedIndices.Resize(indexCount);
+            meshopt_optimizeVertexCache(optimizedIndices.Data(), indices.Data(), indexCount, vertices.GetSize());
+        });
+
+        BlitCL::DynamicArray<Vertex> fetchVertices;
+        BlitCL::DynamicArray<uint32_t> fetchIndices;
+        Measure(results, iterations, "vertexFetchOptimize", path, triangleCount, [&] { CopyArray(fetchIndices, optimizedIndices); }, [&]
+        {
+            fetchVertices.Resize(vertices.GetSize());
+            meshopt_optimizeVertexFetch(fetchVertices.Data(), fetchIndices.Data(), indexCount, vertices.Data(), vertices.GetSize(), sizeof(Vertex));
+        });
+
+        BlitCL::DynamicArray<Vertex> stageVertices;
+        BlitCL::DynamicArray<uint32_t> stageIndices;
+        auto copyStageInput = [&]
+        {
+            CopyArray(stageVertices, fetchVertices);
+            CopyArray(stageIndices, fetchIndices);
+        };
+
+        Measure(results, iterations, "lodChain", path, triangleCount, copyStageInput, [&]
+        {
+            SurfaceResources surfaces;
+            PrimitiveSurface surface{};
+            GenerateLODs(surfaces, surface, stageVertices, stageIndices);
+            s_sink += surface.lodCount;
+        });
+
+        Measure(results, iterations, "clusterize", path, triangleCount, copyStageInput, [&]
+        {
+            SurfaceResources surfaces;
+            s_sink += GenerateClusters(surfaces, stageVertices, stageIndices);
+        });
+
+        Measure(results, iterations, "clusterHierarchy", path, triangleCount, copyStageInput, [&]
+        {
+            SurfaceResources surfaces;
+            s_sink += GenerateClusterHierarchy(surfaces, stageVertices, stageIndices);
+        });
+
+        return true;
+    }
+
+    static bool BenchGltf(std::vector<BenchResult>& results, uint32_t iterations, const char* path)
+    {
+        using namespace BlitzenEngine;
+
+        uint64_t primitiveCount{ 0 };
+        {
+            CgltfScope scope{ nullptr };
+            if (!LoadGltfFile(path, scope))
+            {
+                BLIT_ERROR("Failed to load %s", path);
+                return false;
+            }
+            for (size_t i = 0; i < scope.pData->meshes_count; ++i)
+            {
+                primitiveCount += scope.pData->meshes[i].primitives_count;
+            }
+        }
+
+        Measure(results, iterations, "gltfLoad", path, primitiveCount, [] {}, [&]
+        {
+            CgltfScope scope{ nullptr };
+            LoadGltfFile(path, scope);
+            s_sink += scope.pData ? scope.pData->meshes_count : 0;
+        });
+
+        CgltfScope scope{ nullptr };
+        LoadGltfFile(path, scope);
+        Measure(results, iterations, "gltfSurfaces", path, primitiveCount, [] {}, [&]
+        {
+            SurfaceResources surfaces;
+            LoadGltfSurfaces(surfaces, scope);
+            s_sink += surfaces.m_surfaces.GetSize();
+        });
+
+        return true;
+    }
+
+    static void BenchContainers(std::vector<BenchResult>& results, uint32_t iterations)
+    {
+        Measure(results, iterations, "dynamicArrayPushBack", "", Ce_ContainerElementCount, [] {}, []
+        {
+            BlitCL::DynamicArray<uint32_t> array;
+            for (uint32_t i = 0; i < Ce_ContainerElementCount; ++i)
+            {
+                array.PushBack(i);
+            }
+            s_sink += array.GetSize();
+        });
+
+        BlitCL::DynamicArray<uint32_t> array{ Ce_ContainerElementCount };
+        for (uint32_t i = 0; i < Ce_ContainerElementCount; ++i)
+        {
+            array[i] = i;
+        }
+        Measure(results, iterations, "dynamicArrayIterate", "", Ce_ContainerElementCount, [] {}, [&]
+        {
+            uint64_t sum{ 0 };
+            for (auto value : array)
+            {
+                sum += value;
+            }
+            s_sink += sum;
+        });
+
+        std::vector<std::string> names(Ce_HashMapElementCount);
+        for (uint32_t i = 0; i < Ce_HashMapElementCount; ++i)
+        {
+            names[i] = "BlitzenMesh_" + std::to_string(i);
+        }
+
+        Measure(results, iterations, "hashMapInsert", "", Ce_HashMapElementCount, [] {}, [&]
+        {
+            BlitCL::HashMap<uint32_t> map;
+            for (uint32_t i = 0; i < Ce_HashMapElementCount; ++i)
+            {
+                map.Insert(names[i].c_str(), i);
+            }
+            s_sink += map[names[0].c_str()];
+        });
+
+        BlitCL::HashMap<uint32_t> map;
+        for (uint32_t i = 0; i < Ce_HashMapElementCount; ++i)
+        {
+            map.Insert(names[i].c_str(), i);
+        }
+        Measure(results, iterations, "hashMapLookup", "", Ce_HashMapElementCount, [] {}, [&]
+        {
+            uint64_t sum{ 0 };
+            for (uint32_t i = 0; i < Ce_HashMapElementCount; ++i)
+            {
+                sum += map[names[i].c_str()];
+            }
+            s_sink += sum;
+        });
+    }
+
+    static void BenchMath(std::vector<BenchResult>& results, uint32_t iterations)
+    {
+        std::vector<BlitML::mat4> matrices(Ce_MathElementCount);
+        std::vector<BlitML::mat4> products(Ce_MathElementCount);
+        std::vector<BlitML::vec3> points(Ce_MathElementCount);
+        std::vector<BlitML::vec3> transformedPoints(Ce_MathElementCount);
+        std::vector<BlitML::vec4> spheres(Ce_MathElementCount);
+        std::vector<BlitML::vec4> transformedSpheres(Ce_MathElementCount);
+        for (uint32_t i = 0; i < Ce_MathElementCount; ++i)
+        {
+            auto f{ float(i % 1024) };
+            auto translation{ BlitML::Translate(BlitML::vec3{ f, -f, 0.5f * f }) };
+            auto rotation{ BlitML::Mat4EulerXYZ(f * 0.01f, f * 0.02f, f * 0.03f) };
+            matrices[i] = translation * rotation;
+            points[i] = BlitML::vec3{ f, f * 0.5f, -f };
+            spheres[i] = BlitML::vec4{ f, f * 0.5f, -f, 1.f + f * 0.01f };
+        }
+        auto view{ BlitML::LookAt(BlitML::vec3{ 10.f, 20.f, 30.f }, BlitML::vec3{ 0.f }, BlitML::vec3{ 0.f, 1.f, 0.f }) };
+
+        Measure(results, iterations, "mat4Multiply", "", Ce_MathElementCount, [] {}, [&]
+        {
+            for (uint32_t i = 0; i < Ce_MathElementCount; ++i)
+            {
+                products[i] = view * matrices[i];
+            }
+            s_sink += uint64_t(products[Ce_MathElementCount - 1][12]);
+        });
+
+        Measure(results, iterations, "mat4Inverse", "", Ce_MathElementCount, [] {}, [&]
+        {
+            for (uint32_t i = 0; i < Ce_MathElementCount; ++i)
+            {
+                products[i] = BlitML::Mat4Inverse(matrices[i]);
+            }
+            s_sink += uint64_t(products[Ce_MathElementCount - 1][12]);
+        });
+
+        Measure(results, iterations, "transformPoints", "", Ce_MathElementCount, [] {}, [&]
+        {
+            BlitML::TransformPoints(view, points.data(), transformedPoints.data(), Ce_MathElementCount);
+            s_sink += uint64_t(transformedPoints[Ce_MathElementCount - 1].x);
+        });
+
+        Measure(results, iterations, "transformSpheres", "", Ce_MathElementCount, [] {}, [&]
+        {
+            BlitML::TransformSpheres(view, spheres.data(), transformedSpheres.data(), Ce_MathElementCount);
+            s_sink += uint64_t(transformedSpheres[Ce_MathElementCount - 1].w);
+        });
+    }
+
+    static void WriteJsonString(FILE* pFile, const std::string& str)
+    {
+        fputc('"', pFile);
+        for (auto c : str)
+        {
+            if (c == '"' || c == '\\')
+            {
+                fputc('\\', pFile);
+            }
+            fputc(c, pFile);
+        }
+        fputc('"', pFile);
+    }
+
+    static void WriteResults(FILE* pFile, const std::vector<BenchResult>& results)
+    {
+        fputs("{\n  \"benchmarks\": [\n", pFile);
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const auto& result{ results[i] };
+            fputs("    { \"name\": ", pFile);
+            WriteJsonString(pFile, result.name);
+            fputs(", \"asset\": ", pFile);
+            WriteJsonString(pFile, result.asset);
+            fprintf(pFile, ", \"iterations\": %u, \"items\": %llu, \"minMs\": %.4f, \"medianMs\": %.4f, \"meanMs\": %.4f, \"itemsPerSecond\": %.1f }%s\n",
+                result.iterations, (unsigned long long)result.items, result.minMs, result.medianMs, result.meanMs,
+                result.minMs > 0.0 ? double(result.items) * 1000.0 / result.minMs : 0.0, i + 1 < results.size() ? "," : "");
+        }
+        fputs("  ]\n}\n", pFile);
+    }
+
+    static void PrintUsage()
+    {
+        fputs("Usage: BlitzenBench [--iterations <n>] [--output <file.json>] [--gltf <scene.gltf>]... [mesh.obj]...\n", stderr);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    using namespace BlitzenBench;
+
+    uint32_t iterations{ Ce_DefaultIterations };
+    const char* outputPath{ nullptr };
+    std::vector<const char*> objPaths;
+    std::vector<const char*> gltfPaths;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--iterations") && i + 1 < argc)
+        {
+            iterations = uint32_t(strtoul(argv[++i], nullptr, 10));
+            iterations = iterations ? iterations : 1;
+        }
+        else if (!strcmp(argv[i], "--output") && i + 1 < argc)
+        {
+            outputPath = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--gltf") && i + 1 < argc)
+        {
+            gltfPaths.push_back(argv[++i]);
+        }
+        // Unknown options, or known ones without their value
+        else if (!strncmp(argv[i], "--", 2))
+        {
+            BLIT_ERROR("Unrecognized argument: %s", argv[i]);
+            PrintUsage();
+            return 1;
+        }
+        else
+        {
+            objPaths.push_back(argv[i]);
+        }
+    }
+    if (objPaths.empty())
+    {
+        objPaths.assign(std::begin(Ce_DefaultObjAssets), std::end(Ce_DefaultObjAssets));
+    }
+
+    std::vector<BenchResult> results;
+    bool bSuccess{ true };
+    for (auto path : objPaths)
+    {
+        bSuccess = BenchObjPipeline(results, iterations, path) && bSuccess;
+    }
+    for (auto path : gltfPaths)
+    {
+        bSuccess = BenchGltf(results, iterations, path) && bSuccess;
+    }
+    BenchContainers(results, iterations);
+    BenchMath(results, iterations);
+
+    if (outputPath)
+    {
+        BlitzenPlatform::C_FILE_SCOPE file;
+        if (!file.Open(outputPath, BlitzenPlatform::FileModes::Write, 0))
+        {
+            BLIT_ERROR("Failed to open %s", outputPath);
+            return 1;
+        }
+        WriteResults(file.m_pHandle, results);
+    }
+    else
+    {
+        WriteResults(stdout, results);
+    }
+
+    return bSuccess ? 0 : 1;
+}
@@ -0,0 +1,52 @@
+// Platform layer of the benchmark executable: logging and heap only, no window, events or graphics API.
+// Logs go to stderr uncolored, so that stdout only carries the JSON results. Blocks are never aligned
+#include "Core/blitMemory.h"
+#include <cstring>
+
+namespace BlitzenPlatform
+{
+    void PlatformConsoleWrite(const char* message, uint8_t)
+    {
+        fputs(message, stderr);
+    }
+
+    void PlatformConsoleError(const char* message, uint8_t)
+    {
+        fputs(message, stderr);
+    }
+
+    void PlatformLoggerFileWrite(const char* message, uint8_t)
+    {
+        fputs(message, stderr);
+    }
+
+    void PlatformLoggerFileError(const char* message, uint8_t)
+    {
+        fputs(message, stderr);
+    }
+
+    void* PlatformMalloc(size_t size, uint8_t)
+    {
+        return malloc(size);
+    }
+
+    void PlatformFree(void* pBlock, uint8_t)
+    {
+        free(pBlock);
+    }
+
+    void* PlatformMemZero(void* pBlock, size_t size)
+    {
+        return memset(pBlock, 0, size);
+    }
+
+    void* PlatformMemCopy(void* pDst, void* pSrc, size_t size)
+    {
+        return memcpy(pDst, pSrc, size);
+    }
+
+    void* PlatformMemSet(void* pDst, int32_t value, size_t size)
+    {
+        return memset(pDst, value, size);
+    }
+}
@@ -148,7 +148,7 @@ namespace BlitCL
 
         void Clear()
         {
-            BlitzenCore::BlitZeroMemory(m_pBlock, m_size * sizeof(T));
+            BlitzenCore::BlitZeroMemory(m_pBlock, m_size);
             m_size = 0;
         }
 
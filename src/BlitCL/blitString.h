@@ -164,7 +164,6 @@ namespace BlitCL
 
         void IncreaseCapacity(size_t newSize)
         {
-            auto previousCapacity = m_capacity;
             const char* previousData = m_data;
             m_capacity = newSize * ce_blitStringCapacityMultiplier + 1;
 
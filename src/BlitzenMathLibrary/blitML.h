@@ -42,6 +42,7 @@ namespace BlitML
     inline float Abs(float x) {return fabsf(x);}
     inline float Max(float x, float y) { return (x > y) ? x : y; }
     inline uint32_t Max(uint32_t x, uint32_t y) { return (x > y) ? x : y; }
+    inline uint32_t Min(uint32_t x, uint32_t y) { return (x < y) ? x : y; }
 
     inline uint32_t Clamp(uint32_t initial, uint32_t upper, uint32_t lower) { 
         return (initial >= upper) ? upper
@@ -311,54 +312,8 @@ namespace BlitML
     // Creates and returns an inverse of the provided matrix.
     inline mat4 Mat4Inverse(const mat4& matrix) 
     {
-        const float* m = matrix.data;
-        float t0 = m[10] * m[15];
-        float t1 = m[14] * m[11];
-        float t2 = m[6] * m[15];
-        float t3 = m[14] * m[7];
-        float t4 = m[6] * m[11];
-        float t5 = m[10] * m[7];
-        float t6 = m[2] * m[15];
-        float t7 = m[14] * m[3];
-        float t8 = m[2] * m[11];
-        float t9 = m[10] * m[3];
-        float t10 = m[2] * m[7];
-        float t11 = m[6] * m[3];
-        float t12 = m[8] * m[13];
-        float t13 = m[12] * m[9];
-        float t14 = m[4] * m[13];
-        float t15 = m[12] * m[5];
-        float t16 = m[4] * m[9];
-        float t17 = m[8] * m[5];
-        float t18 = m[0] * m[13];
-        float t19 = m[12] * m[1];
-        float t20 = m[0] * m[9];
-        float t21 = m[8] * m[1];
-        float t22 = m[0] * m[5];
-        float t23 = m[4] * m[1];
-        mat4 res;
-        float* pRes = res.data;
-        pRes[0] = (t0 * m[5] + t3 * m[9] + t4 * m[13]) - (t1 * m[5] + t2 * m[9] + t5 * m[13]);
-        pRes[1] = (t1 * m[1] + t6 * m[9] + t9 * m[13]) - (t0 * m[1] + t7 * m[9] + t8 * m[13]);
-        pRes[2] = (t2 * m[1] + t7 * m[5] + t10 * m[13]) - (t3 * m[1] + t6 * m[5] + t11 * m[13]);
-        pRes[3] = (t5 * m[1] + t8 * m[5] + t11 * m[9]) - (t4 * m[1] + t9 * m[5] + t10 * m[9]);
-        float d = 1.0f / (m[0] * pRes[0] + m[4] * pRes[1] + m[8] * pRes[2] + m[12] * pRes[3]);
-        pRes[0] = d * pRes[0];
-        pRes[1] = d * pRes[1];
-        pRes[2] = d * pRes[2];
-        pRes[3] = d * pRes[3];
-        pRes[4] = d * ((t1 * m[4] + t2 * m[8] + t5 * m[12]) - (t0 * m[4] + t3 * m[8] + t4 * m[12]));
-        pRes[5] = d * ((t0 * m[0] + t7 * m[8] + t8 * m[12]) - (t1 * m[0] + t6 * m[8] + t9 * m[12]));
-        pRes[6] = d * ((t3 * m[0] + t6 * m[4] + t11 * m[12]) - (t2 * m[0] + t7 * m[4] + t10 * m[12]));
-        pRes[7] = d * ((t4 * m[0] + t9 * m[4] + t10 * m[8]) - (t5 * m[0] + t8 * m[4] + t11 * m[8]));
-        pRes[8] = d * ((t12 * m[7] + t15 * m[11] + t16 * m[15]) - (t13 * m[7] + t14 * m[11] + t17 * m[15]));
-        pRes[9] = d * ((t13 * m[3] + t18 * m[11] + t21 * m[15]) - (t12 * m[3] + t19 * m[11] + t20 * m[15]));
-        pRes[10] = d * ((t14 * m[3] + t19 * m[7] + t22 * m[15]) - (t15 * m[3] + t18 * m[7] + t23 * m[15]));
-        pRes[11] = d * ((t17 * m[3] + t20 * m[7] + t23 * m[11]) - (t16 * m[3] + t21 * m[7] + t22 * m[11]));
-        pRes[12] = d * ((t14 * m[10] + t17 * m[14] + t13 * m[6]) - (t16 * m[14] + t12 * m[6] + t15 * m[10]));
-        pRes[13] = d * ((t20 * m[14] + t12 * m[2] + t19 * m[10]) - (t18 * m[10] + t21 * m[14] + t13 * m[2]));
-        pRes[14] = d * ((t18 * m[6] + t23 * m[14] + t15 * m[2]) - (t22 * m[14] + t14 * m[2] + t19 * m[6]));
-        pRes[15] = d * ((t22 * m[10] + t16 * m[2] + t21 * m[6]) - (t20 * m[6] + t23 * m[10] + t17 * m[2]));
+        mat4 res(0);
+        Backend::Mat4Inverse(matrix.data, res.data);
         return res;
     }
 
@@ -490,6 +445,30 @@ namespace BlitML
 
 
 
+    /*-----------------------
+        Batch operations
+    ------------------------*/
+
+    // Transforms count points (w = 1) by the matrix. pResult may be the same array as pPoints
+    inline void TransformPoints(const mat4& matrix, const vec3* pPoints, vec3* pResult, size_t count)
+    {
+        Backend::TransformPoints(matrix.data, &pPoints->x, &pResult->x, count);
+    }
+
+    inline void TransformVec4s(const mat4& matrix, const vec4* pVectors, vec4* pResult, size_t count)
+    {
+        Backend::TransformVec4s(matrix.data, pVectors->elements, pResult->elements, count);
+    }
+
+    // Spheres are packed as center xyz and radius w. Radii are scaled by the largest axis scale of the matrix
+    inline void TransformSpheres(const mat4& matrix, const vec4* pSpheres, vec4* pResult, size_t count)
+    {
+        Backend::TransformSpheres(matrix.data, pSpheres->elements, pResult->elements, count);
+    }
+
+
+
+
     /*-------------------------
         Quaternion operations
     ---------------------------*/
@@ -519,17 +498,8 @@ namespace BlitML
 
     inline mat4 QuatToMat4(const quat& q) 
     {
-        mat4 res;
-        quat n = NormalizeQuat(q);
-        res.data[0] = 1.0f - 2.0f * n.y * n.y - 2.0f * n.z * n.z;
-        res.data[1] = 2.0f * n.x * n.y - 2.0f * n.z * n.w;
-        res.data[2] = 2.0f * n.x * n.z + 2.0f * n.y * n.w;
-        res.data[4] = 2.0f * n.x * n.y + 2.0f * n.z * n.w;
-        res.data[5] = 1.0f - 2.0f * n.x * n.x - 2.0f * n.z * n.z;
-        res.data[6] = 2.0f * n.y * n.z - 2.0f * n.x * n.w;
-        res.data[8] = 2.0f * n.x * n.z - 2.0f * n.y * n.w;
-        res.data[9] = 2.0f * n.y * n.z + 2.0f * n.x * n.w;
-        res.data[10] = 1.0f - 2.0f * n.x * n.x - 2.0f * n.y * n.y;
+        mat4 res(0);
+        Backend::QuatToMat4(q.elements, res.data);
         return res;
     }
 
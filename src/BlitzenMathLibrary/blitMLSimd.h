@@ -0,0 +1,524 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <math.h>
+
+// The SIMD backend is picked at compile time. SSE2 is part of every x64 target, AVX2 needs /arch:AVX2 or -mavx2.
+// BLIT_ML_SCALAR forces the scalar fallback
+#if !defined(BLIT_ML_SCALAR) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+    #define BLIT_ML_SSE2
+    #include <emmintrin.h>
+    #if defined(__AVX2__)
+        #define BLIT_ML_AVX2
+        #include <immintrin.h>
+    #endif
+#endif
+
+// Kernels work on raw floats, matrices are column major (translation in 12, 13, 14), like BlitML::mat4.
+// Both backends are always visible to the benchmark, the types in blitMLTypes.h go through BlitML::Backend
+namespace BlitML
+{
+    namespace Scalar
+    {
+        constexpr const char* Ce_BackendName = "Scalar";
+
+        inline void Vec4Add(const float* v1, const float* v2, float* res)
+        {
+            res[0] = v1[0] + v2[0];
+            res[1] = v1[1] + v2[1];
+            res[2] = v1[2] + v2[2];
+            res[3] = v1[3] + v2[3];
+        }
+
+        inline void Vec4Sub(const float* v1, const float* v2, float* res)
+        {
+            res[0] = v1[0] - v2[0];
+            res[1] = v1[1] - v2[1];
+            res[2] = v1[2] - v2[2];
+            res[3] = v1[3] - v2[3];
+        }
+
+        inline void Vec4Mul(const float* v1, const float* v2, float* res)
+        {
+            res[0] = v1[0] * v2[0];
+            res[1] = v1[1] * v2[1];
+            res[2] = v1[2] * v2[2];
+            res[3] = v1[3] * v2[3];
+        }
+
+        inline void Vec4Div(const float* v1, const float* v2, float* res)
+        {
+            res[0] = v1[0] / v2[0];
+            res[1] = v1[1] / v2[1];
+            res[2] = v1[2] / v2[2];
+            res[3] = v1[3] / v2[3];
+        }
+
+        inline void Vec4DivScalar(const float* v, float f, float* res)
+        {
+            res[0] = v[0] / f;
+            res[1] = v[1] / f;
+            res[2] = v[2] / f;
+            res[3] = v[3] / f;
+        }
+
+        inline void Mat4Mul(const float* m1, const float* m2, float* res)
+        {
+            for (uint32_t i = 0; i < 4; ++i)
+            {
+                for (uint32_t j = 0; j < 4; ++j)
+                {
+                    res[j + i * 4] = m1[0 + j] * m2[0 + i * 4] + m1[4 + j] * m2[1 + i * 4] + m1[8 + j] * m2[2 + i * 4] + m1[12 + j] * m2[3 + i * 4];
+                }
+            }
+        }
+
+        inline void Mat4MulVec4(const float* m, const float* v, float* res)
+        {
+            res[0] = m[0] * v[0] + v[1] * m[4] + v[2] * m[8] + v[3] * m[12];
+            res[1] = m[1] * v[0] + v[1] * m[5] + v[2] * m[9] + v[3] * m[13];
+            res[2] = m[2] * v[0] + v[1] * m[6] + v[2] * m[10] + v[3] * m[14];
+            res[3] = m[3] * v[0] + v[1] * m[7] + v[2] * m[11] + v[3] * m[15];
+        }
+
+        inline void Mat4MulScalar(const float* m, float scalar, float* res)
+        {
+            for (uint32_t i = 0; i < 16; ++i)
+            {
+                res[i] = m[i] * scalar;
+            }
+        }
+
+        inline void Mat4Transpose(const float* m, float* res)
+        {
+            for (uint32_t i = 0; i < 4; ++i)
+            {
+                for (uint32_t j = 0; j < 4; ++j)
+                {
+                    res[j + i * 4] = m[i + j * 4];
+                }
+            }
+        }
+
+        inline void Mat4Inverse(const float* m, float* pRes)
+        {
+            float t0 = m[10] * m[15];
+            float t1 = m[14] * m[11];
+            float t2 = m[6] * m[15];
+            float t3 = m[14] * m[7];
+            float t4 = m[6] * m[11];
+            float t5 = m[10] * m[7];
+            float t6 = m[2] * m[15];
+            float t7 = m[14] * m[3];
+            float t8 = m[2] * m[11];
+            float t9 = m[10] * m[3];
+            float t10 = m[2] * m[7];
+            float t11 = m[6] * m[3];
+            float t12 = m[8] * m[13];
+            float t13 = m[12] * m[9];
+            float t14 = m[4] * m[13];
+            float t15 = m[12] * m[5];
+            float t16 = m[4] * m[9];
+            float t17 = m[8] * m[5];
+            float t18 = m[0] * m[13];
+            float t19 = m[12] * m[1];
+            float t20 = m[0] * m[9];
+            float t21 = m[8] * m[1];
+            float t22 = m[0] * m[5];
+            float t23 = m[4] * m[1];
+            pRes[0] = (t0 * m[5] + t3 * m[9] + t4 * m[13]) - (t1 * m[5] + t2 * m[9] + t5 * m[13]);
+            pRes[1] = (t1 * m[1] + t6 * m[9] + t9 * m[13]) - (t0 * m[1] + t7 * m[9] + t8 * m[13]);
+            pRes[2] = (t2 * m[1] + t7 * m[5] + t10 * m[13]) - (t3 * m[1] + t6 * m[5] + t11 * m[13]);
+            pRes[3] = (t5 * m[1] + t8 * m[5] + t11 * m[9]) - (t4 * m[1] + t9 * m[5] + t10 * m[9]);
+            float d = 1.0f / (m[0] * pRes[0] + m[4] * pRes[1] + m[8] * pRes[2] + m[12] * pRes[3]);
+            pRes[0] = d * pRes[0];
+            pRes[1] = d * pRes[1];
+            pRes[2] = d * pRes[2];
+            pRes[3] = d * pRes[3];
+            pRes[4] = d * ((t1 * m[4] + t2 * m[8] + t5 * m[12]) - (t0 * m[4] + t3 * m[8] + t4 * m[12]));
+            pRes[5] = d * ((t0 * m[0] + t7 * m[8] + t8 * m[12]) - (t1 * m[0] + t6 * m[8] + t9 * m[12]));
+            pRes[6] = d * ((t3 * m[0] + t6 * m[4] + t11 * m[12]) - (t2 * m[0] + t7 * m[4] + t10 * m[12]));
+            pRes[7] = d * ((t4 * m[0] + t9 * m[4] + t10 * m[8]) - (t5 * m[0] + t8 * m[4] + t11 * m[8]));
+            pRes[8] = d * ((t12 * m[7] + t15 * m[11] + t16 * m[15]) - (t13 * m[7] + t14 * m[11] + t17 * m[15]));
+            pRes[9] = d * ((t13 * m[3] + t18 * m[11] + t21 * m[15]) - (t12 * m[3] + t19 * m[11] + t20 * m[15]));
+            pRes[10] = d * ((t14 * m[3] + t19 * m[7] + t22 * m[15]) - (t15 * m[3] + t18 * m[7] + t23 * m[15]));
+            pRes[11] = d * ((t17 * m[3] + t20 * m[7] + t23 * m[11]) - (t16 * m[3] + t21 * m[7] + t22 * m[11]));
+            pRes[12] = d * ((t14 * m[10] + t17 * m[14] + t13 * m[6]) - (t16 * m[14] + t12 * m[6] + t15 * m[10]));
+            pRes[13] = d * ((t20 * m[14] + t12 * m[2] + t19 * m[10]) - (t18 * m[10] + t21 * m[14] + t13 * m[2]));
+            pRes[14] = d * ((t18 * m[6] + t23 * m[14] + t15 * m[2]) - (t22 * m[14] + t14 * m[2] + t19 * m[6]));
+            pRes[15] = d * ((t22 * m[10] + t16 * m[2] + t21 * m[6]) - (t20 * m[6] + t23 * m[10] + t17 * m[2]));
+        }
+
+        // Normalizes the quaternion and writes the full rotation matrix
+        inline void QuatToMat4(const float* q, float* res)
+        {
+            float normal = sqrtf(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+            float x = q[0] / normal;
+            float y = q[1] / normal;
+            float z = q[2] / normal;
+            float w = q[3] / normal;
+            res[0] = 1.0f - 2.0f * y * y - 2.0f * z * z;
+            res[1] = 2.0f * x * y - 2.0f * z * w;
+            res[2] = 2.0f * x * z + 2.0f * y * w;
+            res[3] = 0.f;
+            res[4] = 2.0f * x * y + 2.0f * z * w;
+            res[5] = 1.0f - 2.0f * x * x - 2.0f * z * z;
+            res[6] = 2.0f * y * z - 2.0f * x * w;
+            res[7] = 0.f;
+            res[8] = 2.0f * x * z - 2.0f * y * w;
+            res[9] = 2.0f * y * z + 2.0f * x * w;
+            res[10] = 1.0f - 2.0f * x * x - 2.0f * y * y;
+            res[11] = 0.f;
+            res[12] = 0.f;
+            res[13] = 0.f;
+            res[14] = 0.f;
+            res[15] = 1.f;
+        }
+
+        // Points are tightly packed xyz, w is taken as 1
+        inline void TransformPoints(const float* m, const float* pPoints, float* pResult, size_t count)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                const float* p = pPoints + i * 3;
+                float* r = pResult + i * 3;
+                float x = p[0], y = p[1], z = p[2];
+                r[0] = m[0] * x + y * m[4] + z * m[8] + m[12];
+                r[1] = m[1] * x + y * m[5] + z * m[9] + m[13];
+                r[2] = m[2] * x + y * m[6] + z * m[10] + m[14];
+            }
+        }
+
+        inline void TransformVec4s(const float* m, const float* pVectors, float* pResult, size_t count)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                Mat4MulVec4(m, pVectors + i * 4, pResult + i * 4);
+            }
+        }
+
+        // Largest axis scale of the upper 3x3, used to grow sphere radii
+        inline float Mat4MaxScale(const float* m)
+        {
+            float sx = m[0] * m[0] + m[1] * m[1] + m[2] * m[2];
+            float sy = m[4] * m[4] + m[5] * m[5] + m[6] * m[6];
+            float sz = m[8] * m[8] + m[9] * m[9] + m[10] * m[10];
+            float s = sx > sy ? sx : sy;
+            return sqrtf(s > sz ? s : sz);
+        }
+
+        // Spheres are xyz center and w radius
+        inline void TransformSpheres(const float* m, const float* pSpheres, float* pResult, size_t count)
+        {
+            float scale = Mat4MaxScale(m);
+            for (size_t i = 0; i < count; ++i)
+            {
+                const float* s = pSpheres + i * 4;
+                float* r = pResult + i * 4;
+                float x = s[0], y = s[1], z = s[2];
+                r[0] = m[0] * x + y * m[4] + z * m[8] + m[12];
+                r[1] = m[1] * x + y * m[5] + z * m[9] + m[13];
+                r[2] = m[2] * x + y * m[6] + z * m[10] + m[14];
+                r[3] = s[3] * scale;
+            }
+        }
+    }
+
+#if defined(BLIT_ML_SSE2)
+    namespace Simd
+    {
+    #if defined(BLIT_ML_AVX2)
+        constexpr const char* Ce_BackendName = "AVX2";
+    #else
+        constexpr const char* Ce_BackendName = "SSE2";
+    #endif
+
+        #define BLIT_ML_SHUFFLE(x, y, z, w) ((x) | ((y) << 2) | ((z) << 4) | ((w) << 6))
+        #define BLIT_ML_SWIZZLE(v, x, y, z, w) _mm_shuffle_ps(v, v, BLIT_ML_SHUFFLE(x, y, z, w))
+
+        inline void Vec4Add(const float* v1, const float* v2, float* res)
+        {
+            _mm_storeu_ps(res, _mm_add_ps(_mm_loadu_ps(v1), _mm_loadu_ps(v2)));
+        }
+
+        inline void Vec4Sub(const float* v1, const float* v2, float* res)
+        {
+            _mm_storeu_ps(res, _mm_sub_ps(_mm_loadu_ps(v1), _mm_loadu_ps(v2)));
+        }
+
+        inline void Vec4Mul(const float* v1, const float* v2, float* res)
+        {
+            _mm_storeu_ps(res, _mm_mul_ps(_mm_loadu_ps(v1), _mm_loadu_ps(v2)));
+        }
+
+        inline void Vec4Div(const float* v1, const float* v2, float* res)
+        {
+            _mm_storeu_ps(res, _mm_div_ps(_mm_loadu_ps(v1), _mm_loadu_ps(v2)));
+        }
+
+        inline void Vec4DivScalar(const float* v, float f, float* res)
+        {
+            _mm_storeu_ps(res, _mm_div_ps(_mm_loadu_ps(v), _mm_set1_ps(f)));
+        }
+
+        // Columns times the broadcast components of v, summed in the same order as the scalar code
+        inline __m128 Mat4MulVec4(__m128 c0, __m128 c1, __m128 c2, __m128 c3, __m128 v)
+        {
+            __m128 res = _mm_mul_ps(c0, BLIT_ML_SWIZZLE(v, 0, 0, 0, 0));
+            res = _mm_add_ps(res, _mm_mul_ps(c1, BLIT_ML_SWIZZLE(v, 1, 1, 1, 1)));
+            res = _mm_add_ps(res, _mm_mul_ps(c2, BLIT_ML_SWIZZLE(v, 2, 2, 2, 2)));
+            return _mm_add_ps(res, _mm_mul_ps(c3, BLIT_ML_SWIZZLE(v, 3, 3, 3, 3)));
+        }
+
+        inline void Mat4MulVec4(const float* m, const float* v, float* res)
+        {
+            _mm_storeu_ps(res, Mat4MulVec4(_mm_loadu_ps(m), _mm_loadu_ps(m + 4), _mm_loadu_ps(m + 8), _mm_loadu_ps(m + 12), _mm_loadu_ps(v)));
+        }
+
+        inline void Mat4Mul(const float* m1, const float* m2, float* res)
+        {
+        #if defined(BLIT_ML_AVX2)
+            // Two result columns per iteration, every lane holds the same m1 column
+            __m256 c0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m1));
+            __m256 c1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m1 + 4));
+            __m256 c2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m1 + 8));
+            __m256 c3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m1 + 12));
+            for (uint32_t i = 0; i < 16; i += 8)
+            {
+                __m256 b = _mm256_loadu_ps(m2 + i);
+                __m256 r = _mm256_mul_ps(c0, _mm256_permute_ps(b, 0x00));
+                r = _mm256_add_ps(r, _mm256_mul_ps(c1, _mm256_permute_ps(b, 0x55)));
+                r = _mm256_add_ps(r, _mm256_mul_ps(c2, _mm256_permute_ps(b, 0xaa)));
+                r = _mm256_add_ps(r, _mm256_mul_ps(c3, _mm256_permute_ps(b, 0xff)));
+                _mm256_storeu_ps(res + i, r);
+            }
+        #else
+            __m128 c0 = _mm_loadu_ps(m1);
+            __m128 c1 = _mm_loadu_ps(m1 + 4);
+            __m128 c2 = _mm_loadu_ps(m1 + 8);
+            __m128 c3 = _mm_loadu_ps(m1 + 12);
+            for (uint32_t i = 0; i < 16; i += 4)
+            {
+                _mm_storeu_ps(res + i, Mat4MulVec4(c0, c1, c2, c3, _mm_loadu_ps(m2 + i)));
+            }
+        #endif
+        }
+
+        inline void Mat4MulScalar(const float* m, float scalar, float* res)
+        {
+            __m128 s = _mm_set1_ps(scalar);
+            for (uint32_t i = 0; i < 16; i += 4)
+            {
+                _mm_storeu_ps(res + i, _mm_mul_ps(_mm_loadu_ps(m + i), s));
+            }
+        }
+
+        inline void Mat4Transpose(const float* m, float* res)
+        {
+            __m128 c0 = _mm_loadu_ps(m);
+            __m128 c1 = _mm_loadu_ps(m + 4);
+            __m128 c2 = _mm_loadu_ps(m + 8);
+            __m128 c3 = _mm_loadu_ps(m + 12);
+            _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+            _mm_storeu_ps(res, c0);
+            _mm_storeu_ps(res + 4, c1);
+            _mm_storeu_ps(res + 8, c2);
+            _mm_storeu_ps(res + 12, c3);
+        }
+
+        // 2x2 matrix helpers for the block inverse, a 2x2 matrix is stored as (m00, m01, m10, m11)
+        inline __m128 Mat2Mul(__m128 a, __m128 b)
+        {
+            return _mm_add_ps(_mm_mul_ps(a, BLIT_ML_SWIZZLE(b, 0, 3, 0, 3)), _mm_mul_ps(BLIT_ML_SWIZZLE(a, 1, 0, 3, 2), BLIT_ML_SWIZZLE(b, 2, 1, 2, 1)));
+        }
+        // adj(a) * b
+        inline __m128 Mat2AdjMul(__m128 a, __m128 b)
+        {
+            return _mm_sub_ps(_mm_mul_ps(BLIT_ML_SWIZZLE(a, 3, 3, 0, 0), b), _mm_mul_ps(BLIT_ML_SWIZZLE(a, 1, 1, 2, 2), BLIT_ML_SWIZZLE(b, 2, 3, 0, 1)));
+        }
+        // a * adj(b)
+        inline __m128 Mat2MulAdj(__m128 a, __m128 b)
+        {
+            return _mm_sub_ps(_mm_mul_ps(a, BLIT_ML_SWIZZLE(b, 3, 0, 3, 0)), _mm_mul_ps(BLIT_ML_SWIZZLE(a, 1, 0, 3, 2), BLIT_ML_SWIZZLE(b, 2, 1, 2, 1)));
+        }
+
+        // Block inverse on 2x2 sub matrices. inverse(transpose(M)) == transpose(inverse(M)), so the layout does not matter
+        inline void Mat4Inverse(const float* m, float* res)
+        {
+            __m128 r0 = _mm_loadu_ps(m);
+            __m128 r1 = _mm_loadu_ps(m + 4);
+            __m128 r2 = _mm_loadu_ps(m + 8);
+            __m128 r3 = _mm_loadu_ps(m + 12);
+
+            __m128 a = _mm_movelh_ps(r0, r1);
+            __m128 b = _mm_movehl_ps(r1, r0);
+            __m128 c = _mm_movelh_ps(r2, r3);
+            __m128 d = _mm_movehl_ps(r3, r2);
+
+            // (|A|, |B|, |C|, |D|)
+            __m128 detSub = _mm_sub_ps(
+                _mm_mul_ps(_mm_shuffle_ps(r0, r2, BLIT_ML_SHUFFLE(0, 2, 0, 2)), _mm_shuffle_ps(r1, r3, BLIT_ML_SHUFFLE(1, 3, 1, 3))),
+                _mm_mul_ps(_mm_shuffle_ps(r0, r2, BLIT_ML_SHUFFLE(1, 3, 1, 3)), _mm_shuffle_ps(r1, r3, BLIT_ML_SHUFFLE(0, 2, 0, 2))));
+            __m128 detA = BLIT_ML_SWIZZLE(detSub, 0, 0, 0, 0);
+            __m128 detB = BLIT_ML_SWIZZLE(detSub, 1, 1, 1, 1);
+            __m128 detC = BLIT_ML_SWIZZLE(detSub, 2, 2, 2, 2);
+            __m128 detD = BLIT_ML_SWIZZLE(detSub, 3, 3, 3, 3);
+
+            __m128 dc = Mat2AdjMul(d, c);
+            __m128 ab = Mat2AdjMul(a, b);
+            __m128 x = _mm_sub_ps(_mm_mul_ps(detD, a), Mat2Mul(b, dc));
+            __m128 w = _mm_sub_ps(_mm_mul_ps(detA, d), Mat2Mul(c, ab));
+            __m128 y = _mm_sub_ps(_mm_mul_ps(detB, c), Mat2MulAdj(d, ab));
+            __m128 z = _mm_sub_ps(_mm_mul_ps(detC, b), Mat2MulAdj(a, dc));
+
+            // |M| = |A||D| + |B||C| - tr(adj(A)B adj(D)C)
+            __m128 tr = _mm_mul_ps(ab, BLIT_ML_SWIZZLE(dc, 0, 2, 1, 3));
+            tr = _mm_add_ps(tr, BLIT_ML_SWIZZLE(tr, 2, 3, 0, 1));
+            tr = _mm_add_ps(tr, BLIT_ML_SWIZZLE(tr, 1, 0, 3, 2));
+            __m128 det = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(detA, detD), _mm_mul_ps(detB, detC)), tr);
+
+            __m128 rcpDet = _mm_div_ps(_mm_setr_ps(1.f, -1.f, -1.f, 1.f), det);
+            x = _mm_mul_ps(x, rcpDet);
+            y = _mm_mul_ps(y, rcpDet);
+            z = _mm_mul_ps(z, rcpDet);
+            w = _mm_mul_ps(w, rcpDet);
+
+            // Adjugate shuffle folded into the store
+            _mm_storeu_ps(res, _mm_shuffle_ps(x, y, BLIT_ML_SHUFFLE(3, 1, 3, 1)));
+            _mm_storeu_ps(res + 4, _mm_shuffle_ps(x, y, BLIT_ML_SHUFFLE(2, 0, 2, 0)));
+            _mm_storeu_ps(res + 8, _mm_shuffle_ps(z, w, BLIT_ML_SHUFFLE(3, 1, 3, 1)));
+            _mm_storeu_ps(res + 12, _mm_shuffle_ps(z, w, BLIT_ML_SHUFFLE(2, 0, 2, 0)));
+        }
+
+        inline void QuatToMat4(const float* q, float* res)
+        {
+            __m128 n = _mm_loadu_ps(q);
+            __m128 dot = _mm_mul_ps(n, n);
+            dot = _mm_add_ps(dot, BLIT_ML_SWIZZLE(dot, 2, 3, 0, 1));
+            dot = _mm_add_ps(dot, BLIT_ML_SWIZZLE(dot, 1, 0, 3, 2));
+            n = _mm_div_ps(n, _mm_sqrt_ps(dot));
+
+            // Every row is 1 on the diagonal plus 2 * (a * b + c * d), w of each product is multiplied by zero
+            __m128 two = _mm_setr_ps(2.f, 2.f, 2.f, 0.f);
+            __m128 row0 = _mm_add_ps(_mm_mul_ps(BLIT_ML_SWIZZLE(n, 1, 0, 0, 3), _mm_mul_ps(BLIT_ML_SWIZZLE(n, 1, 1, 2, 3), _mm_setr_ps(-1.f, 1.f, 1.f, 0.f))),
+                _mm_mul_ps(BLIT_ML_SWIZZLE(n, 2, 2, 1, 3), _mm_mul_ps(BLIT_ML_SWIZZLE(n, 2, 3, 3, 3), _mm_setr_ps(-1.f, -1.f, 1.f, 0.f))));
+            __m128 row1 = _mm_add_ps(_mm_mul_ps(BLIT_ML_SWIZZLE(n, 0, 0, 1, 3), _mm_mul_ps(BLIT_ML_SWIZZLE(n, 1, 0, 2, 3), _mm_setr_ps(1.f, -1.f, 1.f, 0.f))),
+                _mm_mul_ps(BLIT_ML_SWIZZLE(n, 2, 2, 0, 3), _mm_mul_ps(BLIT_ML_SWIZZLE(n, 3, 2, 3, 3), _mm_setr_ps(1.f, -1.f, -1.f, 0.f))));
+            __m128 row2 = _mm_add_ps(_mm_mul_ps(BLIT_ML_SWIZZLE(n, 0, 1, 0, 3), _mm_mul_ps(BLIT_ML_SWIZZLE(n, 2, 2, 0, 3), _mm_setr_ps(1.f, 1.f, -1.f, 0.f))),
+                _mm_mul_ps(BLIT_ML_SWIZZLE(n, 1, 0, 1, 3), _mm_mul_ps(BLIT_ML_SWIZZLE(n, 3, 3, 1, 3), _mm_setr_ps(-1.f, 1.f, -1.f, 0.f))));
+
+            _mm_storeu_ps(res, _mm_add_ps(_mm_setr_ps(1.f, 0.f, 0.f, 0.f), _mm_mul_ps(two, row0)));
+            _mm_storeu_ps(res + 4, _mm_add_ps(_mm_setr_ps(0.f, 1.f, 0.f, 0.f), _mm_mul_ps(two, row1)));
+            _mm_storeu_ps(res + 8, _mm_add_ps(_mm_setr_ps(0.f, 0.f, 1.f, 0.f), _mm_mul_ps(two, row2)));
+            _mm_storeu_ps(res + 12, _mm_setr_ps(0.f, 0.f, 0.f, 1.f));
+        }
+
+        // Four points per iteration, transposed to x, y, z registers and back. The tail goes through the scalar code
+        inline void TransformPoints(const float* m, const float* pPoints, float* pResult, size_t count)
+        {
+            __m128 m0 = _mm_set1_ps(m[0]), m1 = _mm_set1_ps(m[1]), m2 = _mm_set1_ps(m[2]);
+            __m128 m4 = _mm_set1_ps(m[4]), m5 = _mm_set1_ps(m[5]), m6 = _mm_set1_ps(m[6]);
+            __m128 m8 = _mm_set1_ps(m[8]), m9 = _mm_set1_ps(m[9]), m10 = _mm_set1_ps(m[10]);
+            __m128 m12 = _mm_set1_ps(m[12]), m13 = _mm_set1_ps(m[13]), m14 = _mm_set1_ps(m[14]);
+
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4)
+            {
+                // (x0 y0 z0 x1) (y1 z1 x2 y2) (z2 x3 y3 z3)
+                __m128 a = _mm_loadu_ps(pPoints + i * 3);
+                __m128 b = _mm_loadu_ps(pPoints + i * 3 + 4);
+                __m128 c = _mm_loadu_ps(pPoints + i * 3 + 8);
+                __m128 x = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, BLIT_ML_SHUFFLE(2, 2, 1, 1)), BLIT_ML_SHUFFLE(0, 3, 0, 2));
+                __m128 y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, BLIT_ML_SHUFFLE(1, 1, 0, 0)), _mm_shuffle_ps(b, c, BLIT_ML_SHUFFLE(3, 3, 2, 2)), BLIT_ML_SHUFFLE(0, 2, 0, 2));
+                __m128 z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, BLIT_ML_SHUFFLE(2, 2, 1, 1)), c, BLIT_ML_SHUFFLE(0, 2, 0, 3));
+
+                __m128 rx = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m0, x), _mm_mul_ps(y, m4)), _mm_mul_ps(z, m8)), m12);
+                __m128 ry = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m1, x), _mm_mul_ps(y, m5)), _mm_mul_ps(z, m9)), m13);
+                __m128 rz = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m2, x), _mm_mul_ps(y, m6)), _mm_mul_ps(z, m10)), m14);
+
+                a = _mm_shuffle_ps(_mm_shuffle_ps(rx, ry, BLIT_ML_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_ps(rz, rx, BLIT_ML_SHUFFLE(0, 0, 1, 1)), BLIT_ML_SHUFFLE(0, 2, 0, 2));
+                b = _mm_shuffle_ps(_mm_shuffle_ps(ry, rz, BLIT_ML_SHUFFLE(1, 1, 1, 1)), _mm_shuffle_ps(rx, ry, BLIT_ML_SHUFFLE(2, 2, 2, 2)), BLIT_ML_SHUFFLE(0, 2, 0, 2));
+                c = _mm_shuffle_ps(_mm_shuffle_ps(rz, rx, BLIT_ML_SHUFFLE(2, 2, 3, 3)), _mm_shuffle_ps(ry, rz, BLIT_ML_SHUFFLE(3, 3, 3, 3)), BLIT_ML_SHUFFLE(0, 2, 0, 2));
+                _mm_storeu_ps(pResult + i * 3, a);
+                _mm_storeu_ps(pResult + i * 3 + 4, b);
+                _mm_storeu_ps(pResult + i * 3 + 8, c);
+            }
+            Scalar::TransformPoints(m, pPoints + i * 3, pResult + i * 3, count - i);
+        }
+
+        inline void TransformVec4s(const float* m, const float* pVectors, float* pResult, size_t count)
+        {
+            size_t i = 0;
+        #if defined(BLIT_ML_AVX2)
+            __m256 c0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m));
+            __m256 c1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m + 4));
+            __m256 c2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m + 8));
+            __m256 c3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m + 12));
+            for (; i + 2 <= count; i += 2)
+            {
+                __m256 v = _mm256_loadu_ps(pVectors + i * 4);
+                __m256 r = _mm256_mul_ps(c0, _mm256_permute_ps(v, 0x00));
+                r = _mm256_add_ps(r, _mm256_mul_ps(c1, _mm256_permute_ps(v, 0x55)));
+                r = _mm256_add_ps(r, _mm256_mul_ps(c2, _mm256_permute_ps(v, 0xaa)));
+                r = _mm256_add_ps(r, _mm256_mul_ps(c3, _mm256_permute_ps(v, 0xff)));
+                _mm256_storeu_ps(pResult + i * 4, r);
+            }
+        #endif
+            __m128 s0 = _mm_loadu_ps(m);
+            __m128 s1 = _mm_loadu_ps(m + 4);
+            __m128 s2 = _mm_loadu_ps(m + 8);
+            __m128 s3 = _mm_loadu_ps(m + 12);
+            for (; i < count; ++i)
+            {
+                _mm_storeu_ps(pResult + i * 4, Mat4MulVec4(s0, s1, s2, s3, _mm_loadu_ps(pVectors + i * 4)));
+            }
+        }
+
+        inline void TransformSpheres(const float* m, const float* pSpheres, float* pResult, size_t count)
+        {
+            float scale = Scalar::Mat4MaxScale(m);
+            size_t i = 0;
+
+            // The translation column takes the place of w * c3, w then gets radius * scale
+        #if defined(BLIT_ML_AVX2)
+            __m256 c0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m));
+            __m256 c1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m + 4));
+            __m256 c2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m + 8));
+            __m256 c3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m + 12));
+            __m256 radiusScale8 = _mm256_set1_ps(scale);
+            for (; i + 2 <= count; i += 2)
+            {
+                __m256 s = _mm256_loadu_ps(pSpheres + i * 4);
+                __m256 r = _mm256_mul_ps(c0, _mm256_permute_ps(s, 0x00));
+                r = _mm256_add_ps(r, _mm256_mul_ps(c1, _mm256_permute_ps(s, 0x55)));
+                r = _mm256_add_ps(r, _mm256_mul_ps(c2, _mm256_permute_ps(s, 0xaa)));
+                r = _mm256_add_ps(r, c3);
+                r = _mm256_blend_ps(r, _mm256_mul_ps(s, radiusScale8), 0x88);
+                _mm256_storeu_ps(pResult + i * 4, r);
+            }
+        #endif
+            __m128 s0 = _mm_loadu_ps(m);
+            __m128 s1 = _mm_loadu_ps(m + 4);
+            __m128 s2 = _mm_loadu_ps(m + 8);
+            __m128 s3 = _mm_loadu_ps(m + 12);
+            __m128 radiusScale = _mm_set1_ps(scale);
+            __m128 xyzMask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+            for (; i < count; ++i)
+            {
+                __m128 s = _mm_loadu_ps(pSpheres + i * 4);
+                __m128 r = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(s0, BLIT_ML_SWIZZLE(s, 0, 0, 0, 0)),
+                    _mm_mul_ps(s1, BLIT_ML_SWIZZLE(s, 1, 1, 1, 1))), _mm_mul_ps(s2, BLIT_ML_SWIZZLE(s, 2, 2, 2, 2))), s3);
+                r = _mm_or_ps(_mm_and_ps(r, xyzMask), _mm_andnot_ps(xyzMask, _mm_mul_ps(s, radiusScale)));
+                _mm_storeu_ps(pResult + i * 4, r);
+            }
+        }
+
+        #undef BLIT_ML_SWIZZLE
+        #undef BLIT_ML_SHUFFLE
+    }
+
+    namespace Backend = Simd;
+#else
+    namespace Backend = Scalar;
+#endif
+}
@@ -1,6 +1,8 @@
 #pragma once
 #include <cstdint>
+#include <type_traits>
 #include "Core/blitMemory.h"
+#include "blitMLSimd.h"
 
 namespace BlitML
 {
@@ -19,7 +21,6 @@ namespace BlitML
         inline vec2() : x{0.f}, y{0.f} {}
         inline vec2(float f) : x{f}, y{f} {}
         inline vec2(float first, float second) : x{first}, y{second} {}
-        inline vec2(const vec2& copy) : x{copy.x}, y{copy.y} {}
     };
 
     inline vec2 operator + (const vec2& v1, const vec2& v2) { return vec2(v1.x + v2.x, v1.y + v2.y); }
@@ -49,7 +50,6 @@ namespace BlitML
         inline vec3(float f) : x{f}, y{f}, z{f} {}
         inline vec3(float first, float second, float third) : x{first}, y{second}, z{third} {}
         inline vec3(const vec2& partial, float third) : x{partial.x}, y{partial.y}, z{third} {}
-        inline vec3(const vec3& copy) : x{copy.x}, y{copy.y}, z{copy.z} {}
     };
 
     inline vec3 operator + (const vec3& v1, const vec3& v2) { return vec3(v1.x + v2.x, v1.y + v2.y, v1.z + v2.z); }
@@ -94,18 +94,24 @@ namespace BlitML
         inline vec4(float first, float second, float third, float fourth) : x{first}, y{second}, z{third}, w{fourth} {}
         inline vec4(const vec2& partial , float third, float fourth) : x{partial.x}, y{partial.y}, z{third}, w{fourth} {}
         inline vec4(const vec3& partial, float fourth = 0.f) : x{partial.x}, y{partial.y}, z{partial.z}, w{fourth} {}
-        inline vec4(const vec4& copy) : x{copy.x}, y{copy.y}, z{copy.z}, w{copy.w} {}  
     };
 
-    inline vec4 operator + (const vec4& v1, const vec4 v2) { return vec4(v1.x + v2.x, v1.y + v2.y, v1.z + v2.z, v1.w + v2.w); }
+    // The backend kernels read vectors and matrices as plain float arrays
+    static_assert(sizeof(vec3) == 3 * sizeof(float));
+    static_assert(sizeof(vec4) == 4 * sizeof(float));
 
-    inline vec4 operator - (const vec4& v1, const vec4& v2){ return vec4(v1.x - v2.x, v1.y - v2.y, v1.z - v2.z, v1.w - v2.w); }
+    // Copies stay trivial, so the render object, surface and vertex arrays copy as plain memory
+    static_assert(std::is_trivially_copyable_v<vec2> && std::is_trivially_copyable_v<vec3> && std::is_trivially_copyable_v<vec4>);
 
-    inline vec4 operator * (const vec4& v1, const vec4& v2) { return vec4(v1.x * v2.x, v1.y * v2.y, v1.z * v2.z, v1.w * v2.w); }
+    inline vec4 operator + (const vec4& v1, const vec4 v2) { vec4 res; Backend::Vec4Add(v1.elements, v2.elements, res.elements); return res; }
 
-    inline vec4 operator / (const vec4& v1, const vec4& v2) { return vec4(v1.x / v2.x, v1.y / v2.y, v1.z / v2.z, v1.w / v2.w); }
+    inline vec4 operator - (const vec4& v1, const vec4& v2){ vec4 res; Backend::Vec4Sub(v1.elements, v2.elements, res.elements); return res; }
 
-    inline vec4 operator / (const vec4& v1, float f) { return vec4(v1.x / f, v1.y / f, v1.z / f, v1.w / f); }
+    inline vec4 operator * (const vec4& v1, const vec4& v2) { vec4 res; Backend::Vec4Mul(v1.elements, v2.elements, res.elements); return res; }
+
+    inline vec4 operator / (const vec4& v1, const vec4& v2) { vec4 res; Backend::Vec4Div(v1.elements, v2.elements, res.elements); return res; }
+
+    inline vec4 operator / (const vec4& v1, float f) { vec4 res; Backend::Vec4DivScalar(v1.elements, f, res.elements); return res; }
 
 
 
@@ -145,73 +151,36 @@ namespace BlitML
         }
     };
 
+    static_assert(sizeof(mat4) == 16 * sizeof(float));
+    static_assert(std::is_trivially_copyable_v<mat4>);
+
     // Returns a transposed copy of the provided matrix (rows->colums)
     // Defined here as it is a good helper when dealing with different shader languages
     inline mat4 Transpose(const mat4& matrix)
     {
-        mat4 res;
-        res.data[0] = matrix.data[0];
-        res.data[1] = matrix.data[4];
-        res.data[2] = matrix.data[8];
-        res.data[3] = matrix.data[12];
-        res.data[4] = matrix.data[1];
-        res.data[5] = matrix.data[5];
-        res.data[6] = matrix.data[9];
-        res.data[7] = matrix.data[13];
-        res.data[8] = matrix.data[2];
-        res.data[9] = matrix.data[6];
-        res.data[10] = matrix.data[10];
-        res.data[11] = matrix.data[14];
-        res.data[12] = matrix.data[3];
-        res.data[13] = matrix.data[7];
-        res.data[14] = matrix.data[11];
-        res.data[15] = matrix.data[15];
+        mat4 res(0);
+        Backend::Mat4Transpose(matrix.data, res.data);
         return res;
     }
 
     inline mat4 operator * (mat4& mat1, mat4& mat2) 
     {
-        mat4 res;
-        for (uint32_t i = 0; i < 4; ++i) {
-            for (uint32_t j = 0; j < 4; ++j) 
-            {
-                res[j + i * 4] = mat1[0 + j] * mat2[0 + i * 4] + mat1[4 + j] * mat2[1 + i * 4] + mat1[8 + j] * mat2[2 + i * 4] + mat1[12 + j] * mat2[3 + i * 4];
-            }
-        }
+        mat4 res(0);
+        Backend::Mat4Mul(mat1.data, mat2.data, res.data);
         return res;
     }
 
     inline vec4 operator * (mat4& mat, const vec4& vec)
     {
         vec4 res;
-        res.x = mat[0] * vec.x + vec.y * mat[4] + vec.z * mat[8] + vec.w * mat[12];
-        res.y = mat[1] * vec.x + vec.y * mat[5] + vec.z * mat[9] + vec.w * mat[13];
-        res.z = mat[2] * vec.x + vec.y * mat[6] + vec.z * mat[10] + vec.w * mat[14];
-        res.w = mat[3] * vec.x + vec.y * mat[7] + vec.z * mat[11] + vec.w * mat[15];
-
+        Backend::Mat4MulVec4(mat.data, vec.elements, res.elements);
         return res;
     }
 
     inline mat4 operator *(mat4& mat, float scalar)
     {
-        return mat4
-        {
-            mat[0] * scalar, 
-            mat[1] * scalar,
-            mat[2] * scalar,
-            mat[3] * scalar,
-            mat[4] * scalar,
-            mat[5] * scalar,
-            mat[6] * scalar,
-            mat[7] * scalar,
-            mat[8] * scalar,
-            mat[9] * scalar,
-            mat[10] * scalar,
-            mat[11] * scalar,
-            mat[12] * scalar,
-            mat[13] * scalar,
-            mat[14] * scalar,
-            mat[15] * scalar
-        };
+        mat4 res(0);
+        Backend::Mat4MulScalar(mat.data, scalar, res.data);
+        return res;
     }
 }
\ No newline at end of file
@@ -0,0 +1,144 @@
+// Micro-benchmark for the BlitML backends. Runs every kernel through the scalar fallback and the SIMD backend on the same data,
+// prints the time per element and the largest difference between the results
+#include "blitMLSimd.h"
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+namespace BlitzenMLBenchmark
+{
+    constexpr size_t Ce_ElementCount = 1 << 16;
+    constexpr uint32_t Ce_Repetitions = 64;
+
+    static float RandomFloat(float min, float max)
+    {
+        return min + (max - min) * (float(rand()) / float(RAND_MAX));
+    }
+
+    // Random affine transform with a positive scale, so that inverses are well conditioned
+    static void RandomMatrix(float* m)
+    {
+        float q[4] = { RandomFloat(-1.f, 1.f), RandomFloat(-1.f, 1.f), RandomFloat(-1.f, 1.f), RandomFloat(0.1f, 1.f) };
+        BlitML::Scalar::QuatToMat4(q, m);
+        float scale = RandomFloat(0.5f, 4.f);
+        for (uint32_t i = 0; i < 12; ++i)
+        {
+            m[i] *= scale;
+        }
+        m[12] = RandomFloat(-100.f, 100.f);
+        m[13] = RandomFloat(-100.f, 100.f);
+        m[14] = RandomFloat(-100.f, 100.f);
+    }
+
+    static float MaxDifference(const std::vector<float>& a, const std::vector<float>& b)
+    {
+        float res = 0.f;
+        for (size_t i = 0; i < a.size(); ++i)
+        {
+            float d = fabsf(a[i] - b[i]) / (fabsf(a[i]) > 1.f ? fabsf(a[i]) : 1.f);
+            res = d > res ? d : res;
+        }
+        return res;
+    }
+
+    // Returns nanoseconds per element, the best of all repetitions
+    template<typename F>
+    static double Time(F&& kernel)
+    {
+        double best = 1e30;
+        for (uint32_t r = 0; r < Ce_Repetitions; ++r)
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+            kernel();
+            auto end = std::chrono::high_resolution_clock::now();
+            double ns = std::chrono::duration<double, std::nano>(end - start).count() / double(Ce_ElementCount);
+            best = ns < best ? ns : best;
+        }
+        return best;
+    }
+
+    // Runs the scalar and the simd version of a kernel, each writes to its own output
+    template<typename S, typename V>
+    static void Compare(const char* name, std::vector<float>& scalarOut, std::vector<float>& simdOut, S&& scalar, V&& simd)
+    {
+        std::fill(scalarOut.begin(), scalarOut.end(), 0.f);
+        std::fill(simdOut.begin(), simdOut.end(), 0.f);
+        double scalarNs = Time(scalar);
+        double simdNs = Time(simd);
+        printf("%-18s %10.2f %10.2f %8.2fx %12.3g\n", name, scalarNs, simdNs, scalarNs / simdNs, MaxDifference(scalarOut, simdOut));
+    }
+}
+
+int main()
+{
+    using namespace BlitzenMLBenchmark;
+    namespace Scalar = BlitML::Scalar;
+    namespace Simd = BlitML::Backend;
+
+    srand(7);
+    const size_t n = Ce_ElementCount;
+
+    std::vector<float> matrices(n * 16);
+    std::vector<float> vectors(n * 4);
+    std::vector<float> spheres(n * 4);
+    for (size_t i = 0; i < n; ++i)
+    {
+        RandomMatrix(&matrices[i * 16]);
+        for (uint32_t j = 0; j < 4; ++j)
+        {
+            vectors[i * 4 + j] = RandomFloat(-10.f, 10.f);
+            spheres[i * 4 + j] = j < 3 ? RandomFloat(-10.f, 10.f) : RandomFloat(0.1f, 5.f);
+        }
+    }
+
+    std::vector<float> scalarOut(n * 16);
+    std::vector<float> simdOut(n * 16);
+
+    printf("BlitML backend: %s, %zu elements, best of %u runs\n", Simd::Ce_BackendName, n, Ce_Repetitions);
+    printf("%-18s %10s %10s %9s %12s\n", "kernel", "scalar ns", "simd ns", "speedup", "max rel diff");
+
+    Compare("Vec4Add", scalarOut, simdOut,
+        [&]() { for (size_t i = 0; i < n; ++i) Scalar::Vec4Add(&vectors[i * 4], &spheres[i * 4], &scalarOut[i * 4]); },
+        [&]() { for (size_t i = 0; i < n; ++i) Simd::Vec4Add(&vectors[i * 4], &spheres[i * 4], &simdOut[i * 4]); });
+
+    Compare("Vec4Div", scalarOut, simdOut,
+        [&]() { for (size_t i = 0; i < n; ++i) Scalar::Vec4Div(&vectors[i * 4], &spheres[i * 4], &scalarOut[i * 4]); },
+        [&]() { for (size_t i = 0; i < n; ++i) Simd::Vec4Div(&vectors[i * 4], &spheres[i * 4], &simdOut[i * 4]); });
+
+    Compare("Mat4Mul", scalarOut, simdOut,
+        [&]() { for (size_t i = 0; i + 1 < n; ++i) Scalar::Mat4Mul(&matrices[i * 16], &matrices[(i + 1) * 16], &scalarOut[i * 16]); },
+        [&]() { for (size_t i = 0; i + 1 < n; ++i) Simd::Mat4Mul(&matrices[i * 16], &matrices[(i + 1) * 16], &simdOut[i * 16]); });
+
+    Compare("Mat4MulVec4", scalarOut, simdOut,
+        [&]() { for (size_t i = 0; i < n; ++i) Scalar::Mat4MulVec4(&matrices[i * 16], &vectors[i * 4], &scalarOut[i * 4]); },
+        [&]() { for (size_t i = 0; i < n; ++i) Simd::Mat4MulVec4(&matrices[i * 16], &vectors[i * 4], &simdOut[i * 4]); });
+
+    Compare("Mat4Transpose", scalarOut, simdOut,
+        [&]() { for (size_t i = 0; i < n; ++i) Scalar::Mat4Transpose(&matrices[i * 16], &scalarOut[i * 16]); },
+        [&]() { for (size_t i = 0; i < n; ++i) Simd::Mat4Transpose(&matrices[i * 16], &simdOut[i * 16]); });
+
+    Compare("Mat4Inverse", scalarOut, simdOut,
+        [&]() { for (size_t i = 0; i < n; ++i) Scalar::Mat4Inverse(&matrices[i * 16], &scalarOut[i * 16]); },
+        [&]() { for (size_t i = 0; i < n; ++i) Simd::Mat4Inverse(&matrices[i * 16], &simdOut[i * 16]); });
+
+    Compare("QuatToMat4", scalarOut, simdOut,
+        [&]() { for (size_t i = 0; i < n; ++i) Scalar::QuatToMat4(&spheres[i * 4], &scalarOut[i * 16]); },
+        [&]() { for (size_t i = 0; i < n; ++i) Simd::QuatToMat4(&spheres[i * 4], &simdOut[i * 16]); });
+
+    // Batch kernels, a single matrix over the whole array
+    Compare("TransformPoints", scalarOut, simdOut,
+        [&]() { Scalar::TransformPoints(&matrices[0], vectors.data(), scalarOut.data(), n); },
+        [&]() { Simd::TransformPoints(&matrices[0], vectors.data(), simdOut.data(), n); });
+
+    Compare("TransformVec4s", scalarOut, simdOut,
+        [&]() { Scalar::TransformVec4s(&matrices[0], vectors.data(), scalarOut.data(), n); },
+        [&]() { Simd::TransformVec4s(&matrices[0], vectors.data(), simdOut.data(), n); });
+
+    Compare("TransformSpheres", scalarOut, simdOut,
+        [&]() { Scalar::TransformSpheres(&matrices[0], spheres.data(), scalarOut.data(), n); },
+        [&]() { Simd::TransformSpheres(&matrices[0], spheres.data(), simdOut.data(), n); });
+
+    return 0;
+}
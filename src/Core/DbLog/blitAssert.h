@@ -46,8 +46,9 @@ namespace BlitzenCore
             #define BLIT_ASSERT_DEBUG(expr)
         #endif
     #else
-        #define BLIT_ASSERT(expr)                   expr;
-        #define BLIT_ASSERT_MESSAGE(expr, message)  expr;
+        // The expression is still evaluated for its side effects, the cast keeps pure checks from warning
+        #define BLIT_ASSERT(expr)                   (void)(expr);
+        #define BLIT_ASSERT_MESSAGE(expr, message)  (void)(expr);
         #define BLIT_ASSERT_DEBUG(expr)         
     #endif
 }
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+
+namespace BlitzenCore
+{
+    // Each thread writes to its own fixed buffer, zones and counters after it is full are dropped
+    constexpr uint32_t Ce_ProfilerEventsPerThread = 1 << 16;
+    constexpr uint32_t Ce_ProfilerThreadNameLength = 32;
+    constexpr const char* Ce_ProfilerTracePath = "BlitzenTrace.json";
+
+#if defined(BLIT_CPU_PROFILER)
+    // Nanoseconds since the profiler started
+    uint64_t ProfilerNow();
+
+    // Names are not copied, they need to outlive the trace (string literals or __func__)
+    void ProfilerRecordZone(const char* name, uint64_t startNs, uint64_t endNs);
+
+    void ProfilerRecordCounter(const char* name, double value);
+
+    void ProfilerSetThreadName(const char* name);
+
+    // Chrome trace event JSON, opens in chrome://tracing and Perfetto. Can be called while other threads are still recording
+    bool ProfilerWriteTrace(const char* filepath);
+
+    class ProfileZone
+    {
+    public:
+        inline ProfileZone(const char* name) :m_name{ name }, m_startNs{ ProfilerNow() } {}
+
+        inline ~ProfileZone() { ProfilerRecordZone(m_name, m_startNs, ProfilerNow()); }
+
+    private:
+        const char* m_name;
+        uint64_t m_startNs;
+    };
+#endif
+}
+
+#if defined(BLIT_CPU_PROFILER)
+    #define BLIT_PROFILE_CONCAT_INNER(a, b) a##b
+    #define BLIT_PROFILE_CONCAT(a, b) BLIT_PROFILE_CONCAT_INNER(a, b)
+
+    #define BLIT_PROFILE_ZONE(name) BlitzenCore::ProfileZone BLIT_PROFILE_CONCAT(blitProfileZone, __LINE__){ name }
+    #define BLIT_PROFILE_FUNCTION() BLIT_PROFILE_ZONE(__func__)
+    #define BLIT_PROFILE_COUNTER(name, value) BlitzenCore::ProfilerRecordCounter(name, double(value))
+    #define BLIT_PROFILE_THREAD_NAME(name) BlitzenCore::ProfilerSetThreadName(name)
+    #define BLIT_PROFILE_WRITE_TRACE(filepath) BlitzenCore::ProfilerWriteTrace(filepath)
+#else
+    #define BLIT_PROFILE_ZONE(name)
+    #define BLIT_PROFILE_FUNCTION()
+    #define BLIT_PROFILE_COUNTER(name, value)
+    #define BLIT_PROFILE_THREAD_NAME(name)
+    #define BLIT_PROFILE_WRITE_TRACE(filepath)
+#endif
@@ -0,0 +1,231 @@
+#include "blitProfiler.h"
+
+#if defined(BLIT_CPU_PROFILER)
+#include "blitLogger.h"
+#include "Platform/Filesystem/blitCFILE.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+namespace BlitzenCore
+{
+    enum class ProfileEventType : uint8_t
+    {
+        Zone = 0,
+        Counter
+    };
+
+    struct ProfileEvent
+    {
+        const char* name;
+        uint64_t startNs;
+        union
+        {
+            uint64_t endNs;
+            double value;
+        };
+        ProfileEventType type;
+    };
+
+    // Only the owning thread writes events. The count is published with release, so a writer sees complete events only
+    struct ThreadProfileBuffer
+    {
+        ProfileEvent events[Ce_ProfilerEventsPerThread];
+        std::atomic<uint32_t> eventCount{ 0 };
+        std::atomic<uint32_t> droppedCount{ 0 };
+
+        char name[Ce_ProfilerThreadNameLength]{};
+        std::atomic<uint8_t> bNamed{ 0 };
+
+        uint32_t threadId{ 0 };
+        ThreadProfileBuffer* pNext{ nullptr };
+    };
+
+    // Lock free list of every thread buffer. Buffers outlive their threads and are freed at exit
+    struct ProfilerBufferList
+    {
+        std::atomic<ThreadProfileBuffer*> pHead{ nullptr };
+        std::atomic<uint32_t> threadCount{ 0 };
+
+        ~ProfilerBufferList()
+        {
+            auto pBuffer{ pHead.load() };
+            while (pBuffer)
+            {
+                auto pNext{ pBuffer->pNext };
+                delete pBuffer;
+                pBuffer = pNext;
+            }
+        }
+    };
+
+    static ProfilerBufferList& GetProfilerBufferList()
+    {
+        static ProfilerBufferList s_bufferList;
+        return s_bufferList;
+    }
+
+    static const auto s_profilerStart{ std::chrono::steady_clock::now() };
+
+    static thread_local ThreadProfileBuffer* tl_pProfileBuffer = nullptr;
+
+    static ThreadProfileBuffer* GetThreadProfileBuffer()
+    {
+        if (!tl_pProfileBuffer)
+        {
+            auto& list{ GetProfilerBufferList() };
+            auto pBuffer{ new ThreadProfileBuffer };
+            pBuffer->threadId = list.threadCount.fetch_add(1) + 1;
+
+            auto pHead{ list.pHead.load(std::memory_order_acquire) };
+            do
+            {
+                pBuffer->pNext = pHead;
+            } while (!list.pHead.compare_exchange_weak(pHead, pBuffer, std::memory_order_release, std::memory_order_acquire));
+
+            tl_pProfileBuffer = pBuffer;
+        }
+
+        return tl_pProfileBuffer;
+    }
+
+    static ProfileEvent* ReserveProfileEvent(ThreadProfileBuffer* pBuffer)
+    {
+        auto count{ pBuffer->eventCount.load(std::memory_order_relaxed) };
+        if (count == Ce_ProfilerEventsPerThread)
+        {
+            pBuffer->droppedCount.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        return &pBuffer->events[count];
+    }
+
+    uint64_t ProfilerNow()
+    {
+        return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s_profilerStart).count());
+    }
+
+    void ProfilerRecordZone(const char* name, uint64_t startNs, uint64_t endNs)
+    {
+        auto pBuffer{ GetThreadProfileBuffer() };
+        auto pEvent{ ReserveProfileEvent(pBuffer) };
+        if (!pEvent)
+        {
+            return;
+        }
+
+        pEvent->name = name;
+        pEvent->startNs = startNs;
+        pEvent->endNs = endNs;
+        pEvent->type = ProfileEventType::Zone;
+        pBuffer->eventCount.fetch_add(1, std::memory_order_release);
+    }
+
+    void ProfilerRecordCounter(const char* name, double value)
+    {
+        auto pBuffer{ GetThreadProfileBuffer() };
+        auto pEvent{ ReserveProfileEvent(pBuffer) };
+        if (!pEvent)
+        {
+            return;
+        }
+
+        pEvent->name = name;
+        pEvent->startNs = ProfilerNow();
+        pEvent->value = value;
+        pEvent->type = ProfileEventType::Counter;
+        pBuffer->eventCount.fetch_add(1, std::memory_order_release);
+    }
+
+    void ProfilerSetThreadName(const char* name)
+    {
+        auto pBuffer{ GetThreadProfileBuffer() };
+        strncpy(pBuffer->name, name, Ce_ProfilerThreadNameLength - 1);
+        pBuffer->bNamed.store(1, std::memory_order_release);
+    }
+
+    // Names come from string literals, only quotes and backslashes need escaping
+    static void WriteJsonString(FILE* pFile, const char* str)
+    {
+        fputc('"', pFile);
+        for (; *str; ++str)
+        {
+            if (*str == '"' || *str == '\\')
+            {
+                fputc('\\', pFile);
+            }
+            fputc(*str, pFile);
+        }
+        fputc('"', pFile);
+    }
+
+    bool ProfilerWriteTrace(const char* filepath)
+    {
+        BlitzenPlatform::C_FILE_SCOPE file;
+        if (!file.Open(filepath, BlitzenPlatform::FileModes::Write, 0))
+        {
+            BLIT_ERROR("Failed to open %s for the CPU trace", filepath);
+            return false;
+        }
+        auto pFile{ file.m_pHandle };
+
+        fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", pFile);
+
+        uint32_t eventCount{ 0 };
+        uint32_t droppedCount{ 0 };
+        bool bFirst{ true };
+        auto pBuffer{ GetProfilerBufferList().pHead.load(std::memory_order_acquire) };
+        for (; pBuffer; pBuffer = pBuffer->pNext)
+        {
+            if (pBuffer->bNamed.load(std::memory_order_acquire))
+            {
+                fprintf(pFile, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", bFirst ? "" : ",\n",
+                    pBuffer->threadId);
+                WriteJsonString(pFile, pBuffer->name);
+                fputs("}}", pFile);
+                bFirst = false;
+            }
+
+            auto count{ pBuffer->eventCount.load(std::memory_order_acquire) };
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                auto& event{ pBuffer->events[i] };
+                fputs(bFirst ? "" : ",\n", pFile);
+                bFirst = false;
+
+                // Chrome trace timestamps are in microseconds
+                if (event.type == ProfileEventType::Zone)
+                {
+                    fputs("{\"ph\":\"X\",\"name\":", pFile);
+                    WriteJsonString(pFile, event.name);
+                    fprintf(pFile, ",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", pBuffer->threadId,
+                        double(event.startNs) / 1000.0, double(event.endNs - event.startNs) / 1000.0);
+                }
+                else
+                {
+                    fputs("{\"ph\":\"C\",\"name\":", pFile);
+                    WriteJsonString(pFile, event.name);
+                    fprintf(pFile, ",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"args\":{\"value\":%f}}", pBuffer->threadId,
+                        double(event.startNs) / 1000.0, event.value);
+                }
+            }
+
+            eventCount += count;
+            droppedCount += pBuffer->droppedCount.load(std::memory_order_relaxed);
+        }
+
+        fputs("\n]}\n", pFile);
+        file.Close();
+
+        if (droppedCount)
+        {
+            BLIT_WARN("CPU profiler buffers were full, %u events were dropped", droppedCount);
+        }
+        BLIT_INFO("CPU trace with %u events written to %s", eventCount, filepath);
+
+        return true;
+    }
+}
+#endif
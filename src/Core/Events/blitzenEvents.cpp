@@ -1,4 +1,5 @@
 #include "blitEvents.h"
+#include "Core/DbLog/blitProfiler.h"
 
 namespace BlitzenCore
 {
@@ -281,6 +282,15 @@ namespace BlitzenCore
         return BlitEventType::MaxTypes;
     }
 
+#if defined(BLIT_CPU_PROFILER)
+    static BlitEventType WriteCpuTraceOnF2ReleaseCallback(BlitzenWorld::BlitzenWorldContext& blitzenContext)
+    {
+        BLIT_PROFILE_WRITE_TRACE(Ce_ProfilerTracePath);
+
+        return BlitEventType::MaxTypes;
+    }
+#endif
+
     static BlitEventType ChangePyramidLevelOnF3ReleaseCallback(BlitzenWorld::BlitzenWorldContext& blitzenContext)
     {
         auto& camera{ blitzenContext.pCameraContainer->GetMainCamera() };
@@ -386,6 +396,10 @@ namespace BlitzenCore
 
         BlitzenCore::RegisterKeyReleaseCallback(pEvents, BlitzenCore::BlitKey::__F1, FreezeFrustumOnF1KeyPressCallback);
 
+    #if defined(BLIT_CPU_PROFILER)
+        BlitzenCore::RegisterKeyReleaseCallback(pEvents, BlitzenCore::BlitKey::__F2, WriteCpuTraceOnF2ReleaseCallback);
+    #endif
+
         BlitzenCore::RegisterKeyReleaseCallback(pEvents, BlitzenCore::BlitKey::__F3, ChangePyramidLevelOnF3ReleaseCallback);
 
         BlitzenCore::RegisterKeyReleaseCallback(pEvents, BlitzenCore::BlitKey::__F4, DecreasePyramidLevelOnF4ReleaseCallback);
@@ -0,0 +1,63 @@
+#pragma once
+#include "Core/blitzenEngine.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+namespace BlitzenCore
+{
+    // Persistent worker threads for data parallel work (asset import, culling etc.)
+    class TaskPool
+    {
+    public:
+        // 0 picks one worker per hardware thread, minus the caller
+        TaskPool(uint32_t workerCount = 0);
+
+        ~TaskPool();
+
+        TaskPool(const TaskPool&) = delete;
+        TaskPool& operator = (const TaskPool&) = delete;
+
+        // Calls task(i) for every i in [0, taskCount). The caller works as well and the function returns when every task is done.
+        // Calls from inside a task run serially on the calling thread
+        void ParallelFor(size_t taskCount, const std::function<void(size_t)>& task);
+
+        // Same as ParallelFor, but runs every task on the calling thread instead of waiting while another thread's call has the workers
+        void TryParallelFor(size_t taskCount, const std::function<void(size_t)>& task);
+
+        // Workers plus the calling thread
+        inline uint32_t GetThreadCount() const { return m_workerCount + 1; }
+
+    private:
+
+        void WorkerLoop();
+
+        void RunTasks();
+
+        // Hands the tasks to the workers and joins them. The caller holds m_dispatchMutex
+        void Dispatch(size_t taskCount, const std::function<void(size_t)>& task);
+
+    private:
+
+        std::thread m_workers[Ce_MaxWorkerThreadCount];
+        uint32_t m_workerCount;
+
+        // Serializes ParallelFor calls from different threads
+        std::mutex m_dispatchMutex;
+
+        std::mutex m_mutex;
+        std::condition_variable m_wakeCondition;
+        std::condition_variable m_doneCondition;
+        uint64_t m_generation{ 0 };
+        uint32_t m_doneWorkerCount{ 0 };
+        bool m_bShutdown{ false };
+
+        const std::function<void(size_t)>* m_pTask{ nullptr };
+        size_t m_taskCount{ 0 };
+        std::atomic<size_t> m_nextTask{ 0 };
+    };
+
+    // Engine wide pool, created on first use
+    TaskPool& GetTaskPool();
+}
@@ -0,0 +1,151 @@
+#include "blitTaskPool.h"
+#include "Core/DbLog/blitProfiler.h"
+
+namespace BlitzenCore
+{
+    // Set for workers and for a caller that is executing tasks, so that nested ParallelFor calls do not deadlock
+    static thread_local bool tl_bInsideTaskPool = false;
+
+    TaskPool::TaskPool(uint32_t workerCount /*=0*/)
+    {
+        if (workerCount == 0)
+        {
+            auto hardwareThreads = std::thread::hardware_concurrency();
+            workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+        }
+        m_workerCount = workerCount < Ce_MaxWorkerThreadCount ? workerCount : Ce_MaxWorkerThreadCount;
+
+        for (uint32_t i = 0; i < m_workerCount; ++i)
+        {
+            m_workers[i] = std::thread{ [this]() { WorkerLoop(); } };
+        }
+    }
+
+    TaskPool::~TaskPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_bShutdown = true;
+        }
+        m_wakeCondition.notify_all();
+
+        for (uint32_t i = 0; i < m_workerCount; ++i)
+        {
+            if (m_workers[i].joinable())
+            {
+                m_workers[i].join();
+            }
+        }
+    }
+
+    void TaskPool::ParallelFor(size_t taskCount, const std::function<void(size_t)>& task)
+    {
+        if (taskCount == 0)
+        {
+            return;
+        }
+
+        // Not worth waking the workers
+        if (m_workerCount == 0 || taskCount == 1 || tl_bInsideTaskPool)
+        {
+            for (size_t i = 0; i < taskCount; ++i)
+            {
+                task(i);
+            }
+            return;
+        }
+
+        std::lock_guard<std::mutex> dispatchLock(m_dispatchMutex);
+        Dispatch(taskCount, task);
+    }
+
+    void TaskPool::TryParallelFor(size_t taskCount, const std::function<void(size_t)>& task)
+    {
+        // The caller of a nested call might hold the dispatch mutex already, so it is not tried then
+        std::unique_lock<std::mutex> dispatchLock(m_dispatchMutex, std::defer_lock);
+        if (m_workerCount == 0 || taskCount < 2 || tl_bInsideTaskPool || !dispatchLock.try_lock())
+        {
+            for (size_t i = 0; i < taskCount; ++i)
+            {
+                task(i);
+            }
+            return;
+        }
+
+        Dispatch(taskCount, task);
+    }
+
+    void TaskPool::Dispatch(size_t taskCount, const std::function<void(size_t)>& task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pTask = &task;
+            m_taskCount = taskCount;
+            m_nextTask = 0;
+            m_doneWorkerCount = 0;
+            ++m_generation;
+        }
+        m_wakeCondition.notify_all();
+
+        tl_bInsideTaskPool = true;
+        RunTasks();
+        tl_bInsideTaskPool = false;
+
+        // Every worker checks in, so none of them can still hold the task when the function returns
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_doneCondition.wait(lock, [this]() { return m_doneWorkerCount == m_workerCount; });
+        m_pTask = nullptr;
+    }
+
+    void TaskPool::WorkerLoop()
+    {
+        BLIT_PROFILE_THREAD_NAME("TaskPoolWorker");
+        tl_bInsideTaskPool = true;
+
+        uint64_t generation = 0;
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wakeCondition.wait(lock, [&]() { return m_bShutdown || m_generation != generation; });
+                if (m_bShutdown)
+                {
+                    return;
+                }
+                generation = m_generation;
+            }
+
+            {
+                BLIT_PROFILE_ZONE("RunTasks");
+                RunTasks();
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (++m_doneWorkerCount == m_workerCount)
+                {
+                    m_doneCondition.notify_one();
+                }
+            }
+        }
+    }
+
+    void TaskPool::RunTasks()
+    {
+        while (true)
+        {
+            auto taskId = m_nextTask.fetch_add(1);
+            if (taskId >= m_taskCount)
+            {
+                return;
+            }
+            (*m_pTask)(taskId);
+        }
+    }
+
+    TaskPool& GetTaskPool()
+    {
+        static TaskPool s_taskPool;
+        return s_taskPool;
+    }
+}
@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include <cstdint>
 #include <cstddef>
+#include <atomic>
 
 namespace BlitzenCore
 {
@@ -62,9 +63,23 @@ namespace BlitzenCore
 	constexpr const char* Ce_DefaultMaterialName = "BlitzenReindeerAlbedoMaterial";
 
     constexpr uint8_t Ce_MaxLodCountPerSurface = 8;
-    constexpr uint32_t Ce_MaxInstanceCountPerLOD = 100'000;
     constexpr uint32_t Ce_MaxInstanceCountPerCluster = 100'000;
 
+    // Mesh processing parameters (any change here invalidates cooked mesh files)
+    constexpr double Ce_LodIndexReduction = 0.65;
+    constexpr float Ce_LodMaxError = 1e-1f;
+    constexpr uint32_t Ce_ClusterMaxVertices = 64;
+    constexpr uint32_t Ce_ClusterMaxTriangles = 124;
+    constexpr float Ce_ClusterConeWeight = 0.25f;
+    // Cluster DAG: neighbouring clusters are merged in groups and simplified to half, until a level stops reducing
+    constexpr uint32_t Ce_ClusterGroupSize = 8;
+    constexpr double Ce_ClusterGroupMinReduction = 0.85;
+
+    // Cooked mesh cache, written next to the source file
+    constexpr const char* Ce_CookedMeshExtension = ".blitmesh";
+    constexpr uint32_t Ce_CookedMeshMagic = 0x48534D42;// "BMSH"
+    constexpr uint32_t Ce_CookedMeshVersion = 4;
+
     constexpr uint32_t Ce_MaxMeshCount = 1'000'000; 
 	constexpr const char* Ce_DefaultMeshName = "bunny";
 
@@ -72,11 +87,13 @@ namespace BlitzenCore
     constexpr uint32_t Ce_MaxTransparentRenderObjects = 100'000;
     constexpr uint32_t Ce_MaxONPC_Objects = 100;
     constexpr uint32_t Ce_MaxDynamicObjectCount = 1'000;
+    // Static render objects per leaf of the render object BVH
+    constexpr uint32_t Ce_BvhMaxLeafObjects = 64;
 
     #if defined(BLIT_DYNAMIC_OBJECT_TEST)
         constexpr uint8_t Ce_LoadDynamicObjectTest = 1;
     #else
-	    consterxpr uint8_t Ce_LoadDynamicObjectTest = 0;
+	    constexpr uint8_t Ce_LoadDynamicObjectTest = 0;
     #endif
 
     #ifdef BLITZEN_CLUSTER_CULLING
@@ -85,12 +102,25 @@ namespace BlitzenCore
         constexpr uint8_t Ce_BuildClusters = 0;
     #endif
 
+    // The LOD index stream is skipped when only the Vulkan cluster path reads geometry (DX12, GL and RT still need it)
+    #if defined(BLITZEN_CLUSTER_CULLING) && !defined(BLIT_RAYTRACING) && (!defined(_WIN32) || defined(BLIT_VK_FORCE))
+        constexpr uint8_t Ce_BuildLodIndices = 0;
+    #else
+        constexpr uint8_t Ce_BuildLodIndices = 1;
+    #endif
+
     #ifdef BLITZEN_DRAW_INSTANCED_CULLING
         constexpr uint8_t Ce_InstanceCulling = 1;
     #else
         constexpr uint8_t Ce_InstanceCulling = 0;
     #endif
 
+    #if defined(BLIT_COMPACT_VERTICES)
+        constexpr uint8_t Ce_CompactVertices = 1;
+    #else
+        constexpr uint8_t Ce_CompactVertices = 0;
+    #endif
+
     #if defined(BLIT_DEPTH_PYRAMID_TEST)
         constexpr uint32_t Ce_DepthPyramidDebug = 1;
     #else
@@ -115,6 +145,19 @@ namespace BlitzenCore
 
     constexpr uint32_t Ce_WorldContextSystemsCount = 5;
 
+    // Upper bound for task pool worker threads (the calling thread always helps as well)
+    constexpr uint32_t Ce_MaxWorkerThreadCount = 63;
+
+    // Render objects per task of the CPU culling engine
+    constexpr uint32_t Ce_CpuCullingBatchSize = 16'384;
+
+    // CPU software occlusion: depth buffer size, occluder selection (screen size relative to the view height) and triangle budget
+    constexpr uint32_t Ce_SoftwareOcclusionWidth = 256;
+    constexpr uint32_t Ce_SoftwareOcclusionHeight = 128;
+    constexpr uint32_t Ce_MaxSoftwareOccluders = 64;
+    constexpr float Ce_SoftwareOccluderMinScreenSize = 0.1f;
+    constexpr uint32_t Ce_SoftwareOcclusionTriangleBudget = 100'000;
+
     enum class AllocationType : uint8_t
     {
         DynamicArray = 0,
@@ -146,8 +189,9 @@ namespace BlitzenCore
 
     inline void LogAllocation(AllocationType alloc, size_t size, AllocationAction action)
     {
-        static size_t totalAllocated{ 0 };
-        static size_t typeAllocations[size_t(AllocationType::MaxTypes)]{ 0 };
+        // Atomic, containers are also allocated by task pool workers
+        static std::atomic<size_t> totalAllocated{ 0 };
+        static std::atomic<size_t> typeAllocations[size_t(AllocationType::MaxTypes)]{};
 
         if (action == AllocationAction::ALLOC)
         {
@@ -161,7 +205,12 @@ namespace BlitzenCore
         }
         else if (action == AllocationAction::FREE_ALL)
         {
-            ShutdownLogging(totalAllocated, typeAllocations);
+            size_t typeTotals[size_t(AllocationType::MaxTypes)]{ 0 };
+            for (size_t i = 0; i < size_t(AllocationType::MaxTypes); ++i)
+            {
+                typeTotals[i] = typeAllocations[i];
+            }
+            ShutdownLogging(totalAllocated, typeTotals);
         }
     }
 
@@ -3,11 +3,13 @@
 #include "Core/Events/blitEvents.h"
 #include "Platform/blitPlatformContext.h"
 #include "Platform/blitPlatform.h"
+#include "Core/DbLog/blitProfiler.h"
+#include "Game/blitBenchmark.h"
 #include <thread>
-#include <mutex>
-#include <condition_variable>
-#include <atomic>
+#include <chrono>
 #include <iostream>
+#include <cstring>
+#include <cstdlib>
 
 using EventSystemMemory = BlitCL::SmartPointer<BlitzenCore::EventSystem>;
 using RndResourcesMemory = BlitCL::SmartPointer<BlitzenEngine::RenderingResources, BlitzenCore::AllocationType::Renderer>;
@@ -15,6 +17,83 @@ using EntitySystemMemory = BlitCL::SmartPointer<BlitzenCore::EntityManager, Blit
 
 
 #if defined(BLIT_GDEV_EDT)
+constexpr uint32_t Ce_DefaultHeadlessFrameCount = 100;
+
+struct RunArguments
+{
+    uint8_t bHeadless{ 0 };
+    uint32_t frameCount{ 0 };
+    const char* readbackPath{ nullptr };
+    const char* gpuTimingsPath{ nullptr };
+    uint8_t framesInFlight{ 0 };
+
+    const char* benchmarkPath{ nullptr };
+    const char* benchmarkReportPath{ BlitzenEngine::Ce_BenchmarkReportPath };
+    const char* recordCameraPath{ nullptr };
+};
+
+// Run options are removed, so that scene creation sees the usual arguments.
+// --benchmark <path file> [--benchmark-report <file.json>] and --record-camera <path file> on every platform,
+// --headless <frames>, --readback <file.ppm>, --gpu-timings <file.csv> and --frames-in-flight <n> on linux
+static void ParseRunArguments(int& argc, char** argv, RunArguments& args)
+{
+    int keptCount = 1;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--benchmark") && i + 1 < argc)
+        {
+            args.benchmarkPath = argv[++i];
+            continue;
+        }
+
+        if (!strcmp(argv[i], "--benchmark-report") && i + 1 < argc)
+        {
+            args.benchmarkReportPath = argv[++i];
+            continue;
+        }
+
+        if (!strcmp(argv[i], "--record-camera") && i + 1 < argc)
+        {
+            args.recordCameraPath = argv[++i];
+            continue;
+        }
+
+        #if defined(linux)
+        if (!strcmp(argv[i], "--headless"))
+        {
+            args.bHeadless = 1;
+            args.frameCount = (i + 1 < argc) ? uint32_t(strtoul(argv[++i], nullptr, 10)) : 0;
+            if (!args.frameCount)
+            {
+                args.frameCount = Ce_DefaultHeadlessFrameCount;
+            }
+            continue;
+        }
+
+        if (!strcmp(argv[i], "--readback") && i + 1 < argc)
+        {
+            args.readbackPath = argv[++i];
+            continue;
+        }
+
+        if (!strcmp(argv[i], "--gpu-timings") && i + 1 < argc)
+        {
+            args.gpuTimingsPath = argv[++i];
+            continue;
+        }
+
+        if (!strcmp(argv[i], "--frames-in-flight") && i + 1 < argc)
+        {
+            args.framesInFlight = uint8_t(strtoul(argv[++i], nullptr, 10));
+            continue;
+        }
+        #endif
+
+        argv[keptCount++] = argv[i];
+    }
+    argc = keptCount;
+}
+
 int main(int argc, char* argv[])
 {
     /* ENGINE SYSTEMS INITIALIZATION */
@@ -27,6 +106,10 @@ int main(int argc, char* argv[])
 	blitzenPrivateContext.pBlitzenContext = &blitzenWorldContext;
 
     BlitzenCore::InitLogging();
+    BLIT_PROFILE_THREAD_NAME("Main");
+
+    RunArguments runArgs{};
+    ParseRunArguments(argc, argv, runArgs);
 
     blitzenPrivateContext.pEngineState = &engine.m_state;
 
@@ -41,6 +124,12 @@ int main(int argc, char* argv[])
     BlitzenEngine::Renderer renderer;
     renderer.Make();
     blitzenPrivateContext.pRenderer = renderer.Data();
+    #if defined(linux)
+    if (runArgs.framesInFlight)
+    {
+        renderer->SetFramesInFlight(runArgs.framesInFlight);
+    }
+    #endif
 
     EntitySystemMemory entityManager;
     entityManager.Make();
@@ -55,7 +144,17 @@ int main(int argc, char* argv[])
 
     // Platform preferably created last and destroyed first
     BlitzenPlatform::PlatformContext platform{};
-    BLIT_ASSERT(BlitzenPlatform::PlatformStartup(BlitzenCore::Ce_BlitzenVersion, &platform, eventSystem.Data(), renderer.Data()));
+    #if defined(linux)
+    if (runArgs.bHeadless)
+    {
+        BLIT_ASSERT(BlitzenPlatform::PlatformStartupHeadless(&platform, eventSystem.Data(), renderer.Data(), 
+            BlitzenCore::Ce_InitialWindowWidth, BlitzenCore::Ce_InitialWindowHeight));
+    }
+    else
+    #endif
+    {
+        BLIT_ASSERT(BlitzenPlatform::PlatformStartup(BlitzenCore::Ce_BlitzenVersion, &platform, eventSystem.Data(), renderer.Data()));
+    }
 
     BlitzenCore::RegisterDefaultEvents(eventSystem.Data());
 
@@ -65,50 +164,52 @@ int main(int argc, char* argv[])
 
 
     // LOADING RESOURCES
-    std::mutex mtx;
-    std::condition_variable loadingDoneConditional;
-    std::atomic<bool> loadingDone(false);
+    // The scene is loaded and uploaded on its own thread, while this one keeps drawing the loading screen, 
+    // and then the scene batches that are ready
+    BlitzenEngine::SceneLoadingState sceneLoading;
     std::thread loadingThread
     {   [&]() 
         {
-             std::lock_guard<std::mutex> lock(mtx);
+            BLIT_PROFILE_THREAD_NAME("Loading");
+            BLIT_PROFILE_ZONE("LoadScene");
 
-            if (!BlitzenEngine::CreateSceneFromArguments(argc, argv, renderingResources.Data(), renderer.Data(), entityManager.Data()))
-            {
-                BLIT_FATAL("Failed to allocate resource for requested scene");
-                loadingDone = true;
-                loadingDoneConditional.notify_one();
-                return;
-            }
-            // Updates renderer
-            if (!renderer->SetupForRendering(drawContext))
+            if (!BlitzenEngine::CreateSceneFromArguments(argc, argv, renderingResources.Data(), renderer.Data(), entityManager.Data(), 
+                drawContext, sceneLoading))
             {
-                BLIT_FATAL("Renderer failed to setup, Blitzen's rendering system is offline");
-                loadingDone = true;
-                loadingDoneConditional.notify_one();
-                return;
+                BLIT_FATAL("Failed to load the requested scene, Blitzen's rendering system is offline");
+                sceneLoading.bFailed = true;
             }
-
-            loadingDone = true;
-            loadingDoneConditional.notify_one();
-            engine.m_state = BlitzenCore::EngineState::RUNNING;
+            sceneLoading.bLoadingDone = true;
         }
     };
 
-    #if(_WIN32)
-        loadingThread.detach();
-    #else
-        loadingThread.join();
+    // Benchmark and headless runs measure the whole scene, so they wait for all of it
+    auto bWaitForWholeScene{ runArgs.benchmarkPath != nullptr };
+    #if defined(linux)
+    bWaitForWholeScene = bWaitForWholeScene || runArgs.bHeadless;
     #endif
 
-    // Placeholder loop, waiting to load
-    while (engine.m_state == BlitzenCore::EngineState::LOADING)
+    // Placeholder loop, waiting for the first part of the scene
+    while (!sceneLoading.bLoadingDone && (bWaitForWholeScene || !sceneLoading.bSceneReady) && engine.m_state == BlitzenCore::EngineState::LOADING)
     {
         BlitzenCore::UpdateWorldClock(coreClock);
 
         BlitzenPlatform::DispatchEvents(&platform);
         eventSystem->UpdateInput(0.f);
         renderer->DrawWhileWaiting(float(coreClock.m_deltaTime));
+
+        #if defined(linux)
+        // Nothing is drawn without a window, the loading thread gets the core
+        if (runArgs.bHeadless)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        #endif
+    }
+
+    if (sceneLoading.bSceneReady && !sceneLoading.bFailed && engine.m_state == BlitzenCore::EngineState::LOADING)
+    {
+        engine.m_state = BlitzenCore::EngineState::RUNNING;
     }
 
     // Extra setup step needed by dx12
@@ -117,24 +218,126 @@ int main(int argc, char* argv[])
         renderer->FinalSetup();
     }
 
+    #if defined(linux)
+        uint32_t headlessFramesDrawn{ 0 };
+        double headlessStartTime{ coreClock.m_elapsedTime };
+    #endif
+
+    // Benchmark runs replay a camera path with a fixed timestep and end with the path
+    BlitzenEngine::CameraPath benchmarkPath;
+    BlitzenEngine::BenchmarkRun benchmarkRun;
+    uint32_t benchmarkFrame{ 0 };
+    uint8_t bBenchmark{ 0 };
+    if (runArgs.benchmarkPath)
+    {
+        if (!BlitzenEngine::LoadCameraPath(benchmarkPath, runArgs.benchmarkPath))
+        {
+            BLIT_ERROR("Benchmark camera path could not be loaded");
+            engine.m_state = BlitzenCore::EngineState::SHUTDOWN;
+        }
+        else
+        {
+            bBenchmark = 1;
+            benchmarkRun.frames.Reserve(benchmarkPath.frameCount);
+        }
+    }
+    BlitCL::DynamicArray<BlitzenEngine::CameraKeyframe> recordedCameraPath;
+
     // MAIN LOOP
     while(engine.m_state == BlitzenCore::EngineState::RUNNING || engine.m_state == BlitzenCore::EngineState::SUSPENDED)
     {
-        if(!BlitzenPlatform::DispatchEvents(&platform))
+        BLIT_PROFILE_ZONE("Frame");
+
+        #if defined(linux)
+        // Headless runs draw a fixed number of frames, the last one may be read back
+        if (runArgs.bHeadless)
+        {
+            if (headlessFramesDrawn == runArgs.frameCount)
+            {
+                engine.m_state = BlitzenCore::EngineState::SHUTDOWN;
+                break;
+            }
+            if (runArgs.readbackPath && headlessFramesDrawn + 1 == runArgs.frameCount)
+            {
+                renderer->RequestColorReadback();
+            }
+            ++headlessFramesDrawn;
+        }
+        #endif
+
+        if (bBenchmark && benchmarkFrame == BlitzenEngine::Ce_BenchmarkWarmupFrames + benchmarkPath.frameCount)
         {
             engine.m_state = BlitzenCore::EngineState::SHUTDOWN;
+            break;
+        }
+
+        // A gltf file that failed after the first batch takes the engine down, same as a failure before it
+        if (sceneLoading.bFailed)
+        {
+            engine.m_state = BlitzenCore::EngineState::SHUTDOWN;
+            break;
+        }
+        auto frameStartTime{ BlitzenPlatform::PlatformGetAbsoluteTime(coreClock.m_clockFrequency) };
+
+        {
+            BLIT_PROFILE_ZONE("DispatchEvents");
+            if(!BlitzenPlatform::DispatchEvents(&platform))
+            {
+                engine.m_state = BlitzenCore::EngineState::SHUTDOWN;
+            }
         }
 
         if(engine.m_state != BlitzenCore::EngineState::SUSPENDED)
         {
             BlitzenCore::UpdateWorldClock(coreClock);
+            BLIT_PROFILE_COUNTER("FrameTimeMs", coreClock.m_deltaTime * 1000.0);
 
-            BlitzenEngine::UpdateCamera(mainCamera, float(coreClock.m_deltaTime));
+            {
+                BLIT_PROFILE_ZONE("UpdateCamera");
+                if (bBenchmark)
+                {
+                    // The world moves by the fixed step and the camera follows the path by frame index, not by time
+                    coreClock.m_deltaTime = BlitzenEngine::Ce_BenchmarkTimestep;
+                    auto pathFrame{ benchmarkFrame > BlitzenEngine::Ce_BenchmarkWarmupFrames ? benchmarkFrame - BlitzenEngine::Ce_BenchmarkWarmupFrames : 0 };
+                    auto key{ BlitzenEngine::SampleCameraPath(benchmarkPath, pathFrame) };
+                    BlitzenEngine::SetCameraTransform(mainCamera, key.position, key.yawRotation, key.pitchRotation);
+                }
+                else
+                {
+                    BlitzenEngine::UpdateCamera(mainCamera, float(coreClock.m_deltaTime));
+                }
+            }
 
-			BlitzenEngine::UpdateDynamicObjects(renderer.Data(), entityManager.Data(), blitzenWorldContext);
+            {
+                BLIT_PROFILE_ZONE("UpdateDynamicObjects");
+			    BlitzenEngine::UpdateDynamicObjects(renderer.Data(), entityManager.Data(), blitzenWorldContext);
+            }
             
-            renderer->Update(drawContext);
-            renderer->DrawFrame(drawContext);
+            {
+                BLIT_PROFILE_ZONE("RendererUpdate");
+                renderer->Update(drawContext);
+            }
+
+            {
+                BLIT_PROFILE_ZONE("DrawFrame");
+                renderer->DrawFrame(drawContext);
+            }
+
+            if (bBenchmark)
+            {
+                if (benchmarkFrame >= BlitzenEngine::Ce_BenchmarkWarmupFrames)
+                {
+                    auto frameMs{ (BlitzenPlatform::PlatformGetAbsoluteTime(coreClock.m_clockFrequency) - frameStartTime) * 1000.0 };
+                    BlitzenEngine::RecordBenchmarkFrame(benchmarkRun, float(frameMs), mainCamera.viewData, renderingResources->m_meshContext,
+                        entityManager->m_renderContainer);
+                }
+                ++benchmarkFrame;
+            }
+
+            if (runArgs.recordCameraPath)
+            {
+                recordedCameraPath.PushBack(BlitzenEngine::GetCameraKeyframe(mainCamera));
+            }
         }
 
         // Reset window resize, TODO: Why is this here??????
@@ -143,9 +346,41 @@ int main(int argc, char* argv[])
         eventSystem->UpdateInput(coreClock.m_deltaTime);
     }
 
+    // Closing the window while loading still waits, the loading thread writes to the resources that are about to be destroyed
+    sceneLoading.bCancel = true;
+    loadingThread.join();
+
+    if (bBenchmark)
+    {
+        BlitzenEngine::WriteBenchmarkReport(benchmarkRun, runArgs.benchmarkPath, runArgs.benchmarkReportPath);
+    }
+
+    if (runArgs.recordCameraPath)
+    {
+        BlitzenEngine::WriteCameraPath(recordedCameraPath, runArgs.recordCameraPath);
+    }
+
+    #if defined(linux)
+    if (runArgs.bHeadless && headlessFramesDrawn)
+    {
+        double headlessTime{ coreClock.m_elapsedTime - headlessStartTime };
+        BLIT_INFO("Headless: %u frames in %f s, %f ms per frame", headlessFramesDrawn, headlessTime, 
+            headlessTime * 1000.0 / double(headlessFramesDrawn));
+
+        if (runArgs.readbackPath)
+        {
+            renderer->WriteColorReadback(runArgs.readbackPath);
+        }
+    }
+
+    if (runArgs.gpuTimingsPath)
+    {
+        renderer->WriteGpuTimingsCsv(runArgs.gpuTimingsPath);
+    }
+    #endif
+
 
-    std::unique_lock<std::mutex> lock(mtx);
-    loadingDoneConditional.wait(lock, [&] { return loadingDone.load(); });
+    BLIT_PROFILE_WRITE_TRACE(BlitzenCore::Ce_ProfilerTracePath);
 }
 #else
 // this was supposed to test my string but I have forgotten about it
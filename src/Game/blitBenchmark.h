@@ -0,0 +1,69 @@
+#pragma once
+#include "blitCamera.h"
+#include "BlitCL/DynamicArray.h"
+#include "Renderer/Resources/Culling/blitCulling.h"
+
+namespace BlitzenEngine
+{
+    // Benchmark runs step the world with this delta time, so that dynamic objects move the same way every run
+    constexpr double Ce_BenchmarkTimestep = 1.0 / 60.0;
+    // The camera holds the first keyframe for these frames, they are left out of the report
+    constexpr uint32_t Ce_BenchmarkWarmupFrames = 16;
+    constexpr const char* Ce_BenchmarkReportPath = "BlitzenBenchmark.json";
+
+    struct CameraKeyframe
+    {
+        BlitML::vec3 position{ 0.f };
+        float yawRotation{ 0.f };
+        float pitchRotation{ 0.f };
+    };
+
+    // Text file. A recorded path starts with "frames <count>" and has one keyframe per frame.
+    // A spline path starts with "spline <frameCount> <pointCount>", its keyframes are Catmull-Rom control points spread over the frames.
+    // Every keyframe line is "x y z yaw pitch"
+    struct CameraPath
+    {
+        BlitCL::DynamicArray<CameraKeyframe> keyframes;
+        uint32_t frameCount{ 0 };
+        uint8_t bSpline{ 0 };
+    };
+
+    bool LoadCameraPath(CameraPath& path, const char* filepath);
+
+    bool WriteCameraPath(const BlitCL::DynamicArray<CameraKeyframe>& keyframes, const char* filepath);
+
+    inline CameraKeyframe GetCameraKeyframe(const Camera& camera)
+    {
+        return { camera.viewData.position, camera.transformData.yawRotation, camera.transformData.pitchRotation };
+    }
+
+    CameraKeyframe SampleCameraPath(const CameraPath& path, uint32_t frame);
+
+    struct BenchmarkFrame
+    {
+        float frameMs;
+        uint32_t drawCount;
+        uint32_t culledCount;
+    };
+
+    struct BenchmarkRun
+    {
+        BlitCL::DynamicArray<BenchmarkFrame> frames;
+
+        // Sum over all frames of the visible objects per LOD
+        uint64_t lodHistogram[BlitzenCore::Ce_MaxLodCountPerSurface]{};
+
+        uint32_t renderCount{ 0 };
+
+        // Reused by the per frame CPU cull that produces the draw and culled counts
+        BlitCL::DynamicArray<IndirectDraw> draws;
+    };
+
+    // Draw and culled counts come from the CPU version of the draw cull (frustum and LOD selection, no occlusion),
+    // so they are the same for every backend
+    void RecordBenchmarkFrame(BenchmarkRun& run, float frameMs, const CameraViewData& view, const SurfaceResources& surfaces,
+        const RenderContainer& renders);
+
+    // JSON with frame time percentiles, draw and culled counts
+    bool WriteBenchmarkReport(BenchmarkRun& run, const char* pathName, const char* filepath);
+}
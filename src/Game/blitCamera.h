@@ -106,6 +106,9 @@ namespace BlitzenEngine
     // Camera rotation with quats
     void RotateCamera(Camera& camera, float deltaTime, float pitchRotation, float yawRotation);
 
+    // Places the camera directly (camera path playback), bypassing velocity and input
+    void SetCameraTransform(Camera& camera, const BlitML::vec3& position, float yawRotation, float pitchRotation);
+
     // Updates the projection matrix when necessary
     void UpdateProjection(Camera& camera, float newWidth, float newHeight);
 
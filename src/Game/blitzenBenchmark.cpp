@@ -0,0 +1,218 @@
+#include "blitBenchmark.h"
+#include "Platform/Filesystem/blitCFILE.h"
+#include <algorithm>
+#include <cstring>
+
+namespace BlitzenEngine
+{
+    bool LoadCameraPath(CameraPath& path, const char* filepath)
+    {
+        BlitzenPlatform::C_FILE_SCOPE file;
+        if (!file.Open(filepath, BlitzenPlatform::FileModes::Read, 0))
+        {
+            BLIT_ERROR("Failed to open camera path %s", filepath);
+            return false;
+        }
+
+        char type[16]{};
+        uint32_t frameCount{ 0 };
+        uint32_t pointCount{ 0 };
+        if (fscanf(file.m_pHandle, "%15s %u", type, &frameCount) != 2 || !frameCount)
+        {
+            BLIT_ERROR("Camera path %s has no header", filepath);
+            return false;
+        }
+
+        if (!strcmp(type, "frames"))
+        {
+            path.bSpline = 0;
+            pointCount = frameCount;
+        }
+        else if (!strcmp(type, "spline"))
+        {
+            path.bSpline = 1;
+            if (fscanf(file.m_pHandle, "%u", &pointCount) != 1 || pointCount < 2)
+            {
+                BLIT_ERROR("Camera spline %s needs at least 2 control points", filepath);
+                return false;
+            }
+        }
+        else
+        {
+            BLIT_ERROR("Unknown camera path type %s in %s", type, filepath);
+            return false;
+        }
+
+        path.frameCount = frameCount;
+        path.keyframes.Resize(pointCount);
+        for (uint32_t i = 0; i < pointCount; ++i)
+        {
+            auto& key{ path.keyframes[i] };
+            if (fscanf(file.m_pHandle, "%f %f %f %f %f", &key.position.x, &key.position.y, &key.position.z,
+                &key.yawRotation, &key.pitchRotation) != 5)
+            {
+                BLIT_ERROR("Camera path %s ends at keyframe %u of %u", filepath, i, pointCount);
+                return false;
+            }
+        }
+
+        BLIT_INFO("Camera path %s: %u frames, %u keyframes", filepath, frameCount, pointCount);
+        return true;
+    }
+
+    bool WriteCameraPath(const BlitCL::DynamicArray<CameraKeyframe>& keyframes, const char* filepath)
+    {
+        BlitzenPlatform::C_FILE_SCOPE file;
+        if (!file.Open(filepath, BlitzenPlatform::FileModes::Write, 0))
+        {
+            BLIT_ERROR("Failed to open %s to record the camera path", filepath);
+            return false;
+        }
+
+        fprintf(file.m_pHandle, "frames %u\n", uint32_t(keyframes.GetSize()));
+        for (const auto& key : keyframes)
+        {
+            fprintf(file.m_pHandle, "%.9g %.9g %.9g %.9g %.9g\n", key.position.x, key.position.y, key.position.z,
+                key.yawRotation, key.pitchRotation);
+        }
+
+        BLIT_INFO("Camera path with %u frames recorded to %s", uint32_t(keyframes.GetSize()), filepath);
+        return true;
+    }
+
+    static float CatmullRom(float p0, float p1, float p2, float p3, float t)
+    {
+        auto t2{ t * t };
+        auto t3{ t2 * t };
+        return 0.5f * ((2.f * p1) + (p2 - p0) * t + (2.f * p0 - 5.f * p1 + 4.f * p2 - p3) * t2 + (3.f * p1 - p0 - 3.f * p2 + p3) * t3);
+    }
+
+    CameraKeyframe SampleCameraPath(const CameraPath& path, uint32_t frame)
+    {
+        auto lastKey{ uint32_t(path.keyframes.GetSize()) - 1 };
+        if (!path.bSpline)
+        {
+            return path.keyframes[frame < lastKey ? frame : lastKey];
+        }
+
+        // Frames are spread evenly over the segments, the end points are repeated for the outer tangents
+        auto t{ path.frameCount > 1 ? float(frame) * float(lastKey) / float(path.frameCount - 1) : 0.f };
+        auto segment{ uint32_t(t) < lastKey ? uint32_t(t) : lastKey - 1 };
+        auto u{ t - float(segment) };
+
+        const auto& k0{ path.keyframes[segment ? segment - 1 : 0] };
+        const auto& k1{ path.keyframes[segment] };
+        const auto& k2{ path.keyframes[segment + 1] };
+        const auto& k3{ path.keyframes[segment + 2 <= lastKey ? segment + 2 : lastKey] };
+
+        CameraKeyframe res;
+        res.position.x = CatmullRom(k0.position.x, k1.position.x, k2.position.x, k3.position.x, u);
+        res.position.y = CatmullRom(k0.position.y, k1.position.y, k2.position.y, k3.position.y, u);
+        res.position.z = CatmullRom(k0.position.z, k1.position.z, k2.position.z, k3.position.z, u);
+        res.yawRotation = CatmullRom(k0.yawRotation, k1.yawRotation, k2.yawRotation, k3.yawRotation, u);
+        res.pitchRotation = CatmullRom(k0.pitchRotation, k1.pitchRotation, k2.pitchRotation, k3.pitchRotation, u);
+        return res;
+    }
+
+    void RecordBenchmarkFrame(BenchmarkRun& run, float frameMs, const CameraViewData& view, const SurfaceResources& surfaces,
+        const RenderContainer& renders)
+    {
+        CullingStats stats{};
+        auto drawCount{ CullRenderContainer(view, surfaces, renders, run.draws, &stats) };
+
+        run.frames.PushBack({ frameMs, drawCount, renders.m_renderCount - drawCount });
+        for (uint32_t i = 0; i < BlitzenCore::Ce_MaxLodCountPerSurface; ++i)
+        {
+            run.lodHistogram[i] += stats.lodHistogram[i];
+        }
+        run.renderCount = renders.m_renderCount;
+    }
+
+    // Nearest rank percentile of sorted values
+    static float Percentile(const BlitCL::DynamicArray<float>& sorted, uint32_t percent)
+    {
+        auto rank{ (sorted.GetSize() * percent + 99) / 100 };
+        return sorted[rank ? rank - 1 : 0];
+    }
+
+    static void WriteCountStats(FILE* pFile, const char* name, const BlitCL::DynamicArray<BenchmarkFrame>& frames, uint32_t BenchmarkFrame::* pCount)
+    {
+        uint32_t minCount{ UINT32_MAX };
+        uint32_t maxCount{ 0 };
+        uint64_t sum{ 0 };
+        for (const auto& frame : frames)
+        {
+            auto count{ frame.*pCount };
+            minCount = count < minCount ? count : minCount;
+            maxCount = count > maxCount ? count : maxCount;
+            sum += count;
+        }
+
+        fprintf(pFile, "  \"%s\": { \"min\": %u, \"avg\": %.2f, \"max\": %u },\n", name, minCount,
+            double(sum) / double(frames.GetSize()), maxCount);
+    }
+
+    // Windows paths have backslashes
+    static void WriteJsonString(FILE* pFile, const char* str)
+    {
+        fputc('"', pFile);
+        for (; *str; ++str)
+        {
+            if (*str == '"' || *str == '\\')
+            {
+                fputc('\\', pFile);
+            }
+            fputc(*str, pFile);
+        }
+        fputc('"', pFile);
+    }
+
+    bool WriteBenchmarkReport(BenchmarkRun& run, const char* pathName, const char* filepath)
+    {
+        if (!run.frames.GetSize())
+        {
+            BLIT_ERROR("Benchmark run has no frames, no report written");
+            return false;
+        }
+
+        BlitCL::DynamicArray<float> frameTimes{ run.frames.GetSize() };
+        double frameTimeSum{ 0.0 };
+        for (size_t i = 0; i < run.frames.GetSize(); ++i)
+        {
+            frameTimes[i] = run.frames[i].frameMs;
+            frameTimeSum += run.frames[i].frameMs;
+        }
+        std::sort(frameTimes.Data(), frameTimes.Data() + frameTimes.GetSize());
+
+        BlitzenPlatform::C_FILE_SCOPE file;
+        if (!file.Open(filepath, BlitzenPlatform::FileModes::Write, 0))
+        {
+            BLIT_ERROR("Failed to open %s for the benchmark report", filepath);
+            return false;
+        }
+        auto pFile{ file.m_pHandle };
+
+        fputs("{\n  \"path\": ", pFile);
+        WriteJsonString(pFile, pathName);
+        fprintf(pFile, ",\n  \"frames\": %u,\n  \"warmupFrames\": %u,\n  \"timestepMs\": %.4f,\n  \"renderObjects\": %u,\n",
+            uint32_t(run.frames.GetSize()), Ce_BenchmarkWarmupFrames, Ce_BenchmarkTimestep * 1000.0, run.renderCount);
+
+        fprintf(pFile, "  \"frameTimeMs\": { \"min\": %.4f, \"avg\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f },\n",
+            frameTimes[0], frameTimeSum / double(frameTimes.GetSize()), Percentile(frameTimes, 50), Percentile(frameTimes, 90),
+            Percentile(frameTimes, 95), Percentile(frameTimes, 99), frameTimes[frameTimes.GetSize() - 1]);
+
+        WriteCountStats(pFile, "draws", run.frames, &BenchmarkFrame::drawCount);
+        WriteCountStats(pFile, "culled", run.frames, &BenchmarkFrame::culledCount);
+
+        fputs("  \"lodHistogram\": [", pFile);
+        for (uint32_t i = 0; i < BlitzenCore::Ce_MaxLodCountPerSurface; ++i)
+        {
+            fprintf(pFile, "%s%llu", i ? ", " : "", (unsigned long long)run.lodHistogram[i]);
+        }
+        fputs("]\n}\n", pFile);
+
+        BLIT_INFO("Benchmark: %u frames, %.4f ms average, %.4f ms p99. Report written to %s", uint32_t(run.frames.GetSize()),
+            frameTimeSum / double(frameTimes.GetSize()), Percentile(frameTimes, 99), filepath);
+        return true;
+    }
+}
@@ -90,6 +90,20 @@ namespace BlitzenEngine
         CreateRotationMatrixFromPitchAndYawQuaternion(pitchOrientation, yawOrientation, camera.transformData.rotation);
     }
 
+    void SetCameraTransform(Camera& camera, const BlitML::vec3& position, float yawRotation, float pitchRotation)
+    {
+        camera.transformData.yawRotation = yawRotation;
+        camera.transformData.pitchRotation = pitchRotation;
+        auto yawOrientation = BlitML::QuatFromAngleAxis(BlitML::vec3(0.f, -1.f, 0.f), yawRotation, 0);
+        auto pitchOrientation = BlitML::QuatFromAngleAxis(BlitML::vec3(1.f, 0.f, 0.f), pitchRotation, 0);
+        CreateRotationMatrixFromPitchAndYawQuaternion(pitchOrientation, yawOrientation, camera.transformData.rotation);
+
+        camera.viewData.position = position;
+        camera.transformData.translation = BlitML::Translate(position);
+        camera.viewData.viewMatrix = BlitML::Mat4Inverse(camera.transformData.translation * camera.transformData.rotation);
+        camera.viewData.projectionViewMatrix = camera.transformData.projectionMatrix * camera.viewData.viewMatrix;
+    }
+
     void UpdateProjection(Camera& camera, float newWidth, float newHeight)
     {
         // New window sizes
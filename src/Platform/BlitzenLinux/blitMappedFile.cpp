@@ -0,0 +1,138 @@
+#if defined(linux)
+#include "Platform/Common/blitMappedFile.h"
+#include "Core/DbLog/blitLogger.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace BlitzenPlatform
+{
+    BLIT_MMF_RES MEMORY_MAPPED_FILE_SCOPE::Open(const char* path, FileModes mode, size_t writeSize)
+    {
+        Close();
+        m_mode = mode;
+
+        if (mode == FileModes::Read)
+        {
+            m_fd = open(path, O_RDONLY | O_CLOEXEC);
+            if (m_fd == -1)
+            {
+                return BLIT_MMF_RES::FILE_CREATION_FAILED;
+            }
+
+            struct stat fileStats{};
+            if (fstat(m_fd, &fileStats) != 0)
+            {
+                return BLIT_MMF_RES::FILE_SIZE_INVALID;
+            }
+            if (fileStats.st_size == 0)
+            {
+                return BLIT_MMF_RES::FILE_SIZE_ZERO;
+            }
+
+            m_fileSize = size_t(fileStats.st_size);
+        }
+        else if (mode == FileModes::Write)
+        {
+            if (writeSize == 0)
+            {
+                return BLIT_MMF_RES::WRITE_SIZE_ZERO;
+            }
+
+            // Creates file if it does not exist, the mapping needs read access as well
+            m_fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+            if (m_fd == -1)
+            {
+                return BLIT_MMF_RES::FILE_CREATION_FAILED;
+            }
+
+            if (ftruncate(m_fd, off_t(writeSize)) != 0)
+            {
+                return BLIT_MMF_RES::FILE_SIZE_INVALID;
+            }
+
+            m_fileSize = writeSize;
+        }
+        else
+        {
+            return BLIT_MMF_RES::BLIT_MMF_RES_MAX;
+        }
+
+        int protection{ mode == FileModes::Read ? PROT_READ : PROT_READ | PROT_WRITE };
+        auto pView{ mmap(nullptr, m_fileSize, protection, MAP_SHARED, m_fd, 0) };
+        if (pView == MAP_FAILED)
+        {
+            return BLIT_MMF_RES::FILE_MAPPING_VIEW_NULL;
+        }
+        m_pFileView = pView;
+
+        // Only hints, failure is not an error. The advice values are not flags, each needs its own call
+        if (mode == FileModes::Read)
+        {
+            if (madvise(m_pFileView, m_fileSize, MADV_SEQUENTIAL) != 0)
+            {
+                BLIT_WARN("madvise(MADV_SEQUENTIAL) failed for: %s", path);
+            }
+            if (madvise(m_pFileView, m_fileSize, MADV_WILLNEED) != 0)
+            {
+                BLIT_WARN("madvise(MADV_WILLNEED) failed for: %s", path);
+            }
+        }
+
+        return BLIT_MMF_RES::SUCCESS;
+    }
+
+    void MEMORY_MAPPED_FILE_SCOPE::Close()
+    {
+        if (m_pFileView)
+        {
+            munmap(m_pFileView, m_fileSize);
+            m_pFileView = nullptr;
+        }
+
+        if (m_fd != -1)
+        {
+            close(m_fd);
+            m_fd = -1;
+        }
+
+        m_fileSize = 0;
+        m_endOffset = 0;
+    }
+
+    MEMORY_MAPPED_FILE_SCOPE::~MEMORY_MAPPED_FILE_SCOPE()
+    {
+        Close();
+    }
+
+    bool ReadMemoryMappedFile(MEMORY_MAPPED_FILE_SCOPE& platformFile, size_t offset, size_t size, void* pDataRead)
+    {
+        if (offset + size > platformFile.m_fileSize)
+        {
+            return false; // Read exceeds file size
+        }
+
+        BlitzenPlatform::PlatformMemCopy(pDataRead, reinterpret_cast<uint8_t*>(platformFile.m_pFileView) + offset, size);
+
+        return true;
+    }
+
+    bool WriteMemoryMappedFile(MEMORY_MAPPED_FILE_SCOPE& platformFile, size_t offset, size_t size, void* pData)
+    {
+        if (offset + size > platformFile.m_fileSize)
+        {
+            return false; // Write exceeds file size
+        }
+
+        BlitzenPlatform::PlatformMemCopy(reinterpret_cast<uint8_t*>(platformFile.m_pFileView) + offset, pData, size);
+
+        if (platformFile.m_endOffset < offset + size)
+        {
+            platformFile.m_endOffset = offset + size;
+        }
+
+        return true;
+    }
+}
+#endif
@@ -117,7 +117,8 @@ namespace BlitzenPlatform
             m_pMapping = nullptr;
         }
 
-        if (m_hFile != nullptr)
+        // CreateFile failures leave INVALID_HANDLE_VALUE behind
+        if (m_hFile != nullptr && m_hFile != INVALID_HANDLE_VALUE)
         {
             CloseHandle(m_hFile);
             m_hFile = nullptr;
@@ -48,7 +48,7 @@ namespace BlitzenPlatform
 
         HANDLE m_hFile{ nullptr };                
         HANDLE m_pMapping{ nullptr };             
-        LPVOID m_pFileView{ INVALID_HANDLE_VALUE };            
+        LPVOID m_pFileView{ nullptr };            
         DWORD m_fileSize{ 0 };
         DWORD m_endOffset{ 0 };
 
@@ -58,7 +58,23 @@ namespace BlitzenPlatform
 
     #elif defined(linux)
 
-    using MEMORY_MAPPED_FILE_SCOPE = C_FILE_SCOPE;// TEMPORARY
+    struct MEMORY_MAPPED_FILE_SCOPE
+    {
+        // Read mappings are advised as sequential and will need, so the kernel starts reading ahead right away
+        BLIT_MMF_RES Open(const char* path, FileModes mode, size_t writeSize);
+
+        void Close();
+
+        ~MEMORY_MAPPED_FILE_SCOPE();
+
+        int m_fd{ -1 };
+        void* m_pFileView{ nullptr };
+        size_t m_fileSize{ 0 };
+        size_t m_endOffset{ 0 };
+
+    private:
+        FileModes m_mode;
+    };
 
     #endif
 
@@ -5,6 +5,11 @@ namespace BlitzenPlatform
 {
     bool PlatformStartup(const char* appName, void* pPlatform, void* pEvents, void* pRenderer);
 
+#if defined(linux)
+    // No display connection or window, the renderer draws offscreen. Events are never dispatched
+    bool PlatformStartupHeadless(void* pPlatform, void* pEvents, void* pRenderer, uint32_t width, uint32_t height);
+#endif
+
     bool DispatchEvents(void* pPlatform);
 
     void BlitzenSleep(uint64_t ms);
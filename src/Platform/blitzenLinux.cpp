@@ -110,6 +110,23 @@ namespace BlitzenPlatform
             return true;
         }
 
+        bool PlatformStartupHeadless(void* pPlatform, void* pEvents, void* pRenderer, uint32_t width, uint32_t height)
+        {
+            auto P_HANDLE{reinterpret_cast<PlatformContext*>(pPlatform)};
+            P_HANDLE->m_pEvents = pEvents;
+            P_HANDLE->m_pDisplay = nullptr;
+            P_HANDLE->m_pConnection = nullptr;
+
+            auto pBackendRenderer = reinterpret_cast<BlitzenEngine::RendererPtrType>(pRenderer);
+            if (!pBackendRenderer->InitHeadless(width, height))
+            {
+                BLIT_FATAL("Failed to initialize rendering API in headless mode");
+                return false;
+            }
+
+            return true;
+        }
+
         void BlitzenSleep(uint64_t ms)
         {
             #if _POSIX_C_SOURCE >= 199309L
@@ -197,6 +214,12 @@ namespace BlitzenPlatform
             auto P_HANDLE{reinterpret_cast<PlatformContext*>(pPlatform)};
             auto pEventSystem{reinterpret_cast<BlitzenCore::EventSystem*>(P_HANDLE->m_pEvents)};
 
+            // Headless
+            if (!P_HANDLE->m_pConnection)
+            {
+                return true;
+            }
+
             xcb_client_message_event_t* pClientMessage;
 
             bool quitFlagged = false;
@@ -611,6 +634,12 @@ namespace BlitzenPlatform
 
         static void PlatformShutdown(PlatformContext* P_HANDLE)
         {
+            // Headless
+            if (!P_HANDLE->m_pDisplay)
+            {
+                return;
+            }
+
             // yeah... we got to turn this shit back on, because it's global for the OS
             XAutoRepeatOn(P_HANDLE->m_pDisplay);
 
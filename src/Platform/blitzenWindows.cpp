@@ -145,7 +145,7 @@ namespace BlitzenPlatform
     {
         static MEMORY_MAPPED_FILE_SCOPE s_scopedFile;
 
-        if (s_scopedFile.m_pFileView == INVALID_HANDLE_VALUE)
+        if (s_scopedFile.m_pFileView == nullptr)
         {
             auto mmfResult{ s_scopedFile.Open("blitLogOutput.txt", FileModes::Write, BlitzenCore::Ce_BlitLogOutputFileSize) };
             if (mmfResult != BLIT_MMF_RES::SUCCESS)
@@ -26,6 +26,9 @@ namespace BlitzenDX12
 
         // Layout transition throwaway function. Some command list incompatibility makes it necessary
         void FinalSetup();
+
+        // Scenes are set up whole on dx12, so there is nothing to publish
+        uint8_t PublishSceneBatch(BlitzenEngine::DrawContext& context, uint8_t bFinal);
     
         // Function for DDS texture loading
         uint8_t UploadTexture(const char* filepath);
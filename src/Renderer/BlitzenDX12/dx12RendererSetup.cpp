@@ -573,7 +573,6 @@ namespace BlitzenDX12
 		Dx12Renderer::VarBuffers* varBuffers, BlitzenEngine::DrawContext& context, uint32_t swapchainWidth, uint32_t swapchainHeight)
 	{
 		const auto& transforms{ context.m_renders.m_transforms };
-		const auto& lodData{ context.m_meshes.m_LODs };
 		const auto& lodInstanceList{ context.m_meshes.m_lodInstanceList };
 		auto renderCount{ context.m_renders.m_renderCount };
 		auto dynamicTransformCount{ context.m_renders.m_dynamicTransformCount };
@@ -638,7 +637,7 @@ namespace BlitzenDX12
 			}
 			else if constexpr (BlitzenCore::Ce_InstanceCulling)
 			{
-				UINT64 instanceBufferSize{ lodData.GetSize() * BlitzenCore::Ce_MaxInstanceCountPerLOD * sizeof(uint32_t) };
+				UINT64 instanceBufferSize{ BlitML::Max(context.m_meshes.m_lodInstanceIndexCount, 1u) * sizeof(uint32_t) };
 				if (!CreateBuffer(device, buffers.drawInstBuffer.buffer.ReleaseAndGetAddressOf(), instanceBufferSize,
 					D3D12_RESOURCE_STATE_COMMON, D3D12_HEAP_TYPE_DEFAULT, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS))
 				{
@@ -802,7 +801,9 @@ namespace BlitzenDX12
 		BlitzenEngine::DrawContext& context, Dx12Renderer::ConstBuffers& buffers)
 	{
 		const auto& vertices{ context.m_meshes.m_hlslVtxs };
+		const auto& compactVertices{ context.m_meshes.m_compactVertices };
 		const auto& indices{ context.m_meshes.m_indices };
+		const auto& compactIndices{ context.m_meshes.m_compactIndices };
 		const auto& surfaces{ context.m_meshes.m_surfaces };
 		auto renders{ context.m_renders.m_renders};
 		auto renderObjectCount{ context.m_renders.m_renderCount };
@@ -811,7 +812,12 @@ namespace BlitzenDX12
 		auto materialCount{ context.m_textures.m_materialCount };
 
 		DX12WRAPPER<ID3D12Resource> vertexStagingBuffer{ nullptr };
-		UINT64 vertexBufferSize{ CreateSSBO(device, buffers.vertexBuffer, vertexStagingBuffer, vertices.GetSize(), vertices.Data())};
+		UINT64 vertexBufferSize
+		{
+			BlitzenCore::Ce_CompactVertices ? 
+			CreateSSBO(device, buffers.vertexBuffer, vertexStagingBuffer, compactVertices.GetSize(), compactVertices.Data()) :
+			CreateSSBO(device, buffers.vertexBuffer, vertexStagingBuffer, vertices.GetSize(), vertices.Data())
+		};
 		if (!vertexBufferSize)
 		{
 			BLIT_ERROR("Failed to create vertex buffer");
@@ -819,7 +825,13 @@ namespace BlitzenDX12
 		}
 
 		DX12WRAPPER<ID3D12Resource> indexStagingBuffer{ nullptr };
-		UINT64 indexBufferSize{ CreateIndexBuffer(device, buffers.indexBuffer, indexStagingBuffer, indices.GetSize(), indices.Data(), buffers.indexBufferView)};
+		UINT64 indexBufferSize
+		{
+			BlitzenCore::Ce_CompactVertices ?
+			CreateIndexBuffer(device, buffers.indexBuffer, indexStagingBuffer, compactIndices.GetSize() / context.m_meshes.m_compactIndexSize, 
+				compactIndices.Data(), buffers.indexBufferView, context.m_meshes.m_compactIndexSize == sizeof(uint16_t) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT) :
+			CreateIndexBuffer(device, buffers.indexBuffer, indexStagingBuffer, indices.GetSize(), indices.Data(), buffers.indexBufferView)
+		};
 		if (!indexBufferSize)
 		{
 			BLIT_ERROR("Failed to create index buffer");
@@ -934,6 +946,7 @@ namespace BlitzenDX12
 		UINT drawHeight, ID3D12DescriptorHeap* samplerHeap)
 	{
 		const auto& vertices{ context.m_meshes.m_hlslVtxs };
+		const auto& compactVertices{ context.m_meshes.m_compactVertices };
 		const auto& transforms{ context.m_renders.m_transforms };
 		const auto& surfaces{ context.m_meshes.m_surfaces };
 		auto pRenders{ context.m_renders.m_renders };
@@ -951,8 +964,16 @@ namespace BlitzenDX12
 
 			auto& vars = varBuffers[i];
 
-			CreateBufferShaderResourceView(device, staticBuffers.vertexBuffer.buffer.Get(), srvHeap->GetCPUDescriptorHandleForHeapStart(),
-				descriptorContext.srvHeapOffset, staticBuffers.vertexBuffer.heapOffset[i], (UINT)vertices.GetSize(), sizeof(BlitzenEngine::Vertex));
+			if (BlitzenCore::Ce_CompactVertices)
+			{
+				CreateBufferShaderResourceView(device, staticBuffers.vertexBuffer.buffer.Get(), srvHeap->GetCPUDescriptorHandleForHeapStart(),
+					descriptorContext.srvHeapOffset, staticBuffers.vertexBuffer.heapOffset[i], (UINT)compactVertices.GetSize(), sizeof(BlitzenEngine::CompactVertex));
+			}
+			else
+			{
+				CreateBufferShaderResourceView(device, staticBuffers.vertexBuffer.buffer.Get(), srvHeap->GetCPUDescriptorHandleForHeapStart(),
+					descriptorContext.srvHeapOffset, staticBuffers.vertexBuffer.heapOffset[i], (UINT)vertices.GetSize(), sizeof(BlitzenEngine::Vertex));
+			}
 		}
 
 		// Teams of descriptors used by both graphics and compute pipelines
@@ -986,7 +1007,7 @@ namespace BlitzenDX12
 			if (BlitzenCore::Ce_InstanceCulling && !CE_DX12OCCLUSION)// Instancing not supported for draw occlusion mode
 			{
 				CreateUnorderedAccessView(device, vars.drawInstBuffer.buffer.Get(), nullptr, srvHeap->GetCPUDescriptorHandleForHeapStart(),
-					descriptorContext.srvHeapOffset, UINT(lods.GetSize() * BlitzenCore::Ce_MaxInstanceCountPerLOD), sizeof(uint32_t), 0);
+					descriptorContext.srvHeapOffset, UINT(BlitML::Max(context.m_meshes.m_lodInstanceIndexCount, 1u)), sizeof(uint32_t), 0);
 			}
 		}
 
@@ -1049,7 +1070,15 @@ namespace BlitzenDX12
 
 	uint8_t Dx12Renderer::SetupForRendering(BlitzenEngine::DrawContext& context)
 	{
-		GenerateHlslVertices(context.m_meshes);
+		// Compact vertices are the same for every backend, the hlsl copy is only needed for the classic layout
+		if (BlitzenCore::Ce_CompactVertices)
+		{
+			GenerateCompactVertices(context.m_meshes);
+		}
+		else
+		{
+			GenerateHlslVertices(context.m_meshes);
+		}
 
 		if (!CreateRootSignatures(m_device.Get(), m_opaqueRootSignature.ReleaseAndGetAddressOf(), m_drawCullSignature.ReleaseAndGetAddressOf(), 
 			m_drawCountResetRoot.ReleaseAndGetAddressOf(), m_drawOccLateSignature.ReleaseAndGetAddressOf(), m_depthPyramidSignature.ReleaseAndGetAddressOf()))
@@ -1103,6 +1132,11 @@ namespace BlitzenDX12
 		return 1;
 	}
 
+	uint8_t Dx12Renderer::PublishSceneBatch(BlitzenEngine::DrawContext&, uint8_t)
+	{
+		return 1;
+	}
+
 	void Dx12Renderer::FinalSetup()
 	{
 		auto& frameTools{ m_frameTools[m_currentFrame] };
@@ -240,17 +240,20 @@ namespace BlitzenDX12
     }
 
     UINT64 CreateIndexBuffer(ID3D12Device* device, DX12WRAPPER<ID3D12Resource>& indexBuffer, DX12WRAPPER<ID3D12Resource>& stagingBuffer,
-        size_t elementCount, void* pData, D3D12_INDEX_BUFFER_VIEW& ibv)
+        size_t elementCount, void* pData, D3D12_INDEX_BUFFER_VIEW& ibv, DXGI_FORMAT format /*=DXGI_FORMAT_R32_UINT*/)
     {
+        // 16 bit indices come with compact vertices
+        UINT64 bufferSize{ (format == DXGI_FORMAT_R16_UINT ? sizeof(uint16_t) : sizeof(uint32_t)) * elementCount };
+
         // SSBO (GPU side buffer)
-        if (!CreateBuffer(device, indexBuffer.ReleaseAndGetAddressOf(), sizeof(uint32_t) * elementCount, 
+        if (!CreateBuffer(device, indexBuffer.ReleaseAndGetAddressOf(), bufferSize, 
             D3D12_RESOURCE_STATE_COMMON, D3D12_HEAP_TYPE_DEFAULT))
         {
             return 0;
         }
 
         // Staging buffer (CPU side buffer)
-        if (!CreateBuffer(device, stagingBuffer.ReleaseAndGetAddressOf(), sizeof(uint32_t) * elementCount, 
+        if (!CreateBuffer(device, stagingBuffer.ReleaseAndGetAddressOf(), bufferSize, 
             D3D12_RESOURCE_STATE_COMMON, D3D12_HEAP_TYPE_UPLOAD))
         {
             return 0;
@@ -262,15 +265,15 @@ namespace BlitzenDX12
         {
             return LOG_ERROR_MESSAGE_AND_RETURN(mappingRes);
         }
-        BlitzenCore::BlitMemCopy(pMappedData, pData, sizeof(uint32_t) * elementCount);
+        BlitzenCore::BlitMemCopy(pMappedData, pData, bufferSize);
 
         ibv = {};
         ibv.BufferLocation = indexBuffer->GetGPUVirtualAddress();
-        ibv.SizeInBytes = static_cast<UINT>(sizeof(uint32_t) * elementCount);
-        ibv.Format = DXGI_FORMAT_R32_UINT;
+        ibv.SizeInBytes = static_cast<UINT>(bufferSize);
+        ibv.Format = format;
 
         // Success
-        return sizeof(uint32_t) * elementCount;
+        return bufferSize;
     }
 
     void CreateSampler(ID3D12Device* device, D3D12_CPU_DESCRIPTOR_HANDLE handle, SIZE_T& samplerHeapOffset,
@@ -35,7 +35,7 @@ namespace BlitzenDX12
         D3D12_RESOURCE_STATES initialState, D3D12_HEAP_TYPE heapType, D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE);
 
     UINT64 CreateIndexBuffer(ID3D12Device* device, DX12WRAPPER<ID3D12Resource>& indexBuffer, DX12WRAPPER<ID3D12Resource>& stagingBuffer,
-        size_t elementCount, void* pData, D3D12_INDEX_BUFFER_VIEW& ibv);
+        size_t elementCount, void* pData, D3D12_INDEX_BUFFER_VIEW& ibv, DXGI_FORMAT format = DXGI_FORMAT_R32_UINT);
 
     uint8_t CreateImageResource(ID3D12Device* device, ID3D12Resource** ppResource, UINT width, UINT height, UINT mipLevels,DXGI_FORMAT format, 
         D3D12_RESOURCE_FLAGS flags, D3D12_HEAP_TYPE heapType, D3D12_RESOURCE_STATES state, D3D12_CLEAR_VALUE* pClear, 
@@ -1,8 +1,12 @@
 #include "vulkanRenderer.h"
 #include "vulkanCommands.h"
+#include "Core/DbLog/blitProfiler.h"
+#include <mutex>
 
 namespace BlitzenVulkan
 {
+    static std::mutex s_queueMutex;
+
     uint8_t VulkanRenderer::FrameTools::Init(VkDevice device, Queue graphicsQueue, Queue transferQueue, Queue computeQueue)
     {
         // Main command buffer
@@ -59,26 +63,27 @@ namespace BlitzenVulkan
             }
         }
 
-        VkFenceCreateInfo fenceInfo{};
-        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-        fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-        fenceInfo.pNext = nullptr;
-        if (vkCreateFence(device, &fenceInfo, nullptr, &inFlightFence.handle) != VK_SUCCESS)
-        {
-            BLIT_ERROR("Failed to create fence");
-            return 0;
-        }
-        if (BlitzenCore::Ce_BuildClusters)
+        // Passes recorded on the task pool
+        for (uint32_t i = 0; i < Ce_RecordedPassCount; ++i)
         {
-            VkFenceCreateInfo notSignaledFenceInfo{};
-            notSignaledFenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-            if (vkCreateFence(device, &notSignaledFenceInfo, nullptr, &preCulsterCullingFence.handle) != VK_SUCCESS)
+            VkCommandPoolCreateInfo passCommandPoolInfo{};
+            CreateCommandPoolInfo(passCommandPoolInfo, graphicsQueue.index, nullptr);
+            if (vkCreateCommandPool(device, &passCommandPoolInfo, nullptr, &passCommandPools[i].handle) != VK_SUCCESS)
             {
-                BLIT_ERROR("Failed to create pre culster culling fence");
+                BLIT_ERROR("Failed to create command pool for recorded pass");
+                return 0;
+            }
+
+            VkCommandBufferAllocateInfo passCommandBufferInfo{};
+            CreateCmdbInfo(passCommandBufferInfo, passCommandPools[i].handle);
+            if (vkAllocateCommandBuffers(device, &passCommandBufferInfo, &passCommandBuffers[i]) != VK_SUCCESS)
+            {
+                BLIT_ERROR("Failed to create command buffer for recorded pass");
                 return 0;
             }
         }
 
+        // Swapchain semaphores have to be binary, the rest of the frame is ordered by the renderer's timelines
         VkSemaphoreCreateInfo semaphoresInfo{};
         semaphoresInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
         semaphoresInfo.flags = 0;
@@ -93,15 +98,14 @@ namespace BlitzenVulkan
             BLIT_ERROR("Failed to create semaphore for presentation");
             return 0;
         }
-        if (vkCreateSemaphore(device, &semaphoresInfo, nullptr, &buffersReadySemaphore.handle) != VK_SUCCESS)
-        {
-            BLIT_ERROR("Failed to create semaphore for var buffer data copy");
-            return 0;
-        }
-        if (BlitzenCore::Ce_BuildClusters && 
-            vkCreateSemaphore(device, &semaphoresInfo, nullptr, &preClusterCullingDoneSemaphore.handle) != VK_SUCCESS)
+
+        VkQueryPoolCreateInfo timestampPoolInfo{};
+        timestampPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        timestampPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        timestampPoolInfo.queryCount = Ce_GpuTimestampQueryCount;
+        if (vkCreateQueryPool(device, &timestampPoolInfo, nullptr, &timestampQueryPool.handle) != VK_SUCCESS)
         {
-            BLIT_ERROR("Failed to create semaphore for pre cluster culling");
+            BLIT_ERROR("Failed to create timestamp query pool");
             return 0;
         }
 
@@ -127,17 +131,31 @@ namespace BlitzenVulkan
         uint32_t signalSemaphoreCount /* =0 */, VkSemaphoreSubmitInfo* signalSemaphore /* =nullptr */,
         VkFence fence /* =VK_NULL_HANDLE */)
     {
-        vkEndCommandBuffer(commandBuffer);
+        SubmitCommandBuffers(queue, 1, &commandBuffer, waitSemaphoreCount, waitSemaphore, signalSemaphoreCount, signalSemaphore, fence);
+    }
 
-        VkCommandBufferSubmitInfo commandBufferInfo{};
-        commandBufferInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
-        commandBufferInfo.commandBuffer = commandBuffer;
+    void SubmitCommandBuffers(VkQueue queue, uint32_t commandBufferCount, VkCommandBuffer* pCommandBuffers,
+        uint32_t waitSemaphoreCount /* =0 */, VkSemaphoreSubmitInfo* waitSemaphore /* =nullptr */,
+        uint32_t signalSemaphoreCount /* =0 */, VkSemaphoreSubmitInfo* signalSemaphore /* =nullptr */,
+        VkFence fence /* =VK_NULL_HANDLE */)
+    {
+        BLIT_PROFILE_FUNCTION();
+
+        VkCommandBufferSubmitInfo commandBufferInfos[Ce_RecordedPassCount + 1]{};
+        BLIT_ASSERT(commandBufferCount <= BLIT_ARRAY_SIZE(commandBufferInfos));
+        for (uint32_t i = 0; i < commandBufferCount; ++i)
+        {
+            vkEndCommandBuffer(pCommandBuffers[i]);
+
+            commandBufferInfos[i].sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+            commandBufferInfos[i].commandBuffer = pCommandBuffers[i];
+        }
 
         VkSubmitInfo2 submitInfo{};
         submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
 
-        submitInfo.commandBufferInfoCount = 1;
-        submitInfo.pCommandBufferInfos = &commandBufferInfo;
+        submitInfo.commandBufferInfoCount = commandBufferCount;
+        submitInfo.pCommandBufferInfos = commandBufferInfos;
 
         submitInfo.waitSemaphoreInfoCount = waitSemaphoreCount;
         submitInfo.pWaitSemaphoreInfos = waitSemaphore;
@@ -145,15 +163,74 @@ namespace BlitzenVulkan
         submitInfo.signalSemaphoreInfoCount = signalSemaphoreCount;
         submitInfo.pSignalSemaphoreInfos = signalSemaphore;
 
+        std::lock_guard<std::mutex> lock(s_queueMutex);
         VK_CHECK(vkQueueSubmit2(queue, 1, &submitInfo, fence))
     }
 
-    void CreateSemahoreSubmitInfo(VkSemaphoreSubmitInfo& semaphoreInfo, VkSemaphore semaphore, VkPipelineStageFlags2 stage)
+    uint8_t SubmitCommandBufferAndWait(VkDevice device, VkQueue queue, VkCommandBuffer commandBuffer)
+    {
+        SyncFence fence;
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        if (vkCreateFence(device, &fenceInfo, nullptr, &fence.handle) != VK_SUCCESS)
+        {
+            BLIT_ERROR("Failed to create fence for one time submit");
+            return 0;
+        }
+
+        SubmitCommandBuffer(queue, commandBuffer, 0, nullptr, 0, nullptr, fence.handle);
+
+        // Not under the queue lock, the other thread keeps submitting and presenting while this one waits
+        if (vkWaitForFences(device, 1, &fence.handle, VK_TRUE, UINT64_MAX) != VK_SUCCESS)
+        {
+            BLIT_ERROR("One time submit did not complete");
+            return 0;
+        }
+        return 1;
+    }
+
+    void QueuePresent(VkQueue queue, const VkPresentInfoKHR& presentInfo)
+    {
+        std::lock_guard<std::mutex> lock(s_queueMutex);
+        vkQueuePresentKHR(queue, &presentInfo);
+    }
+
+    void CreateSemahoreSubmitInfo(VkSemaphoreSubmitInfo& semaphoreInfo, VkSemaphore semaphore, VkPipelineStageFlags2 stage, uint64_t value)
     {
         semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
         semaphoreInfo.pNext = nullptr;
         semaphoreInfo.semaphore = semaphore;
         semaphoreInfo.stageMask = stage;
+        semaphoreInfo.value = value;
+    }
+
+    uint8_t CreateTimelineSemaphore(VkDevice device, VkSemaphore& semaphore)
+    {
+        VkSemaphoreTypeCreateInfo typeInfo{};
+        typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        typeInfo.initialValue = 0;
+
+        VkSemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        semaphoreInfo.pNext = &typeInfo;
+        if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS)
+        {
+            return 0;
+        }
+
+        // Success
+        return 1;
+    }
+
+    void WaitTimelineSemaphore(VkDevice device, VkSemaphore semaphore, uint64_t value, uint64_t timeout)
+    {
+        VkSemaphoreWaitInfo waitInfo{};
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores = &semaphore;
+        waitInfo.pValues = &value;
+        vkWaitSemaphores(device, &waitInfo, timeout);
     }
 
     void CreateCommandPoolInfo(VkCommandPoolCreateInfo& cmdPoolInfo, uint32_t queueIndex, void* pNext, 
@@ -6,14 +6,34 @@ namespace BlitzenVulkan
     // Puts command buffer in the ready state. vkCmd type function can be called after this and until vkEndCommandBuffer is called
     void BeginCommandBuffer(VkCommandBuffer commandBuffer, VkCommandBufferUsageFlags);
 
-    // Creates semaphore submit info which can be passed to VkSubmitInfo2 before queue submit
-    void CreateSemahoreSubmitInfo(VkSemaphoreSubmitInfo& semaphoreInfo, VkSemaphore semaphore, VkPipelineStageFlags2 stage);
+    // Creates semaphore submit info which can be passed to VkSubmitInfo2 before queue submit. The value is ignored for binary semaphores
+    void CreateSemahoreSubmitInfo(VkSemaphoreSubmitInfo& semaphoreInfo, VkSemaphore semaphore, VkPipelineStageFlags2 stage, uint64_t value = 0);
+
+    // Creates a semaphore whose counter starts at 0
+    uint8_t CreateTimelineSemaphore(VkDevice device, VkSemaphore& semaphore);
+
+    // Blocks until the counter of a timeline semaphore reaches value
+    void WaitTimelineSemaphore(VkDevice device, VkSemaphore semaphore, uint64_t value, uint64_t timeout);
 
     // Ends command buffer and submits it. Synchronization structures can also be specified
     void SubmitCommandBuffer(VkQueue queue, VkCommandBuffer commandBuffer, uint32_t waitSemaphoreCount = 0,
         VkSemaphoreSubmitInfo* pWaitInfo = nullptr, uint32_t signalSemaphoreCount = 0,
         VkSemaphoreSubmitInfo* signalSemaphore = nullptr, VkFence fence = VK_NULL_HANDLE);
 
+    // Queues are externally synchronized and may be the same queue. Scene loading submits from its own thread while the main thread
+    // draws the loading screen, so every queue operation goes through the functions below, which share one lock.
+    // The lock only covers vkQueueSubmit2 and vkQueuePresentKHR, waits happen outside of it
+
+    // Submits with a temporary fence and blocks on it, for one time setup work
+    uint8_t SubmitCommandBufferAndWait(VkDevice device, VkQueue queue, VkCommandBuffer commandBuffer);
+
+    void QueuePresent(VkQueue queue, const VkPresentInfoKHR& presentInfo);
+
+    // Ends every command buffer and submits them as one batch, executed in array order
+    void SubmitCommandBuffers(VkQueue queue, uint32_t commandBufferCount, VkCommandBuffer* pCommandBuffers, uint32_t waitSemaphoreCount = 0,
+        VkSemaphoreSubmitInfo* pWaitInfo = nullptr, uint32_t signalSemaphoreCount = 0,
+        VkSemaphoreSubmitInfo* signalSemaphore = nullptr, VkFence fence = VK_NULL_HANDLE);
+
     void CreateCommandPoolInfo(VkCommandPoolCreateInfo& cmdPoolInfo, uint32_t queueIndex, void* pNext,
         VkCommandPoolCreateFlags flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
 
@@ -104,11 +104,12 @@ namespace BlitzenVulkan
     constexpr uint32_t Ce_ComputeQueueInfoIndex = 2;
 
 
-    // Double buffering 
+    // Frames in flight are picked at startup (up to Ce_MaxFramesInFlight), double buffering only changes the default
+    constexpr uint8_t Ce_MaxFramesInFlight = 3;
 #if defined(BLIT_DOUBLE_BUFFERING)
-    constexpr uint8_t ce_framesInFlight = 2;
+    constexpr uint8_t Ce_DefaultFramesInFlight = 2;
 #else
-    constexpr uint8_t ce_framesInFlight = 1;
+    constexpr uint8_t Ce_DefaultFramesInFlight = 1;
 #endif
 
 #if defined(BLIT_VSYNC)
@@ -121,8 +122,10 @@ namespace BlitzenVulkan
 
     // The format and usage flags that will be set for the color and depth attachments
     constexpr VkFormat ce_colorAttachmentFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
+    constexpr uint32_t Ce_ColorAttachmentTexelSize = 8;// 4 half floats, used by the headless readback
     constexpr VkImageLayout ce_ColorAttachmentLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-    constexpr VkImageUsageFlags ce_colorAttachmentImageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT;
+    constexpr VkImageUsageFlags ce_colorAttachmentImageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT | 
+        VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
     constexpr VkClearColorValue ce_WindowClearColor =
     {
         BlitzenCore::Ce_DefaultWindowBackgroundColor[0],
@@ -139,9 +142,21 @@ namespace BlitzenVulkan
     constexpr VkImageUsageFlags Ce_DepthPyramidImageUsage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT;
     constexpr uint8_t ce_maxDepthPyramidMipLevels = 16;
 
+    // Pipeline cache blob, loaded at startup and written back on shutdown. Discarded if it comes from a different device or driver
+    constexpr const char* Ce_PipelineCacheFilepath = "VulkanShaders/BlitzenPipelineCache.bin";
+
+    // Per LOD instanced culling (opt in, cluster mode replaces it). Single pass, no occlusion culling, like DX12
+    #if defined(BLIT_VK_INSTANCED_CULLING) && !defined(BLITZEN_CLUSTER_CULLING)
+        constexpr uint8_t Ce_VkInstanceCulling = 1;
+    #else
+        constexpr uint8_t Ce_VkInstanceCulling = 0;
+    #endif
+
     // The size of the stack arrays that hold push descriptor writes
     #if defined(BLITZEN_CLUSTER_CULLING)
         constexpr uint32_t Ce_ComputeDescriptorWriteArraySize = 8;
+    #elif defined(BLIT_VK_INSTANCED_CULLING)
+        constexpr uint32_t Ce_ComputeDescriptorWriteArraySize = 9;
     #else
         constexpr uint32_t Ce_ComputeDescriptorWriteArraySize = 7;
     #endif
@@ -154,18 +169,32 @@ namespace BlitzenVulkan
     constexpr uint32_t Ce_VisibilityBufferDrawCullDescriptorId = 5;
     constexpr uint32_t Ce_SurfaceBufferDrawCullDescriptorId = 6;
     constexpr uint32_t Ce_ClusterBufferDrawCullDescriptorId = 7;
+    // Instancing only (the cluster path takes priority when both are defined)
+    constexpr uint32_t Ce_LodInstanceCounterDrawCullDescriptorId = 7;
+    constexpr uint32_t Ce_InstanceIndexDrawCullDescriptorId = 8;
 
     constexpr uint32_t Ce_DepthPyramidImageBindingID = 3;
 
-    constexpr uint32_t Ce_GraphicsDescriptorWriteArraySize = 6;
+    // Cluster mode vertex shaders pull their indices from the meshlet data
+    // Instanced vertex shaders read the render object id from the instance index buffer
+    #if defined(BLITZEN_CLUSTER_CULLING)
+        constexpr uint32_t Ce_GraphicsDescriptorWriteArraySize = 8;
+    #elif defined(BLIT_VK_INSTANCED_CULLING)
+        constexpr uint32_t Ce_GraphicsDescriptorWriteArraySize = 7;
+    #else
+        constexpr uint32_t Ce_GraphicsDescriptorWriteArraySize = 6;
+    #endif
 
     constexpr uint32_t Ce_VertexBufferPushDescriptorId = 1;
     constexpr uint32_t Ce_MaterialBufferPushDescriptorId = 2;
     constexpr uint32_t Ce_TransformBufferGraphicsDescriptorId = 3;
     constexpr uint32_t Ce_DrawCmdBufferGraphicsDescriptorId = 4;
     constexpr uint32_t Ce_SurfaceBufferGraphicsDescriptorId = 5;
+    constexpr uint32_t Ce_ClusterBufferGraphicsDescriptorId = 6;
+    constexpr uint32_t Ce_MeshletDataBufferGraphicsDescriptorId = 7;
+    constexpr uint32_t Ce_InstanceIndexBufferGraphicsDescriptorId = 6;
 
-    constexpr uint32_t Ce_StaticSSBODataCount = 10;
+    constexpr uint32_t Ce_StaticSSBODataCount = 12;
 
     constexpr uint32_t Ce_VertexBufferDataCopyIndex = 0;
     constexpr uint32_t Ce_IndexBufferDataCopyIndex = 1;
@@ -177,6 +206,13 @@ namespace BlitzenVulkan
     constexpr uint32_t Ce_MaterialBufferDataCopyIndex = 7;
     constexpr uint32_t Ce_ClusterBufferDataCopyIndex = 8;
     constexpr uint32_t Ce_ClusterIndexBufferDataCopyIndex = 9;
+    constexpr uint32_t Ce_LodInstanceBufferDataCopyIndex = 10;
+    constexpr uint32_t Ce_VisibilityBufferFillIndex = 11;// No data, zeroed
+
+    // Scene batches update the static buffers above and the two buffers that are only sized by the scene
+    constexpr uint32_t Ce_InstanceIndexSceneBufferIndex = 12;
+    constexpr uint32_t Ce_IndirectTaskSceneBufferIndex = 13;
+    constexpr uint32_t Ce_SceneBufferCount = 14;
 
     
     constexpr uint32_t IndirectDrawElementCount = 10'000'000;
@@ -185,7 +221,34 @@ namespace BlitzenVulkan
 	// TODO: REMOVE THIS 
     constexpr uint32_t Ce_SinglePointer = 1;
 
-    constexpr size_t ce_textureStagingBufferSize = 128 * 1024 * 1024;
+    // Persistent staging ring for every upload (textures and static buffers), every texture has to fit in it. 
+    // Host visible memory used by uploads stays at this size, whatever the size of the scene
+    constexpr size_t Ce_StagingRingSize = 128 * 1024 * 1024;
+    constexpr VkDeviceSize Ce_StagingAlignment = 16;// Largest BC block
+    // Textures copied by one transfer submission, and submissions in flight before the loader has to wait for one
+    constexpr uint32_t Ce_TextureUploadBatchSize = 32;
+    constexpr uint32_t Ce_UploadBatchCount = 3;
+    // Buffer data goes through the ring in chunks, so that the copy of one chunk overlaps the memcpy of the next ones
+    constexpr VkDeviceSize Ce_BufferUploadChunkSize = 4 * 1024 * 1024;
+    constexpr uint32_t Ce_BufferUploadBatchSize = 8;
+
+    #if defined(BLIT_VK_TEXTURE_STREAMING)
+        constexpr uint8_t Ce_TextureStreaming = 1;
+    #else
+        constexpr uint8_t Ce_TextureStreaming = 0;
+    #endif
+    // Mips up to this size are loaded with the scene and are never evicted
+    constexpr uint32_t Ce_TextureStreamingTailSize = 128;
+    // Streamed textures are kept under this size by making every texture coarser by the same number of mips
+    constexpr size_t Ce_TextureStreamingBudget = 512 * 1024 * 1024;
+    // Requests are computed every few frames, and only a few textures change resolution at a time
+    constexpr uint32_t Ce_TextureStreamingInterval = 8;
+    constexpr uint32_t Ce_MaxStreamedTextureImages = 8;
+
+    // Dynamic transforms are tracked with a bitset per frame, only the changed ranges are copied
+    constexpr uint32_t Ce_DirtyTransformWordCount = (BlitzenCore::Ce_MaxDynamicObjectCount + 63) / 64;
+    // Runs past this count are merged into the last copy region, the staging copy is up to date everywhere
+    constexpr uint32_t Ce_MaxTransformCopyRegions = 32;
 
     constexpr uint32_t PushDescriptorSetID = 0;// Used when calling PuhsDesriptors for the set parameter
     constexpr uint32_t TextureDescriptorSetID = 1;
@@ -196,6 +259,51 @@ namespace BlitzenVulkan
     constexpr uint64_t ce_fenceTimeout = 1000000000;
     constexpr uint64_t ce_swapchainImageTimeout = ce_fenceTimeout;
 
+    // GPU timestamp profiling. Each pass writes a begin and an end timestamp
+    enum class GpuPass : uint32_t
+    {
+        PreClusterCull = 0,
+        ClusterCull,
+        DrawCull,
+        Geometry,
+        DepthPyramid,
+        LateCull,
+        LateGeometry,
+        Transparents,
+        PresentationCopy,
+
+        MaxPasses
+    };
+    constexpr uint32_t Ce_GpuPassCount = uint32_t(GpuPass::MaxPasses);
+
+    // Parts of DrawFrame recorded on the task pool, each into its own command buffer. Submitted in this order
+    enum class RecordedPass : uint32_t
+    {
+        Opaque = 0,
+        LateOpaque,
+        Onpc,
+        Transparents,
+
+        MaxPasses
+    };
+    constexpr uint32_t Ce_RecordedPassCount = uint32_t(RecordedPass::MaxPasses);
+    constexpr uint32_t Ce_GpuTimestampQueryCount = Ce_GpuPassCount * 2;
+    constexpr uint32_t Ce_GpuTimingHistorySize = 1024;// Frames kept for the rolling stats and the CSV dump
+    constexpr const char* Ce_GpuPassNames[Ce_GpuPassCount]
+    {
+        "PreClusterCull", "ClusterCull", "DrawCull", "Geometry", "DepthPyramid", "LateCull", "LateGeometry", "Transparents", "PresentationCopy"
+    };
+
+    // Milliseconds per pass over the frames in the history. Passes that did not run in a frame are not sampled
+    struct GpuPassTimings
+    {
+        float lastMs[Ce_GpuPassCount]{};
+        float minMs[Ce_GpuPassCount]{};
+        float avgMs[Ce_GpuPassCount]{};
+        float p99Ms[Ce_GpuPassCount]{};
+        uint32_t sampleCount[Ce_GpuPassCount]{};
+    };
+
 
 
     struct VulkanStats
@@ -216,6 +324,15 @@ namespace BlitzenVulkan
         uint8_t bObliqueNearPlaneClippingObjectsExist = 0;
 
         uint8_t bTranspartentObjectsExist = 0;
+
+        // No surface or swapchain, frames are rendered to the color attachment only
+        uint8_t bHeadless = 0;
+
+        uint8_t bGpuTimestampsSupported = 0;
+        GpuPassTimings gpuTimings;
+
+        // maxComputeWorkGroupCount[0], limits the indirect cluster culling dispatch
+        uint32_t maxClusterCullGroupCount = 0;
     };
 
 
@@ -243,6 +360,13 @@ namespace BlitzenVulkan
         ~PipelineObject();
     };
 
+    struct PipelineCache
+    {
+        VkPipelineCache handle = VK_NULL_HANDLE;
+
+        ~PipelineCache();
+    };
+
     struct PipelineLayout
     {
         VkPipelineLayout handle = VK_NULL_HANDLE;
@@ -300,6 +424,13 @@ namespace BlitzenVulkan
         ~SyncFence();
     };
 
+    struct QueryPool
+    {
+        VkQueryPool handle = VK_NULL_HANDLE;
+
+        ~QueryPool();
+    };
+
     struct AccelerationStructure
     {
         VkAccelerationStructureKHR handle = VK_NULL_HANDLE;
@@ -446,13 +577,20 @@ namespace BlitzenVulkan
         uint32_t clusterId;
     };
 
+    // Written by the pre cluster shader, cluster culling is dispatched indirectly from the first part
+    struct ClusterCountData
+    {
+        VkDispatchIndirectCommand dispatch;
+        uint32_t count;
+    };
+
 	struct alignas(16) ClusterCullShaderPushConstant
 	{
         VkDeviceAddress renderObjectBufferAddress;
         VkDeviceAddress clusterDispatchBufferAddress;
         VkDeviceAddress clusterCountBufferAddress;
         uint32_t drawCount;
-        uint32_t padding0;
+        uint32_t clusterCapacity;// Pre cluster pass only
 	};
     static_assert(sizeof(ClusterCullShaderPushConstant) == 32, "Unexpected size for ClusterCullShaderPushConstant");
     static_assert(alignof(ClusterCullShaderPushConstant) == 16, "Unexpected alignment for ClusterCullShaderPushConstant");
@@ -3,6 +3,10 @@
 #include "vulkanPipelines.h"
 #include "vulkanResourceFunctions.h"
 #include "Core/Events/blitTimeManager.h"
+#include "Platform/Filesystem/blitCFILE.h"
+#include "Core/DbLog/blitProfiler.h"
+#include "Core/Threads/blitTaskPool.h"
+#include "Meshoptimizer/meshoptimizer.h"
 
 // Not necessary since I have my own math library
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -43,20 +47,68 @@ namespace BlitzenVulkan
         return plane / glm::length(glm::vec3(plane));
     }
 
-    static void UpdateBuffers(BlitzenEngine::DrawContext& context, VulkanRenderer::FrameTools& tools,
-        VulkanRenderer::VarBuffers& buffers, VkQueue queue)
+    // Writes the dynamic transforms that changed since this frame last ran. Returns 1 if a copy was submitted
+    static uint8_t UpdateBuffers(BlitzenEngine::DrawContext& context, VulkanRenderer::FrameTools& tools,
+        VulkanRenderer::VarBuffers& buffers, VkQueue queue, VkSemaphore transferTimeline, uint64_t frameSerial)
     {
+        BLIT_PROFILE_FUNCTION();
+
+        if (!buffers.dirtyTransformCount)
+        {
+            return 0;
+        }
+
+        // The frame fence was waited, so neither the staging copy nor the transform buffer are in use
+        constexpr VkDeviceSize transformSize{ sizeof(BlitzenEngine::MeshTransform) };
+        auto pTransforms{ context.m_renders.m_transforms };
+        VkBufferCopy regions[Ce_MaxTransformCopyRegions]{};
+        uint32_t regionCount{ 0 };
+        for (uint32_t w = 0; w < Ce_DirtyTransformWordCount; ++w)
+        {
+            auto word{ buffers.dirtyTransforms[w] };
+            for (uint32_t bit = 0; word; ++bit, word >>= 1)
+            {
+                if (!(word & 1))
+                {
+                    continue;
+                }
+
+                auto transformId{ w * 64 + bit };
+                buffers.pTransformData[transformId] = pTransforms[transformId];
+
+                auto offset{ transformId * transformSize };
+                if (regionCount && (regions[regionCount - 1].srcOffset + regions[regionCount - 1].size == offset ||
+                    regionCount == Ce_MaxTransformCopyRegions))
+                {
+                    regions[regionCount - 1].size = offset + transformSize - regions[regionCount - 1].srcOffset;
+                }
+                else
+                {
+                    regions[regionCount++] = { offset, offset, transformSize };
+                }
+            }
+            buffers.dirtyTransforms[w] = 0;
+        }
+        buffers.dirtyTransformCount = 0;
+
+        // Host writes to the mapped buffer are visible to the frame's submission
+        if (buffers.bDirectTransformWrites)
+        {
+            return 0;
+        }
+
         BeginCommandBuffer(tools.transferCommandBuffer, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
-        CopyBufferToBuffer(tools.transferCommandBuffer, buffers.transformStagingBuffer.bufferHandle,
-            buffers.transformBuffer.buffer.bufferHandle, buffers.dynamicTransformDataSize, 0, 0);
+        vkCmdCopyBuffer(tools.transferCommandBuffer, buffers.transformStagingBuffer.bufferHandle,
+            buffers.transformBuffer.buffer.bufferHandle, regionCount, regions);
 
         // VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT is used here because the signal comes from a transfer queue.
         // More specific shader stages (like VERTEX or COMPUTE) are invalid for transfer queues per Vulkan spec.
         // This ensures compatibility with graphics queue work that reads the transform buffer.
         // DO NOT WASTE TIME TRYING TO CHANGE THIS
         VkSemaphoreSubmitInfo bufferCopySemaphoreInfo{};
-        CreateSemahoreSubmitInfo(bufferCopySemaphoreInfo, tools.buffersReadySemaphore.handle, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT);
+        CreateSemahoreSubmitInfo(bufferCopySemaphoreInfo, transferTimeline, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, frameSerial);
         SubmitCommandBuffer(queue, tools.transferCommandBuffer, 0, nullptr, 1, &bufferCopySemaphoreInfo);
+        return 1;
     }
 
     static void BeginRendering(VkCommandBuffer commandBuffer, VkExtent2D renderAreaExtent, VkOffset2D renderAreaOffset,
@@ -157,6 +209,77 @@ namespace BlitzenVulkan
         PipelineBarrier(cmdb, 0, nullptr, BLIT_ARRAY_SIZE(waitForCullingShader), waitForCullingShader, 0, nullptr);
     }
 
+    // Instanced culling pass (frustum culling, LOD selection, one instanced command per visible LOD)
+    static void DrawInstanceCullPass(VkCommandBuffer cmdb, VkInstance instance, VkPipeline countResetPipeline, VkPipeline cullPipeline,
+        VkPipeline cmdPipeline, VkPipelineLayout layout, VulkanRenderer::StaticBuffers& staticBuffers, uint32_t drawCount,
+        uint32_t descriptorCount, VkWriteDescriptorSet* pDescriptors, VkDeviceAddress objAddress)
+    {
+        // Count reset barrier and last frame's command shader reads of the instance counters
+        VkBufferMemoryBarrier2 resetBarriers[2]{};
+        BufferMemoryBarrier(staticBuffers.indirectCountBuffer.buffer.bufferHandle, resetBarriers[0],
+            VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT, VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+            VK_ACCESS_2_TRANSFER_WRITE_BIT, 0, VK_WHOLE_SIZE);
+        BufferMemoryBarrier(staticBuffers.lodInstanceCounterBuffer.buffer.bufferHandle, resetBarriers[1],
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            VK_ACCESS_2_SHADER_WRITE_BIT, 0, VK_WHOLE_SIZE);
+        PipelineBarrier(cmdb, 0, nullptr, BLIT_ARRAY_SIZE(resetBarriers), resetBarriers, 0, nullptr);
+        vkCmdFillBuffer(cmdb, staticBuffers.indirectCountBuffer.buffer.bufferHandle, 0, sizeof(uint32_t), 0);
+
+        // Every culling shader uses the same descriptors and push constant layout (the draw count is the LOD count for reset and commands)
+        PushDescriptors(instance, cmdb, VK_PIPELINE_BIND_POINT_COMPUTE, layout, PushDescriptorSetID, descriptorCount, pDescriptors);
+        DrawCullShaderPushConstant lodPushConstant{ objAddress, staticBuffers.lodCount };
+        DrawCullShaderPushConstant objectPushConstant{ objAddress, drawCount };
+
+        // Instance count reset
+        vkCmdBindPipeline(cmdb, VK_PIPELINE_BIND_POINT_COMPUTE, countResetPipeline);
+        vkCmdPushConstants(cmdb, layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(DrawCullShaderPushConstant), &lodPushConstant);
+        vkCmdDispatch(cmdb, BlitML::GetComputeShaderGroupSize(staticBuffers.lodCount, 64), 1, 1);
+
+        // Waits for the reset and for last frame's vertex shader reads of the instance indices
+        VkBufferMemoryBarrier2 cullBarriers[2]{};
+        BufferMemoryBarrier(staticBuffers.lodInstanceCounterBuffer.buffer.bufferHandle, cullBarriers[0],
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT, 0, VK_WHOLE_SIZE);
+        BufferMemoryBarrier(staticBuffers.instanceIndexBuffer.buffer.bufferHandle, cullBarriers[1],
+            VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            VK_ACCESS_2_SHADER_WRITE_BIT, 0, VK_WHOLE_SIZE);
+        PipelineBarrier(cmdb, 0, nullptr, BLIT_ARRAY_SIZE(cullBarriers), cullBarriers, 0, nullptr);
+
+        // Culling, fills the instance lists
+        vkCmdBindPipeline(cmdb, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline);
+        vkCmdPushConstants(cmdb, layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(DrawCullShaderPushConstant), &objectPushConstant);
+        vkCmdDispatch(cmdb, BlitML::GetComputeShaderGroupSize(drawCount, 64), 1, 1);
+
+        // Waits for the instance counts, the count reset and last frame's command reads
+        VkBufferMemoryBarrier2 cmdBarriers[3]{};
+        BufferMemoryBarrier(staticBuffers.lodInstanceCounterBuffer.buffer.bufferHandle, cmdBarriers[0],
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            VK_ACCESS_2_SHADER_READ_BIT, 0, VK_WHOLE_SIZE);
+        BufferMemoryBarrier(staticBuffers.indirectCountBuffer.buffer.bufferHandle, cmdBarriers[1],
+            VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT, 0, VK_WHOLE_SIZE);
+        BufferMemoryBarrier(staticBuffers.indirectDrawBuffer.buffer.bufferHandle, cmdBarriers[2],
+            VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_SHADER_READ_BIT,
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_WRITE_BIT, 0, VK_WHOLE_SIZE);
+        PipelineBarrier(cmdb, 0, nullptr, BLIT_ARRAY_SIZE(cmdBarriers), cmdBarriers, 0, nullptr);
+
+        // One command per LOD with visible instances
+        vkCmdBindPipeline(cmdb, VK_PIPELINE_BIND_POINT_COMPUTE, cmdPipeline);
+        vkCmdPushConstants(cmdb, layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(DrawCullShaderPushConstant), &lodPushConstant);
+        vkCmdDispatch(cmdb, BlitML::GetComputeShaderGroupSize(staticBuffers.lodCount, 64), 1, 1);
+
+        // Barrier blocks graphics commands, count and instance index reads
+        VkBufferMemoryBarrier2 waitForCullingShader[3]{};
+        BufferMemoryBarrier(staticBuffers.indirectCountBuffer.buffer.bufferHandle, waitForCullingShader[0], VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            VK_ACCESS_2_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT, 0, VK_WHOLE_SIZE);
+        BufferMemoryBarrier(staticBuffers.indirectDrawBuffer.buffer.bufferHandle, waitForCullingShader[1], VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            VK_ACCESS_2_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT,
+            VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_SHADER_READ_BIT, 0, VK_WHOLE_SIZE);
+        BufferMemoryBarrier(staticBuffers.instanceIndexBuffer.buffer.bufferHandle, waitForCullingShader[2], VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            VK_ACCESS_2_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT, 0, VK_WHOLE_SIZE);
+        PipelineBarrier(cmdb, 0, nullptr, BLIT_ARRAY_SIZE(waitForCullingShader), waitForCullingShader, 0, nullptr);
+    }
+
     // Prepares the second culling compute pass (frustum culling, LOD selection, occlusion, visibility setting)
     // Creates commands for previously culled objects. Sets visibility for non-culled objects (already drawn after previous pass)
     static void DrawCullOcclusionPass(VkCommandBuffer cmdb, VkInstance instance, VkPipeline pipeline, VkPipelineLayout layout,
@@ -315,24 +438,32 @@ namespace BlitzenVulkan
             waitForCullingShader, 0, nullptr);
     }
 
+    // Cluster dispatch elements that fit both the buffer and the group count limit, as a whole number of 64 wide groups
+    static uint32_t GetClusterDispatchCapacity(uint32_t bufferElementCount, uint32_t maxGroupCount)
+    {
+        return BlitML::Min(bufferElementCount / 64, maxGroupCount) * 64;
+    }
+
     static void PreClusterDrawCull(VkCommandBuffer commandBuffer, VkPipeline pipeline, VkPipelineLayout layout, uint32_t descriptorWriteCount, 
         VkWriteDescriptorSet* pDescriptorWrites, VkBuffer clusterCountBuffer, VkDeviceAddress clusterCountBufferAddress,
-        VkBuffer clusterDataBuffer, VkDeviceAddress clusterDispatchBufferAddress,  VkBuffer clusterCountCopy, uint32_t drawCount, 
-        VkDeviceAddress renderObjectBufferAddress, uint8_t lateCulling, VkInstance instance)
+        VkBuffer clusterDataBuffer, VkDeviceAddress clusterDispatchBufferAddress, uint32_t drawCount, 
+        VkDeviceAddress renderObjectBufferAddress, uint32_t clusterCapacity, uint8_t lateCulling, VkInstance instance)
     {
-        // Barrier before count reset
+        // Barrier before count reset, the previous frame dispatched cluster culling from it
         VkBufferMemoryBarrier2 waitBeforeZeroingClusterCount{};
-        BufferMemoryBarrier(clusterCountBuffer, waitBeforeZeroingClusterCount, VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_READ_BIT,
-            VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, 0, sizeof(uint32_t));
+        BufferMemoryBarrier(clusterCountBuffer, waitBeforeZeroingClusterCount, 
+            VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_SHADER_READ_BIT,
+            VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, 0, sizeof(ClusterCountData));
         PipelineBarrier(commandBuffer, 0, nullptr, Ce_SinglePointer, &waitBeforeZeroingClusterCount, 0, nullptr);
-        // Reset
-        vkCmdFillBuffer(commandBuffer, clusterCountBuffer, 0, sizeof(uint32_t), 0);
+        // Reset, an empty dispatch is still a valid one
+        ClusterCountData resetData{ { 0, 1, 1 }, 0 };
+        vkCmdUpdateBuffer(commandBuffer, clusterCountBuffer, 0, sizeof(ClusterCountData), &resetData);
 
         // Barrier for previous frame cluster count and cluster dispatch read
         VkBufferMemoryBarrier2 waitForBuffersBeforeDispatch[2]{};
         // Cluster count
         BufferMemoryBarrier(clusterCountBuffer, waitForBuffersBeforeDispatch[0], VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, 
-            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT, 0, sizeof(uint32_t));
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT, 0, sizeof(ClusterCountData));
         // Cluster dispatch
         BufferMemoryBarrier(clusterDataBuffer, waitForBuffersBeforeDispatch[1], VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT,
             VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_WRITE_BIT, 0, sizeof(ClusterDispatchData) * drawCount);
@@ -348,30 +479,25 @@ namespace BlitzenVulkan
         ClusterCullShaderPushConstant pushConstant
         {
             renderObjectBufferAddress, clusterDispatchBufferAddress, 
-            clusterCountBufferAddress, drawCount
+            clusterCountBufferAddress, drawCount, clusterCapacity
         };
         vkCmdPushConstants(commandBuffer, layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ClusterCullShaderPushConstant), &pushConstant);
         // Dispatch
         vkCmdDispatch(commandBuffer, (drawCount / 64) + 1, 1, 1);
 
-        // Cluster dispatch read barrier
-        VkBufferMemoryBarrier2 clusterDispatchVisibilityBarrier{};
-        BufferMemoryBarrier(clusterDataBuffer, clusterDispatchVisibilityBarrier, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_WRITE_BIT,
+        // Cluster dispatch data and count are read by the cluster culling shader, the count is also its indirect dispatch
+        VkBufferMemoryBarrier2 clusterDispatchVisibilityBarriers[2]{};
+        BufferMemoryBarrier(clusterDataBuffer, clusterDispatchVisibilityBarriers[0], VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_WRITE_BIT,
             VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT, 0, VK_WHOLE_SIZE);
-        PipelineBarrier(commandBuffer, 0, nullptr, 1, &clusterDispatchVisibilityBarrier, 0, nullptr);
-
-        // Cluster count copy barrier
-        VkBufferMemoryBarrier2 copyToStagingBufferBarrier{};
-        BufferMemoryBarrier(clusterCountBuffer, copyToStagingBufferBarrier, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_WRITE_BIT,
-            VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, 0, sizeof(uint32_t));
-        PipelineBarrier(commandBuffer, 0, nullptr, 1, &copyToStagingBufferBarrier, 0, nullptr);
-        // Copy
-        CopyBufferToBuffer(commandBuffer, clusterCountBuffer, clusterCountCopy, sizeof(uint32_t), 0, 0);
+        BufferMemoryBarrier(clusterCountBuffer, clusterDispatchVisibilityBarriers[1], VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_WRITE_BIT,
+            VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_SHADER_READ_BIT,
+            0, sizeof(ClusterCountData));
+        PipelineBarrier(commandBuffer, 0, nullptr, BLIT_ARRAY_SIZE(clusterDispatchVisibilityBarriers), clusterDispatchVisibilityBarriers, 0, nullptr);
     }
 
     static void ClusterCull(VkCommandBuffer commandBuffer, VkPipeline pipeline, VkPipelineLayout layout, uint32_t descriptorWriteCount, VkWriteDescriptorSet* pDescriptorWrites,
-        VkBuffer clusterCountBuffer, AllocatedBuffer& clusterCountCopyBuffer, VkBuffer clusterDispatchBuffer, VkDeviceAddress clusterDispatchBufferAddress, 
-        VkBuffer drawCountBuffer, VkBuffer indirectDrawBuffer, uint32_t dispatchCount, VkDeviceAddress renderObjectBufferAddress, VkInstance instance)
+        VkBuffer clusterCountBuffer, VkDeviceAddress clusterCountBufferAddress, VkBuffer clusterDispatchBuffer, VkDeviceAddress clusterDispatchBufferAddress, 
+        VkBuffer drawCountBuffer, VkBuffer indirectDrawBuffer, VkDeviceAddress renderObjectBufferAddress, VkInstance instance)
     {
         // Draw count reset barrier
         VkBufferMemoryBarrier2 drawCountFillBarrier{};
@@ -403,11 +529,11 @@ namespace BlitzenVulkan
         vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
         ClusterCullShaderPushConstant pushConstant
         { 
-            renderObjectBufferAddress, clusterDispatchBufferAddress, 0, dispatchCount
+            renderObjectBufferAddress, clusterDispatchBufferAddress, clusterCountBufferAddress, 0, 0// The cluster count is read from the count buffer
         };
         vkCmdPushConstants(commandBuffer, layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ClusterCullShaderPushConstant), &pushConstant);
-        // Dispatch
-        vkCmdDispatch(commandBuffer, BlitML::GetComputeShaderGroupSize(dispatchCount, 64) , 1, 1);
+        // Group count and cluster count come from the pre cluster pass, without a readback
+        vkCmdDispatchIndirect(commandBuffer, clusterCountBuffer, offsetof(ClusterCountData, dispatch));
 
         // Barriers stop graphics command read and count read
         VkBufferMemoryBarrier2 waitForCullingShader[2]{};
@@ -466,9 +592,18 @@ namespace BlitzenVulkan
 
         // Draw
         vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
-        vkCmdBindIndexBuffer(commandBuffer, staticBuffers.indexBuffer.bufferHandle, 0, VK_INDEX_TYPE_UINT32);
-        vkCmdDrawIndexedIndirectCount(commandBuffer, staticBuffers.indirectDrawBuffer.buffer.bufferHandle, offsetof(IndirectDrawData, drawIndirect),
-            staticBuffers.indirectCountBuffer.buffer.bufferHandle, 0, IndirectDrawElementCount, sizeof(IndirectDrawData));
+        if constexpr (BlitzenCore::Ce_BuildClusters)
+        {
+            // Cluster commands are read as non indexed (vertex count, instance count, cluster id), the vertex shader fetches the indices
+            vkCmdDrawIndirectCount(commandBuffer, staticBuffers.indirectDrawBuffer.buffer.bufferHandle, offsetof(IndirectDrawData, drawIndirect),
+                staticBuffers.indirectCountBuffer.buffer.bufferHandle, 0, IndirectDrawElementCount, sizeof(IndirectDrawData));
+        }
+        else
+        {
+            vkCmdBindIndexBuffer(commandBuffer, staticBuffers.indexBuffer.bufferHandle, 0, staticBuffers.indexType);
+            vkCmdDrawIndexedIndirectCount(commandBuffer, staticBuffers.indirectDrawBuffer.buffer.bufferHandle, offsetof(IndirectDrawData, drawIndirect),
+                staticBuffers.indirectCountBuffer.buffer.bufferHandle, 0, IndirectDrawElementCount, sizeof(IndirectDrawData));
+        }
 
         // End pass
         vkCmdEndRendering(commandBuffer);
@@ -505,9 +640,18 @@ namespace BlitzenVulkan
 
         // Draw
         vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
-        vkCmdBindIndexBuffer(commandBuffer, staticBuffers.indexBuffer.bufferHandle, 0, VK_INDEX_TYPE_UINT32);
-        vkCmdDrawIndexedIndirectCount(commandBuffer, staticBuffers.indirectDrawBuffer.buffer.bufferHandle, offsetof(IndirectDrawData, drawIndirect),
-            staticBuffers.indirectCountBuffer.buffer.bufferHandle, 0, IndirectDrawElementCount, sizeof(IndirectDrawData));
+        if constexpr (BlitzenCore::Ce_BuildClusters)
+        {
+            // Cluster commands are read as non indexed (vertex count, instance count, cluster id), the vertex shader fetches the indices
+            vkCmdDrawIndirectCount(commandBuffer, staticBuffers.indirectDrawBuffer.buffer.bufferHandle, offsetof(IndirectDrawData, drawIndirect),
+                staticBuffers.indirectCountBuffer.buffer.bufferHandle, 0, IndirectDrawElementCount, sizeof(IndirectDrawData));
+        }
+        else
+        {
+            vkCmdBindIndexBuffer(commandBuffer, staticBuffers.indexBuffer.bufferHandle, 0, staticBuffers.indexType);
+            vkCmdDrawIndexedIndirectCount(commandBuffer, staticBuffers.indirectDrawBuffer.buffer.bufferHandle, offsetof(IndirectDrawData, drawIndirect),
+                staticBuffers.indirectCountBuffer.buffer.bufferHandle, 0, IndirectDrawElementCount, sizeof(IndirectDrawData));
+        }
 
         // End pass
         vkCmdEndRendering(commandBuffer);
@@ -543,7 +687,7 @@ namespace BlitzenVulkan
 
         // Draw
         vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
-        vkCmdBindIndexBuffer(commandBuffer, staticBuffers.indexBuffer.bufferHandle, 0, VK_INDEX_TYPE_UINT32);
+        vkCmdBindIndexBuffer(commandBuffer, staticBuffers.indexBuffer.bufferHandle, 0, staticBuffers.indexType);
         vkCmdDrawIndexedIndirectCount(commandBuffer, staticBuffers.indirectDrawBuffer.buffer.bufferHandle, offsetof(IndirectDrawData, drawIndirect),
             staticBuffers.indirectCountBuffer.buffer.bufferHandle, 0, IndirectDrawElementCount, sizeof(IndirectDrawData));
 
@@ -725,6 +869,8 @@ namespace BlitzenVulkan
         uint32_t waitSemaphoreCount, VkSemaphore* pWaitSemaphores, uint32_t* pImageIndices, VkResult* pResults = nullptr,
         void* pNextChain = nullptr)
     {
+        BLIT_PROFILE_FUNCTION();
+
         VkPresentInfoKHR info{};
         info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
         info.pNext = pNextChain;
@@ -738,7 +884,45 @@ namespace BlitzenVulkan
         info.pImageIndices = pImageIndices;
         info.pResults = pResults;
 
-        vkQueuePresentKHR(queue, &info);
+        QueuePresent(queue, info);
+    }
+
+    // Ends a headless frame. Instead of presenting, the color attachment may be copied to a host visible buffer
+    static void SubmitHeadlessFrame(uint32_t commandBufferCount, VkCommandBuffer* pCommandBuffers, VkQueue queue, VkImage colorAttachment, 
+        VkImageLayout colorAttachmentLayout, VkExtent2D drawExtent, VkBuffer readbackBuffer, uint8_t bReadback, VkSemaphoreSubmitInfo* pWaitSemaphore,
+        VkSemaphore frameTimeline, uint64_t frameSerial)
+    {
+        BLIT_PROFILE_FUNCTION();
+
+        // The readback is recorded at the end of the last command buffer
+        auto commandBuffer{ pCommandBuffers[commandBufferCount - 1] };
+
+        if (bReadback)
+        {
+            VkImageMemoryBarrier2 copySourceBarrier{};
+            ImageMemoryBarrier(colorAttachment, copySourceBarrier, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+                VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, colorAttachmentLayout, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, 
+                VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_REMAINING_MIP_LEVELS);
+            PipelineBarrier(commandBuffer, 0, nullptr, 0, nullptr, 1, &copySourceBarrier);
+
+            VkBufferImageCopy region{};
+            region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            region.imageSubresource.mipLevel = 0;
+            region.imageSubresource.baseArrayLayer = 0;
+            region.imageSubresource.layerCount = 1;
+            region.imageExtent = { drawExtent.width, drawExtent.height, 1 };
+            vkCmdCopyImageToBuffer(commandBuffer, colorAttachment, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffer, 1, &region);
+
+            // The host reads the buffer after the frame fence
+            VkBufferMemoryBarrier2 hostReadBarrier{};
+            BufferMemoryBarrier(readbackBuffer, hostReadBarrier, VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT, 0, VK_WHOLE_SIZE);
+            PipelineBarrier(commandBuffer, 0, nullptr, 1, &hostReadBarrier, 0, nullptr);
+        }
+
+        VkSemaphoreSubmitInfo signalSemaphoreInfo{};
+        CreateSemahoreSubmitInfo(signalSemaphoreInfo, frameTimeline, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, frameSerial);
+        SubmitCommandBuffers(queue, commandBufferCount, pCommandBuffers, pWaitSemaphore != nullptr, pWaitSemaphore, 1, &signalSemaphoreInfo);
     }
 
     static void RecreateSwapchain(VkDevice device, VkPhysicalDevice pdv, VkSurfaceKHR surface, VmaAllocator vma, 
@@ -790,7 +974,7 @@ namespace BlitzenVulkan
 
     void VulkanRenderer::Update(const BlitzenEngine::DrawContext& context)
     {
-        if (context.m_camera.transformData.bWindowResize)
+        if (context.m_camera.transformData.bWindowResize && !m_stats.bHeadless)
         {
             RecreateSwapchain(m_device, m_physicalDevice, m_surface.handle, m_allocator,
                 m_swapchainValues, m_graphicsQueue, m_presentQueue, m_computeQueue,
@@ -813,10 +997,230 @@ namespace BlitzenVulkan
         m_drawCullDescriptors[Ce_TransformBufferDrawCullDescriptorId].pBufferInfo = &vBuffers.transformBuffer.bufferInfo;
     }
 
-    void VulkanRenderer::UpdateObjectTransform(uint32_t transformId, BlitzenEngine::MeshTransform* pTransform)
+    void VulkanRenderer::UpdateObjectTransform(uint32_t transformId, BlitzenEngine::MeshTransform*)
+    {
+        // Every frame has its own buffer, each one reads the transform from the render container the next time it updates,
+        // so the new transform itself is not needed here
+        const uint64_t bit{ 1ull << (transformId % 64) };
+        for (uint8_t i = 0; i < m_framesInFlight; ++i)
+        {
+            auto& buffers{ m_varBuffers[i] };
+            auto& word{ buffers.dirtyTransforms[transformId / 64] };
+            buffers.dirtyTransformCount += !(word & bit);
+            word |= bit;
+        }
+    }
+
+    void VulkanRenderer::RecordFramePass(RecordedPass pass, VkCommandBuffer commandBuffer, const BlitzenEngine::DrawContext& context,
+        VarBuffers& vBuffers, VkImageLayout colorAttachmentWorkingLayout)
     {
-        auto pData = m_varBuffers[m_currentFrame].pTransformData;
-        BlitzenCore::BlitMemCopy(pData + transformId, pTransform, sizeof(BlitzenEngine::MeshTransform));
+        BLIT_PROFILE_FUNCTION();
+
+        // The draw functions write to the descriptor arrays and attachment infos, every thread needs its own
+        VkWriteDescriptorSet graphicsDescriptors[Ce_GraphicsDescriptorWriteArraySize];
+        VkWriteDescriptorSet drawCullDescriptors[Ce_ComputeDescriptorWriteArraySize];
+        BlitzenCore::BlitMemCopy(graphicsDescriptors, m_graphicsDescriptors, sizeof(graphicsDescriptors));
+        BlitzenCore::BlitMemCopy(drawCullDescriptors, m_drawCullDescriptors, sizeof(drawCullDescriptors));
+        auto colorAttachmentInfo{ m_colorAttachmentInfo };
+        auto depthAttachmentInfo{ m_depthAttachmentInfo };
+        auto pTextureSet{ &m_textureDescriptorSets[m_currentFrame] };
+
+        BeginCommandBuffer(commandBuffer, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+
+        // Dynamic state is not inherited between command buffers
+        DefineViewportAndScissor(commandBuffer, m_swapchainValues.swapchainExtent);
+
+        switch (pass)
+        {
+            case RecordedPass::Opaque:
+            {
+                // With clusters the compute command buffer resets them
+                if constexpr (!BlitzenCore::Ce_BuildClusters)
+                {
+                    ResetGpuTimestamps(commandBuffer);
+                }
+
+                // Attachment barriers for layout transitions before rendering
+                VkImageMemoryBarrier2 renderingAttachmentDefinitionBarriers[2] = {};
+                ImageMemoryBarrier(m_colorAttachment.image.image, renderingAttachmentDefinitionBarriers[0], VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_NONE,
+                    VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, colorAttachmentWorkingLayout,
+                    VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_REMAINING_MIP_LEVELS);
+                ImageMemoryBarrier(m_depthAttachment.image.image, renderingAttachmentDefinitionBarriers[1],
+                    VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_NONE,
+                    VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                    VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, VK_IMAGE_ASPECT_DEPTH_BIT,
+                    0, VK_REMAINING_MIP_LEVELS);
+                PipelineBarrier(commandBuffer, 0, nullptr, 0, nullptr, 2, renderingAttachmentDefinitionBarriers);
+
+                if constexpr (BlitzenCore::Ce_BuildClusters)
+                {
+                    // Culls opaque render object clusters
+                    BeginGpuPass(commandBuffer, GpuPass::ClusterCull);
+                    ClusterCull(commandBuffer, m_intialClusterCullPipeline.handle, m_clusterCullLayout.handle,
+                        BLIT_ARRAY_SIZE(drawCullDescriptors), drawCullDescriptors, m_staticBuffers.clusterCountBuffer.bufferHandle,
+                        m_staticBuffers.clusterCountBufferAddress, m_staticBuffers.clusterDispatchBuffer.bufferHandle,
+                        m_staticBuffers.clusterDispatchBufferAddress, m_staticBuffers.indirectCountBuffer.buffer.bufferHandle,
+                        m_staticBuffers.indirectDrawBuffer.buffer.bufferHandle, m_staticBuffers.renderObjectBufferAddress, m_instance);
+                    EndGpuPass(commandBuffer, GpuPass::ClusterCull);
+
+                    BeginGpuPass(commandBuffer, GpuPass::Geometry);
+                    DrawGeometry(commandBuffer, graphicsDescriptors, BLIT_ARRAY_SIZE(graphicsDescriptors),
+                        m_opaqueGeometryPipeline.handle, m_graphicsPipelineLayout.handle, pTextureSet, colorAttachmentInfo,
+                        depthAttachmentInfo, m_drawExtent, m_staticBuffers, m_drawnRenderCount, Ce_InitialCulling, m_instance,
+                        m_stats.bRayTracingSupported, Ce_SinglePointer, &m_staticBuffers.tlasData.handle);
+                    EndGpuPass(commandBuffer, GpuPass::Geometry);
+                    break;
+                }
+
+                if (m_drawnRenderCount == 0)
+                {
+                    // TODO: Change this so that it instantly goes to present and quits the function before going further
+                    DrawBackgroundImage(commandBuffer, m_basicBackgroundPipeline.handle, m_basicBackgroundLayout.handle,
+                        m_instance, m_colorAttachment.image.imageView, m_drawExtent);
+                }
+
+                /*
+                    !RENDER OPERATIONS INFO:
+                    1.The first culling shader is called.
+                      It only works on objects that were visible last frame and are not transparent.
+                      It performs frustum culling and LOD selection.(See InitialDrawCull.comp)
+
+                    2.The first draw pass is called.
+                      It takes the indirect commands and indirect count that were written by the culling shader.
+                      It uses one draw call to draw everything that those buffer specify
+
+                    Pre-3.The depth generation shader is called, to allow for occlusion culling.
+
+                    3.The second culling shader is called.
+                      It does frustum culling and LOD selection on every object. It also does occlusion culling this time.
+                      It only creates indirect draw commands for the objects that were NOT visible last frame.
+                      It also updates the visibility buffer for every object, to affect the next frame.
+                      Transparent objects are ignored
+
+                    4.The second draw pass is called.
+                      It is the exact same as the first one, but gets its commands from the second culling pass.
+
+                    5.The 3rd culling shader is called.
+                      It is the same shader as the second pass but this time ignores opaque objects and operator on transparent ones.
+
+                    6.The final draw pass is called.
+                      It takes the commands from the 3rd culling shader.
+                      Its fragment shader also has a modified specialization constant for alpha discard
+
+                    Steps 1-2 are recorded in the opaque pass, Pre-3 to 4 in the late opaque pass and 5-6 in the transparent pass
+                */
+
+                // Instanced mode replaces steps 1-4 with a single pass. The draw count depends on the visible LODs instead of the visible objects
+                if constexpr (Ce_VkInstanceCulling)
+                {
+                    BeginGpuPass(commandBuffer, GpuPass::DrawCull);
+                    DrawInstanceCullPass(commandBuffer, m_instance, m_drawInstCountResetPipeline.handle, m_drawInstCullPipeline.handle,
+                        m_drawInstCmdPipeline.handle, m_drawCullLayout.handle, m_staticBuffers, m_drawnRenderCount,
+                        BLIT_ARRAY_SIZE(drawCullDescriptors), drawCullDescriptors, m_staticBuffers.renderObjectBufferAddress);
+                    EndGpuPass(commandBuffer, GpuPass::DrawCull);
+
+                    BeginGpuPass(commandBuffer, GpuPass::Geometry);
+                    DrawGeometry(commandBuffer, graphicsDescriptors, BLIT_ARRAY_SIZE(graphicsDescriptors), m_instancedGeometryPipeline.handle,
+                        m_graphicsPipelineLayout.handle, pTextureSet, colorAttachmentInfo, depthAttachmentInfo,
+                        m_drawExtent, m_staticBuffers, m_drawnRenderCount, Ce_InitialCulling, m_instance, m_stats.bRayTracingSupported,
+                        Ce_SinglePointer, &m_staticBuffers.tlasData.handle);
+                    EndGpuPass(commandBuffer, GpuPass::Geometry);
+                }
+                else
+                {
+                    // First culling pass
+                    BeginGpuPass(commandBuffer, GpuPass::DrawCull);
+                    DrawCullFirstPass(commandBuffer, m_instance, m_initialDrawCullPipeline.handle, m_drawCullLayout.handle,
+                        m_staticBuffers, vBuffers, m_drawnRenderCount, BLIT_ARRAY_SIZE(drawCullDescriptors),
+                        drawCullDescriptors, m_staticBuffers.renderObjectBufferAddress);
+                    EndGpuPass(commandBuffer, GpuPass::DrawCull);
+
+                    // First draw pass
+                    BeginGpuPass(commandBuffer, GpuPass::Geometry);
+                    DrawGeometry(commandBuffer, graphicsDescriptors, BLIT_ARRAY_SIZE(graphicsDescriptors), m_opaqueGeometryPipeline.handle,
+                        m_graphicsPipelineLayout.handle, pTextureSet, colorAttachmentInfo, depthAttachmentInfo,
+                        m_drawExtent, m_staticBuffers, m_drawnRenderCount, Ce_InitialCulling, m_instance, m_stats.bRayTracingSupported,
+                        Ce_SinglePointer, &m_staticBuffers.tlasData.handle);
+                    EndGpuPass(commandBuffer, GpuPass::Geometry);
+                }
+                break;
+            }
+
+            case RecordedPass::LateOpaque:
+            {
+                // Depth pyramid generation
+                BeginGpuPass(commandBuffer, GpuPass::DepthPyramid);
+                GenerateDepthPyramid(commandBuffer, m_depthAttachment, m_depthPyramid, m_depthPyramidExtent,
+                    m_depthPyramidMipLevels, m_depthPyramidMips, m_depthPyramidGenerationPipeline.handle,
+                    m_depthPyramidGenerationLayout.handle, m_instance);
+                EndGpuPass(commandBuffer, GpuPass::DepthPyramid);
+
+                // Second culling pass
+                BeginGpuPass(commandBuffer, GpuPass::LateCull);
+                DrawCullOcclusionPass(commandBuffer, m_instance, m_lateDrawCullPipeline.handle, m_drawCullLayout.handle,
+                    m_staticBuffers, vBuffers, m_depthPyramid, m_depthAttachment, m_drawnRenderCount,
+                    BLIT_ARRAY_SIZE(drawCullDescriptors), drawCullDescriptors, m_staticBuffers.renderObjectBufferAddress);
+                EndGpuPass(commandBuffer, GpuPass::LateCull);
+
+                // Second draw pass
+                BeginGpuPass(commandBuffer, GpuPass::LateGeometry);
+                DrawGeometry(commandBuffer, graphicsDescriptors, BLIT_ARRAY_SIZE(graphicsDescriptors),
+                    m_opaqueGeometryPipeline.handle, m_graphicsPipelineLayout.handle, pTextureSet, colorAttachmentInfo, depthAttachmentInfo,
+                    m_drawExtent, m_staticBuffers, m_drawnRenderCount, Ce_LateCulling, m_instance, m_stats.bRayTracingSupported,
+                    Ce_SinglePointer, &m_staticBuffers.tlasData.handle);
+                EndGpuPass(commandBuffer, GpuPass::LateGeometry);
+                break;
+            }
+
+            case RecordedPass::Onpc:
+            {
+                // Replace the regular render object write with the onpc one
+                graphicsDescriptors[2] = m_staticBuffers.onpcReflectiveRenderObjectBuffer.descriptorWrite;
+                drawCullDescriptors[1] = m_staticBuffers.onpcReflectiveRenderObjectBuffer.descriptorWrite;
+
+                DispatchRenderObjectCullingComputeShader(commandBuffer, m_onpcDrawCullPipeline.handle, m_drawCullLayout.handle,
+                    BLIT_ARRAY_SIZE(drawCullDescriptors), drawCullDescriptors, m_staticBuffers.indirectCountBuffer.buffer.bufferHandle,
+                    m_staticBuffers.indirectDrawBuffer.buffer.bufferHandle, m_staticBuffers.visibilityBuffer.buffer.bufferHandle,
+                    m_depthAttachment, m_depthPyramid, m_drawnOnpcRenderCount, m_staticBuffers.renderObjectBufferAddress,
+                    Ce_LateCulling, m_instance);
+
+                auto onpcProjectionMatrix{ context.m_camera.onbcProjectionMatrix };
+                DrawGeometryONPC(commandBuffer, graphicsDescriptors, BLIT_ARRAY_SIZE(graphicsDescriptors), m_onpcReflectiveGeometryPipeline.handle,
+                    m_onpcReflectiveGeometryLayout.handle, pTextureSet, colorAttachmentInfo, depthAttachmentInfo,
+                    m_drawExtent, m_staticBuffers, m_drawnOnpcRenderCount, m_instance,
+                    m_stats.bRayTracingSupported, Ce_SinglePointer, &m_staticBuffers.tlasData.handle, &onpcProjectionMatrix);
+                break;
+            }
+
+            case RecordedPass::Transparents:
+            {
+                BeginGpuPass(commandBuffer, GpuPass::Transparents);
+                if constexpr (BlitzenCore::Ce_BuildClusters)
+                {
+                    ClusterCull(commandBuffer, m_transparentClusterCullPipeline.handle, m_clusterCullLayout.handle,
+                        BLIT_ARRAY_SIZE(drawCullDescriptors), drawCullDescriptors, m_staticBuffers.transparentClusterCountBuffer.bufferHandle,
+                        m_staticBuffers.transparentClusterCountBufferAddress, m_staticBuffers.transparentClusterDispatchBuffer.bufferHandle,
+                        m_staticBuffers.transparentClusterDispatchBufferAddress, m_staticBuffers.indirectCountBuffer.buffer.bufferHandle,
+                        m_staticBuffers.indirectDrawBuffer.buffer.bufferHandle, m_staticBuffers.transparentRenderObjectBufferAddress, m_instance);
+                }
+                else
+                {
+                    DrawCullFirstPass(commandBuffer, m_instance, m_transparentDrawCullPipeline.handle, m_drawCullLayout.handle,
+                        m_staticBuffers, vBuffers, m_drawnTransparentRenderCount, BLIT_ARRAY_SIZE(drawCullDescriptors),
+                        drawCullDescriptors, m_staticBuffers.transparentRenderObjectBufferAddress);
+                }
+
+                DrawTransparents(commandBuffer, graphicsDescriptors, BLIT_ARRAY_SIZE(graphicsDescriptors),
+                    m_postPassGeometryPipeline.handle, m_graphicsPipelineLayout.handle, pTextureSet, colorAttachmentInfo, depthAttachmentInfo,
+                    m_drawExtent, m_staticBuffers, m_drawnTransparentRenderCount, m_instance,
+                    m_stats.bRayTracingSupported, Ce_SinglePointer, &m_staticBuffers.tlasData.handle);
+                EndGpuPass(commandBuffer, GpuPass::Transparents);
+                break;
+            }
+
+            default:
+                break;
+        }
     }
 
     void VulkanRenderer::DrawFrame(BlitzenEngine::DrawContext& context)
@@ -824,10 +1228,32 @@ namespace BlitzenVulkan
         auto& fTools = m_frameToolsList[m_currentFrame];
         auto& vBuffers = m_varBuffers[m_currentFrame];
 
-        // Waits for the fence in the current frame tools struct to be signaled and resets it for next time when it gets signalled
-        vkWaitForFences(m_device, 1, &fTools.inFlightFence.handle, VK_TRUE, ce_fenceTimeout);
-        VK_CHECK(vkResetFences(m_device, 1, &(fTools.inFlightFence.handle)))
-        UpdateBuffers(context, fTools, vBuffers, m_transferQueue.handle);
+        // Waits for the frame that last used these frame tools, which signaled the frame timeline m_framesInFlight values ago
+        auto frameSerial{ ++m_frameSerial };
+        if (frameSerial > m_framesInFlight)
+        {
+            BLIT_PROFILE_ZONE("WaitForFrameTimeline");
+            WaitTimelineSemaphore(m_device, m_frameTimeline.handle, frameSerial - m_framesInFlight, ce_fenceTimeout);
+        }
+        ReadGpuTimestamps(fTools);
+
+        // Scene batches published by the loading thread since the last frame. Streaming starts once the last one is drawn
+        ApplySceneBatch();
+        if constexpr (Ce_TextureStreaming)
+        {
+            if (m_bSceneComplete)
+            {
+                UpdateTextureStreaming(context);
+            }
+        }
+        WriteDirtyTextureDescriptors();
+
+        // Nothing waits for the transfer when no transform changed or when they were written in place
+        uint8_t bBuffersUpdated{ 0 };
+        {
+            std::lock_guard<std::mutex> queueLock(m_queueSubmitMutex);
+            bBuffersUpdated = UpdateBuffers(context, fTools, vBuffers, m_transferQueue.handle, m_transferTimeline.handle, frameSerial);
+        }
 
         if (context.m_camera.transformData.bFreezeFrustum)
         {
@@ -840,294 +1266,177 @@ namespace BlitzenVulkan
         }
 
         // Swapchain image, needed to present the color attachment results
-        uint32_t swapchainIdx;
-        vkAcquireNextImageKHR(m_device, m_swapchainValues.swapchainHandle, ce_swapchainImageTimeout, fTools.imageAcquiredSemaphore.handle, VK_NULL_HANDLE, &swapchainIdx);
+        uint32_t swapchainIdx{ 0 };
+        if (!m_stats.bHeadless)
+        {
+            BLIT_PROFILE_ZONE("AcquireSwapchainImage");
+            vkAcquireNextImageKHR(m_device, m_swapchainValues.swapchainHandle, ce_swapchainImageTimeout, fTools.imageAcquiredSemaphore.handle, VK_NULL_HANDLE, &swapchainIdx);
+        }
 
         // Color attachment working layout depends on if there are any render objects
-        auto colorAttachmentWorkingLayout = context.m_renders.m_renderCount ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
+        auto colorAttachmentWorkingLayout = m_drawnRenderCount ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
 
         if constexpr (BlitzenCore::Ce_BuildClusters)
         {
             // Fist culling pass with separate command buffer
             BeginCommandBuffer(fTools.computeCommandBuffer, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+            ResetGpuTimestamps(fTools.computeCommandBuffer);
+            BeginGpuPass(fTools.computeCommandBuffer, GpuPass::PreClusterCull);
 
 			// Generates cluster dispatch data and count for the opaque render objects
             PreClusterDrawCull(fTools.computeCommandBuffer, m_preClusterCullPipeline.handle, m_clusterCullLayout.handle,
                 BLIT_ARRAY_SIZE(m_drawCullDescriptors), m_drawCullDescriptors, m_staticBuffers.clusterCountBuffer.bufferHandle,
                 m_staticBuffers.clusterCountBufferAddress, m_staticBuffers.clusterDispatchBuffer.bufferHandle,
-                m_staticBuffers.clusterDispatchBufferAddress, m_staticBuffers.clusterCountCopyBuffer.bufferHandle,
-                context.m_renders.m_renderCount, m_staticBuffers.renderObjectBufferAddress, Ce_InitialCulling, m_instance);
+                m_staticBuffers.clusterDispatchBufferAddress, m_drawnRenderCount, m_staticBuffers.renderObjectBufferAddress, 
+                GetClusterDispatchCapacity(IndirectDrawElementCount, m_stats.maxClusterCullGroupCount), Ce_InitialCulling, m_instance);
 
 			// Generates cluster dispatch data and count for the transparent render objects
             PreClusterDrawCull(fTools.computeCommandBuffer, m_preClusterCullPipeline.handle, m_clusterCullLayout.handle,
 				BLIT_ARRAY_SIZE(m_drawCullDescriptors), m_drawCullDescriptors, m_staticBuffers.transparentClusterCountBuffer.bufferHandle,
                 m_staticBuffers.transparentClusterCountBufferAddress, m_staticBuffers.transparentClusterDispatchBuffer.bufferHandle,
-                m_staticBuffers.transparentClusterDispatchBufferAddress, m_staticBuffers.transparentClusterCountCopyBuffer.bufferHandle,
-				uint32_t(context.m_renders.m_transparentRenderCount), m_staticBuffers.transparentRenderObjectBufferAddress,
-				Ce_InitialCulling, m_instance);
+                m_staticBuffers.transparentClusterDispatchBufferAddress, m_drawnTransparentRenderCount, m_staticBuffers.transparentRenderObjectBufferAddress,
+				GetClusterDispatchCapacity(Ce_TrasparentDispatchElementCount, m_stats.maxClusterCullGroupCount), Ce_InitialCulling, m_instance);
+            EndGpuPass(fTools.computeCommandBuffer, GpuPass::PreClusterCull);
 
-            // Submits command buffer to generate cluster dispatch count
+            // Submits command buffer to generate cluster dispatch count. 
+            // The graphics queue waits for it on the GPU, cluster culling is dispatched from the count buffer
             VkSemaphoreSubmitInfo bufferUpdateWaitSemaphore{};
-            CreateSemahoreSubmitInfo(bufferUpdateWaitSemaphore, fTools.buffersReadySemaphore.handle, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+            CreateSemahoreSubmitInfo(bufferUpdateWaitSemaphore, m_transferTimeline.handle, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, frameSerial);
             VkSemaphoreSubmitInfo waitForClusterData{};
-            CreateSemahoreSubmitInfo(waitForClusterData, fTools.preClusterCullingDoneSemaphore.handle,VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
-            SubmitCommandBuffer(m_computeQueue.handle, fTools.computeCommandBuffer, Ce_SinglePointer, 
-                &bufferUpdateWaitSemaphore, Ce_SinglePointer, &waitForClusterData, fTools.preCulsterCullingFence.handle);
-            vkWaitForFences(m_device, Ce_SinglePointer, &fTools.preCulsterCullingFence.handle, VK_TRUE, ce_fenceTimeout);
-            vkResetFences(m_device, Ce_SinglePointer, &fTools.preCulsterCullingFence.handle);
-
-            // Command recording begins again
-            BeginCommandBuffer(fTools.commandBuffer, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
-            
-            DefineViewportAndScissor(fTools.commandBuffer, m_swapchainValues.swapchainExtent);
-
-            // Attachment barriers for layout transitions before rendering
-            VkImageMemoryBarrier2 renderingAttachmentDefinitionBarriers[2] = {};
-            ImageMemoryBarrier(m_colorAttachment.image.image, renderingAttachmentDefinitionBarriers[0],
-                VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_NONE,
-                VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
-                VK_IMAGE_LAYOUT_UNDEFINED, colorAttachmentWorkingLayout, VK_IMAGE_ASPECT_COLOR_BIT,
-                0, VK_REMAINING_MIP_LEVELS);
-            ImageMemoryBarrier(m_depthAttachment.image.image, renderingAttachmentDefinitionBarriers[1],
-                VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_NONE,
-                VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
-                VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, VK_IMAGE_ASPECT_DEPTH_BIT,
-                0, VK_REMAINING_MIP_LEVELS);
-            PipelineBarrier(fTools.commandBuffer, 0, nullptr, 0, nullptr, 2, renderingAttachmentDefinitionBarriers);
-
-            auto dispatchCount
-            {
-                static_cast<uint32_t>(*reinterpret_cast<uint32_t*>(m_staticBuffers.clusterCountCopyBuffer.allocationInfo.pMappedData))
-            };
-			auto transparentDispatchCount
-			{
-				static_cast<uint32_t>(*reinterpret_cast<uint32_t*>(m_staticBuffers.transparentClusterCountCopyBuffer.allocationInfo.pMappedData))
-			};
-
-            // Culls opaque render object clusters
-            ClusterCull(fTools.commandBuffer, m_intialClusterCullPipeline.handle, m_clusterCullLayout.handle,
-                BLIT_ARRAY_SIZE(m_drawCullDescriptors), m_drawCullDescriptors, m_staticBuffers.clusterCountBuffer.bufferHandle,
-                m_staticBuffers.clusterCountCopyBuffer, m_staticBuffers.clusterDispatchBuffer.bufferHandle,
-                m_staticBuffers.clusterDispatchBufferAddress, m_staticBuffers.indirectCountBuffer.buffer.bufferHandle,
-                m_staticBuffers.indirectDrawBuffer.buffer.bufferHandle, dispatchCount, m_staticBuffers.renderObjectBufferAddress, m_instance);
-
-            DrawGeometry(fTools.commandBuffer, m_graphicsDescriptors, BLIT_ARRAY_SIZE(m_graphicsDescriptors),
-                m_opaqueGeometryPipeline.handle, m_graphicsPipelineLayout.handle, &m_textureDescriptorSet, m_colorAttachmentInfo,
-                m_depthAttachmentInfo, m_drawExtent, m_staticBuffers, dispatchCount, Ce_InitialCulling, m_instance,
-                m_stats.bRayTracingSupported, Ce_SinglePointer, &m_staticBuffers.tlasData.handle);
-            
-            if (m_stats.bTranspartentObjectsExist)
-            {
-                ClusterCull(fTools.commandBuffer, m_transparentClusterCullPipeline.handle, m_clusterCullLayout.handle,
-                    BLIT_ARRAY_SIZE(m_drawCullDescriptors), m_drawCullDescriptors, m_staticBuffers.transparentClusterCountBuffer.bufferHandle,
-                    m_staticBuffers.transparentClusterCountCopyBuffer, m_staticBuffers.transparentClusterDispatchBuffer.bufferHandle,
-                    m_staticBuffers.transparentClusterDispatchBufferAddress,m_staticBuffers.indirectCountBuffer.buffer.bufferHandle,
-                    m_staticBuffers.indirectDrawBuffer.buffer.bufferHandle, transparentDispatchCount, m_staticBuffers.transparentRenderObjectBufferAddress, 
-                    m_instance);
-
-                DrawTransparents(fTools.commandBuffer, m_graphicsDescriptors, BLIT_ARRAY_SIZE(m_graphicsDescriptors),
-                    m_postPassGeometryPipeline.handle, m_graphicsPipelineLayout.handle, &m_textureDescriptorSet, m_colorAttachmentInfo, m_depthAttachmentInfo,
-                    m_drawExtent, m_staticBuffers, transparentDispatchCount, m_instance, m_stats.bRayTracingSupported, Ce_SinglePointer, &m_staticBuffers.tlasData.handle);
-            }
-
-
-            // Image barriers to transition the layout of the color attachment and the swapchain image
-            VkImageMemoryBarrier2 colorAttachmentTransferBarriers[2] = {};
-            ImageMemoryBarrier(m_colorAttachment.image.image, colorAttachmentTransferBarriers[0], VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
-                VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT, colorAttachmentWorkingLayout, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_REMAINING_MIP_LEVELS);
-            ImageMemoryBarrier(m_swapchainValues.swapchainImages[size_t(swapchainIdx)], colorAttachmentTransferBarriers[1], VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_NONE,
-                VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_ASPECT_COLOR_BIT,
-                0, VK_REMAINING_MIP_LEVELS);
-            PipelineBarrier(fTools.commandBuffer, 0, nullptr, 0, nullptr, 2, colorAttachmentTransferBarriers);
-
-            // Copies the color attachment to the swapchain image
-            CopyColorAttachmentToSwapchainImage(fTools.commandBuffer, m_swapchainValues.swapchainImageViews[swapchainIdx],
-                m_swapchainValues.swapchainImages[swapchainIdx], m_colorAttachment,m_drawExtent, m_generatePresentationPipeline.handle, 
-                m_generatePresentationLayout.handle, m_instance);
+            CreateSemahoreSubmitInfo(waitForClusterData, m_computeTimeline.handle, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, frameSerial);
+            std::lock_guard<std::mutex> queueLock(m_queueSubmitMutex);
+            SubmitCommandBuffer(m_computeQueue.handle, fTools.computeCommandBuffer, bBuffersUpdated ? Ce_SinglePointer : 0,
+                &bufferUpdateWaitSemaphore, Ce_SinglePointer, &waitForClusterData);
+        }
 
-            VkSemaphoreSubmitInfo waitSemaphores[2]{ {}, {} };
-            CreateSemahoreSubmitInfo(waitSemaphores[0], fTools.imageAcquiredSemaphore.handle, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
-            CreateSemahoreSubmitInfo(waitSemaphores[1], fTools.preClusterCullingDoneSemaphore.handle, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
-            VkSemaphoreSubmitInfo signalSemaphore{};
-            CreateSemahoreSubmitInfo(signalSemaphore, fTools.readyToPresentSemaphore.handle, VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT);
-            SubmitCommandBuffer(m_graphicsQueue.handle, fTools.commandBuffer, 2, waitSemaphores, 1, &signalSemaphore, fTools.inFlightFence.handle);
+        // Passes are independent on the CPU, the barriers recorded in each one order them on the GPU.
+        // The loading thread might have the workers for its uploads, the passes are recorded here then
+        RecordedPass passes[Ce_RecordedPassCount];
+        uint32_t passCount{ 0 };
+        passes[passCount++] = RecordedPass::Opaque;
+        if constexpr (!BlitzenCore::Ce_BuildClusters && !Ce_VkInstanceCulling)
+        {
+            passes[passCount++] = RecordedPass::LateOpaque;
+        }
+        // Onpc culling reads the depth pyramid, so it only runs with the two pass path
+        if (!BlitzenCore::Ce_BuildClusters && !Ce_VkInstanceCulling && m_stats.bObliqueNearPlaneClippingObjectsExist)
+        {
+            passes[passCount++] = RecordedPass::Onpc;
+        }
+        if (m_stats.bTranspartentObjectsExist)
+        {
+            passes[passCount++] = RecordedPass::Transparents;
+        }
 
-            PresentToSwapchain(m_device, m_graphicsQueue.handle, &m_swapchainValues.swapchainHandle,
-                1, 1, &fTools.readyToPresentSemaphore.handle, &swapchainIdx);
+        // The main command buffer goes last, it ends the frame
+        VkCommandBuffer commandBuffers[Ce_RecordedPassCount + 1];
+        {
+            BLIT_PROFILE_ZONE("RecordPasses");
+            BlitzenCore::GetTaskPool().TryParallelFor(passCount, [&](size_t i)
+            {
+                commandBuffers[i] = fTools.passCommandBuffers[size_t(passes[i])];
+                RecordFramePass(passes[i], commandBuffers[i], context, vBuffers, colorAttachmentWorkingLayout);
+            });
         }
+        commandBuffers[passCount] = fTools.commandBuffer;
+        BeginCommandBuffer(fTools.commandBuffer, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
 
+        // Cluster culling is dispatched from the pre cluster results, otherwise only the transform copy has to be waited for
+        VkSemaphoreSubmitInfo frameDataWait{};
+        uint8_t bFrameDataWait{ 1 };
+        if constexpr (BlitzenCore::Ce_BuildClusters)
+        {
+            CreateSemahoreSubmitInfo(frameDataWait, m_computeTimeline.handle, VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, frameSerial);
+        }
         else
         {
-            // The command buffer recording begin here (stops when submit is called)
-            BeginCommandBuffer(fTools.commandBuffer, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
-
-            // The viewport and scissor are dynamic, so they should be set here
-            DefineViewportAndScissor(fTools.commandBuffer, m_swapchainValues.swapchainExtent);
-            // Attachment barriers for layout transitions before rendering
-            VkImageMemoryBarrier2 renderingAttachmentDefinitionBarriers[2] = {};
-            ImageMemoryBarrier(m_colorAttachment.image.image, renderingAttachmentDefinitionBarriers[0], VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_NONE,
-                VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, colorAttachmentWorkingLayout, 
-                VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_REMAINING_MIP_LEVELS);
-            ImageMemoryBarrier(m_depthAttachment.image.image, renderingAttachmentDefinitionBarriers[1],
-                VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_ACCESS_2_NONE,
-                VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
-                VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL, VK_IMAGE_ASPECT_DEPTH_BIT,
-                0, VK_REMAINING_MIP_LEVELS);
-            PipelineBarrier(fTools.commandBuffer, 0, nullptr, 0, nullptr, 2, renderingAttachmentDefinitionBarriers);
-
-            if (context.m_renders.m_renderCount == 0)
-            {
-                // TODO: Change this so that it instantly goes to present and quits the function before going further
-                DrawBackgroundImage(fTools.commandBuffer, m_basicBackgroundPipeline.handle, m_basicBackgroundLayout.handle,
-                m_instance, m_colorAttachment.image.imageView, m_drawExtent);
-            }
-            /*
-                !RENDER OPERATIONS INFO:
-                1.The first culling shader is called.
-                  It only works on objects that were visible last frame and are not transparent.
-                  It performs frustum culling and LOD selection.(See InitialDrawCull.comp)
-
-                2.The first draw pass is called.
-                  It takes the indirect commands and indirect count that were written by the culling shader.
-                  It uses one draw call to draw everything that those buffer specify
-
-                Pre-3.The depth generation shader is called, to allow for occlusion culling.
-
-                3.The second culling shader is called.
-                  It does frustum culling and LOD selection on every object. It also does occlusion culling this time.
-                  It only creates indirect draw commands for the objects that were NOT visible last frame.
-                  It also updates the visibility buffer for every object, to affect the next frame.
-                  Transparent objects are ignored
-
-                4.The second draw pass is called.
-                  It is the exact same as the first one, but gets its commands from the second culling pass.
-
-                5.The 3rd culling shader is called.
-                  It is the same shader as the second pass but this time ignores opaque objects and operator on transparent ones.
-
-                6.The final draw pass is called.
-                  It takes the commands from the 3rd culling shader.
-                  Its fragment shader also has a modified specialization constant for alpha discard
-            */
-
-            // First culling pass
-            DrawCullFirstPass(fTools.commandBuffer, m_instance, m_initialDrawCullPipeline.handle, m_drawCullLayout.handle,
-                m_staticBuffers, vBuffers, context.m_renders.m_renderCount, BLIT_ARRAY_SIZE(m_drawCullDescriptors),
-                m_drawCullDescriptors, m_staticBuffers.renderObjectBufferAddress);
-
-            // First draw pass
-            DrawGeometry(fTools.commandBuffer, m_graphicsDescriptors, BLIT_ARRAY_SIZE(m_graphicsDescriptors), m_opaqueGeometryPipeline.handle, 
-                m_graphicsPipelineLayout.handle, &m_textureDescriptorSet, m_colorAttachmentInfo, m_depthAttachmentInfo,
-                m_drawExtent, m_staticBuffers, context.m_renders.m_renderCount, Ce_InitialCulling, m_instance, m_stats.bRayTracingSupported,
-                Ce_SinglePointer, &m_staticBuffers.tlasData.handle);
-
-            // Depth pyramid generation
-            GenerateDepthPyramid(fTools.commandBuffer, m_depthAttachment, m_depthPyramid, m_depthPyramidExtent,
-                m_depthPyramidMipLevels, m_depthPyramidMips, m_depthPyramidGenerationPipeline.handle,
-                m_depthPyramidGenerationLayout.handle, m_instance);
-
-            // Second culling pass 
-            DrawCullOcclusionPass(fTools.commandBuffer, m_instance, m_lateDrawCullPipeline.handle, m_drawCullLayout.handle,
-                m_staticBuffers, vBuffers, m_depthPyramid, m_depthAttachment, context.m_renders.m_renderCount,
-                BLIT_ARRAY_SIZE(m_drawCullDescriptors), m_drawCullDescriptors, m_staticBuffers.renderObjectBufferAddress);
-
-            // Second draw pass
-            DrawGeometry(fTools.commandBuffer, m_graphicsDescriptors, BLIT_ARRAY_SIZE(m_graphicsDescriptors),
-                m_opaqueGeometryPipeline.handle, m_graphicsPipelineLayout.handle, &m_textureDescriptorSet, m_colorAttachmentInfo, m_depthAttachmentInfo,
-                m_drawExtent, m_staticBuffers, context.m_renders.m_renderCount, Ce_LateCulling, m_instance, m_stats.bRayTracingSupported,
-                Ce_SinglePointer, &m_staticBuffers.tlasData.handle);
-
-            if (m_stats.bObliqueNearPlaneClippingObjectsExist)
-            {
-                // Replace the regular render object write with the onpc one
-                m_graphicsDescriptors[2] = m_staticBuffers.onpcReflectiveRenderObjectBuffer.descriptorWrite;
-                m_drawCullDescriptors[1] = m_staticBuffers.onpcReflectiveRenderObjectBuffer.descriptorWrite;
+            CreateSemahoreSubmitInfo(frameDataWait, m_transferTimeline.handle, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, frameSerial);
+            bFrameDataWait = bBuffersUpdated;
+        }
 
-                DispatchRenderObjectCullingComputeShader(fTools.commandBuffer, m_onpcDrawCullPipeline.handle, m_drawCullLayout.handle,
-                    BLIT_ARRAY_SIZE(m_drawCullDescriptors), m_drawCullDescriptors, m_staticBuffers.indirectCountBuffer.buffer.bufferHandle,
-                    m_staticBuffers.indirectDrawBuffer.buffer.bufferHandle, m_staticBuffers.visibilityBuffer.buffer.bufferHandle,
-                    m_depthAttachment, m_depthPyramid, context.m_renders.m_onpcRenderCount, m_staticBuffers.renderObjectBufferAddress,
-                    Ce_LateCulling, m_instance);
+        if (m_stats.bHeadless)
+        {
+            std::lock_guard<std::mutex> queueLock(m_queueSubmitMutex);
+            SubmitHeadlessFrame(passCount + 1, commandBuffers, m_graphicsQueue.handle, m_colorAttachment.image.image, colorAttachmentWorkingLayout,
+                m_drawExtent, m_colorReadbackBuffer.bufferHandle, m_bColorReadbackRequested, bFrameDataWait ? &frameDataWait : nullptr,
+                m_frameTimeline.handle, frameSerial);
+            m_bColorReadbackReady = m_bColorReadbackReady || m_bColorReadbackRequested;
+            m_bColorReadbackRequested = 0;
+            m_currentFrame = (m_currentFrame + 1) % m_framesInFlight;
+            return;
+        }
 
-                DrawGeometryONPC(fTools.commandBuffer, m_graphicsDescriptors, BLIT_ARRAY_SIZE(m_graphicsDescriptors), m_onpcReflectiveGeometryPipeline.handle, 
-                    m_onpcReflectiveGeometryLayout.handle, &m_textureDescriptorSet, m_colorAttachmentInfo, m_depthAttachmentInfo,
-                    m_drawExtent, m_staticBuffers, context.m_renders.m_onpcRenderCount, m_instance,
-                    m_stats.bRayTracingSupported, Ce_SinglePointer, &m_staticBuffers.tlasData.handle, &context.m_camera.onbcProjectionMatrix);
-            }
+        /*
+        Presentation:
+        -The color attachment is copied to the current swapchain image
+        -The commands are submitted
+        -The swapchain image is presented
+        */
+
+        // Image barriers to transition the layout of the color attachment and the swapchain image
+        BeginGpuPass(fTools.commandBuffer, GpuPass::PresentationCopy);
+        VkImageMemoryBarrier2 colorAttachmentTransferBarriers[2] = {};
+        ImageMemoryBarrier(m_colorAttachment.image.image, colorAttachmentTransferBarriers[0],
+            VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT,
+            colorAttachmentWorkingLayout, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_REMAINING_MIP_LEVELS);
+        ImageMemoryBarrier(m_swapchainValues.swapchainImages[static_cast<size_t>(swapchainIdx)],
+            colorAttachmentTransferBarriers[1],
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_NONE,
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_WRITE_BIT,
+            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_ASPECT_COLOR_BIT,
+            0, VK_REMAINING_MIP_LEVELS);
+        PipelineBarrier(fTools.commandBuffer, 0, nullptr, 0, nullptr, 2, colorAttachmentTransferBarriers);
 
-            if (m_stats.bTranspartentObjectsExist)
-            {
-                DrawCullFirstPass(fTools.commandBuffer, m_instance, m_transparentDrawCullPipeline.handle, m_drawCullLayout.handle,
-                    m_staticBuffers, vBuffers, uint32_t(context.m_renders.m_transparentRenderCount), BLIT_ARRAY_SIZE(m_drawCullDescriptors),
-                    m_drawCullDescriptors, m_staticBuffers.transparentRenderObjectBufferAddress);
+        // Copies the color attachment to the swapchain image
+        if constexpr (BlitzenCore::Ce_DepthPyramidDebug && !BlitzenCore::Ce_BuildClusters && !Ce_VkInstanceCulling)
+        {
+            CopyPyramidToSwapchain(m_instance, fTools.commandBuffer, m_depthPyramid, m_swapchainValues, m_drawExtent,
+                m_depthPyramidExtent, m_depthPyramidMipLevels, m_depthPyramidMips, m_generatePresentationPipeline.handle, 
+                m_generatePresentationLayout.handle, swapchainIdx, context.m_camera.transformData.debugPyramidLevel, 
+                m_depthAttachment.sampler.handle);
+        }
+        else
+        {
+            CopyColorAttachmentToSwapchainImage(fTools.commandBuffer, m_swapchainValues.swapchainImageViews[swapchainIdx],
+                m_swapchainValues.swapchainImages[swapchainIdx], m_colorAttachment, m_drawExtent, m_generatePresentationPipeline.handle,
+                m_generatePresentationLayout.handle, m_instance);
+        }
+        EndGpuPass(fTools.commandBuffer, GpuPass::PresentationCopy);
 
-                DrawTransparents(fTools.commandBuffer, m_graphicsDescriptors, BLIT_ARRAY_SIZE(m_graphicsDescriptors),
-                    m_postPassGeometryPipeline.handle, m_graphicsPipelineLayout.handle, &m_textureDescriptorSet, m_colorAttachmentInfo, m_depthAttachmentInfo,
-                    m_drawExtent, m_staticBuffers, uint32_t(context.m_renders.m_transparentRenderCount), m_instance,
-                    m_stats.bRayTracingSupported, Ce_SinglePointer, &m_staticBuffers.tlasData.handle);
-            }
+        // Adds semaphores and submits every command buffer of the frame in one batch
+        VkSemaphoreSubmitInfo waitSemaphores[2]{ {}, frameDataWait };
+        CreateSemahoreSubmitInfo(waitSemaphores[0], fTools.imageAcquiredSemaphore.handle, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+        VkSemaphoreSubmitInfo signalSemaphores[2]{ {}, {} };
+        CreateSemahoreSubmitInfo(signalSemaphores[0], fTools.readyToPresentSemaphore.handle, VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT);
+        CreateSemahoreSubmitInfo(signalSemaphores[1], m_frameTimeline.handle, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, frameSerial);
+        std::lock_guard<std::mutex> queueLock(m_queueSubmitMutex);
+        SubmitCommandBuffers(m_graphicsQueue.handle, passCount + 1, commandBuffers, bFrameDataWait ? 2 : 1, waitSemaphores, 2, signalSemaphores);
 
-            /*
-            Presentation:
-            -The color attachment is copied to the current swapchain image
-            -The commands are submitted
-            -The swapchain image is presented
-            */
-
-            // Image barriers to transition the layout of the color attachment and the swapchain image
-            VkImageMemoryBarrier2 colorAttachmentTransferBarriers[2] = {};
-            ImageMemoryBarrier(m_colorAttachment.image.image, colorAttachmentTransferBarriers[0],
-                VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
-                VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT,
-                colorAttachmentWorkingLayout, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_REMAINING_MIP_LEVELS);
-            ImageMemoryBarrier(m_swapchainValues.swapchainImages[static_cast<size_t>(swapchainIdx)],
-                colorAttachmentTransferBarriers[1],
-                VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_NONE,
-                VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_WRITE_BIT,
-                VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_ASPECT_COLOR_BIT,
-                0, VK_REMAINING_MIP_LEVELS);
-            PipelineBarrier(fTools.commandBuffer, 0, nullptr, 0, nullptr, 2, colorAttachmentTransferBarriers);
-
-            // Copies the color attachment to the swapchain image
-            if constexpr (BlitzenCore::Ce_DepthPyramidDebug)
-            {
-                CopyPyramidToSwapchain(m_instance, fTools.commandBuffer, m_depthPyramid, m_swapchainValues, m_drawExtent,
-                    m_depthPyramidExtent, m_depthPyramidMipLevels, m_depthPyramidMips, m_generatePresentationPipeline.handle, 
-                    m_generatePresentationLayout.handle, swapchainIdx, context.m_camera.transformData.debugPyramidLevel, 
-                    m_depthAttachment.sampler.handle);
-            }
-            else
-            {
-                CopyColorAttachmentToSwapchainImage(fTools.commandBuffer, m_swapchainValues.swapchainImageViews[swapchainIdx],
-                    m_swapchainValues.swapchainImages[swapchainIdx], m_colorAttachment, m_drawExtent, m_generatePresentationPipeline.handle,
-                    m_generatePresentationLayout.handle, m_instance);
-            }
-            
-
-            // Adds semaphores and submits command buffer
-            VkSemaphoreSubmitInfo waitSemaphores[2]{ {}, {} };
-            CreateSemahoreSubmitInfo(waitSemaphores[0], fTools.imageAcquiredSemaphore.handle, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
-            CreateSemahoreSubmitInfo(waitSemaphores[1], fTools.buffersReadySemaphore.handle, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT);
-            VkSemaphoreSubmitInfo signalSemaphore{};
-            CreateSemahoreSubmitInfo(signalSemaphore, fTools.readyToPresentSemaphore.handle, VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT);
-            SubmitCommandBuffer(m_graphicsQueue.handle, fTools.commandBuffer, 2, waitSemaphores, 1, &signalSemaphore, fTools.inFlightFence.handle);
-
-            PresentToSwapchain(m_device, m_graphicsQueue.handle, &m_swapchainValues.swapchainHandle, 1, 1, 
-                &fTools.readyToPresentSemaphore.handle, &swapchainIdx);
-        }
+        PresentToSwapchain(m_device, m_graphicsQueue.handle, &m_swapchainValues.swapchainHandle, 1, 1, 
+            &fTools.readyToPresentSemaphore.handle, &swapchainIdx);
 
-        m_currentFrame = (m_currentFrame + 1) % ce_framesInFlight;
+        m_currentFrame = (m_currentFrame + 1) % m_framesInFlight;
     }
 
     void VulkanRenderer::DrawWhileWaiting(float deltaTime)
     {
+        // Nothing to show without a swapchain
+        if (m_stats.bHeadless)
+        {
+            return;
+        }
+
         auto& fTools = m_frameToolsList[0];
         auto colorAttachmentWorkingLayout = VK_IMAGE_LAYOUT_GENERAL;
 
-        vkWaitForFences(m_device, 1, &fTools.inFlightFence.handle, VK_TRUE, ce_fenceTimeout);
-        VK_CHECK(vkResetFences(m_device, 1, &(fTools.inFlightFence.handle)));
+        // The idle command buffer is reused every time, so the previous submission needs to be done
+        auto frameSerial{ ++m_frameSerial };
+        if (frameSerial > 1)
+        {
+            WaitTimelineSemaphore(m_device, m_frameTimeline.handle, frameSerial - 1, ce_fenceTimeout);
+        }
 
         // Swapchain image, needed to present the color attachment results
         uint32_t swapchainIdx;
@@ -1175,10 +1484,58 @@ namespace BlitzenVulkan
         VkSemaphoreSubmitInfo waitSemaphores{};
 
         CreateSemahoreSubmitInfo(waitSemaphores, fTools.imageAcquiredSemaphore.handle, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
-        VkSemaphoreSubmitInfo signalSemaphore{};
-        CreateSemahoreSubmitInfo(signalSemaphore, fTools.readyToPresentSemaphore.handle, VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT);
-        SubmitCommandBuffer(m_graphicsQueue.handle, m_idleDrawCommandBuffer, 1, &waitSemaphores, 1, &signalSemaphore, fTools.inFlightFence.handle);
+        VkSemaphoreSubmitInfo signalSemaphores[2]{ {}, {} };
+        CreateSemahoreSubmitInfo(signalSemaphores[0], fTools.readyToPresentSemaphore.handle, VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT);
+        CreateSemahoreSubmitInfo(signalSemaphores[1], m_frameTimeline.handle, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, frameSerial);
+        std::lock_guard<std::mutex> queueLock(m_queueSubmitMutex);
+        SubmitCommandBuffer(m_graphicsQueue.handle, m_idleDrawCommandBuffer, 1, &waitSemaphores, 2, signalSemaphores);
 
         PresentToSwapchain(m_device, m_graphicsQueue.handle, &m_swapchainValues.swapchainHandle, 1, 1, &fTools.readyToPresentSemaphore.handle, &swapchainIdx);
     }
-}
\ No newline at end of file
+
+    uint8_t VulkanRenderer::WriteColorReadback(const char* filepath)
+    {
+        if (!m_bColorReadbackReady)
+        {
+            BLIT_ERROR("No color attachment readback was requested");
+            return 0;
+        }
+
+        vkDeviceWaitIdle(m_device);
+
+        BlitzenPlatform::C_FILE_SCOPE file;
+        if (!file.Open(filepath, BlitzenPlatform::FileModes::Write, 1))
+        {
+            BLIT_ERROR("Failed to open %s", filepath);
+            return 0;
+        }
+
+        char header[64];
+        auto headerSize{ snprintf(header, sizeof(header), "P6\n%u %u\n255\n", m_drawExtent.width, m_drawExtent.height) };
+
+        // RGBA16F to RGB8, clamped without tone mapping (same as the presentation shader)
+        auto pTexels{ reinterpret_cast<const uint16_t*>(m_colorReadbackBuffer.allocationInfo.pMappedData) };
+        size_t pixelCount{ size_t(m_drawExtent.width) * m_drawExtent.height };
+        BlitCL::DynamicArray<uint8_t> pixels{ pixelCount * 3 };
+        for (size_t i = 0; i < pixelCount; ++i)
+        {
+            for (size_t c = 0; c < 3; ++c)
+            {
+                auto value{ meshopt_dequantizeHalf(pTexels[i * 4 + c]) };
+                value = value < 0.f ? 0.f : value > 1.f ? 1.f : value;
+                pixels[i * 3 + c] = uint8_t(value * 255.f + 0.5f);
+            }
+        }
+
+        size_t written{ 0 };
+        if (!BlitzenPlatform::FilesystemWrite(file, size_t(headerSize), header, &written) ||
+            !BlitzenPlatform::FilesystemWrite(file, pixels.GetSize(), pixels.Data(), &written))
+        {
+            BLIT_ERROR("Failed to write %s", filepath);
+            return 0;
+        }
+
+        BLIT_INFO("Color attachment written to %s", filepath);
+        return 1;
+    }
+}
@@ -86,6 +86,15 @@ namespace BlitzenVulkan
         }
     }
 
+    PipelineCache::~PipelineCache()
+    {
+        if (handle != VK_NULL_HANDLE)
+        {
+            auto vdv = S_GET_VULKAN_MEMORY()->device;
+            vkDestroyPipelineCache(vdv, handle, nullptr);
+        }
+    }
+
     ShaderModule::~ShaderModule()
     {
         if (handle != VK_NULL_HANDLE)
@@ -149,6 +158,15 @@ namespace BlitzenVulkan
         }
     }
 
+    QueryPool::~QueryPool()
+    {
+        if (handle != VK_NULL_HANDLE)
+        {
+            auto vdv = S_GET_VULKAN_MEMORY()->device;
+            vkDestroyQueryPool(vdv, handle, nullptr);
+        }
+    }
+
 
     // Acceleration structure is an extensions so it needs to load the destroy function as well
     static void DestroyAccelerationStructureKHR(VkInstance instance, VkDevice device, VkAccelerationStructureKHR as, const VkAllocationCallbacks* pAllocator)
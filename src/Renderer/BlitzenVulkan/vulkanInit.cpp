@@ -233,7 +233,7 @@ namespace BlitzenVulkan
         return 0;
     }
 
-    static uint8_t CreateInstance(VkInstance& instance, VkDebugUtilsMessengerEXT* pDM = nullptr)
+    static uint8_t CreateInstance(VkInstance& instance, uint8_t bHeadless, VkDebugUtilsMessengerEXT* pDM = nullptr)
     {
         uint32_t apiVersion = 0;
         VK_CHECK(vkEnumerateInstanceVersion(&apiVersion));
@@ -261,6 +261,12 @@ namespace BlitzenVulkan
         // Initialize data
         InstanceExtensionContext extensionContext;
         extensionContext.availableExtensions.Resize(availableExtensionCount);
+        // Headless mode has no window, surface extensions are not needed
+        if (bHeadless)
+        {
+            extensionContext.extensionsSupportRequested[0] = 0;
+            extensionContext.extensionsSupportRequested[1] = 0;
+        }
         vkEnumerateInstanceExtensionProperties(nullptr, &availableExtensionCount, extensionContext.availableExtensions.Data());
         // Finds extensions
         if (!FindInstanceExtensions(instanceInfo, extensionContext))
@@ -330,6 +336,7 @@ namespace BlitzenVulkan
             !features12.bufferDeviceAddress || !features12.descriptorIndexing || !features12.runtimeDescriptorArray || !features12.storageBuffer8BitAccess ||
             !features12.shaderFloat16 || !features12.drawIndirectCount || !features12.samplerFilterMinmax || !features12.shaderInt8 || 
             !features12.shaderSampledImageArrayNonUniformIndexing ||!features12.uniformAndStorageBuffer8BitAccess || !features12.storagePushConstant8 ||
+            !features12.timelineSemaphore ||
             !features13.synchronization2 || !features13.dynamicRendering || !features13.maintenance4)
         {
             return 0;
@@ -361,7 +368,7 @@ namespace BlitzenVulkan
 
         ExtensionQueryHelper extensionsData[Ce_MaxRequestedDeviceExtensions]
         {
-            { VK_KHR_SWAPCHAIN_EXTENSION_NAME, Ce_SwapchainExtensionRequested, Ce_SwapchainExtensionRequired },
+            { VK_KHR_SWAPCHAIN_EXTENSION_NAME, Ce_SwapchainExtensionRequested && !stats.bHeadless, Ce_SwapchainExtensionRequired },
             { VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME, Ce_IsPushDescriptorExtensionsRequested, Ce_IsPushDescriptorExtensionsRequired },
             { VK_KHR_ACCELERATION_STRUCTURE_EXTENSION_NAME, Ce_RayTracingRequested, Ce_RayTracingRequired },
             { VK_KHR_RAY_QUERY_EXTENSION_NAME, Ce_RayTracingRequested, Ce_RayTracingRequired },
@@ -528,9 +535,34 @@ namespace BlitzenVulkan
             ++queueIndex;
         }
 
+        // Headless mode never presents and nothing is submitted from another thread, so single family devices (software ICDs) can share the graphics queue
+        if (stats.bHeadless)
+        {
+            presentQueue.index = graphicsQueue.index;
+            presentQueue.hasIndex = graphicsQueue.hasIndex;
+
+            if (!transferQueue.hasIndex)
+            {
+                BLIT_WARN("No dedicated transfer queue, using the graphics queue");
+                transferQueue.index = graphicsQueue.index;
+                transferQueue.hasIndex = graphicsQueue.hasIndex;
+            }
+
+            if (!computeQueue.hasIndex && !BlitzenCore::Ce_BuildClusters)
+            {
+                computeQueue.index = graphicsQueue.index;
+                computeQueue.hasIndex = graphicsQueue.hasIndex;
+            }
+        }
+
         queueIndex = 0;
         for (auto& queueProps : queueFamilyProperties)
         {
+            if (stats.bHeadless)
+            {
+                break;
+            }
+
             // Checks for presentation queue, if one was not already found
             VkBool32 supportsPresent = VK_FALSE;
             VK_CHECK(vkGetPhysicalDeviceSurfaceSupportKHR(pdv, queueIndex, surface, &supportsPresent));
@@ -607,6 +639,9 @@ namespace BlitzenVulkan
             return 0;
         }
 
+        // Cluster culling is dispatched indirectly, the pre cluster shader keeps the group count under this
+        stats.maxClusterCullGroupCount = props.limits.maxComputeWorkGroupCount[0];
+
         return 1;
 
     }
@@ -651,7 +686,7 @@ namespace BlitzenVulkan
         for (auto& pdv : physicalDevices)
         {
             // Checks for possible non discrete GPUs
-            if (!ValidatePhysicalDevice(pdv, instance, surface, graphicsQueue,
+            if (ValidatePhysicalDevice(pdv, instance, surface, graphicsQueue,
                 computeQueue, presentQueue, transferQueue, stats))
             {
                 gpu = pdv;
@@ -725,6 +760,9 @@ namespace BlitzenVulkan
         // Allows uniform buffers to have 8bit members
         ctx.vulkan12Features.uniformAndStorageBuffer8BitAccess = true;
 
+        // Frame synchronization uses timeline semaphores instead of a fence and semaphores per frame
+        ctx.vulkan12Features.timelineSemaphore = true;
+
         ctx.vulkan13Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
 
         // Dynamic rendering removes the need for VkRenderPass and allows the creation of rendering attachmets at draw time
@@ -820,27 +858,25 @@ namespace BlitzenVulkan
         VkDeviceQueueCreateInfo queueInfos [Ce_MaxUniqueueDeviceQueueIndices] {};
         uint32_t queueCount{ 0 };
 
-        // Graphics
-        queueInfos[Ce_GraphicsQueueInfoIndex] = {};
-        queueInfos[Ce_GraphicsQueueInfoIndex].queueFamilyIndex = graphicsQueue.index;
-        queueCount++;
-
-        // Dedicated transfer
-        queueInfos[Ce_TransferQueueInfoIndex] = {};
-        queueInfos[Ce_TransferQueueInfoIndex].queueFamilyIndex = transferQueue.index;
-        queueCount++;
-
-        // Dedicated compute (TODO: Might want to be careful here, and add it only if I am on cluster mode)
-        queueInfos[Ce_ComputeQueueInfoIndex] = {};
-        queueInfos[Ce_ComputeQueueInfoIndex].queueFamilyIndex = computeQueue.index;
-        queueCount++;
-
-        // If graphics has a different index from present, add a new info for it
-        if (graphicsQueue.index != presentQueue.index)
+        // One info per unique family, headless mode may put every queue on the graphics family
+        uint32_t requestedFamilies[Ce_MaxUniqueueDeviceQueueIndices]
+        {
+            graphicsQueue.index, transferQueue.index, computeQueue.index, presentQueue.index
+        };
+        for (auto family : requestedFamilies)
         {
-            queueInfos[queueCount] = {};
-            queueInfos[queueCount].queueFamilyIndex = presentQueue.index;
-            queueCount++;
+            uint8_t bFamilyAdded = 0;
+            for (uint32_t i = 0; i < queueCount; ++i)
+            {
+                bFamilyAdded = bFamilyAdded || queueInfos[i].queueFamilyIndex == family;
+            }
+
+            if (!bFamilyAdded)
+            {
+                queueInfos[queueCount] = {};
+                queueInfos[queueCount].queueFamilyIndex = family;
+                queueCount++;
+            }
         }
 
         if (queueCount > Ce_MaxUniqueueDeviceQueueIndices)
@@ -902,13 +938,13 @@ namespace BlitzenVulkan
 
     uint8_t VulkanRenderer::Init(uint32_t windowWidth, uint32_t windowHeight, void* pPlatform)
     {
-        if(!CreateInstance(m_instance, &m_debugMessenger))
+        if(!CreateInstance(m_instance, m_stats.bHeadless, &m_debugMessenger))
         {
             BLIT_ERROR("Failed to create vulkan instance");
             return 0;
         }
 
-        if(!BlitzenPlatform::CreateVulkanSurface(m_instance, m_surface.handle, m_pCustomAllocator, pPlatform))
+        if(!m_stats.bHeadless && !BlitzenPlatform::CreateVulkanSurface(m_instance, m_surface.handle, m_pCustomAllocator, pPlatform))
         {
             BLIT_ERROR("Failed to create Vulkan window surface");
             return 0;
@@ -926,7 +962,14 @@ namespace BlitzenVulkan
             return 0;
         }
 
-        if(!CreateSwapchain(m_device, m_surface.handle, m_physicalDevice, windowWidth, windowHeight, m_graphicsQueue, m_presentQueue, m_computeQueue, 
+        SetupGpuTimestamps();
+
+        if (m_stats.bHeadless)
+        {
+            // Viewport and scissor are taken from the swapchain extent
+            m_swapchainValues.swapchainExtent = { windowWidth, windowHeight };
+        }
+        else if(!CreateSwapchain(m_device, m_surface.handle, m_physicalDevice, windowWidth, windowHeight, m_graphicsQueue, m_presentQueue, m_computeQueue, 
             m_pCustomAllocator, m_swapchainValues))
         {
             BLIT_ERROR("Failed to create Vulkan swapchain");
@@ -934,7 +977,7 @@ namespace BlitzenVulkan
         }
 
         // Commands
-        for (size_t i = 0; i < ce_framesInFlight; ++i)
+        for (size_t i = 0; i < m_framesInFlight; ++i)
         {
             if (!m_frameToolsList[i].Init(m_device, m_graphicsQueue, m_transferQueue, m_computeQueue))
             {
@@ -942,6 +985,12 @@ namespace BlitzenVulkan
                 return 0;
             }
         }
+        if (!CreateTimelineSemaphore(m_device, m_frameTimeline.handle) || !CreateTimelineSemaphore(m_device, m_transferTimeline.handle) ||
+            (BlitzenCore::Ce_BuildClusters && !CreateTimelineSemaphore(m_device, m_computeTimeline.handle)))
+        {
+            BLIT_ERROR("Failed to create frame timeline semaphores");
+            return 0;
+        }
 
         // This will be referred to by rendering attachments and will be updated when the window is resized
         m_drawExtent = {m_swapchainValues.swapchainExtent.width, m_swapchainValues.swapchainExtent.height};
@@ -968,24 +1017,69 @@ namespace BlitzenVulkan
             return 0;
         }
 
-        
-		if (!CreateIdleDrawHandles(m_device, m_basicBackgroundPipeline.handle, m_basicBackgroundLayout.handle, m_backgroundImageSetLayout.handle, 
+        if (!CreateUploadTools())
+        {
+            BLIT_ERROR("Failed to create upload tools");
+            return 0;
+        }
+
+        if (!CreatePipelineCache(m_device, m_physicalDevice, m_pipelineCache.handle, Ce_PipelineCacheFilepath))
+        {
+            BLIT_ERROR("Failed to create pipeline cache");
+            return 0;
+        }
+
+		if (!CreateIdleDrawHandles(m_device, m_pipelineCache.handle, m_basicBackgroundPipeline.handle, m_basicBackgroundLayout.handle, m_backgroundImageSetLayout.handle, 
             m_graphicsQueue.index, m_idleCommandBufferPool.handle, m_idleDrawCommandBuffer))
 		{
             BLIT_ERROR("Failed to create idle draw handles");
 		    return 0;
 		}
 
-        if (!CreateLoadingTrianglePipeline(m_device, m_loadingTrianglePipeline.handle, m_loadingTriangleLayout.handle))
+        if (!CreateLoadingTrianglePipeline(m_device, m_pipelineCache.handle, m_loadingTrianglePipeline.handle, m_loadingTriangleLayout.handle))
         {
             BLIT_ERROR("Failed to create loading triangle pipeline");
             return 0;
         }
 
+        // Host visible copy of the color attachment for headless frames
+        if (m_stats.bHeadless)
+        {
+            VkDeviceSize readbackSize{ VkDeviceSize(m_drawExtent.width) * m_drawExtent.height * Ce_ColorAttachmentTexelSize };
+            if (!CreateBuffer(m_allocator, m_colorReadbackBuffer, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU,
+                readbackSize, VMA_ALLOCATION_CREATE_MAPPED_BIT))
+            {
+                BLIT_ERROR("Failed to create color attachment readback buffer");
+                return 0;
+            }
+        }
+
         // Success
         return 1;
     }
 
+    uint8_t VulkanRenderer::InitHeadless(uint32_t width, uint32_t height)
+    {
+        m_stats.bHeadless = 1;
+        return Init(width, height, nullptr);
+    }
+
+    void VulkanRenderer::SetFramesInFlight(uint8_t framesInFlight)
+    {
+        if (m_frameTimeline.handle != VK_NULL_HANDLE)
+        {
+            BLIT_WARN("Frames in flight can only be set before the renderer is initialized");
+            return;
+        }
+        if (!framesInFlight || framesInFlight > Ce_MaxFramesInFlight)
+        {
+            BLIT_WARN("%u frames in flight is not supported, using %u", uint32_t(framesInFlight), uint32_t(Ce_DefaultFramesInFlight));
+            return;
+        }
+
+        m_framesInFlight = framesInFlight;
+    }
+
     static uint8_t FindSwapchainSurfaceFormat(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, VkSwapchainCreateInfoKHR& info, VkFormat& swapchainFormat)
     {
         // Get the amount of available surface formats
@@ -1222,7 +1316,7 @@ namespace BlitzenVulkan
         return 1;
     }
 
-    uint8_t CreateIdleDrawHandles(VkDevice device, VkPipeline& pipeline, VkPipelineLayout& layout, VkDescriptorSetLayout& setLayout, 
+    uint8_t CreateIdleDrawHandles(VkDevice device, VkPipelineCache pipelineCache, VkPipeline& pipeline, VkPipelineLayout& layout, VkDescriptorSetLayout& setLayout, 
         uint32_t queueIndex, VkCommandPool& commandPool, VkCommandBuffer& commandBuffer)
     {
         VkDescriptorSetLayoutBinding backgroundImageLayoutBinding{};
@@ -1244,7 +1338,7 @@ namespace BlitzenVulkan
         }
 
         // Create the background shader in case the renderer has not objects
-        if (!CreateComputeShaderProgram(device, "VulkanShaders/BasicBackground.comp.glsl.spv",
+        if (!CreateComputeShaderProgram(device, pipelineCache, "VulkanShaders/BasicBackground.comp.glsl.spv",
             VK_SHADER_STAGE_COMPUTE_BIT, "main", layout, &pipeline))
         {
             BLIT_ERROR("Failed to create BasicBackground.comp shader program");
@@ -1276,6 +1370,24 @@ namespace BlitzenVulkan
         // Wait for the device to finish its work before destroying resources
         vkDeviceWaitIdle(m_device);
 
+        if (m_pipelineCache.handle != VK_NULL_HANDLE)
+        {
+            SavePipelineCache(m_device, m_pipelineCache.handle, Ce_PipelineCacheFilepath);
+        }
+
+        // Streamed out textures that were still waiting for their frames
+        for (const auto& retired : m_retiredTextureImages)
+        {
+            vkDestroyImageView(m_device, retired.imageView, nullptr);
+            vmaDestroyImage(m_allocator, retired.image, retired.allocation);
+        }
+
+        // Buffers replaced by scene batches
+        for (const auto& retired : m_retiredBuffers)
+        {
+            vmaDestroyBuffer(m_allocator, retired.buffer, retired.allocation);
+        }
+
         for(size_t i = 0; i < m_depthPyramidMipLevels; ++i)
         {
             vkDestroyImageView(m_device, m_depthPyramidMips[i], m_pCustomAllocator);
@@ -1,5 +1,6 @@
 #include "vulkanRenderer.h"
 #include "vulkanPipelines.h"
+#include "Core/Threads/blitTaskPool.h"
 
 namespace BlitzenVulkan
 {
@@ -125,8 +126,8 @@ namespace BlitzenVulkan
         return 1;
     }
 
-    uint8_t CreateComputeShaderProgram(VkDevice device, const char* filepath, VkShaderStageFlagBits shaderStage, const char* entryPointName, 
-    VkPipelineLayout& layout, VkPipeline* pPipeline, VkSpecializationInfo* pSpecializationInfo /*=nullptr*/)
+    uint8_t CreateComputeShaderProgram(VkDevice device, VkPipelineCache pipelineCache, const char* filepath, VkShaderStageFlagBits shaderStage, 
+        const char* entryPointName, VkPipelineLayout& layout, VkPipeline* pPipeline, VkSpecializationInfo* pSpecializationInfo /*=nullptr*/)
     {
         // Creates the shader module and the shader stage
         ShaderModule module{};
@@ -146,7 +147,7 @@ namespace BlitzenVulkan
         pipelineInfo.layout = layout;
 
         // Creates the compute pipeline
-        if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, pPipeline) != VK_SUCCESS)
+        if (vkCreateComputePipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, pPipeline) != VK_SUCCESS)
         {
             return 0;
         }
@@ -322,93 +323,97 @@ namespace BlitzenVulkan
     }
 
 
-    uint8_t CreateClusterComputePipelines(VkDevice device, VkPipeline* preClusterPipeline, VkPipeline* initialCullingPipeline,
-        VkPipeline* transparentClusterCullPipeline, VkPipelineLayout mainCullingShaderLayout)
+    uint8_t CreatePipelineCache(VkDevice device, VkPhysicalDevice physicalDevice, VkPipelineCache& pipelineCache, const char* filepath)
     {
-        if (!CreateComputeShaderProgram(device, "VulkanShaders/PreClusterDrawCull.comp.glsl.spv",
-            VK_SHADER_STAGE_COMPUTE_BIT, "main", mainCullingShaderLayout, preClusterPipeline))
+        VkPhysicalDeviceProperties props{};
+        vkGetPhysicalDeviceProperties(physicalDevice, &props);
+
+        // The blob is only passed to the driver if it was written by the same device and driver
+        BlitCL::String bytes;
+        size_t filesize{ 0 };
+        BlitzenPlatform::C_FILE_SCOPE scopedFILE;
+        if (scopedFILE.Open(filepath, BlitzenPlatform::FileModes::Read, 1) &&
+            BlitzenPlatform::FilesystemReadAllBytes(scopedFILE, bytes, &filesize))
         {
-            BLIT_ERROR("Failed to create PreClusterDrawCull.comp shader program");
-            return 0;
+            VkPipelineCacheHeaderVersionOne header{};
+            if (filesize >= sizeof(header))
+            {
+                BlitzenPlatform::PlatformMemCopy(&header, bytes.Data(), sizeof(header));
+            }
+            if (filesize < sizeof(header) || header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+                header.vendorID != props.vendorID || header.deviceID != props.deviceID ||
+                memcmp(header.pipelineCacheUUID, props.pipelineCacheUUID, VK_UUID_SIZE))
+            {
+                BLIT_INFO("Pipeline cache %s does not match the device, pipelines will be rebuilt", filepath);
+                filesize = 0;
+            }
         }
-
-        if (!CreateComputeShaderProgram(device, "VulkanShaders/InitialClusterCull.comp.glsl.spv",
-            VK_SHADER_STAGE_COMPUTE_BIT, "main", mainCullingShaderLayout, initialCullingPipeline))
+        else
         {
-            BLIT_ERROR("Failed to create InitialClusterCull.comp shader program");
-            return 0;
+            filesize = 0;
         }
 
-        if (!CreateComputeShaderProgram(device, "VulkanShaders/TransparentClusterCull.comp.glsl.spv",
-            VK_SHADER_STAGE_COMPUTE_BIT, "main", mainCullingShaderLayout, transparentClusterCullPipeline))
+        VkPipelineCacheCreateInfo cacheInfo{};
+        cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        cacheInfo.initialDataSize = filesize;
+        cacheInfo.pInitialData = filesize ? bytes.Data() : nullptr;
+        if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &pipelineCache) != VK_SUCCESS)
         {
-			BLIT_ERROR("Failed to create transparentClusterCull.comp shader program");
             return 0;
         }
 
-		// Success
+        // Success
         return 1;
     }
 
-
-    uint8_t CreateComputeShaders(VkDevice device, VkPipeline* cullingPipeline, VkPipeline* lateCullingPipeline, 
-        VkPipeline* onpcCullPipeline, VkPipeline* transparentCullShaderPipeline, VkPipelineLayout mainCullingShaderLayout, 
-        VkPipeline* depthPyramidGenerationPipeline, VkPipelineLayout depthPyramidGenerationLayout, 
-        VkPipeline* presentImageGenerationPipeline, VkPipelineLayout presentImageGenerationPipelineLayout)
+    void SavePipelineCache(VkDevice device, VkPipelineCache pipelineCache, const char* filepath)
     {
-
-        if (!CreateComputeShaderProgram(device, "VulkanShaders/InitialDrawCull.comp.glsl.spv",
-            VK_SHADER_STAGE_COMPUTE_BIT, "main", mainCullingShaderLayout, cullingPipeline))
-        {
-            BLIT_ERROR("Failed to create InitialDrawCull.comp shader program");
-            return 0;
-        }
-
-        // Late culling shader compute pipeline
-        if (!CreateComputeShaderProgram(device, "VulkanShaders/LateDrawCull.comp.glsl.spv",
-            VK_SHADER_STAGE_COMPUTE_BIT, "main", mainCullingShaderLayout, lateCullingPipeline))
+        size_t dataSize{ 0 };
+        if (vkGetPipelineCacheData(device, pipelineCache, &dataSize, nullptr) != VK_SUCCESS || !dataSize)
         {
-            BLIT_ERROR("Failed to create LateDrawCull.comp shader program");
-            return 0;
+            return;
         }
 
-        // Generate depth pyramid compute shader
-        if (!CreateComputeShaderProgram(device, "VulkanShaders/DepthPyramidGeneration.comp.glsl.spv",
-            VK_SHADER_STAGE_COMPUTE_BIT, "main", depthPyramidGenerationLayout, depthPyramidGenerationPipeline))
+        BlitCL::DynamicArray<uint8_t> data{ dataSize };
+        if (vkGetPipelineCacheData(device, pipelineCache, &dataSize, data.Data()) != VK_SUCCESS)
         {
-            BLIT_ERROR("Failed to create DepthPyramidGeneration.comp shader program");
-            return 0;
+            BLIT_WARN("Failed to get pipeline cache data");
+            return;
         }
 
-        // Redundant shader
-        if (!CreateComputeShaderProgram(device, "VulkanShaders/OnpcDrawCull.comp.glsl.spv",
-            VK_SHADER_STAGE_COMPUTE_BIT, "main", mainCullingShaderLayout, onpcCullPipeline))
+        BlitzenPlatform::C_FILE_SCOPE scopedFILE;
+        size_t bytesWritten{ 0 };
+        if (!scopedFILE.Open(filepath, BlitzenPlatform::FileModes::Write, 1) ||
+            !BlitzenPlatform::FilesystemWrite(scopedFILE, dataSize, data.Data(), &bytesWritten))
         {
-            BLIT_ERROR("Failed to create OnpcDrawCull.comp shader program");
-            return 0;
+            BLIT_WARN("Failed to write pipeline cache to %s", filepath);
         }
+    }
 
-        if (!CreateComputeShaderProgram(device, "VulkanShaders/TransparentDrawCull.comp.glsl.spv",
-            VK_SHADER_STAGE_COMPUTE_BIT, "main", mainCullingShaderLayout, transparentCullShaderPipeline))
+    uint8_t CreateComputePipelines(VkDevice device, VkPipelineCache pipelineCache, uint32_t pipelineCount, ComputePipelineDesc* pDescs)
+    {
+        // Every pipeline reads and compiles its own module, the cache is internally synchronized
+        uint8_t results[Ce_MaxStartupComputePipelines]{};
+        BlitzenCore::GetTaskPool().ParallelFor(pipelineCount, [&](size_t i)
         {
-            BLIT_ERROR("Failed to create OnpcDrawCull.comp shader program");
-            return 0;
-        }
+            results[i] = CreateComputeShaderProgram(device, pipelineCache, pDescs[i].filepath, VK_SHADER_STAGE_COMPUTE_BIT, "main",
+                pDescs[i].layout, pDescs[i].pPipeline);
+        });
 
-        // Creates the generate presentation image compute shader program
-        if (!CreateComputeShaderProgram(device, "VulkanShaders/GeneratePresentation.comp.glsl.spv",
-            VK_SHADER_STAGE_COMPUTE_BIT, "main", presentImageGenerationPipelineLayout, presentImageGenerationPipeline))
+        uint8_t bSuccess{ 1 };
+        for (uint32_t i = 0; i < pipelineCount; ++i)
         {
-            BLIT_ERROR("Failed to create GeneratePresentation.comp shader program");
-            return 0;
+            if (!results[i])
+            {
+                BLIT_ERROR("Failed to create %s shader program", pDescs[i].filepath);
+                bSuccess = 0;
+            }
         }
-
-        // Success
-        return 1;
+        return bSuccess;
     }
 
-    static uint8_t CreateGraphicsPipelineWithShader(VkDevice device, VkPipelineLayout layout, VkPipeline* pPipeline, 
-        uint32_t shaderStageCount, VkPipelineShaderStageCreateInfo* pShaderStages)
+    static uint8_t CreateGraphicsPipelineWithShader(VkDevice device, VkPipelineCache pipelineCache, VkPipelineLayout layout,
+        VkPipeline* pPipeline, uint32_t shaderStageCount, const VkPipelineShaderStageCreateInfo* pShaderStages)
     {
         VkGraphicsPipelineCreateInfo pipelineInfo{};
         VkPipelineRenderingCreateInfo dynamicRenderingInfo{};
@@ -430,109 +435,132 @@ namespace BlitzenVulkan
         pipelineInfo.stageCount = shaderStageCount;
         pipelineInfo.pStages = pShaderStages;
         pipelineInfo.layout = layout;
-        if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr,
+        if (vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, nullptr,
             pPipeline) != VK_SUCCESS)
         {
             return 0;
         }
 
-        // Success 
+        // Success
         return 1;
     }
 
-    uint8_t CreateGraphicsPipelines(VkDevice device, uint8_t bMeshShaders, 
-        VkPipeline* mainGraphicsPipeline, VkPipeline* postPassGraphicsPipeline, VkPipelineLayout mainGraphicsPipelineLayout, 
-        VkPipeline* onpcPipeline, VkPipelineLayout onpcPipelineLayout)
+    uint8_t CreateGraphicsPipelines(VkDevice device, VkPipelineCache pipelineCache, uint8_t bMeshShaders,
+        VkPipeline* mainGraphicsPipeline, VkPipeline* postPassGraphicsPipeline, VkPipelineLayout mainGraphicsPipelineLayout,
+        VkPipeline* onpcPipeline, VkPipelineLayout onpcPipelineLayout, VkPipeline* instancedGraphicsPipeline)
     {
-        // Main(opaque) graphics pipeline
-        ShaderModule vertexShaderModule;
-        ShaderModule taskShaderModule;
-        VkPipelineShaderStageCreateInfo shaderStages[3] = {};
-        if(bMeshShaders)
-        {
-            if (!CreateShaderProgram(device, "VulkanShaders/MeshShader.mesh.glsl.spv",
-                VK_SHADER_STAGE_MESH_BIT_EXT, "main", vertexShaderModule.handle, shaderStages[0]))
-            {
-                BLIT_ERROR("Failed to create MeshShader.mesh shader program");
-                return 0;
-            }
+        // Only what the active path draws with. Instanced mode replaces the main pipeline, cluster and instanced mode have no onpc pass
+        constexpr uint8_t bMainPipeline = !Ce_VkInstanceCulling;
+        constexpr uint8_t bOnpcPipeline = !BlitzenCore::Ce_BuildClusters && !Ce_VkInstanceCulling;
 
-            if (!CreateShaderProgram(device, "VulkanShaders/MeshShader.task.glsl.spv",
-                VK_SHADER_STAGE_TASK_BIT_EXT, "main", taskShaderModule.handle, shaderStages[2]))
-            {
-                BLIT_ERROR("Failed to create MeshShader.task shader program");
-                return 0;
-            }
+        enum GraphicsShader : uint32_t { Geometry, Task, Fragment, OnpcVertex, InstancedVertex, GraphicsShaderCount };
+        struct ShaderDesc
+        {
+            const char* filepath;
+            VkShaderStageFlagBits stage;
+        };
+        ShaderDesc shaderDescs[GraphicsShaderCount]{};
+        if (bMeshShaders)
+        {
+            shaderDescs[Geometry] = { "VulkanShaders/MeshShader.mesh.glsl.spv", VK_SHADER_STAGE_MESH_BIT_EXT };
+            shaderDescs[Task] = { "VulkanShaders/MeshShader.task.glsl.spv", VK_SHADER_STAGE_TASK_BIT_EXT };
+        }
+        else if (BlitzenCore::Ce_BuildClusters)
+        {
+            // Vertex shader that decodes the compact meshlet data
+            shaderDescs[Geometry] = { "VulkanShaders/ClusterObjectShader.vert.glsl.spv", VK_SHADER_STAGE_VERTEX_BIT };
         }
         else
         {
             // Vertex shader for traditional pipeline
-            if (!CreateShaderProgram(device, "VulkanShaders/MainObjectShader.vert.glsl.spv",
-                VK_SHADER_STAGE_VERTEX_BIT, "main", vertexShaderModule.handle, shaderStages[0]))
+            shaderDescs[Geometry] = { "VulkanShaders/MainObjectShader.vert.glsl.spv", VK_SHADER_STAGE_VERTEX_BIT };
+        }
+        shaderDescs[Fragment] = { "VulkanShaders/MainObjectShader.frag.glsl.spv", VK_SHADER_STAGE_FRAGMENT_BIT };
+        if (bOnpcPipeline)
+        {
+            // This was for a temporary math test, I will keep it for some time
+            shaderDescs[OnpcVertex] = { "VulkanShaders/OnpcGeometry.vert.glsl.spv", VK_SHADER_STAGE_VERTEX_BIT };
+        }
+        if (Ce_VkInstanceCulling)
+        {
+            // The vertex shader gets the render object from the instance index buffer
+            shaderDescs[InstancedVertex] = { "VulkanShaders/InstancedObjectShader.vert.glsl.spv", VK_SHADER_STAGE_VERTEX_BIT };
+        }
+
+        // Modules are read and created in parallel, the unused slots stay empty
+        ShaderModule modules[GraphicsShaderCount];
+        VkPipelineShaderStageCreateInfo shaderStages[GraphicsShaderCount] = {};
+        uint8_t moduleResults[GraphicsShaderCount]{};
+        BlitzenCore::GetTaskPool().ParallelFor(GraphicsShaderCount, [&](size_t i)
+        {
+            moduleResults[i] = !shaderDescs[i].filepath || CreateShaderProgram(device, shaderDescs[i].filepath, shaderDescs[i].stage,
+                "main", modules[i].handle, shaderStages[i]);
+        });
+        for (uint32_t i = 0; i < GraphicsShaderCount; ++i)
+        {
+            if (!moduleResults[i])
             {
-                BLIT_ERROR("Failed to create MainObjectShader.vert shader program");
+                BLIT_ERROR("Failed to create %s shader program", shaderDescs[i].filepath);
                 return 0;
             }
         }
-        ShaderModule fragShaderModule;
-        if (!CreateShaderProgram(device, "VulkanShaders/MainObjectShader.frag.glsl.spv",
-            VK_SHADER_STAGE_FRAGMENT_BIT, "main", fragShaderModule.handle, shaderStages[1]))
-        {
-            BLIT_ERROR("Failed to create MainObjectShader.frag shader program");
-            return 0;
-        }
-		if (!CreateGraphicsPipelineWithShader(device, mainGraphicsPipelineLayout, mainGraphicsPipeline, 
-            bMeshShaders ? 3 : 2, shaderStages))
-		{
-			BLIT_ERROR("Failed to create main graphics pipeline");
-			return 0;
-		}
-
-        // Tranparent pipeline specialization
-		VkPipelineShaderStageCreateInfo postPassShaderStages[2] = {};
-		postPassShaderStages[0] = shaderStages[0];
+
+        // Tranparent pipeline specialization, the fragment module is shared
         VkSpecializationMapEntry postPassSpecializationMapEntry{};
         VkSpecializationInfo postPassSpecialization{};
         uint32_t postPass = 1;
         CreateShaderProgramSpecializationConstant(postPassSpecializationMapEntry,
             0, 0, sizeof(uint32_t), postPassSpecialization, &postPass);
-        ShaderModule postPassFragShaderModule;
-        if (!CreateShaderProgram(device, "VulkanShaders/MainObjectShader.frag.glsl.spv",
-            VK_SHADER_STAGE_FRAGMENT_BIT, "main", postPassFragShaderModule.handle,
-            postPassShaderStages[1], &postPassSpecialization))
+        auto postPassFragmentStage{ shaderStages[Fragment] };
+        postPassFragmentStage.pSpecializationInfo = &postPassSpecialization;
+
+        struct GraphicsPipelineDesc
         {
-            BLIT_ERROR("Failed to create MainObjectShader.frag post pass specialization shader program");
-            return 0;
+            const char* name;
+            VkPipelineLayout layout;
+            VkPipeline* pPipeline;
+            uint32_t stageCount;
+            VkPipelineShaderStageCreateInfo stages[3];
+        };
+        GraphicsPipelineDesc pipelineDescs[4]{};
+        uint32_t pipelineCount{ 0 };
+        if (bMainPipeline)
+        {
+            pipelineDescs[pipelineCount++] = { "main", mainGraphicsPipelineLayout, mainGraphicsPipeline, bMeshShaders ? 3u : 2u,
+                { shaderStages[Geometry], shaderStages[Fragment], shaderStages[Task] } };
         }
-        if (!CreateGraphicsPipelineWithShader(device, mainGraphicsPipelineLayout, postPassGraphicsPipeline, 
-            BLIT_ARRAY_SIZE(postPassShaderStages), postPassShaderStages))
+        pipelineDescs[pipelineCount++] = { "post pass", mainGraphicsPipelineLayout, postPassGraphicsPipeline, 2,
+            { shaderStages[Geometry], postPassFragmentStage } };
+        if (bOnpcPipeline)
         {
-            BLIT_ERROR("Failed to create post pass graphics pipeline")
-            return 0;
+            pipelineDescs[pipelineCount++] = { "onpc", onpcPipelineLayout, onpcPipeline, 2, { shaderStages[OnpcVertex], shaderStages[Fragment] } };
         }
-        
-        // This was for a temporary math test, I will keep it for some time
-        ShaderModule onpcVertexShaderModule;
-        VkPipelineShaderStageCreateInfo onpcGeometryShaderStages[2] = {};
-        if (!CreateShaderProgram(device, "VulkanShaders/OnpcGeometry.vert.glsl.spv",
-            VK_SHADER_STAGE_VERTEX_BIT, "main", onpcVertexShaderModule.handle, onpcGeometryShaderStages[0]))
+        if (Ce_VkInstanceCulling)
         {
-            BLIT_ERROR("Failed to create OnpcGeometry.vert shader program");
-            return 0;
+            pipelineDescs[pipelineCount++] = { "instanced", mainGraphicsPipelineLayout, instancedGraphicsPipeline, 2,
+                { shaderStages[InstancedVertex], shaderStages[Fragment] } };
         }
-        onpcGeometryShaderStages[1] = shaderStages[1];
-        if (!CreateGraphicsPipelineWithShader(device, onpcPipelineLayout, onpcPipeline, 
-            BLIT_ARRAY_SIZE(onpcGeometryShaderStages), onpcGeometryShaderStages))
+
+        uint8_t pipelineResults[BLIT_ARRAY_SIZE(pipelineDescs)]{};
+        BlitzenCore::GetTaskPool().ParallelFor(pipelineCount, [&](size_t i)
         {
-			BLIT_ERROR("Failed to create onpc graphics pipeline");
-            return 0;
+            const auto& desc{ pipelineDescs[i] };
+            pipelineResults[i] = CreateGraphicsPipelineWithShader(device, pipelineCache, desc.layout, desc.pPipeline, desc.stageCount, desc.stages);
+        });
+        for (uint32_t i = 0; i < pipelineCount; ++i)
+        {
+            if (!pipelineResults[i])
+            {
+                BLIT_ERROR("Failed to create %s graphics pipeline", pipelineDescs[i].name);
+                return 0;
+            }
         }
 
         // Success
         return 1;
     }
 
-    uint8_t CreateLoadingTrianglePipeline(VkDevice device, VkPipeline& pipeline, VkPipelineLayout& layout)
+    uint8_t CreateLoadingTrianglePipeline(VkDevice device, VkPipelineCache pipelineCache, VkPipeline& pipeline, VkPipelineLayout& layout)
     {
         VkGraphicsPipelineCreateInfo pipelineInfo{};
         VkPipelineRenderingCreateInfo dynamicRenderingInfo{};
@@ -584,7 +612,7 @@ namespace BlitzenVulkan
 
         //Create the graphics pipeline
         pipelineInfo.layout = layout;
-        if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, Ce_SinglePointer, &pipelineInfo,
+        if (vkCreateGraphicsPipelines(device, pipelineCache, Ce_SinglePointer, &pipelineInfo,
             nullptr, &pipeline) != VK_SUCCESS)
         {
             BLIT_ERROR("Failed to create idle draw pipeline");
@@ -21,8 +21,8 @@ namespace BlitzenVulkan
         VkShaderModule& shaderModule, VkPipelineShaderStageCreateInfo& pipelineShaderStage, VkSpecializationInfo* pSpecializationInfo = nullptr);
 
     // Tries to create a compute pipeline
-    uint8_t CreateComputeShaderProgram(VkDevice device, const char* filepath, VkShaderStageFlagBits shaderStage, const char* entryPointName, 
-        VkPipelineLayout& layout, VkPipeline* pPipeline, VkSpecializationInfo* pSpecializationInfo = nullptr);
+    uint8_t CreateComputeShaderProgram(VkDevice device, VkPipelineCache pipelineCache, const char* filepath, VkShaderStageFlagBits shaderStage, 
+        const char* entryPointName, VkPipelineLayout& layout, VkPipeline* pPipeline, VkSpecializationInfo* pSpecializationInfo = nullptr);
 
     // Initializes the given specialization info with a single given specialization entry
     void CreateShaderProgramSpecializationConstant(VkSpecializationMapEntry& specializationEntry, uint32_t constantId, uint32_t offset, size_t size,
@@ -69,19 +69,30 @@ namespace BlitzenVulkan
     void CreatePushConstantRange(VkPushConstantRange& pushConstant, VkShaderStageFlags shaderStage, 
         uint32_t size, uint32_t offset = 0);
 
-    // Creates main compute shaders. Implemented in vulkanPipeline.cpp
-    uint8_t CreateComputeShaders(VkDevice device, VkPipeline* cullingPipeline, VkPipeline* lateCullingPipeline,
-        VkPipeline* onpcCullPipeline, VkPipeline* transparentCullShaderPipeline, VkPipelineLayout mainCullingShaderLayout,
-        VkPipeline* depthPyramidGenerationPipeline, VkPipelineLayout depthPyramidGenerationLayout,
-        VkPipeline* presentImageGenerationPipeline, VkPipelineLayout presentImageGenerationPipelineLayout);
+    // Creates the pipeline cache, with the data of the file at filepath if it was written by the same device and driver
+    uint8_t CreatePipelineCache(VkDevice device, VkPhysicalDevice physicalDevice, VkPipelineCache& pipelineCache, const char* filepath);
 
-    uint8_t CreateClusterComputePipelines(VkDevice device, VkPipeline* preClusterPipeline, VkPipeline* initialCullingPipeline,
-        VkPipeline* lateCullingPipeline, VkPipelineLayout mainCullingShaderLayout);
+    // Writes the pipeline cache data to filepath, so that the next run can skip shader compilation
+    void SavePipelineCache(VkDevice device, VkPipelineCache pipelineCache, const char* filepath);
 
-    // Creates most of the graphics pipelines. I need to refactor this
-    uint8_t CreateGraphicsPipelines(VkDevice device, uint8_t bMeshShaders, VkPipeline* mainGraphicsPipeline, VkPipeline* postPassGraphicsPipeline, 
-        VkPipelineLayout mainGraphicsPipelineLayout, VkPipeline* onpcPipeline, VkPipelineLayout onpcPipelineLayout);
+    // Compute pipeline with a single shader and "main" as the entry point
+    struct ComputePipelineDesc
+    {
+        const char* filepath;
+        VkPipelineLayout layout;
+        VkPipeline* pPipeline;
+    };
+    constexpr uint32_t Ce_MaxStartupComputePipelines = 8;
+
+    // Creates the compute pipelines in parallel on the task pool
+    uint8_t CreateComputePipelines(VkDevice device, VkPipelineCache pipelineCache, uint32_t pipelineCount, ComputePipelineDesc* pDescs);
+
+    // Creates the graphics pipelines that the active path (clusters, instancing or draw culling) uses. 
+    // Shader modules are loaded and pipelines are created in parallel
+    uint8_t CreateGraphicsPipelines(VkDevice device, VkPipelineCache pipelineCache, uint8_t bMeshShaders, VkPipeline* mainGraphicsPipeline, 
+        VkPipeline* postPassGraphicsPipeline, VkPipelineLayout mainGraphicsPipelineLayout, VkPipeline* onpcPipeline, VkPipelineLayout onpcPipelineLayout, 
+        VkPipeline* instancedGraphicsPipeline);
 
     // Creates loading triangle pipeline
-    uint8_t CreateLoadingTrianglePipeline(VkDevice device, VkPipeline& pipeline, VkPipelineLayout& layout);
+    uint8_t CreateLoadingTrianglePipeline(VkDevice device, VkPipelineCache pipelineCache, VkPipeline& pipeline, VkPipelineLayout& layout);
 }
\ No newline at end of file
@@ -83,6 +83,8 @@ namespace BlitzenVulkan
         // Gets the address of the vertex buffer and then the index buffer
         auto vertexBufferAddress = GetBufferAddress(device, staticBuffers.vertexBuffer.buffer.bufferHandle);
         auto indexBufferAddress = GetBufferAddress(device, staticBuffers.indexBuffer.bufferHandle);
+        VkDeviceSize vertexStride = BlitzenCore::Ce_CompactVertices ? sizeof(BlitzenEngine::CompactVertex) : sizeof(BlitzenEngine::Vertex);
+        VkDeviceSize indexSize = staticBuffers.indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
 
         for (size_t i = 0; i < surfaces.GetSize(); ++i)
         {
@@ -99,20 +101,21 @@ namespace BlitzenVulkan
             geometry.geometry.triangles.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR;
             geometry.geometry.triangles.pNext = nullptr;
 
-            // Passing vertex data
-            geometry.geometry.triangles.vertexFormat = VK_FORMAT_R32G32B32_SFLOAT;
+            // Passing vertex data. Compact vertices start with snorm16 positions, 
+            // the BLAS stays in quantized space and the TLAS instance transform adds the surface bounds
+            geometry.geometry.triangles.vertexFormat = BlitzenCore::Ce_CompactVertices ? VK_FORMAT_R16G16B16A16_SNORM : VK_FORMAT_R32G32B32_SFLOAT;
             // Gets the precise address of the vertex buffer for the current surface (needs to be incremented by the vertex offset)
             geometry.geometry.triangles.vertexData.deviceAddress =
-                static_cast<VkDeviceAddress>(vertexBufferAddress + surface.vertexOffset * sizeof(BlitzenEngine::Vertex));
-            geometry.geometry.triangles.vertexStride = sizeof(BlitzenEngine::Vertex);
+                static_cast<VkDeviceAddress>(vertexBufferAddress + surface.vertexOffset * vertexStride);
+            geometry.geometry.triangles.vertexStride = vertexStride;
             // Primitive vertex count (at the moment), is an array created for this one, optinal line of code
             geometry.geometry.triangles.maxVertex = primitiveVertexCounts[i];
 
             // Passing index data
-            geometry.geometry.triangles.indexType = VK_INDEX_TYPE_UINT32;
+            geometry.geometry.triangles.indexType = staticBuffers.indexType;
             // Precise address of the index buffer
             geometry.geometry.triangles.indexData.deviceAddress =
-                static_cast<VkDeviceAddress>(indexBufferAddress + lods[surface.lodOffset].firstIndex * sizeof(uint32_t));
+                static_cast<VkDeviceAddress>(indexBufferAddress + lods[surface.lodOffset].firstIndex * indexSize);
 
 
             // Build info for the acceleration structu. Takes the geometry struct from above and some other configs
@@ -189,8 +192,10 @@ namespace BlitzenVulkan
         auto commandBuffer = frameTools.transferCommandBuffer;
         BeginCommandBuffer(commandBuffer, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
         BuildAccelerationStructureKHR(instance, commandBuffer, static_cast<uint32_t>(surfaces.GetSize()), buildInfos.Data(), buildRangePtrs.Data());
-        SubmitCommandBuffer(queue, commandBuffer);
-        vkQueueWaitIdle(queue);
+        if (!SubmitCommandBufferAndWait(device, queue, commandBuffer))
+        {
+            return 0;
+        }
 
         return 1;
     }
@@ -232,6 +237,17 @@ namespace BlitzenVulkan
             // Casts the orientation quat to a matrix
             auto orientationTranspose{ BlitML::Transpose(BlitML::QuatToMat4(transform.orientation)) };
             auto xform = orientationTranspose * transform.scale;
+            auto position = transform.pos;
+
+            // Compact blas geometry is in [-1, 1], the surface bounding sphere is folded into the instance transform
+            if (BlitzenCore::Ce_CompactVertices)
+            {
+                const auto& center = surface.center;
+                position.x += xform[0] * center.x + xform[1] * center.y + xform[2] * center.z;
+                position.y += xform[4] * center.x + xform[5] * center.y + xform[6] * center.z;
+                position.z += xform[8] * center.x + xform[9] * center.y + xform[10] * center.z;
+                xform = xform * surface.radius;
+            }
 
             VkAccelerationStructureInstanceKHR instance{};
             // Copies the first 3 elements of the 1st row of the matrix to the 1st row of the Vulkan side matrix
@@ -241,9 +257,9 @@ namespace BlitzenVulkan
             // Copies the first 3 elements of the 3rd row of the matrix to the 3rd row of the Vulkan side matrix
             BlitzenCore::BlitMemCopy(instance.transform.matrix[2], &xform[8], sizeof(float) * 3);
 
-            instance.transform.matrix[0][3] = transform.pos.x;
-            instance.transform.matrix[1][3] = transform.pos.y;
-            instance.transform.matrix[2][3] = transform.pos.z;
+            instance.transform.matrix[0][3] = position.x;
+            instance.transform.matrix[1][3] = position.y;
+            instance.transform.matrix[2][3] = position.z;
 
             instance.instanceCustomIndex = i;
             instance.mask = 1 << 0/*surface.postPass*/; // No transparent objects are passed here, 
@@ -313,8 +329,10 @@ namespace BlitzenVulkan
         auto commandBuffer = frameTools.transferCommandBuffer;
         BeginCommandBuffer(commandBuffer, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
         BuildAccelerationStructureKHR(instance, commandBuffer, 1, &buildInfo, &pBuildRange);
-        SubmitCommandBuffer(queue, commandBuffer);
-        vkQueueWaitIdle(queue);
+        if (!SubmitCommandBufferAndWait(device, queue, commandBuffer))
+        {
+            return 0;
+        }
 
         return 1;
     }
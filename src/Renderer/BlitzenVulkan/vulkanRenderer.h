@@ -1,6 +1,9 @@
 #pragma once
+#include <mutex>
+#include <atomic>
 #include "vulkanData.h"
 #include "Renderer/Resources/Textures/blitTextures.h"
+#include "Platform/Common/blitMappedFile.h"
 #include "Game/blitCamera.h"
 #include "Game/blitObject.h"
 
@@ -19,15 +22,23 @@ namespace BlitzenVulkan
         // Initalizes the Vulkan API.
         uint8_t Init(uint32_t windowWidth, uint32_t windowHeight, void* pPlatformHandle);
 
+        // Initializes without a surface or swapchain. DrawFrame renders to the color attachment and never presents
+        uint8_t InitHeadless(uint32_t width, uint32_t height);
+
         // Sets up the Vulkan renderer for drawing according to the resources loaded by the engine
         uint8_t SetupForRendering(BlitzenEngine::DrawContext& drawContext);
 
         // Needed for dx12, not used here for now
         void FinalSetup();
 
-        // Function for DDS texture loading
+        // Function for DDS texture loading. Creates the image and queues the data copy, which completes before SetupForRendering
+        // or before the scene batch that follows
         uint8_t UploadTexture(const char* filepath);
 
+        // Called by the loading thread after SetupForRendering, for what was added to the scene since then or since the last batch.
+        // Uploads the new data, growing the buffers that are too small, and the next DrawFrame draws it. The final batch starts texture streaming
+        uint8_t PublishSceneBatch(BlitzenEngine::DrawContext& context, uint8_t bFinal);
+
         // Shows a loading screen while waiting for resources to be loaded
         void DrawWhileWaiting(float deltaTime);
 
@@ -39,8 +50,20 @@ namespace BlitzenVulkan
         // When a dynamic object moves, it should call this function to update the staging buffer
         void UpdateObjectTransform(uint32_t transformId, BlitzenEngine::MeshTransform* pTransform);
 
+        // Frames the CPU may record ahead of the GPU (1 to Ce_MaxFramesInFlight). Only has an effect before Init
+        void SetFramesInFlight(uint8_t framesInFlight);
+
         inline VulkanStats GetStats() const { return m_stats; }
 
+        // Headless only. The next DrawFrame copies the color attachment to a host visible buffer
+        inline void RequestColorReadback() { m_bColorReadbackRequested = m_stats.bHeadless; }
+
+        // Waits for the device and writes the last readback as a binary PPM
+        uint8_t WriteColorReadback(const char* filepath);
+
+        // One row per frame in the timing history, one column per GPU pass in milliseconds (empty if the pass did not run)
+        uint8_t WriteGpuTimingsCsv(const char* filepath);
+
     public:
 
         // This struct holds any vulkan structure (buffers, sync structures etc), that need to have an instance for each frame in flight
@@ -55,18 +78,119 @@ namespace BlitzenVulkan
             CommandPool computeCommandPool;
             VkCommandBuffer computeCommandBuffer;
 
-            SyncFence preCulsterCullingFence;
-            SyncFence inFlightFence;
+            // Command pools are externally synchronized, so every pass that is recorded in parallel has its own
+            CommandPool passCommandPools[Ce_RecordedPassCount];
+            VkCommandBuffer passCommandBuffers[Ce_RecordedPassCount];
 
             Semaphore imageAcquiredSemaphore;
-            Semaphore buffersReadySemaphore;
             Semaphore readyToPresentSemaphore;
 
-            Semaphore preClusterCullingDoneSemaphore;
+            // Begin and end timestamp of each GpuPass. Read back when the frame tools are reused
+            QueryPool timestampQueryPool;
+            uint8_t bTimestampsWritten{ 0 };
 
             uint8_t Init(VkDevice device, Queue graphicsQueue, Queue transferQueue, Queue computeQueue);
         };
 
+        // Transfer submission that copies a batch of textures and buffer chunks from the staging ring
+        struct UploadBatch
+        {
+            CommandPool commandPool;
+            VkCommandBuffer commandBuffer;
+            SyncFence fence;
+
+            // Part of the staging ring read by the batch, free again once the fence is signaled
+            VkDeviceSize ringBegin{ 0 };
+            VkDeviceSize ringEnd{ 0 };
+            uint8_t bInFlight{ 0 };
+
+            // Submission number, every batch up to a serial is done when none of them is in flight
+            uint64_t serial{ 0 };
+        };
+
+        // Texture whose image exists, but whose data has not been copied yet. The file stays mapped until then
+        struct PendingTextureUpload
+        {
+            BlitzenPlatform::MEMORY_MAPPED_FILE_SCOPE mappedFile;
+            size_t dataOffset;
+            size_t dataSize;
+            VkDeviceSize stagingOffset;
+            AllocatedImage* pImage;
+            uint8_t mipLevels;
+        };
+
+        // Chunk of a buffer, copied from host memory when the batch is flushed. Filled with zeroes when there is no data
+        struct PendingBufferUpload
+        {
+            const void* pData;
+            VkBuffer buffer;
+            VkDeviceSize bufferOffset;
+            VkDeviceSize size;
+            VkDeviceSize stagingOffset;
+        };
+
+        // Streamed texture. The image only holds the mips from residentMip, so sampling is clamped to what is loaded
+        struct TextureStreamingState
+        {
+            uint32_t pathOffset;// Into m_texturePaths
+            size_t dataOffset;// Mip 0 in the file
+            uint32_t width;
+            uint32_t height;
+            uint32_t blockSize;
+            uint8_t mipCount;
+            uint8_t tailMip;// Finest mip loaded with the scene
+            uint8_t residentMip;
+            uint8_t bStreaming;
+        };
+
+        // Replacement image, swapped with the texture's image once its upload batch is done
+        struct StreamedTextureImage
+        {
+            AllocatedImage image;
+            uint32_t textureId;
+            uint8_t mip;
+            uint64_t batchSerial;
+            uint8_t bActive{ 0 };
+        };
+
+        // Old image, destroyed once no frame in flight can sample it
+        struct RetiredTextureImage
+        {
+            VkImage image;
+            VkImageView imageView;
+            VmaAllocation allocation;
+            uint64_t frame;
+        };
+
+        // Buffer state of one of the scene buffers, written by the loading thread
+        struct SceneBufferState
+        {
+            // Replaces the live buffer when it was too small or its data changed in place, swapped in by the main loop
+            AllocatedBuffer grownBuffer;
+            VkDeviceSize size{ 0 };// Bytes uploaded so far
+            VkDeviceSize capacity{ 0 };// Size of the newest buffer
+        };
+
+        // Old buffer, destroyed once no frame in flight can read it
+        struct RetiredBuffer
+        {
+            VkBuffer buffer;
+            VmaAllocation allocation;
+            uint64_t frame;
+        };
+
+        // Scene counts of the last published batch
+        struct SceneBatchPublication
+        {
+            uint32_t renderCount;
+            uint32_t transparentRenderCount;
+            uint32_t onpcRenderCount;
+            uint32_t lodCount;
+            size_t textureCount;
+            VkIndexType indexType;
+            uint8_t bFinal;
+        };
+
         // The renderer will have one instance of these buffers, which will include buffers that my be updated
         struct VarBuffers
         {
@@ -74,14 +198,22 @@ namespace BlitzenVulkan
 
             PushDescriptorBuffer<void> transformBuffer{ 5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER };
             AllocatedBuffer transformStagingBuffer;
-            BlitzenEngine::MeshTransform* pTransformData = nullptr;
+            BlitzenEngine::MeshTransform* pTransformData = nullptr;// Staging copy, or the transform buffer itself with direct writes
             size_t dynamicTransformDataSize{ 0 };
+
+            // Dynamic transforms changed since this frame's buffer was last written, one bit per transform id
+            uint64_t dirtyTransforms[Ce_DirtyTransformWordCount]{};
+            uint32_t dirtyTransformCount{ 0 };
+
+            // Set when the transform buffer is host visible device memory (resizable BAR or UMA), there is no transfer then
+            uint8_t bDirectTransformWrites{ 0 };
         };
 
         struct StaticBuffers
         {
             PushDescriptorBuffer<void> vertexBuffer{ 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER };
             AllocatedBuffer indexBuffer;
+            VkIndexType indexType{ VK_INDEX_TYPE_UINT32 };// 16 bit with compact vertices when every surface fits
 
             PushDescriptorBuffer<void> clusterBuffer{ 12, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER };
             PushDescriptorBuffer<void> meshletDataBuffer{ 13, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER };
@@ -106,6 +238,11 @@ namespace BlitzenVulkan
 
             PushDescriptorBuffer<void> visibilityBuffer{ 10, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER };
 
+            // Instanced culling. Per LOD instance offset and count, and the render object ids of the visible instances of each LOD
+            PushDescriptorBuffer<void> lodInstanceCounterBuffer{ 16, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER };
+            PushDescriptorBuffer<void> instanceIndexBuffer{ 17, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER };
+            uint32_t lodCount{ 0 };
+
             // Used for transfering data from pre cluster culling pass, to cluster culling pass
             // The buffer changes for transparent objects, 
             // so device addresses to the correct buffer need to be given to the shaders
@@ -113,12 +250,10 @@ namespace BlitzenVulkan
 			VkDeviceAddress clusterDispatchBufferAddress;
             AllocatedBuffer clusterCountBuffer;
 			VkDeviceAddress clusterCountBufferAddress;
-            AllocatedBuffer clusterCountCopyBuffer;
 			AllocatedBuffer transparentClusterDispatchBuffer;
 			VkDeviceAddress transparentClusterDispatchBufferAddress;
 			AllocatedBuffer transparentClusterCountBuffer;
             VkDeviceAddress transparentClusterCountBufferAddress;
-			AllocatedBuffer transparentClusterCountCopyBuffer;
 
             AllocatedBuffer blasBuffer;
             BlitCL::DynamicArray<AccelerationStructure> blasData;
@@ -183,11 +318,76 @@ namespace BlitzenVulkan
         uint8_t m_depthPyramidMipLevels;
         VkExtent2D m_depthPyramidExtent;
 
+        // Headless mode copies the color attachment here when a readback is requested
+        AllocatedBuffer m_colorReadbackBuffer;
+        uint8_t m_bColorReadbackRequested{ 0 };
+        uint8_t m_bColorReadbackReady{ 0 };
+
         // Will hold all textures that will be loaded for the scene, to pass them to the global descriptor set later
         TextureData loadedTextures[BlitzenCore::Ce_MaxTextureCount];
         size_t textureCount;
         ImageSampler m_textureSampler;
 
+        uint8_t CreateUploadTools();
+
+        // Queues a mip chain read for an image created with CreateImage. The copy is submitted with the rest of the batch
+        uint8_t QueueTextureUpload(const char* filepath, size_t dataOffset, size_t dataSize, AllocatedImage& image, uint8_t mipLevels);
+
+        // Queues the copy of size bytes of pData to buffer at bufferOffset, in Ce_BufferUploadChunkSize chunks. 
+        // A null pData zeroes the range instead. The data is read when the chunk's batch is flushed
+        uint8_t QueueBufferUpload(VkBuffer buffer, const void* pData, VkDeviceSize size, VkDeviceSize bufferOffset = 0);
+
+        // Returns a staging ring offset for the next upload. Waits for the batches that still read that part of the ring
+        uint8_t ReserveStaging(VkDeviceSize size, VkDeviceSize& offset);
+
+        // Copies the pending textures from their mappings and the pending buffer chunks on the worker threads
+        // and submits their copies without waiting
+        uint8_t FlushUploads();
+
+        uint8_t RetireUploadBatch(UploadBatch& batch);
+
+        // Flushes and waits for every batch, called before the textures are given to descriptors and before static buffers are used
+        uint8_t WaitForUploads();
+
+        AllocatedBuffer m_stagingRing;
+        VkDeviceSize m_stagingHead{ 0 };
+        // Part of the ring reserved since the last flush
+        VkDeviceSize m_pendingStagingBegin{ 0 };
+        VkDeviceSize m_pendingStagingEnd{ 0 };
+        UploadBatch m_uploadBatches[Ce_UploadBatchCount];
+        uint32_t m_uploadBatchIndex{ 0 };
+        PendingTextureUpload m_pendingTextureUploads[Ce_TextureUploadBatchSize];
+        uint32_t m_pendingTextureUploadCount{ 0 };
+        PendingBufferUpload m_pendingBufferUploads[Ce_BufferUploadBatchSize];
+        uint32_t m_pendingBufferUploadCount{ 0 };
+        uint64_t m_uploadSerial{ 0 };
+
+        // Called after the frame fence once the whole scene is loaded. Swaps in finished images, marks their descriptors dirty 
+        // and every Ce_TextureStreamingInterval frames requests new mips from the screen size of the objects that use each texture
+        void UpdateTextureStreaming(const BlitzenEngine::DrawContext& context);
+
+        // Called after the frame fence. Writes the texture descriptors that changed (streamed images or new textures) in this frame's set
+        void WriteDirtyTextureDescriptors();
+
+        uint8_t StreamTexture(uint32_t textureId, uint8_t mip);
+
+        // Streams every texture whose target is coarser (evictions) or finer than its resident mip. Returns 0 once a request fails
+        uint8_t StreamTargetMips(uint8_t bEvictions, uint32_t streamedCount, uint32_t& streamCount);
+
+        // Replacement images whose upload is no longer pending either left with a batch (m_uploadSerial covers it),
+        // or were dropped by a failed flush and are given back
+        void MarkSubmittedStreamedImages();
+        void CancelDroppedStreamedImages();
+
+        TextureStreamingState m_textureStreaming[BlitzenCore::Ce_MaxTextureCount];
+        BlitCL::DynamicArray<char> m_texturePaths;
+        BlitCL::DynamicArray<float> m_textureScreenSizes;
+        BlitCL::DynamicArray<uint8_t> m_textureTargetMips;
+        StreamedTextureImage m_streamedTextureImages[Ce_MaxStreamedTextureImages];
+        BlitCL::DynamicArray<RetiredTextureImage> m_retiredTextureImages;
+        BlitCL::DynamicArray<uint32_t> m_dirtyTextureDescriptors[Ce_MaxFramesInFlight];
+        uint64_t m_textureStreamingFrame{ 0 };
+
         /*
             Buffer resources section
         */
@@ -195,7 +395,45 @@ namespace BlitzenVulkan
 
         StaticBuffers m_staticBuffers;
 
-        VarBuffers m_varBuffers[ce_framesInFlight];
+        VarBuffers m_varBuffers[Ce_MaxFramesInFlight];
+
+        /*
+            Scene batch section
+        */
+    private:
+
+        // Loading thread. Makes the newest buffer of a scene buffer hold size bytes of pData, appending to it when it fits.
+        // Otherwise (or with bRewrite) the data goes to a new buffer, the old one might still be read by frames in flight
+        uint8_t UpdateSceneBuffer(uint32_t bufferIndex, const void* pData, VkDeviceSize size, uint8_t bRewrite, uint8_t bNoData);
+
+        // Loading thread. Appends the static transforms of the batch to the transform buffer of each frame
+        uint8_t UpdateSceneTransforms(BlitzenEngine::DrawContext& context);
+
+        // Main thread, after the frame fence. Swaps in the buffers and counts of the last batch, 
+        // unless the loading thread is publishing one right now
+        void ApplySceneBatch();
+
+        // Destroys the retired buffers that no frame in flight reads anymore
+        void DestroyRetiredBuffers();
+
+        // Held by the loading thread for the whole publication
+        std::mutex m_sceneBatchMutex;
+        std::atomic<bool> m_bSceneBatchPending{ false };
+        SceneBatchPublication m_sceneBatch{};
+
+        SceneBufferState m_sceneBuffers[Ce_SceneBufferCount];
+        AllocatedBuffer m_grownTransformBuffers[Ce_MaxFramesInFlight];
+        uint32_t m_sceneTransformEnd{ 0 };// Transform ids uploaded so far
+        uint32_t m_sceneTransformCapacity{ 0 };
+        uint32_t m_sceneCompactIndexSize{ 0 };
+        BlitCL::DynamicArray<RetiredBuffer> m_retiredBuffers;
+
+        // Counts of the batch that the main loop draws
+        uint32_t m_drawnRenderCount{ 0 };
+        uint32_t m_drawnTransparentRenderCount{ 0 };
+        uint32_t m_drawnOnpcRenderCount{ 0 };
+        size_t m_drawnTextureCount{ 0 };
+        uint8_t m_bSceneComplete{ 0 };
 
         /*
             Descriptor section
@@ -215,9 +453,13 @@ namespace BlitzenVulkan
         // Descriptor layout for the texture descriptors. 1 binding that holds an array of textures
         DescriptorSetLayout m_textureDescriptorSetlayout;
 
+        // Texture array size. Later batches write their textures to the slots past the ones loaded with the first batch
+        uint32_t m_textureDescriptorCapacity{ BlitzenCore::Ce_MaxTextureCount };
+
         // This descriptor set does not use push descriptors and thus it needs to be allocated with a descriptor pool
+        // One set per frame in flight, so that streamed textures can be rewritten in the set of the frame that is recorded
         DescriptorPool m_textureDescriptorPool;
-        VkDescriptorSet m_textureDescriptorSet;
+        VkDescriptorSet m_textureDescriptorSets[Ce_MaxFramesInFlight];
 
         // Descriptor set layout for the backup shader, used when draw count is 0
         DescriptorSetLayout m_backgroundImageSetLayout;
@@ -230,8 +472,12 @@ namespace BlitzenVulkan
         */
     private:
 
+        // Shared by every pipeline, written to Ce_PipelineCacheFilepath on shutdown
+        PipelineCache m_pipelineCache;
+
         // Main graphics pipeline. Draws opaque objects that have no special properties
         PipelineObject m_opaqueGeometryPipeline;
+        PipelineObject m_instancedGeometryPipeline;
         PipelineObject m_postPassGeometryPipeline;
         PipelineLayout m_graphicsPipelineLayout;
 
@@ -254,6 +500,11 @@ namespace BlitzenVulkan
         PipelineObject m_transparentDrawCullPipeline;
         PipelineLayout m_drawCullLayout;
 
+        // Instanced culling shaders. Reset the LOD instance counts, cull into per LOD instance lists, write one command per visible LOD
+        PipelineObject m_drawInstCountResetPipeline;
+        PipelineObject m_drawInstCullPipeline;
+        PipelineObject m_drawInstCmdPipeline;
+
         // Culling shader for clusters (no mesh shaders)
         PipelineObject m_preClusterCullPipeline;
         PipelineObject m_intialClusterCullPipeline;
@@ -278,7 +529,11 @@ namespace BlitzenVulkan
         */
     private:
 
-        FrameTools m_frameToolsList[ce_framesInFlight];
+        // Records one of the frame's passes into its own command buffer. Called from task pool threads, so it only writes to local copies
+        void RecordFramePass(RecordedPass pass, VkCommandBuffer commandBuffer, const BlitzenEngine::DrawContext& context,
+            VarBuffers& vBuffers, VkImageLayout colorAttachmentWorkingLayout);
+
+        FrameTools m_frameToolsList[Ce_MaxFramesInFlight];
 
         // Used for any loading pipeline
         CommandPool m_idleCommandBufferPool;
@@ -286,6 +541,13 @@ namespace BlitzenVulkan
 
         // Frame tools index
         uint8_t m_currentFrame;
+        uint8_t m_framesInFlight{ Ce_DefaultFramesInFlight };
+
+        // Every submitted frame (loading screen included) has a serial. Each timeline reaches it once that part of the frame is done
+        uint64_t m_frameSerial{ 0 };
+        Semaphore m_frameTimeline;// Graphics queue, waited on before the frame's tools are reused
+        Semaphore m_transferTimeline;// Dynamic transform copy
+        Semaphore m_computeTimeline;// Pre cluster culling
 
         // Holds stats that give information about how the vulkanRenderer is operating
         VulkanStats m_stats;
@@ -294,6 +556,33 @@ namespace BlitzenVulkan
         Queue m_presentQueue;
         Queue m_computeQueue;
         Queue m_transferQueue;
+
+        // The loading thread submits uploads while the main thread draws, and the queues might be the same one
+        std::mutex m_queueSubmitMutex;
+
+        /*
+            GPU timestamps section
+        */
+    private:
+
+        // Checks the timestamp support of the graphics and compute queues
+        void SetupGpuTimestamps();
+
+        // Reset has to be recorded in the first command buffer of the frame
+        void ResetGpuTimestamps(VkCommandBuffer commandBuffer);
+        void BeginGpuPass(VkCommandBuffer commandBuffer, GpuPass pass);
+        void EndGpuPass(VkCommandBuffer commandBuffer, GpuPass pass);
+
+        // Called after the frame fence, reads the timestamps of the last frame that used these tools and updates the stats
+        void ReadGpuTimestamps(FrameTools& tools);
+
+        float m_timestampPeriod{ 0.f };
+        uint64_t m_timestampMask{ 0 };
+        uint8_t m_bComputeTimestampsSupported{ 0 };
+
+        // Ring of per frame pass durations, negative when a pass did not run
+        float m_gpuTimingHistory[Ce_GpuTimingHistorySize][Ce_GpuPassCount];
+        uint32_t m_gpuTimingFrameCount{ 0 };
     };
 
 
@@ -303,7 +592,7 @@ namespace BlitzenVulkan
         VkAllocationCallbacks* pCustomAllocator, Swapchain& newSwapchain, VkSwapchainKHR oldSwapchain = VK_NULL_HANDLE);
 
     // Initalizes structure needed to call the DrawWhileWaiting function
-    uint8_t CreateIdleDrawHandles(VkDevice device, VkPipeline& pipeline,
+    uint8_t CreateIdleDrawHandles(VkDevice device, VkPipelineCache pipelineCache, VkPipeline& pipeline,
         VkPipelineLayout& layout, VkDescriptorSetLayout& setLayout,
         uint32_t queueIndex, VkCommandPool& commandPool, VkCommandBuffer& commandBuffer);
 
@@ -3,91 +3,362 @@
 #include "vulkanCommands.h"
 #include "vulkanRenderer.h"
 #include "vulkanPipelines.h"
+#include "Core/DbLog/blitProfiler.h"
+#include "Core/Threads/blitTaskPool.h"
 
 namespace BlitzenVulkan
 {
-    static uint8_t LoadDDSImageData(BlitzenEngine::DDS_HEADER& header, BlitzenEngine::DDS_HEADER_DXT10& header10, BlitzenPlatform::C_FILE_SCOPE& scopedFILE,
-        VkFormat& vulkanImageFormat, void* pData)
+    uint8_t VulkanRenderer::CreateUploadTools()
     {
-        vulkanImageFormat = GetDDSVulkanFormat(header, header10);
-        if (vulkanImageFormat == VK_FORMAT_UNDEFINED)
+        if (!CreateBuffer(m_allocator, m_stagingRing, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU,
+            Ce_StagingRingSize, VMA_ALLOCATION_CREATE_MAPPED_BIT))
         {
-            BLIT_ERROR("Could not retrieve valid VkFormat for texture");
+            BLIT_ERROR("Failed to create staging ring");
             return 0;
         }
 
-        uint32_t blockSize = (vulkanImageFormat == VK_FORMAT_BC1_RGBA_UNORM_BLOCK || vulkanImageFormat == VK_FORMAT_BC4_SNORM_BLOCK || vulkanImageFormat == VK_FORMAT_BC4_UNORM_BLOCK) ? 8 : 16;
-        auto imageSize = BlitzenEngine::GetDDSImageSizeBC(header.dwWidth, header.dwHeight, header.dwMipMapCount, blockSize);
-        if (imageSize == 0)
+        for (auto& batch : m_uploadBatches)
+        {
+            VkCommandPoolCreateInfo commandPoolInfo{};
+            CreateCommandPoolInfo(commandPoolInfo, m_transferQueue.index, nullptr);
+            if (vkCreateCommandPool(m_device, &commandPoolInfo, nullptr, &batch.commandPool.handle) != VK_SUCCESS)
+            {
+                BLIT_ERROR("Failed to create upload command pool");
+                return 0;
+            }
+
+            VkCommandBufferAllocateInfo commandBufferInfo{};
+            CreateCmdbInfo(commandBufferInfo, batch.commandPool.handle);
+            if (vkAllocateCommandBuffers(m_device, &commandBufferInfo, &batch.commandBuffer) != VK_SUCCESS)
+            {
+                BLIT_ERROR("Failed to create upload command buffer");
+                return 0;
+            }
+
+            VkFenceCreateInfo fenceInfo{};
+            fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+            if (vkCreateFence(m_device, &fenceInfo, nullptr, &batch.fence.handle) != VK_SUCCESS)
+            {
+                BLIT_ERROR("Failed to create upload fence");
+                return 0;
+            }
+        }
+
+        return 1;
+    }
+
+    uint8_t VulkanRenderer::RetireUploadBatch(UploadBatch& batch)
+    {
+        if (vkWaitForFences(m_device, 1, &batch.fence.handle, VK_TRUE, ce_fenceTimeout) != VK_SUCCESS)
         {
-            BLIT_ERROR("Texture data size result is 0, cannot load texture");
+            BLIT_ERROR("Upload batch did not complete");
             return 0;
         }
+        vkResetFences(m_device, 1, &batch.fence.handle);
 
-        auto file = scopedFILE.m_pHandle;
-        auto readSize = fread(pData, 1, imageSize, file);
+        batch.bInFlight = 0;
+        return 1;
+    }
 
-        if (!pData)
+    uint8_t VulkanRenderer::ReserveStaging(VkDeviceSize size, VkDeviceSize& offset)
+    {
+        if (size > Ce_StagingRingSize)
         {
-            BLIT_ERROR("Failed to initialize texture data");
+            BLIT_ERROR("Upload does not fit in the staging ring");
             return 0;
         }
 
-        if (readSize != imageSize)
+        auto begin{ (m_stagingHead + Ce_StagingAlignment - 1) & ~(Ce_StagingAlignment - 1) };
+        if (begin + size > Ce_StagingRingSize)
+        {
+            // A batch reads one contiguous range, so the pending one is submitted before wrapping around
+            if (!FlushUploads())
+            {
+                return 0;
+            }
+            begin = 0;
+        }
+
+        for (auto& batch : m_uploadBatches)
+        {
+            if (batch.bInFlight && begin < batch.ringEnd && batch.ringBegin < begin + size && !RetireUploadBatch(batch))
+            {
+                return 0;
+            }
+        }
+
+        if (m_pendingStagingBegin == m_pendingStagingEnd)
+        {
+            m_pendingStagingBegin = begin;
+        }
+        m_pendingStagingEnd = begin + size;
+
+        offset = begin;
+        m_stagingHead = begin + size;
+        return 1;
+    }
+
+    uint8_t VulkanRenderer::FlushUploads()
+    {
+        if (!m_pendingTextureUploadCount && !m_pendingBufferUploadCount)
+        {
+            return 1;
+        }
+
+        BLIT_PROFILE_FUNCTION();
+
+        auto textureUploadCount{ m_pendingTextureUploadCount };
+        auto bufferUploadCount{ m_pendingBufferUploadCount };
+        m_pendingTextureUploadCount = 0;
+        m_pendingBufferUploadCount = 0;
+
+        // Mip chains are copied straight from the file mappings to the mapped ring, each worker copies whole textures or buffer chunks
+        auto pStaging{ reinterpret_cast<uint8_t*>(m_stagingRing.allocationInfo.pMappedData) };
+        BlitzenCore::GetTaskPool().ParallelFor(textureUploadCount + bufferUploadCount, [&](size_t i)
+            {
+                if (i < textureUploadCount)
+                {
+                    BLIT_PROFILE_ZONE("CopyTextureData");
+
+                    auto& upload{ m_pendingTextureUploads[i] };
+                    BlitzenPlatform::ReadMemoryMappedFile(upload.mappedFile, upload.dataOffset, upload.dataSize, pStaging + upload.stagingOffset);
+                    upload.mappedFile.Close();
+                    return;
+                }
+
+                const auto& upload{ m_pendingBufferUploads[i - textureUploadCount] };
+                if (upload.pData)
+                {
+                    BLIT_PROFILE_ZONE("CopyBufferData");
+                    memcpy(pStaging + upload.stagingOffset, upload.pData, upload.size);
+                }
+            });
+
+        auto& batch{ m_uploadBatches[m_uploadBatchIndex] };
+        if (batch.bInFlight && !RetireUploadBatch(batch))
         {
-            BLIT_ERROR("Texture data size is ambiguous");
             return 0;
         }
 
-        // Success
+        BeginCommandBuffer(batch.commandBuffer, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+        for (uint32_t i = 0; i < textureUploadCount; ++i)
+        {
+            const auto& upload{ m_pendingTextureUploads[i] };
+            RecordTextureImageCopy(batch.commandBuffer, m_stagingRing.bufferHandle, upload.stagingOffset,
+                *upload.pImage, upload.mipLevels);
+        }
+        for (uint32_t i = 0; i < bufferUploadCount; ++i)
+        {
+            const auto& upload{ m_pendingBufferUploads[i] };
+            if (upload.pData)
+            {
+                CopyBufferToBuffer(batch.commandBuffer, m_stagingRing.bufferHandle, upload.buffer, upload.size, upload.stagingOffset, upload.bufferOffset);
+            }
+            else
+            {
+                vkCmdFillBuffer(batch.commandBuffer, upload.buffer, upload.bufferOffset, upload.size, 0);
+            }
+        }
+        {
+            std::lock_guard<std::mutex> queueLock(m_queueSubmitMutex);
+            SubmitCommandBuffer(m_transferQueue.handle, batch.commandBuffer, 0, nullptr, 0, nullptr, batch.fence.handle);
+        }
+
+        batch.ringBegin = m_pendingStagingBegin;
+        batch.ringEnd = m_pendingStagingEnd;
+        batch.bInFlight = 1;
+        batch.serial = ++m_uploadSerial;
+        m_uploadBatchIndex = (m_uploadBatchIndex + 1) % Ce_UploadBatchCount;
+        m_pendingStagingBegin = 0;
+        m_pendingStagingEnd = 0;
+
+        return 1;
+    }
+
+    uint8_t VulkanRenderer::WaitForUploads()
+    {
+        if (!FlushUploads())
+        {
+            return 0;
+        }
+
+        for (auto& batch : m_uploadBatches)
+        {
+            if (batch.bInFlight && !RetireUploadBatch(batch))
+            {
+                return 0;
+            }
+        }
+
+        return 1;
+    }
+
+    uint8_t VulkanRenderer::QueueTextureUpload(const char* filepath, size_t dataOffset, size_t dataSize, AllocatedImage& image, uint8_t mipLevels)
+    {
+        // Might submit the pending batch, so the slot is picked after
+        VkDeviceSize stagingOffset{ 0 };
+        if (!ReserveStaging(dataSize, stagingOffset))
+        {
+            BLIT_ERROR("Failed to reserve staging memory for texture");
+            return 0;
+        }
+
+        // The mapping is kept open until the batch is flushed, so that the kernel reads ahead while the loader moves on
+        auto& upload{ m_pendingTextureUploads[m_pendingTextureUploadCount] };
+        auto mappingResult{ upload.mappedFile.Open(filepath, BlitzenPlatform::FileModes::Read, 0) };
+        if (mappingResult != BlitzenPlatform::BLIT_MMF_RES::SUCCESS || dataOffset + dataSize > upload.mappedFile.m_fileSize)
+        {
+            BLIT_ERROR("Failed to map texture file %s: %s", filepath, BlitzenPlatform::GET_BLIT_MMF_RES_ERROR_STR(mappingResult));
+            upload.mappedFile.Close();
+            return 0;
+        }
+
+        upload.dataOffset = dataOffset;
+        upload.dataSize = dataSize;
+        upload.stagingOffset = stagingOffset;
+        upload.pImage = &image;
+        upload.mipLevels = mipLevels;
+
+        if (++m_pendingTextureUploadCount == Ce_TextureUploadBatchSize)
+        {
+            return FlushUploads();
+        }
+        return 1;
+    }
+
+    uint8_t VulkanRenderer::QueueBufferUpload(VkBuffer buffer, const void* pData, VkDeviceSize size, VkDeviceSize bufferOffset)
+    {
+        for (VkDeviceSize dataOffset = 0; dataOffset < size; dataOffset += Ce_BufferUploadChunkSize)
+        {
+            auto chunkSize{ size - dataOffset < Ce_BufferUploadChunkSize ? size - dataOffset : Ce_BufferUploadChunkSize };
+
+            // Might submit the pending batch, so the slot is picked after
+            VkDeviceSize stagingOffset{ 0 };
+            if (pData && !ReserveStaging(chunkSize, stagingOffset))
+            {
+                BLIT_ERROR("Failed to reserve staging memory for buffer");
+                return 0;
+            }
+
+            auto& upload{ m_pendingBufferUploads[m_pendingBufferUploadCount] };
+            upload.pData = pData ? reinterpret_cast<const uint8_t*>(pData) + dataOffset : nullptr;
+            upload.buffer = buffer;
+            upload.bufferOffset = bufferOffset + dataOffset;
+            upload.size = chunkSize;
+            upload.stagingOffset = stagingOffset;
+
+            if (++m_pendingBufferUploadCount == Ce_BufferUploadBatchSize && !FlushUploads())
+            {
+                return 0;
+            }
+        }
+
         return 1;
     }
 
     uint8_t VulkanRenderer::UploadTexture(const char* filepath) 
     {
+        BLIT_PROFILE_FUNCTION();
+
         if (!m_stats.bResourceManagementReady)
         {
             BLIT_ERROR("Resource management is not initialized, cannot upload texture");
             return 0;
         }
 
-        // Staging buffer
-        AllocatedBuffer stagingBuffer;
-        if(!CreateBuffer(m_allocator, stagingBuffer, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, 
-            ce_textureStagingBufferSize, VMA_ALLOCATION_CREATE_MAPPED_BIT))
+        if (textureCount >= m_textureDescriptorCapacity)
         {
-            BLIT_ERROR("Failed to create staging buffer for texture data copy");
+            BLIT_ERROR("Max texture count exceeded");
             return 0;
         }
-        void* pData{ stagingBuffer.allocationInfo.pMappedData };
 
-        // Initializes necessary data for DDS texture
-		BlitzenEngine::DDS_HEADER header{};
-		BlitzenEngine::DDS_HEADER_DXT10 header10{};
-        BlitzenPlatform::C_FILE_SCOPE scopedFILE{};
-        VkFormat format = VK_FORMAT_UNDEFINED;
-        if(!BlitzenEngine::OpenDDSImageFile(filepath, header, header10, scopedFILE))
+        // Only the headers are parsed here, the mip chain is copied with the rest of the batch
+        BlitzenEngine::DDS_HEADER header{};
+        BlitzenEngine::DDS_HEADER_DXT10 header10{};
+        size_t dataOffset{ 0 };
+        size_t fileSize{ 0 };
         {
-            BLIT_ERROR("Failed to open texture file");
+            BlitzenPlatform::MEMORY_MAPPED_FILE_SCOPE mappedFile;
+            auto mappingResult{ mappedFile.Open(filepath, BlitzenPlatform::FileModes::Read, 0) };
+            if (mappingResult != BlitzenPlatform::BLIT_MMF_RES::SUCCESS)
+            {
+                BLIT_ERROR("Failed to map texture file %s: %s", filepath, BlitzenPlatform::GET_BLIT_MMF_RES_ERROR_STR(mappingResult));
+                return 0;
+            }
+
+            if (!BlitzenEngine::ParseDDSHeaders(filepath, reinterpret_cast<const uint8_t*>(mappedFile.m_pFileView),
+                mappedFile.m_fileSize, header, header10, dataOffset))
+            {
+                BLIT_ERROR("Failed to open texture file");
+                return 0;
+            }
+            fileSize = mappedFile.m_fileSize;
+        }
+
+        auto format{ GetDDSVulkanFormat(header, header10) };
+        if (format == VK_FORMAT_UNDEFINED)
+        {
+            BLIT_ERROR("Could not retrieve valid VkFormat for texture");
             return 0;
         }
-		if (!LoadDDSImageData(header, header10, scopedFILE, format, pData))
-		{
-            BLIT_ERROR("Failed to load texture data");
+
+        uint32_t blockSize = (format == VK_FORMAT_BC1_RGBA_UNORM_BLOCK || format == VK_FORMAT_BC4_SNORM_BLOCK || format == VK_FORMAT_BC4_UNORM_BLOCK) ? 8 : 16;
+        auto imageSize = BlitzenEngine::GetDDSImageSizeBC(header.dwWidth, header.dwHeight, header.dwMipMapCount, blockSize);
+        if (imageSize == 0 || dataOffset + imageSize > fileSize)
+        {
+            BLIT_ERROR("Texture data size is ambiguous: %s", filepath);
             return 0;
-		}
+        }
+
+        // With streaming, only the mip tail is loaded with the scene. Finer mips come from UpdateTextureStreaming
+        uint8_t firstMip{ 0 };
+        uint8_t mipCount{ uint8_t(header.dwMipMapCount) };
+        if constexpr (Ce_TextureStreaming)
+        {
+            while (firstMip + 1 < mipCount && BlitML::Max(header.dwWidth >> firstMip, header.dwHeight >> firstMip) > Ce_TextureStreamingTailSize)
+            {
+                ++firstMip;
+            }
 
-        // Creates the texture image for Vulkan by copying the data from the staging buffer
-        if(!CreateTextureImage(stagingBuffer, m_device, m_allocator, loadedTextures[textureCount].image, 
-        {header.dwWidth, header.dwHeight, 1}, format, VK_IMAGE_USAGE_SAMPLED_BIT, 
-        m_frameToolsList[0].transferCommandBuffer, m_transferQueue.handle, header.dwMipMapCount))
+            auto& state{ m_textureStreaming[textureCount] };
+            state.pathOffset = uint32_t(m_texturePaths.GetSize());
+            for (const char* c = filepath; ; ++c)
+            {
+                m_texturePaths.PushBack(*c);
+                if (!*c)
+                {
+                    break;
+                }
+            }
+            state.dataOffset = dataOffset;
+            state.width = header.dwWidth;
+            state.height = header.dwHeight;
+            state.blockSize = blockSize;
+            state.mipCount = mipCount;
+            state.tailMip = firstMip;
+            state.residentMip = firstMip;
+            state.bStreaming = 0;
+        }
+        auto mipOffset{ BlitzenEngine::GetDDSImageSizeBC(header.dwWidth, header.dwHeight, firstMip, blockSize) };
+        VkExtent3D extent{ BlitML::Max(header.dwWidth >> firstMip, 1u), BlitML::Max(header.dwHeight >> firstMip, 1u), 1 };
+
+        // The image is created now, so that texture ids stay in upload order
+        auto& texture{ loadedTextures[textureCount] };
+        if (!CreateImage(m_device, m_allocator, texture.image, extent, format,
+            VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, mipCount - firstMip))
         {
             BLIT_ERROR("Failed to load Vulkan texture image");
             return 0;
         }
+
+        if (!QueueTextureUpload(filepath, dataOffset + mipOffset, imageSize - mipOffset, texture.image, mipCount - firstMip))
+        {
+            BLIT_ERROR("Failed to queue texture upload");
+            return 0;
+        }
         
         // Add the global sampler at the element in the array that was just porcessed
-        loadedTextures[textureCount].sampler = m_textureSampler.handle;
+        texture.sampler = m_textureSampler.handle;
         textureCount++;
         return 1;
     }
@@ -112,6 +383,14 @@ namespace BlitzenVulkan
         uint32_t clusterIndicesBindingID = currentId++;
         uint32_t onpcObjectsBindingID = currentId++;
 
+        uint32_t lodInstanceCounterBindingID;
+        uint32_t instanceIndexBindingID;
+        if (Ce_VkInstanceCulling)
+        {
+            lodInstanceCounterBindingID = currentId++;
+            instanceIndexBindingID = currentId++;
+        }
+
         uint32_t tlasBindingID;
         if (bRaytracing)
         {
@@ -169,6 +448,15 @@ namespace BlitzenVulkan
         CreateDescriptorSetLayoutBinding(pBindings[onpcObjectsBindingID], staticBuffers.onpcReflectiveRenderObjectBuffer.descriptorBinding,
             descriptorCountOfEachPushDescriptorLayoutBinding, staticBuffers.onpcReflectiveRenderObjectBuffer.descriptorType, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
 
+        if (Ce_VkInstanceCulling)
+        {
+            CreateDescriptorSetLayoutBinding(pBindings[lodInstanceCounterBindingID], staticBuffers.lodInstanceCounterBuffer.descriptorBinding,
+                descriptorCountOfEachPushDescriptorLayoutBinding, staticBuffers.lodInstanceCounterBuffer.descriptorType, VK_SHADER_STAGE_COMPUTE_BIT);
+
+            CreateDescriptorSetLayoutBinding(pBindings[instanceIndexBindingID], staticBuffers.instanceIndexBuffer.descriptorBinding,
+                descriptorCountOfEachPushDescriptorLayoutBinding, staticBuffers.instanceIndexBuffer.descriptorType, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT);
+        }
+
         if (bRaytracing)
         {
             CreateDescriptorSetLayoutBinding(pBindings[tlasBindingID], staticBuffers.tlasBuffer.descriptorBinding, descriptorCountOfEachPushDescriptorLayoutBinding,
@@ -181,7 +469,7 @@ namespace BlitzenVulkan
 
     static uint8_t CreateDescriptorLayouts(VkDevice device, VkDescriptorSetLayout& ssboPushDescriptorLayout,
         VulkanRenderer::VarBuffers& varBuffers, VulkanRenderer::StaticBuffers& staticBuffers,
-        uint8_t bRaytracing, uint8_t bMeshShaders, uint32_t textureCount, VkDescriptorSetLayout& textureSetLayout,
+        uint8_t bRaytracing, uint8_t bMeshShaders, uint32_t textureDescriptorCount, VkDescriptorSetLayout& textureSetLayout,
         const PushDescriptorImage& depthAttachment, const PushDescriptorImage& depthPyramid,
         VkDescriptorSetLayout& depthPyramidSetLayout, const PushDescriptorImage& colorAttachment,
         VkDescriptorSetLayout& presentationSetLayout)
@@ -190,6 +478,11 @@ namespace BlitzenVulkan
 
         // The big GPU push descriptor set layout. Holds most buffers
         BlitCL::DynamicArray<VkDescriptorSetLayoutBinding> gpuPushDescriptorBindings{ 13, {} };
+        if (Ce_VkInstanceCulling)
+        {
+            gpuPushDescriptorBindings.PushBack({});
+            gpuPushDescriptorBindings.PushBack({});
+        }
         if (bRaytracing)
         {
             gpuPushDescriptorBindings.PushBack({});
@@ -204,7 +497,7 @@ namespace BlitzenVulkan
 
         // Descriptor set layout for textures
         VkDescriptorSetLayoutBinding texturesLayoutBinding{};
-        CreateDescriptorSetLayoutBinding(texturesLayoutBinding, 0, static_cast<uint32_t>(textureCount),
+        CreateDescriptorSetLayoutBinding(texturesLayoutBinding, 0, textureDescriptorCount,
             VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT);
         textureSetLayout = CreateDescriptorSetLayout(device, 1, &texturesLayoutBinding);
         if (textureSetLayout == VK_NULL_HANDLE)
@@ -254,13 +547,31 @@ namespace BlitzenVulkan
         return 1;
     }
 
+    // Transform buffer is dynamic. Device local memory the host can write to (resizable BAR or UMA) is preferred, 
+    // dynamic transforms are then written in place. Otherwise VMA falls back to plain device memory
+    static uint8_t CreateTransformBuffer(VmaAllocator vma, AllocatedBuffer& buffer, VkDeviceSize size)
+    {
+        return CreateBuffer(vma, buffer, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, size, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | 
+            VMA_ALLOCATION_CREATE_HOST_ACCESS_ALLOW_TRANSFER_INSTEAD_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT);
+    }
+
+    // Non coherent memory would need a flush after every write, the staging copy is used for it instead
+    static uint8_t IsDirectWriteTransformBuffer(VmaAllocator vma, const AllocatedBuffer& buffer)
+    {
+        VkMemoryPropertyFlags transformMemoryFlags{ 0 };
+        vmaGetAllocationMemoryProperties(vma, buffer.allocation, &transformMemoryFlags);
+        constexpr VkMemoryPropertyFlags directWriteFlags{ VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | 
+            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT };
+        return (transformMemoryFlags & directWriteFlags) == directWriteFlags && buffer.allocationInfo.pMappedData;
+    }
+
     static uint8_t VarBuffersInit(VkDevice device, VmaAllocator vma, VkCommandBuffer commandBuffer, VkQueue queue,
-        BlitzenEngine::DrawContext& context, VulkanRenderer::VarBuffers* varBuffers)
+        BlitzenEngine::DrawContext& context, VulkanRenderer::VarBuffers* varBuffers, uint8_t framesInFlight)
     {
-        const auto& transforms{ context.m_renders.m_transforms };
         size_t transformDynamicDataSize{ context.m_renders.m_dynamicTransformCount * sizeof(BlitzenEngine::MeshTransform)};
 
-        for (size_t i = 0; i < ce_framesInFlight; ++i)
+        for (size_t i = 0; i < framesInFlight; ++i)
         {
             auto& buffers = varBuffers[i];
 
@@ -277,95 +588,78 @@ namespace BlitzenVulkan
             CreatePushDescriptorWrite(buffers.viewDataBuffer.descriptorWrite, buffers.viewDataBuffer.bufferInfo, 
                 buffers.viewDataBuffer.buffer.bufferHandle, buffers.viewDataBuffer.descriptorType, buffers.viewDataBuffer.descriptorBinding);
 
-            // Transform buffer is also dynamic
-            AllocatedBuffer transformStagingBufferTemp;
-            auto transformBufferSize
-            {
-                SetupPushDescriptorBuffer(device, vma,buffers.transformBuffer, transformStagingBufferTemp, context.m_renders.m_transformCount,
-                    VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, context.m_renders.m_transforms)
-            };
-            if (transformBufferSize == 0)
+            // Static transform ids start at Ce_MaxDynamicObjectCount, so the buffer is sized up to the last one
+            VkDeviceSize transformBufferSize{ context.m_renders.m_staticTransformOffset * sizeof(BlitzenEngine::MeshTransform) };
+            if (!transformBufferSize || !CreateTransformBuffer(vma, buffers.transformBuffer.buffer, transformBufferSize))
             {
                 BLIT_ERROR("Failed to create transform buffer");
                 return 0;
             }
+            CreatePushDescriptorWrite(buffers.transformBuffer.descriptorWrite, buffers.transformBuffer.bufferInfo,
+                buffers.transformBuffer.buffer.bufferHandle, buffers.transformBuffer.descriptorType, buffers.transformBuffer.descriptorBinding);
+
+            if (IsDirectWriteTransformBuffer(vma, buffers.transformBuffer.buffer))
+            {
+                buffers.pTransformData = reinterpret_cast<BlitzenEngine::MeshTransform*>(buffers.transformBuffer.buffer.allocationInfo.pMappedData);
+                BlitzenCore::BlitMemCopy(buffers.pTransformData, context.m_renders.m_transforms, transformBufferSize);
+                buffers.bDirectTransformWrites = 1;
+                buffers.dynamicTransformDataSize = transformDynamicDataSize;
+                continue;
+            }
+
+            AllocatedBuffer transformStagingBufferTemp;
+            if (!CreateBuffer(vma, transformStagingBufferTemp, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU,
+                transformBufferSize, VMA_ALLOCATION_CREATE_MAPPED_BIT))
+            {
+                BLIT_ERROR("Failed to create transform staging buffer");
+                return 0;
+            }
+            BlitzenCore::BlitMemCopy(transformStagingBufferTemp.allocationInfo.pMappedData, context.m_renders.m_transforms, transformBufferSize);
+
             // Records command to copy staging buffer data to GPU buffers
             BeginCommandBuffer(commandBuffer, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
             CopyBufferToBuffer(commandBuffer, transformStagingBufferTemp.bufferHandle, buffers.transformBuffer.buffer.bufferHandle, transformBufferSize, 0, 0);
-            SubmitCommandBuffer(queue, commandBuffer);
-            vkQueueWaitIdle(queue);
+            if (!SubmitCommandBufferAndWait(device, queue, commandBuffer))
+            {
+                BLIT_ERROR("Failed to copy transforms");
+                return 0;
+            }
 
-            // Persistently mapped staging buffer
+            // Persistently mapped staging buffer. It starts with every dynamic transform, so copy regions may span clean ones
             CreateBuffer(vma, buffers.transformStagingBuffer, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, 
                 transformDynamicDataSize, VMA_ALLOCATION_CREATE_MAPPED_BIT);
             buffers.pTransformData = reinterpret_cast<BlitzenEngine::MeshTransform*>(buffers.transformStagingBuffer.allocationInfo.pMappedData);
+            if (transformDynamicDataSize)
+            {
+                BlitzenCore::BlitMemCopy(buffers.pTransformData, context.m_renders.m_transforms, transformDynamicDataSize);
+            }
             buffers.dynamicTransformDataSize = transformDynamicDataSize;
         }
 
         return 1;
     }
 
+    // Host data of every static buffer, streamed through the staging ring once the buffers exist
     struct StaticBufferCopyContext
     {
-        VkBuffer stagings[Ce_StaticSSBODataCount]{};
+        const void* pData[Ce_StaticSSBODataCount]{};
+        VkBuffer buffers[Ce_StaticSSBODataCount]{};
         VkDeviceSize sizes[Ce_StaticSSBODataCount]{};
-    };
-    static void CopyStaticBufferDataToGPUBuffers(VkCommandBuffer commandBuffer, VkQueue queue, VulkanRenderer::StaticBuffers& buffers, StaticBufferCopyContext& ctx,
-        VkDeviceSize visibilityBufferSize)
-    {
-        BeginCommandBuffer(commandBuffer, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
-
-        CopyBufferToBuffer(commandBuffer, ctx.stagings[Ce_VertexBufferDataCopyIndex], buffers.vertexBuffer.buffer.bufferHandle, 
-            ctx.sizes[Ce_VertexBufferDataCopyIndex], 0, 0);
-
-        CopyBufferToBuffer(commandBuffer, ctx.stagings[Ce_IndexBufferDataCopyIndex], buffers.indexBuffer.bufferHandle, 
-            ctx.sizes[Ce_IndexBufferDataCopyIndex], 0, 0);
-
-        CopyBufferToBuffer(commandBuffer, ctx.stagings[Ce_OpaqueRenderBufferCopyIndex], buffers.renderObjectBuffer.bufferHandle, 
-            ctx.sizes[Ce_OpaqueRenderBufferCopyIndex], 0, 0);
-
-        if (ctx.sizes[Ce_TransparentRenderBufferCopyIndex] != 0)
-        {
-            CopyBufferToBuffer(commandBuffer, ctx.stagings[Ce_TransparentRenderBufferCopyIndex], buffers.transparentRenderObjectBuffer.bufferHandle, 
-                ctx.sizes[Ce_TransparentRenderBufferCopyIndex], 0, 0);
-        }
-
-        if (ctx.sizes[Ce_ONPCRenderBufferCopyIndex] != 0)
-        {
-            CopyBufferToBuffer(commandBuffer, ctx.stagings[Ce_ONPCRenderBufferCopyIndex], buffers.onpcReflectiveRenderObjectBuffer.buffer.bufferHandle, 
-                ctx.sizes[Ce_ONPCRenderBufferCopyIndex], 0, 0);
-        }
-
-        CopyBufferToBuffer(commandBuffer, ctx.stagings[Ce_SurfaceBufferDataCopyIndex], buffers.surfaceBuffer.buffer.bufferHandle, 
-            ctx.sizes[Ce_SurfaceBufferDataCopyIndex], 0, 0);
 
-		CopyBufferToBuffer(commandBuffer, ctx.stagings[Ce_LodBufferDataCopyIndex], buffers.lodBuffer.buffer.bufferHandle, 
-            ctx.sizes[Ce_LodBufferDataCopyIndex], 0, 0);
-
-        CopyBufferToBuffer(commandBuffer, ctx.stagings[Ce_MaterialBufferDataCopyIndex], buffers.materialBuffer.buffer.bufferHandle, 
-            ctx.sizes[Ce_MaterialBufferDataCopyIndex], 0, 0);
-        
-        // Visibility buffer just gets filled with zeroes
-        vkCmdFillBuffer(commandBuffer, buffers.visibilityBuffer.buffer.bufferHandle, 0, visibilityBufferSize, 0);
-
-        if (BlitzenCore::Ce_BuildClusters)
+        inline void Set(uint32_t index, VkBuffer buffer, const void* pSrc, VkDeviceSize size)
         {
-            CopyBufferToBuffer(commandBuffer, ctx.stagings[Ce_ClusterBufferDataCopyIndex], buffers.clusterBuffer.buffer.bufferHandle, 
-                ctx.sizes[Ce_ClusterBufferDataCopyIndex], 0, 0);
-
-            CopyBufferToBuffer(commandBuffer, ctx.stagings[Ce_ClusterIndexBufferDataCopyIndex], buffers.meshletDataBuffer.buffer.bufferHandle, 
-                ctx.sizes[Ce_ClusterIndexBufferDataCopyIndex], 0, 0);
+            buffers[index] = buffer;
+            pData[index] = pSrc;
+            sizes[index] = size;
         }
+    };
 
-        // Submit the commands and wait for the queue to finish
-        SubmitCommandBuffer(queue, commandBuffer);
-        vkQueueWaitIdle(queue);
-    }
-
-    static uint8_t StaticBuffersInit(VkInstance instance, VkDevice device, VmaAllocator vma, VulkanRenderer::FrameTools& frameTools, VkQueue transferQueue,
-        VulkanRenderer::StaticBuffers& staticBuffers, BlitzenEngine::DrawContext& context, VulkanStats& stats)
+    // Creates the device local buffers. Their data is not copied here, copyContext gets what each of them needs
+    static uint8_t StaticBuffersInit(VkDevice device, VmaAllocator vma, VulkanRenderer::StaticBuffers& staticBuffers, 
+        BlitzenEngine::DrawContext& context, VulkanStats& stats, StaticBufferCopyContext& copyContext)
     {
         const auto& vertices{ context.m_meshes.m_vertices };
+        const auto& compactVertices{ context.m_meshes.m_compactVertices };
         const auto& indices{ context.m_meshes.m_indices };
         auto pRenderObjects { context.m_renders.m_renders};
         auto renderObjectCount{ context.m_renders.m_renderCount };
@@ -380,114 +674,136 @@ namespace BlitzenVulkan
         auto transparentRenderobjects = context.m_renders.m_transparentRenders;
         uint32_t transparentRenderCount = context.m_renders.m_transparentRenderCount;
         const auto& lodData = context.m_meshes.m_LODs;
+        const auto& lodInstanceList = context.m_meshes.m_lodInstanceList;
 
         // Additional RT flags for geometry
         auto bRT{ stats.bRayTracingSupported };
         uint32_t geometryRtFlags = bRT ? VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT : 0;
 
-        // Vertex buffer
-        AllocatedBuffer stagingVertexBuffer{};
+        // Vertex buffer (the compact layout replaces the classic one)
+        VkBufferUsageFlags vertexBufferUsage{ VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | geometryRtFlags };
         auto vertexBufferSize
         {
-            SetupPushDescriptorBuffer(device, vma, staticBuffers.vertexBuffer, stagingVertexBuffer, vertices.GetSize(),
-                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | geometryRtFlags, vertices.Data())
+            BlitzenCore::Ce_CompactVertices ?
+            SetupPushDescriptorBuffer<BlitzenEngine::CompactVertex>(vma, VMA_MEMORY_USAGE_GPU_ONLY, staticBuffers.vertexBuffer, compactVertices.GetSize(), vertexBufferUsage) :
+            SetupPushDescriptorBuffer<BlitzenEngine::Vertex>(vma, VMA_MEMORY_USAGE_GPU_ONLY, staticBuffers.vertexBuffer, vertices.GetSize(), vertexBufferUsage)
         };
         if (vertexBufferSize == 0)
         {
             BLIT_ERROR("Failed to create vertex buffer");
             return 0;
         }
+        copyContext.Set(Ce_VertexBufferDataCopyIndex, staticBuffers.vertexBuffer.buffer.bufferHandle, 
+            BlitzenCore::Ce_CompactVertices ? static_cast<const void*>(compactVertices.Data()) : vertices.Data(), vertexBufferSize);
 
         // Index buffer
-        AllocatedBuffer stagingIndexBuffer;
         VkDeviceSize indexBufferSize{ indices.GetSize() * sizeof(uint32_t) };
-        if (!CreateSSBO(vma, device, indices.Data(), staticBuffers.indexBuffer, stagingIndexBuffer, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, indexBufferSize))
+        void* pIndexData{ indices.Data() };
+        staticBuffers.indexType = VK_INDEX_TYPE_UINT32;
+        if (BlitzenCore::Ce_CompactVertices)
         {
-            BLIT_ERROR("Failed to create index buffer");
-            return 0;
+            indexBufferSize = context.m_meshes.m_compactIndices.GetSize();
+            pIndexData = context.m_meshes.m_compactIndices.Data();
+            staticBuffers.indexType = context.m_meshes.m_compactIndexSize == sizeof(uint16_t) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+        }
+        // Cluster mode pulls vertices through the meshlet data, the index buffer might not exist
+        if (indexBufferSize != 0)
+        {
+            if (!CreateBuffer(vma, staticBuffers.indexBuffer, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | geometryRtFlags, 
+                VMA_MEMORY_USAGE_GPU_ONLY, indexBufferSize, VMA_ALLOCATION_CREATE_MAPPED_BIT))
+            {
+                BLIT_ERROR("Failed to create index buffer");
+                return 0;
+            }
+            copyContext.Set(Ce_IndexBufferDataCopyIndex, staticBuffers.indexBuffer.bufferHandle, pIndexData, indexBufferSize);
         }
 
         // Opaque render buffer
-        AllocatedBuffer renderObjectStagingBuffer;
         VkDeviceSize renderObjectBufferSize{ renderObjectCount * sizeof(BlitzenEngine::RenderObject) };
-        if (!CreateSSBO(vma, device, pRenderObjects, staticBuffers.renderObjectBuffer, renderObjectStagingBuffer,
-            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, renderObjectBufferSize))
+        if (renderObjectBufferSize == 0 || !CreateBuffer(vma, staticBuffers.renderObjectBuffer, 
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, 
+            VMA_MEMORY_USAGE_GPU_ONLY, renderObjectBufferSize, VMA_ALLOCATION_CREATE_MAPPED_BIT))
         {
             BLIT_ERROR("Failed to create render object buffer");
             return 0;
         }
+        copyContext.Set(Ce_OpaqueRenderBufferCopyIndex, staticBuffers.renderObjectBuffer.bufferHandle, pRenderObjects, renderObjectBufferSize);
         // Address for push constant
         staticBuffers.renderObjectBufferAddress = GetBufferAddress(device, staticBuffers.renderObjectBuffer.bufferHandle);
 
         // ONPC render buffer
-        AllocatedBuffer onpcRenderObjectStagingBuffer;
-        VkDeviceSize onpcRenderObjectBufferSize{ 0 };
         if (onpcRenderObjectCount != 0)
         {
-
-            onpcRenderObjectBufferSize = SetupPushDescriptorBuffer(device, vma, staticBuffers.onpcReflectiveRenderObjectBuffer,
-                onpcRenderObjectStagingBuffer, onpcRenderObjectCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, pOnpcRenderObjects);
+            auto onpcRenderObjectBufferSize
+            {
+                SetupPushDescriptorBuffer<BlitzenEngine::RenderObject>(vma, VMA_MEMORY_USAGE_GPU_ONLY, staticBuffers.onpcReflectiveRenderObjectBuffer,
+                    onpcRenderObjectCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT)
+            };
             if (onpcRenderObjectBufferSize == 0)
             {
                 BLIT_ERROR("Failed to create Oblique Near-Plane Clipping render object buffer");
                 return 0;
             }
+            copyContext.Set(Ce_ONPCRenderBufferCopyIndex, staticBuffers.onpcReflectiveRenderObjectBuffer.buffer.bufferHandle, 
+                pOnpcRenderObjects, onpcRenderObjectBufferSize);
             stats.bObliqueNearPlaneClippingObjectsExist = 1;
         }
 
         // Transparent render buffer
-        AllocatedBuffer tranparentRenderObjectStagingBuffer;
         auto transparentRenderObjectBufferSize{ transparentRenderCount * sizeof(BlitzenEngine::RenderObject) };
         if (transparentRenderObjectBufferSize != 0)
         {
-            if (!CreateSSBO(vma, device, transparentRenderobjects, staticBuffers.transparentRenderObjectBuffer, tranparentRenderObjectStagingBuffer,
-                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, transparentRenderObjectBufferSize))
+            if (!CreateBuffer(vma, staticBuffers.transparentRenderObjectBuffer,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, 
+                VMA_MEMORY_USAGE_GPU_ONLY, transparentRenderObjectBufferSize, VMA_ALLOCATION_CREATE_MAPPED_BIT))
             {
                 BLIT_ERROR("Failed to create transparent render object buffer");
                 return 0;
             }
+            copyContext.Set(Ce_TransparentRenderBufferCopyIndex, staticBuffers.transparentRenderObjectBuffer.bufferHandle, 
+                transparentRenderobjects, transparentRenderObjectBufferSize);
             stats.bTranspartentObjectsExist = 1;
             staticBuffers.transparentRenderObjectBufferAddress = GetBufferAddress(device, staticBuffers.transparentRenderObjectBuffer.bufferHandle);
         }
 
         // Surface buffer
-        AllocatedBuffer surfaceStagingBuffer;
         auto surfaceBufferSize
         {
-            SetupPushDescriptorBuffer(device, vma, staticBuffers.surfaceBuffer, surfaceStagingBuffer, surfaces.GetSize(),
-                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, surfaces.Data())
+            SetupPushDescriptorBuffer<BlitzenEngine::PrimitiveSurface>(vma, VMA_MEMORY_USAGE_GPU_ONLY, staticBuffers.surfaceBuffer, surfaces.GetSize(),
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT)
         };
         if (surfaceBufferSize == 0)
         {
             BLIT_ERROR("Failed to create surface buffer");
             return 0;
         }
+        copyContext.Set(Ce_SurfaceBufferDataCopyIndex, staticBuffers.surfaceBuffer.buffer.bufferHandle, surfaces.Data(), surfaceBufferSize);
 
         // Lod buffer
-        AllocatedBuffer lodStagingBuffer;
         auto lodBufferSize
         {
-            SetupPushDescriptorBuffer(device, vma, staticBuffers.lodBuffer, lodStagingBuffer, lodData.GetSize(),
-                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, lodData.Data())
+            SetupPushDescriptorBuffer<BlitzenEngine::LodData>(vma, VMA_MEMORY_USAGE_GPU_ONLY, staticBuffers.lodBuffer, lodData.GetSize(),
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT)
         };
         if (lodBufferSize == 0)
         {
             BLIT_ERROR("Failed to create surface buffer");
             return 0;
         }
+        copyContext.Set(Ce_LodBufferDataCopyIndex, staticBuffers.lodBuffer.buffer.bufferHandle, lodData.Data(), lodBufferSize);
 
         // Mat buffer
-        AllocatedBuffer materialStagingBuffer;
         auto materialBufferSize
         {
-            SetupPushDescriptorBuffer(device, vma, staticBuffers.materialBuffer, materialStagingBuffer, materialCount,
-            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, pMaterials)
+            SetupPushDescriptorBuffer<BlitzenEngine::Material>(vma, VMA_MEMORY_USAGE_GPU_ONLY, staticBuffers.materialBuffer, materialCount,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT)
         };
         if (materialBufferSize == 0)
         {
             BLIT_ERROR("Failed to create material buffer");
             return 0;
         }
+        copyContext.Set(Ce_MaterialBufferDataCopyIndex, staticBuffers.materialBuffer.buffer.bufferHandle, pMaterials, materialBufferSize);
 
         // Indirect draw cmd
         auto indirectDrawBufferSize
@@ -520,31 +836,62 @@ namespace BlitzenVulkan
             BLIT_ERROR("Failed to create render object visibility buffer");
             return 0;
         }
+        copyContext.Set(Ce_VisibilityBufferFillIndex, staticBuffers.visibilityBuffer.buffer.bufferHandle, nullptr, visibilityBufferSize);
+
+        // Instanced culling buffers. Every LOD owns the instance index range that SetLodInstanceRanges gave it
+        if (Ce_VkInstanceCulling)
+        {
+            auto lodInstanceBufferSize
+            {
+                SetupPushDescriptorBuffer<BlitzenEngine::LodInstanceCounter>(vma, VMA_MEMORY_USAGE_GPU_ONLY, staticBuffers.lodInstanceCounterBuffer,
+                    lodInstanceList.GetSize(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT)
+            };
+            if (lodInstanceBufferSize == 0)
+            {
+                BLIT_ERROR("Failed to create LOD instance counter buffer");
+                return 0;
+            }
+            copyContext.Set(Ce_LodInstanceBufferDataCopyIndex, staticBuffers.lodInstanceCounterBuffer.buffer.bufferHandle, 
+                lodInstanceList.Data(), lodInstanceBufferSize);
+
+            if (!SetupPushDescriptorBuffer<uint32_t>(vma, VMA_MEMORY_USAGE_GPU_ONLY, staticBuffers.instanceIndexBuffer,
+                BlitML::Max(context.m_meshes.m_lodInstanceIndexCount, 1u), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT))
+            {
+                BLIT_ERROR("Failed to create instance index buffer");
+                return 0;
+            }
+            staticBuffers.lodCount = uint32_t(lodInstanceList.GetSize());
+        }
 
         // Cluster mode buffers
-        VkDeviceSize clusterBufferSize = 0;
-        AllocatedBuffer clusterStagingBuffer;
-        VkDeviceSize clusterIndexBufferSize = 0;
-        AllocatedBuffer clusterIndexStagingBuffer;
         VkDeviceSize clusterDispatchBufferSize = 0;
         VkDeviceSize transparentClusterDispatchBufferSize = 0;
         if (BlitzenCore::Ce_BuildClusters)
         {
-            clusterBufferSize = SetupPushDescriptorBuffer(device, vma, staticBuffers.clusterBuffer, clusterStagingBuffer,
-                clusters.GetSize(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, clusters.Data());
+            auto clusterBufferSize
+            {
+                SetupPushDescriptorBuffer<BlitzenEngine::Cluster>(vma, VMA_MEMORY_USAGE_GPU_ONLY, staticBuffers.clusterBuffer,
+                    clusters.GetSize(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT)
+            };
             if (clusterBufferSize == 0)
             {
                 BLIT_ERROR("Failed to create cluster buffer");
                 return 0;
             }
+            copyContext.Set(Ce_ClusterBufferDataCopyIndex, staticBuffers.clusterBuffer.buffer.bufferHandle, clusters.Data(), clusterBufferSize);
 
-            clusterIndexBufferSize = SetupPushDescriptorBuffer(device, vma, staticBuffers.meshletDataBuffer, clusterIndexStagingBuffer,
-                clusterData.GetSize(), VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, clusterData.Data());
+            auto clusterIndexBufferSize
+            {
+                SetupPushDescriptorBuffer<uint32_t>(vma, VMA_MEMORY_USAGE_GPU_ONLY, staticBuffers.meshletDataBuffer,
+                    clusterData.GetSize(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT)
+            };
             if (clusterIndexBufferSize == 0)
             {
                 BLIT_ERROR("Failed to create cluster indices buffer");
                 return 0;
             }
+            copyContext.Set(Ce_ClusterIndexBufferDataCopyIndex, staticBuffers.meshletDataBuffer.buffer.bufferHandle, 
+                clusterData.Data(), clusterIndexBufferSize);
 
             // Cluster dispatch buffer (cluster data for visible objects)
             clusterDispatchBufferSize = IndirectDrawElementCount * sizeof(ClusterDispatchData);
@@ -557,9 +904,10 @@ namespace BlitzenVulkan
             // Device address
             staticBuffers.clusterDispatchBufferAddress = GetBufferAddress(device, staticBuffers.clusterDispatchBuffer.bufferHandle);
 
-            // Cluster count for all visible frame objects
-            if (!CreateBuffer(vma, staticBuffers.clusterCountBuffer, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
-                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VMA_MEMORY_USAGE_GPU_ONLY, sizeof(uint32_t), VMA_ALLOCATION_CREATE_MAPPED_BIT))
+            // Cluster count for all visible frame objects, also the indirect dispatch of cluster culling
+            if (!CreateBuffer(vma, staticBuffers.clusterCountBuffer, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VMA_MEMORY_USAGE_GPU_ONLY, sizeof(ClusterCountData), 
+                VMA_ALLOCATION_CREATE_MAPPED_BIT))
             {
                 BLIT_ERROR("Failed to create indirect count buffer");
                 return 0;
@@ -567,14 +915,6 @@ namespace BlitzenVulkan
             // Device address
             staticBuffers.clusterCountBufferAddress = GetBufferAddress(device, staticBuffers.clusterCountBuffer.bufferHandle);
 
-            // CPU side cluster count
-            if (!CreateBuffer(vma, staticBuffers.clusterCountCopyBuffer, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                VMA_MEMORY_USAGE_CPU_TO_GPU, sizeof(uint32_t), VMA_ALLOCATION_CREATE_MAPPED_BIT))
-            {
-                BLIT_ERROR("Failed to create indirect count copy buffer");
-                return 0;
-            }
-
             // Transparent version of cluster dispatch
             transparentClusterDispatchBufferSize = Ce_TrasparentDispatchElementCount * sizeof(ClusterDispatchData);
             if (!CreateBuffer(vma, staticBuffers.transparentClusterDispatchBuffer,
@@ -588,23 +928,15 @@ namespace BlitzenVulkan
             staticBuffers.transparentClusterDispatchBufferAddress = GetBufferAddress(device, staticBuffers.transparentClusterDispatchBuffer.bufferHandle);
 
             // Transparent version of cluster count
-            if (!CreateBuffer(vma, staticBuffers.transparentClusterCountBuffer, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+            if (!CreateBuffer(vma, staticBuffers.transparentClusterCountBuffer, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VMA_MEMORY_USAGE_GPU_ONLY,
-                sizeof(uint32_t), VMA_ALLOCATION_CREATE_MAPPED_BIT))
+                sizeof(ClusterCountData), VMA_ALLOCATION_CREATE_MAPPED_BIT))
             {
                 BLIT_ERROR("Failed to create transparent indirect count buffer");
                 return 0;
             }
             // Device address
             staticBuffers.transparentClusterCountBufferAddress = GetBufferAddress(device, staticBuffers.transparentClusterCountBuffer.bufferHandle);
-
-            // Transparent Cluster count copy
-            if (!CreateBuffer(vma, staticBuffers.transparentClusterCountCopyBuffer, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                VMA_MEMORY_USAGE_CPU_TO_GPU, sizeof(uint32_t), VMA_ALLOCATION_CREATE_MAPPED_BIT))
-            {
-                BLIT_ERROR("Failed to create indirect count copy buffer");
-                return 0;
-            }
         }
 
         // Mesh shader cmd
@@ -623,48 +955,121 @@ namespace BlitzenVulkan
             }
         }
 
-        // Data copy to SSBOs
-        auto commandBuffer = frameTools.transferCommandBuffer;
-        StaticBufferCopyContext copyContext;
-        copyContext.stagings[Ce_VertexBufferDataCopyIndex] = stagingVertexBuffer.bufferHandle;
-        copyContext.sizes[Ce_VertexBufferDataCopyIndex] = vertexBufferSize;
-        copyContext.stagings[Ce_IndexBufferDataCopyIndex] = stagingIndexBuffer.bufferHandle;
-        copyContext.sizes[Ce_IndexBufferDataCopyIndex] = indexBufferSize;
-        copyContext.stagings[Ce_OpaqueRenderBufferCopyIndex] = renderObjectStagingBuffer.bufferHandle;
-        copyContext.sizes[Ce_OpaqueRenderBufferCopyIndex] = renderObjectBufferSize;
-        copyContext.stagings[Ce_TransparentRenderBufferCopyIndex] = tranparentRenderObjectStagingBuffer.bufferHandle;
-        copyContext.sizes[Ce_TransparentRenderBufferCopyIndex] = transparentRenderObjectBufferSize;
-        copyContext.stagings[Ce_SurfaceBufferDataCopyIndex] = surfaceStagingBuffer.bufferHandle;
-        copyContext.sizes[Ce_SurfaceBufferDataCopyIndex] = surfaceBufferSize;
-        copyContext.stagings[Ce_LodBufferDataCopyIndex] = lodStagingBuffer.bufferHandle;
-        copyContext.sizes[Ce_LodBufferDataCopyIndex] = lodBufferSize;
-        copyContext.stagings[Ce_MaterialBufferDataCopyIndex] = materialStagingBuffer.bufferHandle;
-        copyContext.sizes[Ce_MaterialBufferDataCopyIndex] = materialBufferSize;
-        copyContext.stagings[Ce_ClusterBufferDataCopyIndex] = clusterStagingBuffer.bufferHandle;
-        copyContext.sizes[Ce_ClusterBufferDataCopyIndex] = clusterBufferSize;
-        copyContext.stagings[Ce_ClusterIndexBufferDataCopyIndex] = clusterIndexStagingBuffer.bufferHandle;
-        copyContext.sizes[Ce_ClusterIndexBufferDataCopyIndex] = clusterIndexBufferSize;
-        CopyStaticBufferDataToGPUBuffers(commandBuffer, transferQueue, staticBuffers, copyContext, visibilityBufferSize);
-
-        // Raytracing
-        if (stats.bRayTracingSupported)
-        {
-            if (!BuildBlas(instance, device, vma, frameTools, transferQueue, context, staticBuffers))
-            {
-                BLIT_ERROR("Failed to build blas for RT");
-                return 0;
-            }
-            if (!BuildTlas(instance, device, vma, frameTools, transferQueue, staticBuffers, context))
-            {
-                BLIT_ERROR("Failed to build tlas for RT");
-                return 0;
-            }
-        }
-
         // SUCCESS
         return 1;
     }
 
+    // Host data of a scene buffer, what StaticBuffersInit uploads and what scene batches append to
+    struct SceneBufferSource
+    {
+        const void* pData;// Zeroes when null
+        VkDeviceSize size;
+        uint8_t bNoData;// Written by the GPU, nothing is uploaded
+    };
+
+    static void GetSceneBufferSources(const BlitzenEngine::DrawContext& context, const VulkanStats& stats, SceneBufferSource* pSources)
+    {
+        const auto& meshes{ context.m_meshes };
+        const auto& renders{ context.m_renders };
+
+        if (BlitzenCore::Ce_CompactVertices)
+        {
+            pSources[Ce_VertexBufferDataCopyIndex] = { meshes.m_compactVertices.Data(), 
+                meshes.m_compactVertices.GetSize() * sizeof(BlitzenEngine::CompactVertex), 0 };
+            pSources[Ce_IndexBufferDataCopyIndex] = { meshes.m_compactIndices.Data(), meshes.m_compactIndices.GetSize(), 0 };
+        }
+        else
+        {
+            pSources[Ce_VertexBufferDataCopyIndex] = { meshes.m_vertices.Data(), meshes.m_vertices.GetSize() * sizeof(BlitzenEngine::Vertex), 0 };
+            pSources[Ce_IndexBufferDataCopyIndex] = { meshes.m_indices.Data(), meshes.m_indices.GetSize() * sizeof(uint32_t), 0 };
+        }
+
+        pSources[Ce_OpaqueRenderBufferCopyIndex] = { renders.m_renders, renders.m_renderCount * sizeof(BlitzenEngine::RenderObject), 0 };
+        pSources[Ce_TransparentRenderBufferCopyIndex] = { renders.m_transparentRenders, 
+            renders.m_transparentRenderCount * sizeof(BlitzenEngine::RenderObject), 0 };
+        pSources[Ce_ONPCRenderBufferCopyIndex] = { renders.m_onpcRenders, renders.m_onpcRenderCount * sizeof(BlitzenEngine::RenderObject), 0 };
+        pSources[Ce_SurfaceBufferDataCopyIndex] = { meshes.m_surfaces.Data(), meshes.m_surfaces.GetSize() * sizeof(BlitzenEngine::PrimitiveSurface), 0 };
+        pSources[Ce_LodBufferDataCopyIndex] = { meshes.m_LODs.Data(), meshes.m_LODs.GetSize() * sizeof(BlitzenEngine::LodData), 0 };
+        pSources[Ce_MaterialBufferDataCopyIndex] = { context.m_textures.m_materials, 
+            context.m_textures.m_materialCount * sizeof(BlitzenEngine::Material), 0 };
+
+        if (BlitzenCore::Ce_BuildClusters)
+        {
+            pSources[Ce_ClusterBufferDataCopyIndex] = { meshes.m_clusters.Data(), meshes.m_clusters.GetSize() * sizeof(BlitzenEngine::Cluster), 0 };
+            pSources[Ce_ClusterIndexBufferDataCopyIndex] = { meshes.m_clusterIndices.Data(), meshes.m_clusterIndices.GetSize() * sizeof(uint32_t), 0 };
+        }
+
+        if (Ce_VkInstanceCulling)
+        {
+            pSources[Ce_LodInstanceBufferDataCopyIndex] = { meshes.m_lodInstanceList.Data(), 
+                meshes.m_lodInstanceList.GetSize() * sizeof(BlitzenEngine::LodInstanceCounter), 0 };
+            pSources[Ce_InstanceIndexSceneBufferIndex] = { nullptr, BlitML::Max(meshes.m_lodInstanceIndexCount, 1u) * sizeof(uint32_t), 1 };
+        }
+
+        pSources[Ce_VisibilityBufferFillIndex] = { nullptr, renders.m_renderCount * sizeof(uint32_t), 0 };
+
+        if (stats.meshShaderSupport)
+        {
+            pSources[Ce_IndirectTaskSceneBufferIndex] = { nullptr, renders.m_renderCount * sizeof(IndirectTaskData), 1 };
+        }
+    }
+
+    // Buffer behind a scene buffer index, and what has to follow it when a batch replaces it
+    struct SceneBufferTarget
+    {
+        AllocatedBuffer* pBuffer;
+        PushDescriptorBuffer<void>* pPushBuffer;
+        VkDeviceAddress* pAddress;
+        VkBufferUsageFlags usage;
+    };
+
+    static SceneBufferTarget GetSceneBufferTarget(VulkanRenderer::StaticBuffers& staticBuffers, uint32_t bufferIndex, uint8_t bRayTracing)
+    {
+        // Same usage as StaticBuffersInit
+        VkBufferUsageFlags geometryRtFlags = bRayTracing ? VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT : 0;
+        constexpr VkBufferUsageFlags ssboUsage{ VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT };
+        auto pushBufferTarget = [](PushDescriptorBuffer<void>& buffer, VkBufferUsageFlags usage)
+        {
+            return SceneBufferTarget{ &buffer.buffer, &buffer, nullptr, usage };
+        };
+
+        switch (bufferIndex)
+        {
+        case Ce_VertexBufferDataCopyIndex:
+            return pushBufferTarget(staticBuffers.vertexBuffer, ssboUsage | geometryRtFlags);
+        case Ce_IndexBufferDataCopyIndex:
+            return { &staticBuffers.indexBuffer, nullptr, nullptr, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | geometryRtFlags };
+        case Ce_OpaqueRenderBufferCopyIndex:
+            return { &staticBuffers.renderObjectBuffer, nullptr, &staticBuffers.renderObjectBufferAddress, 
+                ssboUsage | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT };
+        case Ce_TransparentRenderBufferCopyIndex:
+            return { &staticBuffers.transparentRenderObjectBuffer, nullptr, &staticBuffers.transparentRenderObjectBufferAddress, 
+                ssboUsage | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT };
+        case Ce_ONPCRenderBufferCopyIndex:
+            return pushBufferTarget(staticBuffers.onpcReflectiveRenderObjectBuffer, ssboUsage);
+        case Ce_SurfaceBufferDataCopyIndex:
+            return pushBufferTarget(staticBuffers.surfaceBuffer, ssboUsage);
+        case Ce_LodBufferDataCopyIndex:
+            return pushBufferTarget(staticBuffers.lodBuffer, ssboUsage);
+        case Ce_MaterialBufferDataCopyIndex:
+            return pushBufferTarget(staticBuffers.materialBuffer, ssboUsage);
+        case Ce_ClusterBufferDataCopyIndex:
+            return pushBufferTarget(staticBuffers.clusterBuffer, ssboUsage);
+        case Ce_ClusterIndexBufferDataCopyIndex:
+            return pushBufferTarget(staticBuffers.meshletDataBuffer, ssboUsage);
+        case Ce_LodInstanceBufferDataCopyIndex:
+            return pushBufferTarget(staticBuffers.lodInstanceCounterBuffer, ssboUsage);
+        case Ce_VisibilityBufferFillIndex:
+            return pushBufferTarget(staticBuffers.visibilityBuffer, ssboUsage);
+        case Ce_InstanceIndexSceneBufferIndex:
+            return pushBufferTarget(staticBuffers.instanceIndexBuffer, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+        case Ce_IndirectTaskSceneBufferIndex:
+            return pushBufferTarget(staticBuffers.indirectTaskBuffer, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+        default:
+            return { nullptr, nullptr, nullptr, 0 };
+        }
+    }
+
     static void SetupGpuBufferDescriptorWriteArrays(const VulkanRenderer::StaticBuffers& m_currentStaticBuffers, const VulkanRenderer::VarBuffers& varBuffers,
         VkWriteDescriptorSet* pushDescriptorWritesGraphics, VkWriteDescriptorSet* pushDescriptorWritesCompute)
     {
@@ -676,6 +1081,8 @@ namespace BlitzenVulkan
             pushDescriptorWritesGraphics[Ce_TransformBufferGraphicsDescriptorId] = varBuffers.transformBuffer.descriptorWrite;
             pushDescriptorWritesGraphics[Ce_DrawCmdBufferGraphicsDescriptorId] = m_currentStaticBuffers.indirectDrawBuffer.descriptorWrite;
             pushDescriptorWritesGraphics[Ce_SurfaceBufferGraphicsDescriptorId] = m_currentStaticBuffers.surfaceBuffer.descriptorWrite;
+            pushDescriptorWritesGraphics[Ce_ClusterBufferGraphicsDescriptorId] = m_currentStaticBuffers.clusterBuffer.descriptorWrite;
+            pushDescriptorWritesGraphics[Ce_MeshletDataBufferGraphicsDescriptorId] = m_currentStaticBuffers.meshletDataBuffer.descriptorWrite;
 
             pushDescriptorWritesCompute[ce_viewDataWriteElement] = varBuffers.viewDataBuffer.descriptorWrite;
             pushDescriptorWritesCompute[Ce_LodBufferDescriptorId] = m_currentStaticBuffers.lodBuffer.descriptorWrite;
@@ -702,6 +1109,14 @@ namespace BlitzenVulkan
             pushDescriptorWritesCompute[Ce_DrawCountBufferDrawCullDescriptorId] = m_currentStaticBuffers.indirectCountBuffer.descriptorWrite;
             pushDescriptorWritesCompute[Ce_VisibilityBufferDrawCullDescriptorId] = m_currentStaticBuffers.visibilityBuffer.descriptorWrite;
             pushDescriptorWritesCompute[Ce_SurfaceBufferDrawCullDescriptorId] = m_currentStaticBuffers.surfaceBuffer.descriptorWrite;
+
+            if constexpr (Ce_VkInstanceCulling)
+            {
+                pushDescriptorWritesGraphics[Ce_InstanceIndexBufferGraphicsDescriptorId] = m_currentStaticBuffers.instanceIndexBuffer.descriptorWrite;
+
+                pushDescriptorWritesCompute[Ce_LodInstanceCounterDrawCullDescriptorId] = m_currentStaticBuffers.lodInstanceCounterBuffer.descriptorWrite;
+                pushDescriptorWritesCompute[Ce_InstanceIndexDrawCullDescriptorId] = m_currentStaticBuffers.instanceIndexBuffer.descriptorWrite;
+            }
         }
     }
 
@@ -780,8 +1195,9 @@ namespace BlitzenVulkan
         return 1;
     }
 
-    static uint8_t AllocateTextureDescriptorSet(VkDevice device, uint32_t textureCount, TextureData* pTextures,
-        VkDescriptorPool& descriptorPool, VkDescriptorSetLayout* pLayout, VkDescriptorSet& descriptorSet)
+    // Descriptors past textureCount hold the first texture, until a scene batch writes its own textures there
+    static uint8_t AllocateTextureDescriptorSets(VkDevice device, uint32_t textureCount, uint32_t descriptorCount, TextureData* pTextures,
+        VkDescriptorPool& descriptorPool, VkDescriptorSetLayout layout, uint32_t setCount, VkDescriptorSet* pSets)
     {
         if (textureCount == 0)
         {
@@ -791,33 +1207,42 @@ namespace BlitzenVulkan
         
         VkDescriptorPoolSize poolSize{};
         poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        poolSize.descriptorCount = textureCount;
+        poolSize.descriptorCount = descriptorCount * setCount;
 
-        descriptorPool = CreateDescriptorPool(device, 1, &poolSize, 1);
+        descriptorPool = CreateDescriptorPool(device, 1, &poolSize, setCount);
         if (descriptorPool == VK_NULL_HANDLE)
         {
             BLIT_ERROR("Failed to create descriptor pool for textures");
             return 0;
         }
         
-        if (!AllocateDescriptorSets(device, descriptorPool, pLayout, 1, &descriptorSet))
+        VkDescriptorSetLayout layouts[Ce_MaxFramesInFlight];
+        for (uint32_t i = 0; i < setCount; ++i)
+        {
+            layouts[i] = layout;
+        }
+        if (!AllocateDescriptorSets(device, descriptorPool, layouts, setCount, pSets))
         {
             BLIT_ERROR("Failed to allocate descriptor set for textures");
             return 0;
         }
 
         // Array of descriptor infos
-        BlitCL::DynamicArray<VkDescriptorImageInfo> imageInfos(textureCount);
+        BlitCL::DynamicArray<VkDescriptorImageInfo> imageInfos(descriptorCount);
         for (size_t i = 0; i < imageInfos.GetSize(); ++i)
         {
+            const auto& texture{ pTextures[i < textureCount ? i : 0] };
             imageInfos[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            imageInfos[i].imageView = pTextures[i].image.imageView;
-            imageInfos[i].sampler = pTextures[i].sampler;
+            imageInfos[i].imageView = texture.image.imageView;
+            imageInfos[i].sampler = texture.sampler;
         }
 
-        VkWriteDescriptorSet write{};
-        WriteImageDescriptorSets(write, imageInfos.Data(), VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, descriptorSet, uint32_t(imageInfos.GetSize()), 0);
-        vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+        for (uint32_t i = 0; i < setCount; ++i)
+        {
+            VkWriteDescriptorSet write{};
+            WriteImageDescriptorSets(write, imageInfos.Data(), VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, pSets[i], uint32_t(imageInfos.GetSize()), 0);
+            vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+        }
 
         return 1;
     }
@@ -825,8 +1250,21 @@ namespace BlitzenVulkan
 
     uint8_t VulkanRenderer::SetupForRendering(BlitzenEngine::DrawContext& context)
     {
+        BLIT_PROFILE_FUNCTION();
+
         BLIT_ASSERT(m_stats.bResourceManagementReady);
 
+        if (!WaitForUploads())
+        {
+            BLIT_ERROR("Failed to upload textures");
+            return 0;
+        }
+
+        if (BlitzenCore::Ce_CompactVertices)
+        {
+            GenerateCompactVertices(context.m_meshes);
+        }
+
         if (!RenderingAttachmentsInit(m_device, m_allocator, m_colorAttachment, m_colorAttachmentInfo, 
             m_depthAttachment, m_depthAttachmentInfo, m_depthPyramid, m_depthPyramidMipLevels, m_depthPyramidMips, 
             m_drawExtent, m_depthPyramidExtent))
@@ -835,8 +1273,16 @@ namespace BlitzenVulkan
             return 0;
         }
 
+        // Scene batches write their textures past the ones loaded so far, so the array is as large as the device allows
+        VkPhysicalDeviceProperties deviceProperties{};
+        vkGetPhysicalDeviceProperties(m_physicalDevice, &deviceProperties);
+        const auto& limits{ deviceProperties.limits };
+        auto textureDescriptorLimit{ BlitML::Min(BlitML::Min(limits.maxPerStageDescriptorSampledImages, limits.maxPerStageDescriptorSamplers),
+            BlitML::Min(BlitML::Min(limits.maxDescriptorSetSampledImages, limits.maxDescriptorSetSamplers), limits.maxPerStageResources)) };
+        m_textureDescriptorCapacity = BlitML::Max(uint32_t(textureCount), BlitML::Min(BlitzenCore::Ce_MaxTextureCount, textureDescriptorLimit));
+
         if(!CreateDescriptorLayouts(m_device, m_pushDescriptorBufferLayout.handle, m_varBuffers[0], m_staticBuffers, 
-            m_stats.bRayTracingSupported, m_stats.meshShaderSupport, (uint32_t)textureCount, m_textureDescriptorSetlayout.handle, 
+            m_stats.bRayTracingSupported, m_stats.meshShaderSupport, m_textureDescriptorCapacity, m_textureDescriptorSetlayout.handle, 
             m_depthAttachment, m_depthPyramid, m_depthPyramidDescriptorLayout.handle, m_colorAttachment, 
             m_generatePresentationImageSetLayout.handle))
         {
@@ -853,20 +1299,55 @@ namespace BlitzenVulkan
             return 0;
         }
 
-        if(!VarBuffersInit(m_device, m_allocator, m_frameToolsList[0].transferCommandBuffer, m_transferQueue.handle, context, m_varBuffers))
         {
-            BLIT_ERROR("Failed to create uniform buffers");
+            std::lock_guard<std::mutex> queueLock(m_queueSubmitMutex);
+            if(!VarBuffersInit(m_device, m_allocator, m_frameToolsList[0].transferCommandBuffer, m_transferQueue.handle, context, m_varBuffers, m_framesInFlight))
+            {
+                BLIT_ERROR("Failed to create uniform buffers");
+                return 0;
+            }
+        }
+
+        StaticBufferCopyContext staticBufferCopies;
+        if(!StaticBuffersInit(m_device, m_allocator, m_staticBuffers, context, m_stats, staticBufferCopies))
+        {
+            BLIT_ERROR("Failed to create static buffers");
             return 0;
         }
 
-        if(!StaticBuffersInit(m_instance, m_device, m_allocator, m_frameToolsList[0], m_transferQueue.handle, m_staticBuffers, context, m_stats))
+        // Streamed through the staging ring, the memcpy of one batch overlaps the transfer of the previous ones
+        for (uint32_t i = 0; i < Ce_StaticSSBODataCount; ++i)
+        {
+            if (staticBufferCopies.sizes[i] && !QueueBufferUpload(staticBufferCopies.buffers[i], staticBufferCopies.pData[i], staticBufferCopies.sizes[i]))
+            {
+                BLIT_ERROR("Failed to upload data to the GPU");
+                return 0;
+            }
+        }
+        if (!WaitForUploads())
         {
             BLIT_ERROR("Failed to upload data to the GPU");
             return 0;
         }
 
-        if (!AllocateTextureDescriptorSet(m_device, (uint32_t)textureCount, loadedTextures, m_textureDescriptorPool.handle, &m_textureDescriptorSetlayout.handle,
-            m_textureDescriptorSet))
+        // Raytracing. The acceleration structures only hold what is loaded here, scene batches do not rebuild them
+        if (m_stats.bRayTracingSupported)
+        {
+            std::lock_guard<std::mutex> queueLock(m_queueSubmitMutex);
+            if (!BuildBlas(m_instance, m_device, m_allocator, m_frameToolsList[0], m_transferQueue.handle, context, m_staticBuffers))
+            {
+                BLIT_ERROR("Failed to build blas for RT");
+                return 0;
+            }
+            if (!BuildTlas(m_instance, m_device, m_allocator, m_frameToolsList[0], m_transferQueue.handle, m_staticBuffers, context))
+            {
+                BLIT_ERROR("Failed to build tlas for RT");
+                return 0;
+            }
+        }
+
+        if (!AllocateTextureDescriptorSets(m_device, (uint32_t)textureCount, m_textureDescriptorCapacity, loadedTextures, m_textureDescriptorPool.handle, 
+            m_textureDescriptorSetlayout.handle, m_framesInFlight, m_textureDescriptorSets))
         {
             BLIT_ERROR("Failed to allocate texture descriptor sets");
             return 0;
@@ -874,26 +1355,56 @@ namespace BlitzenVulkan
 
         SetupGpuBufferDescriptorWriteArrays(m_staticBuffers, m_varBuffers[0], m_graphicsDescriptors, m_drawCullDescriptors);
 
-        if (!CreateComputeShaders(m_device, &m_initialDrawCullPipeline.handle, &m_lateDrawCullPipeline.handle, 
-            &m_onpcDrawCullPipeline.handle, &m_transparentDrawCullPipeline.handle, m_drawCullLayout.handle, 
-            &m_depthPyramidGenerationPipeline.handle, m_depthPyramidGenerationLayout.handle, 
-            &m_generatePresentationPipeline.handle, m_generatePresentationLayout.handle))
+        // Only the compute pipelines of the active culling path
+        ComputePipelineDesc computePipelines[Ce_MaxStartupComputePipelines]{};
+        uint32_t computePipelineCount{ 0 };
+        computePipelines[computePipelineCount++] = { "VulkanShaders/GeneratePresentation.comp.glsl.spv", 
+            m_generatePresentationLayout.handle, &m_generatePresentationPipeline.handle };
+        if constexpr (BlitzenCore::Ce_BuildClusters)
         {
-            BLIT_ERROR("Failed to create compute shaders");
-            return 0;
+            computePipelines[computePipelineCount++] = { "VulkanShaders/PreClusterDrawCull.comp.glsl.spv", 
+                m_clusterCullLayout.handle, &m_preClusterCullPipeline.handle };
+            computePipelines[computePipelineCount++] = { "VulkanShaders/InitialClusterCull.comp.glsl.spv", 
+                m_clusterCullLayout.handle, &m_intialClusterCullPipeline.handle };
+            computePipelines[computePipelineCount++] = { "VulkanShaders/TransparentClusterCull.comp.glsl.spv", 
+                m_clusterCullLayout.handle, &m_transparentClusterCullPipeline.handle };
         }
-
-        if (BlitzenCore::Ce_BuildClusters && !CreateClusterComputePipelines(m_device, &m_preClusterCullPipeline.handle, 
-            &m_intialClusterCullPipeline.handle, &m_transparentClusterCullPipeline.handle, m_clusterCullLayout.handle))
+        else
+        {
+            if constexpr (Ce_VkInstanceCulling)
+            {
+                computePipelines[computePipelineCount++] = { "VulkanShaders/DrawInstCountReset.comp.glsl.spv", 
+                    m_drawCullLayout.handle, &m_drawInstCountResetPipeline.handle };
+                computePipelines[computePipelineCount++] = { "VulkanShaders/DrawInstCull.comp.glsl.spv", 
+                    m_drawCullLayout.handle, &m_drawInstCullPipeline.handle };
+                computePipelines[computePipelineCount++] = { "VulkanShaders/DrawInstCmd.comp.glsl.spv", 
+                    m_drawCullLayout.handle, &m_drawInstCmdPipeline.handle };
+            }
+            else
+            {
+                computePipelines[computePipelineCount++] = { "VulkanShaders/InitialDrawCull.comp.glsl.spv", 
+                    m_drawCullLayout.handle, &m_initialDrawCullPipeline.handle };
+                computePipelines[computePipelineCount++] = { "VulkanShaders/LateDrawCull.comp.glsl.spv", 
+                    m_drawCullLayout.handle, &m_lateDrawCullPipeline.handle };
+                computePipelines[computePipelineCount++] = { "VulkanShaders/DepthPyramidGeneration.comp.glsl.spv", 
+                    m_depthPyramidGenerationLayout.handle, &m_depthPyramidGenerationPipeline.handle };
+                // Onpc culling reads the depth pyramid, which instanced mode never generates
+                computePipelines[computePipelineCount++] = { "VulkanShaders/OnpcDrawCull.comp.glsl.spv", 
+                    m_drawCullLayout.handle, &m_onpcDrawCullPipeline.handle };
+            }
+            computePipelines[computePipelineCount++] = { "VulkanShaders/TransparentDrawCull.comp.glsl.spv", 
+                m_drawCullLayout.handle, &m_transparentDrawCullPipeline.handle };
+        }
+        if (!CreateComputePipelines(m_device, m_pipelineCache.handle, computePipelineCount, computePipelines))
         {
-            BLIT_ERROR("Failed to create cluster shaders");
+            BLIT_ERROR("Failed to create compute shaders");
             return 0;
         }
         
         // Create the graphics pipeline object 
-        if(!CreateGraphicsPipelines(m_device, m_stats.meshShaderSupport, &m_opaqueGeometryPipeline.handle,
+        if(!CreateGraphicsPipelines(m_device, m_pipelineCache.handle, m_stats.meshShaderSupport, &m_opaqueGeometryPipeline.handle,
             &m_postPassGeometryPipeline.handle, m_graphicsPipelineLayout.handle, 
-            &m_onpcReflectiveGeometryPipeline.handle, m_onpcReflectiveGeometryLayout.handle))
+            &m_onpcReflectiveGeometryPipeline.handle, m_onpcReflectiveGeometryLayout.handle, &m_instancedGeometryPipeline.handle))
         {
             BLIT_ERROR("Failed to create the primary graphics pipeline object");
             return 0;
@@ -903,6 +1414,23 @@ namespace BlitzenVulkan
         context.m_camera.viewData.pyramidWidth = static_cast<float>(m_depthPyramidExtent.width);
         context.m_camera.viewData.pyramidHeight = static_cast<float>(m_depthPyramidExtent.height);
 
+        // Scene batches append to what was uploaded here
+        SceneBufferSource sceneBufferSources[Ce_SceneBufferCount]{};
+        GetSceneBufferSources(context, m_stats, sceneBufferSources);
+        for (uint32_t i = 0; i < Ce_SceneBufferCount; ++i)
+        {
+            m_sceneBuffers[i].size = sceneBufferSources[i].size;
+            m_sceneBuffers[i].capacity = sceneBufferSources[i].size;
+        }
+        m_sceneTransformEnd = context.m_renders.m_staticTransformOffset;
+        m_sceneTransformCapacity = m_sceneTransformEnd;
+        m_sceneCompactIndexSize = context.m_meshes.m_compactIndexSize;
+
+        m_drawnRenderCount = context.m_renders.m_renderCount;
+        m_drawnTransparentRenderCount = context.m_renders.m_transparentRenderCount;
+        m_drawnOnpcRenderCount = context.m_renders.m_onpcRenderCount;
+        m_drawnTextureCount = textureCount;
+
         return 1;
     }
 
@@ -910,4 +1438,285 @@ namespace BlitzenVulkan
     {
 
     }
+
+    uint8_t VulkanRenderer::PublishSceneBatch(BlitzenEngine::DrawContext& context, uint8_t bFinal)
+    {
+        BLIT_PROFILE_FUNCTION();
+
+        std::lock_guard<std::mutex> lock(m_sceneBatchMutex);
+
+        if (BlitzenCore::Ce_CompactVertices)
+        {
+            GenerateCompactVertices(context.m_meshes);
+        }
+
+        SceneBufferSource sources[Ce_SceneBufferCount]{};
+        GetSceneBufferSources(context, m_stats, sources);
+        auto bIndexSizeChanged{ BlitzenCore::Ce_CompactVertices && context.m_meshes.m_compactIndexSize != m_sceneCompactIndexSize };
+        for (uint32_t i = 0; i < Ce_SceneBufferCount; ++i)
+        {
+            // Data that changes in place goes to a new buffer. Instance ranges move with every batch, 
+            // the final batch sorts the render objects (their visibility starts over) and wider indices rewrite the earlier ones
+            auto bRewrite{ i == Ce_LodInstanceBufferDataCopyIndex || (bFinal && i == Ce_OpaqueRenderBufferCopyIndex) ||
+                (bFinal && i == Ce_VisibilityBufferFillIndex) || (bIndexSizeChanged && i == Ce_IndexBufferDataCopyIndex) };
+            if (!UpdateSceneBuffer(i, sources[i].pData, sources[i].size, bRewrite, sources[i].bNoData))
+            {
+                BLIT_ERROR("Failed to update scene buffer %u", i);
+                return 0;
+            }
+        }
+
+        if (!UpdateSceneTransforms(context))
+        {
+            BLIT_ERROR("Failed to update the transform buffers");
+            return 0;
+        }
+
+        // Textures of the batch were queued by UploadTexture
+        if (!WaitForUploads())
+        {
+            BLIT_ERROR("Failed to upload the scene batch");
+            return 0;
+        }
+
+        m_sceneBatch.renderCount = context.m_renders.m_renderCount;
+        m_sceneBatch.transparentRenderCount = context.m_renders.m_transparentRenderCount;
+        m_sceneBatch.onpcRenderCount = context.m_renders.m_onpcRenderCount;
+        m_sceneBatch.lodCount = Ce_VkInstanceCulling ? uint32_t(context.m_meshes.m_lodInstanceList.GetSize()) : 0;
+        m_sceneBatch.textureCount = textureCount;
+        m_sceneBatch.indexType = BlitzenCore::Ce_CompactVertices && context.m_meshes.m_compactIndexSize == sizeof(uint16_t) ? 
+            VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+        m_sceneBatch.bFinal = bFinal;
+        m_sceneCompactIndexSize = context.m_meshes.m_compactIndexSize;
+        m_bSceneBatchPending = true;
+
+        return 1;
+    }
+
+    uint8_t VulkanRenderer::UpdateSceneBuffer(uint32_t bufferIndex, const void* pData, VkDeviceSize size, uint8_t bRewrite, uint8_t bNoData)
+    {
+        auto& state{ m_sceneBuffers[bufferIndex] };
+        auto previousSize{ state.size };
+        if (size == 0 || (size <= previousSize && !bRewrite))
+        {
+            return 1;
+        }
+        state.size = size;
+
+        // The frames in flight only read what is before previousSize
+        if (size <= state.capacity && !bRewrite)
+        {
+            auto buffer{ state.grownBuffer.bufferHandle ? state.grownBuffer.bufferHandle : 
+                GetSceneBufferTarget(m_staticBuffers, bufferIndex, m_stats.bRayTracingSupported).pBuffer->bufferHandle };
+            return bNoData || QueueBufferUpload(buffer, pData ? reinterpret_cast<const uint8_t*>(pData) + previousSize : nullptr, 
+                size - previousSize, previousSize);
+        }
+
+        // A replacement that was never swapped in is not read by any frame
+        if (state.grownBuffer.bufferHandle)
+        {
+            vmaDestroyBuffer(m_allocator, state.grownBuffer.bufferHandle, state.grownBuffer.allocation);
+            state.grownBuffer.bufferHandle = VK_NULL_HANDLE;
+        }
+
+        // Grows by half, so that a scene loaded in many batches does not copy everything each time
+        auto grownCapacity{ state.capacity + state.capacity / 2 };
+        auto capacity{ size <= state.capacity ? state.capacity : size > grownCapacity ? size : grownCapacity };
+        auto target{ GetSceneBufferTarget(m_staticBuffers, bufferIndex, m_stats.bRayTracingSupported) };
+        if (!CreateBuffer(m_allocator, state.grownBuffer, target.usage, VMA_MEMORY_USAGE_GPU_ONLY, capacity, VMA_ALLOCATION_CREATE_MAPPED_BIT))
+        {
+            BLIT_ERROR("Failed to create scene buffer");
+            return 0;
+        }
+        state.capacity = capacity;
+
+        return bNoData || QueueBufferUpload(state.grownBuffer.bufferHandle, pData, size);
+    }
+
+    uint8_t VulkanRenderer::UpdateSceneTransforms(BlitzenEngine::DrawContext& context)
+    {
+        constexpr VkDeviceSize transformSize{ sizeof(BlitzenEngine::MeshTransform) };
+        auto pTransforms{ context.m_renders.m_transforms };
+        auto transformEnd{ context.m_renders.m_staticTransformOffset };
+        if (transformEnd <= m_sceneTransformEnd)
+        {
+            return 1;
+        }
+
+        if (transformEnd <= m_sceneTransformCapacity)
+        {
+            for (uint8_t i = 0; i < m_framesInFlight; ++i)
+            {
+                auto buffer{ m_grownTransformBuffers[i].bufferHandle ? m_grownTransformBuffers[i].bufferHandle : 
+                    m_varBuffers[i].transformBuffer.buffer.bufferHandle };
+                if (!QueueBufferUpload(buffer, pTransforms + m_sceneTransformEnd, (transformEnd - m_sceneTransformEnd) * transformSize, 
+                    m_sceneTransformEnd * transformSize))
+                {
+                    return 0;
+                }
+            }
+            m_sceneTransformEnd = transformEnd;
+            return 1;
+        }
+
+        // Only the static transforms are uploaded, the main thread writes the dynamic ones once the buffer is swapped in
+        auto capacity{ BlitML::Min(BlitML::Max(transformEnd, m_sceneTransformCapacity + m_sceneTransformCapacity / 2), BlitzenCore::Ce_MaxRenderObjects) };
+        for (uint8_t i = 0; i < m_framesInFlight; ++i)
+        {
+            auto& grownBuffer{ m_grownTransformBuffers[i] };
+            if (grownBuffer.bufferHandle)
+            {
+                vmaDestroyBuffer(m_allocator, grownBuffer.bufferHandle, grownBuffer.allocation);
+                grownBuffer.bufferHandle = VK_NULL_HANDLE;
+            }
+            if (!CreateTransformBuffer(m_allocator, grownBuffer, capacity * transformSize))
+            {
+                BLIT_ERROR("Failed to create transform buffer");
+                return 0;
+            }
+
+            // The staging copy is only used when the buffer is not written in place. While the old one was, the main thread does not touch it
+            auto& buffers{ m_varBuffers[i] };
+            if (!IsDirectWriteTransformBuffer(m_allocator, grownBuffer) && !buffers.transformStagingBuffer.bufferHandle && buffers.dynamicTransformDataSize && 
+                !CreateBuffer(m_allocator, buffers.transformStagingBuffer, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, 
+                buffers.dynamicTransformDataSize, VMA_ALLOCATION_CREATE_MAPPED_BIT))
+            {
+                BLIT_ERROR("Failed to create transform staging buffer");
+                return 0;
+            }
+
+            if (!QueueBufferUpload(grownBuffer.bufferHandle, pTransforms + BlitzenCore::Ce_MaxDynamicObjectCount, 
+                (transformEnd - BlitzenCore::Ce_MaxDynamicObjectCount) * transformSize, BlitzenCore::Ce_MaxDynamicObjectCount * transformSize))
+            {
+                return 0;
+            }
+        }
+        m_sceneTransformCapacity = capacity;
+        m_sceneTransformEnd = transformEnd;
+
+        return 1;
+    }
+
+    // Takes the handles of src, src no longer owns them
+    static void AdoptBuffer(AllocatedBuffer& dst, AllocatedBuffer& src)
+    {
+        dst.bufferHandle = src.bufferHandle;
+        dst.allocation = src.allocation;
+        dst.allocationInfo = src.allocationInfo;
+        src.bufferHandle = VK_NULL_HANDLE;
+    }
+
+    void VulkanRenderer::ApplySceneBatch()
+    {
+        DestroyRetiredBuffers();
+
+        // The batch waits for the next frame while the loading thread is publishing
+        if (m_bSceneComplete || !m_bSceneBatchPending || !m_sceneBatchMutex.try_lock())
+        {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(m_sceneBatchMutex, std::adopt_lock);
+        BLIT_PROFILE_FUNCTION();
+
+        for (uint32_t i = 0; i < Ce_SceneBufferCount; ++i)
+        {
+            auto& grownBuffer{ m_sceneBuffers[i].grownBuffer };
+            if (!grownBuffer.bufferHandle)
+            {
+                continue;
+            }
+
+            auto target{ GetSceneBufferTarget(m_staticBuffers, i, m_stats.bRayTracingSupported) };
+            if (target.pBuffer->bufferHandle)
+            {
+                m_retiredBuffers.PushBack({ target.pBuffer->bufferHandle, target.pBuffer->allocation, m_frameSerial });
+            }
+            AdoptBuffer(*target.pBuffer, grownBuffer);
+
+            // The descriptor write arrays point to the buffer info, so they follow it
+            if (target.pPushBuffer)
+            {
+                CreatePushDescriptorWrite(target.pPushBuffer->descriptorWrite, target.pPushBuffer->bufferInfo, target.pBuffer->bufferHandle, 
+                    target.pPushBuffer->descriptorType, target.pPushBuffer->descriptorBinding);
+            }
+            if (target.pAddress)
+            {
+                *target.pAddress = GetBufferAddress(m_device, target.pBuffer->bufferHandle);
+            }
+        }
+
+        for (uint8_t i = 0; i < m_framesInFlight; ++i)
+        {
+            auto& grownBuffer{ m_grownTransformBuffers[i] };
+            if (!grownBuffer.bufferHandle)
+            {
+                continue;
+            }
+
+            auto& buffers{ m_varBuffers[i] };
+            m_retiredBuffers.PushBack({ buffers.transformBuffer.buffer.bufferHandle, buffers.transformBuffer.buffer.allocation, m_frameSerial });
+            AdoptBuffer(buffers.transformBuffer.buffer, grownBuffer);
+            buffers.transformBuffer.bufferInfo.buffer = buffers.transformBuffer.buffer.bufferHandle;
+
+            buffers.bDirectTransformWrites = IsDirectWriteTransformBuffer(m_allocator, buffers.transformBuffer.buffer);
+            buffers.pTransformData = reinterpret_cast<BlitzenEngine::MeshTransform*>(buffers.bDirectTransformWrites ? 
+                buffers.transformBuffer.buffer.allocationInfo.pMappedData : buffers.transformStagingBuffer.allocationInfo.pMappedData);
+
+            // The new buffer has none of the dynamic transforms
+            auto dynamicTransformCount{ uint32_t(buffers.dynamicTransformDataSize / sizeof(BlitzenEngine::MeshTransform)) };
+            for (uint32_t id = 0; id < dynamicTransformCount; ++id)
+            {
+                const uint64_t bit{ 1ull << (id % 64) };
+                auto& word{ buffers.dirtyTransforms[id / 64] };
+                buffers.dirtyTransformCount += !(word & bit);
+                word |= bit;
+            }
+        }
+
+        m_drawnRenderCount = m_sceneBatch.renderCount;
+        m_drawnTransparentRenderCount = m_sceneBatch.transparentRenderCount;
+        m_drawnOnpcRenderCount = m_sceneBatch.onpcRenderCount;
+        m_staticBuffers.lodCount = m_sceneBatch.lodCount;
+        m_staticBuffers.indexType = m_sceneBatch.indexType;
+        m_stats.bTranspartentObjectsExist = m_drawnTransparentRenderCount != 0;
+        m_stats.bObliqueNearPlaneClippingObjectsExist = m_drawnOnpcRenderCount != 0;
+
+        // New textures go to the free descriptors of every set
+        for (auto textureId = m_drawnTextureCount; textureId < m_sceneBatch.textureCount; ++textureId)
+        {
+            for (uint8_t i = 0; i < m_framesInFlight; ++i)
+            {
+                m_dirtyTextureDescriptors[i].PushBack(uint32_t(textureId));
+            }
+        }
+        m_drawnTextureCount = m_sceneBatch.textureCount;
+
+        if (m_sceneBatch.bFinal)
+        {
+            if constexpr (Ce_TextureStreaming)
+            {
+                m_textureScreenSizes.Resize(m_drawnTextureCount);
+                m_textureTargetMips.Resize(m_drawnTextureCount);
+            }
+            m_bSceneComplete = 1;
+        }
+        m_bSceneBatchPending = false;
+    }
+
+    void VulkanRenderer::DestroyRetiredBuffers()
+    {
+        // Retired before the frame with that serial was recorded, so m_framesInFlight frames later none of them is in flight
+        for (size_t i = 0; i < m_retiredBuffers.GetSize();)
+        {
+            const auto& retired{ m_retiredBuffers[i] };
+            if (m_frameSerial - retired.frame < m_framesInFlight)
+            {
+                ++i;
+                continue;
+            }
+
+            vmaDestroyBuffer(m_allocator, retired.buffer, retired.allocation);
+            m_retiredBuffers.RemoveAtIndex(i);
+        }
+    }
 }
\ No newline at end of file
@@ -34,10 +34,9 @@ namespace BlitzenVulkan
 
     uint8_t CreateImageView(VkDevice device, VkImageView& imageView, VkImage image, VkFormat format, uint8_t baseMipLevel, uint8_t mipLevels);
 
-    // This function is similar to the above but it gives its own buffer and mip levels are required. 
-    // The buffer should already hold the texture data in pMappedData
-    uint8_t CreateTextureImage(AllocatedBuffer& buffer, VkDevice device, VmaAllocator allocator, AllocatedImage& image, 
-        VkExtent3D extent, VkFormat format, VkImageUsageFlags usage, VkCommandBuffer commandBuffer, VkQueue queue, uint8_t mipLevels);
+    // Records the transitions and the copy of every mip of a texture image created with CreateImage. 
+    // The buffer should already hold the mips, tightly packed from bufferOffset
+    void RecordTextureImageCopy(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize bufferOffset, AllocatedImage& image, uint8_t mipLevels);
 
     VkSampler CreateSampler(VkDevice device, VkFilter filter, VkSamplerMipmapMode mipmapMode, VkSamplerAddressMode addressMode, void* pNextChain = nullptr);
 
@@ -259,24 +259,13 @@ namespace BlitzenVulkan
         return 1;
     }
 
-    uint8_t CreateTextureImage(AllocatedBuffer& buffer, VkDevice device, VmaAllocator allocator, AllocatedImage& image, 
-        VkExtent3D extent, VkFormat format, VkImageUsageFlags usage, VkCommandBuffer commandBuffer, VkQueue queue, uint8_t mipLevels)
+    void RecordTextureImageCopy(VkCommandBuffer commandBuffer, VkBuffer buffer, VkDeviceSize bufferOffset, AllocatedImage& image, uint8_t mipLevels)
     {
-        // Create an image for the texture data to be copied into. 
-        // Adds the VK_IMAGE_USAGE_TRANSFER_DST_BIT, so that it can accept the data transfer from the buffer
-        if (!CreateImage(device, allocator, image, extent, format, usage | VK_IMAGE_USAGE_TRANSFER_DST_BIT, mipLevels))
-        {
-            BLIT_ERROR("Failed to create image resource for texture");
-            return 0;
-        }
-
-        // Get the initial offset for the first mip level to be copied
-        uint32_t bufferOffset = 0;
-        uint32_t mipWidth = extent.width;
-        uint32_t mipHeight = extent.height;
-        uint32_t blockSize = (format == VK_FORMAT_BC1_RGBA_UNORM_BLOCK || format == VK_FORMAT_BC4_SNORM_BLOCK || format == VK_FORMAT_BC4_UNORM_BLOCK) ? 8 : 16;
+        uint32_t mipWidth = image.extent.width;
+        uint32_t mipHeight = image.extent.height;
+        uint32_t blockSize = (image.format == VK_FORMAT_BC1_RGBA_UNORM_BLOCK || image.format == VK_FORMAT_BC4_SNORM_BLOCK || image.format == VK_FORMAT_BC4_UNORM_BLOCK) ? 8 : 16;
 
-        // Copy regions
+        // Copy regions, the mip levels are tightly packed in the buffer
         BlitCL::DynamicArray<VkBufferImageCopy2> copyRegions{ mipLevels };
         for(uint8_t i = 0; i < mipLevels; ++i)
         {
@@ -288,8 +277,6 @@ namespace BlitzenVulkan
 		    mipHeight = mipHeight > 1 ? mipHeight / 2 : 1;
         }
 
-        BeginCommandBuffer(commandBuffer, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
-
         // Create an image barrier for transiton to transfer dst optimal layout
         VkImageMemoryBarrier2 transitionToTransferDSToptimal{};
         ImageMemoryBarrier(image.image, transitionToTransferDSToptimal, VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, 
@@ -297,18 +284,13 @@ namespace BlitzenVulkan
         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_REMAINING_MIP_LEVELS);
         PipelineBarrier(commandBuffer, 0, nullptr, 0, nullptr, 1, &transitionToTransferDSToptimal);
 
-        CopyBufferToImage(commandBuffer, buffer.bufferHandle, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels, copyRegions.Data());
+        CopyBufferToImage(commandBuffer, buffer, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels, copyRegions.Data());
 
         VkImageMemoryBarrier2 transitionImageToShaderReadOptimal{};
         ImageMemoryBarrier(image.image, transitionImageToShaderReadOptimal, VK_PIPELINE_STAGE_2_COPY_BIT, 
         VK_ACCESS_2_TRANSFER_READ_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, 
         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_REMAINING_MIP_LEVELS);
         PipelineBarrier(commandBuffer, 0, nullptr, 0, nullptr, 1, &transitionImageToShaderReadOptimal);
-
-        SubmitCommandBuffer(queue, commandBuffer);
-        vkQueueWaitIdle(queue);
-
-        return 1;
     }
 
     VkFormat GetDDSVulkanFormat(const BlitzenEngine::DDS_HEADER& header, const BlitzenEngine::DDS_HEADER_DXT10& header10)
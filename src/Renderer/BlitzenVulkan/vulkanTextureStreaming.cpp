@@ -0,0 +1,285 @@
+#include "vulkanRenderer.h"
+#include "vulkanResourceFunctions.h"
+#include "Renderer/Resources/Textures/blitTextureStreaming.h"
+#include "Core/DbLog/blitProfiler.h"
+
+namespace BlitzenVulkan
+{
+    // Size of the mip chain from mip to the last one
+    static size_t GetStreamedMipsSize(const VulkanRenderer::TextureStreamingState& state, uint8_t mip)
+    {
+        return BlitzenEngine::GetDDSImageSizeBC(BlitML::Max(state.width >> mip, 1u), BlitML::Max(state.height >> mip, 1u),
+            state.mipCount - mip, state.blockSize);
+    }
+
+    static bool IsStreamedUploadPending(const VulkanRenderer::StreamedTextureImage& streamed, 
+        const VulkanRenderer::PendingTextureUpload* pUploads, uint32_t uploadCount)
+    {
+        for (uint32_t i = 0; i < uploadCount; ++i)
+        {
+            if (pUploads[i].pImage == &streamed.image)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void VulkanRenderer::MarkSubmittedStreamedImages()
+    {
+        for (auto& streamed : m_streamedTextureImages)
+        {
+            if (streamed.bActive && !streamed.batchSerial && 
+                !IsStreamedUploadPending(streamed, m_pendingTextureUploads, m_pendingTextureUploadCount))
+            {
+                streamed.batchSerial = m_uploadSerial;
+            }
+        }
+    }
+
+    void VulkanRenderer::CancelDroppedStreamedImages()
+    {
+        for (auto& streamed : m_streamedTextureImages)
+        {
+            if (!streamed.bActive || streamed.batchSerial || 
+                IsStreamedUploadPending(streamed, m_pendingTextureUploads, m_pendingTextureUploadCount))
+            {
+                continue;
+            }
+
+            streamed.image.CleanupResources(m_allocator, m_device);
+            streamed.image.image = VK_NULL_HANDLE;
+            streamed.image.imageView = VK_NULL_HANDLE;
+            streamed.bActive = 0;
+            m_textureStreaming[streamed.textureId].bStreaming = 0;
+        }
+    }
+
+    uint8_t VulkanRenderer::StreamTexture(uint32_t textureId, uint8_t mip)
+    {
+        StreamedTextureImage* pStreamed{ nullptr };
+        for (auto& streamed : m_streamedTextureImages)
+        {
+            if (!streamed.bActive)
+            {
+                pStreamed = &streamed;
+                break;
+            }
+        }
+        if (!pStreamed)
+        {
+            return 0;
+        }
+
+        auto& state{ m_textureStreaming[textureId] };
+        auto& texture{ loadedTextures[textureId].image };
+        VkExtent3D extent{ BlitML::Max(state.width >> mip, 1u), BlitML::Max(state.height >> mip, 1u), 1 };
+        if (!CreateImage(m_device, m_allocator, pStreamed->image, extent, texture.format,
+            VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, state.mipCount - mip))
+        {
+            BLIT_ERROR("Failed to create streamed texture image");
+            return 0;
+        }
+
+        // Queueing submits the pending batch early when it is full or the staging ring wraps around.
+        // Earlier requests left with such a batch, unless it failed and dropped them
+        auto uploadSerial{ m_uploadSerial };
+        auto mipOffset{ BlitzenEngine::GetDDSImageSizeBC(state.width, state.height, mip, state.blockSize) };
+        auto bQueued{ QueueTextureUpload(m_texturePaths.Data() + state.pathOffset, state.dataOffset + mipOffset, 
+            GetStreamedMipsSize(state, mip), pStreamed->image, state.mipCount - mip) };
+        if (m_uploadSerial != uploadSerial)
+        {
+            MarkSubmittedStreamedImages();
+        }
+        else
+        {
+            CancelDroppedStreamedImages();
+        }
+
+        if (!bQueued)
+        {
+            BLIT_ERROR("Failed to queue streamed texture upload");
+            pStreamed->image.CleanupResources(m_allocator, m_device);
+            pStreamed->image.image = VK_NULL_HANDLE;
+            pStreamed->image.imageView = VK_NULL_HANDLE;
+            return 0;
+        }
+
+        pStreamed->textureId = textureId;
+        pStreamed->mip = mip;
+        pStreamed->bActive = 1;
+        pStreamed->batchSerial = 0;// Set once the batch is submitted
+        MarkSubmittedStreamedImages();
+        state.bStreaming = 1;
+        return 1;
+    }
+
+    uint8_t VulkanRenderer::StreamTargetMips(uint8_t bEvictions, uint32_t streamedCount, uint32_t& streamCount)
+    {
+        for (uint32_t i = 0; i < streamedCount && streamCount < Ce_MaxStreamedTextureImages; ++i)
+        {
+            const auto& state{ m_textureStreaming[i] };
+            auto target{ m_textureTargetMips[i] };
+            if (state.bStreaming || target == state.residentMip || (target > state.residentMip) != bool(bEvictions))
+            {
+                continue;
+            }
+
+            if (!StreamTexture(i, target))
+            {
+                return 0;
+            }
+            ++streamCount;
+        }
+        return 1;
+    }
+
+    void VulkanRenderer::WriteDirtyTextureDescriptors()
+    {
+        // The last submission that used this frame's set is done (frame timeline)
+        auto& dirtyTextures{ m_dirtyTextureDescriptors[m_currentFrame] };
+        if (!dirtyTextures.GetSize())
+        {
+            return;
+        }
+
+        BlitCL::DynamicArray<VkDescriptorImageInfo> imageInfos{ dirtyTextures.GetSize() };
+        BlitCL::DynamicArray<VkWriteDescriptorSet> writes{ dirtyTextures.GetSize() };
+        for (size_t i = 0; i < dirtyTextures.GetSize(); ++i)
+        {
+            const auto& texture{ loadedTextures[dirtyTextures[i]] };
+            imageInfos[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            imageInfos[i].imageView = texture.image.imageView;
+            imageInfos[i].sampler = texture.sampler;
+
+            writes[i] = {};
+            WriteImageDescriptorSets(writes[i], &imageInfos[i], VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                m_textureDescriptorSets[m_currentFrame], 1, 0, dirtyTextures[i]);
+        }
+        vkUpdateDescriptorSets(m_device, uint32_t(writes.GetSize()), writes.Data(), 0, nullptr);
+        dirtyTextures.Clear();
+    }
+
+    void VulkanRenderer::UpdateTextureStreaming(const BlitzenEngine::DrawContext& context)
+    {
+        BLIT_PROFILE_FUNCTION();
+
+        ++m_textureStreamingFrame;
+
+        // Batches that are done give their part of the staging ring back
+        uint64_t oldestInFlightSerial{ UINT64_MAX };
+        for (auto& batch : m_uploadBatches)
+        {
+            if (batch.bInFlight && vkGetFenceStatus(m_device, batch.fence.handle) == VK_SUCCESS)
+            {
+                RetireUploadBatch(batch);
+            }
+            if (batch.bInFlight && batch.serial < oldestInFlightSerial)
+            {
+                oldestInFlightSerial = batch.serial;
+            }
+        }
+
+        // Finished images take the place of the old ones, which wait until no frame in flight can sample them
+        for (auto& streamed : m_streamedTextureImages)
+        {
+            if (!streamed.bActive || !streamed.batchSerial || streamed.batchSerial >= oldestInFlightSerial)
+            {
+                continue;
+            }
+
+            auto& texture{ loadedTextures[streamed.textureId].image };
+            m_retiredTextureImages.PushBack({ texture.image, texture.imageView, texture.allocation, m_textureStreamingFrame });
+            texture.image = streamed.image.image;
+            texture.imageView = streamed.image.imageView;
+            texture.allocation = streamed.image.allocation;
+            texture.extent = streamed.image.extent;
+            streamed.image.image = VK_NULL_HANDLE;
+            streamed.image.imageView = VK_NULL_HANDLE;
+
+            m_textureStreaming[streamed.textureId].residentMip = streamed.mip;
+            m_textureStreaming[streamed.textureId].bStreaming = 0;
+            streamed.bActive = 0;
+
+            for (uint8_t i = 0; i < m_framesInFlight; ++i)
+            {
+                m_dirtyTextureDescriptors[i].PushBack(streamed.textureId);
+            }
+        }
+
+        // After m_framesInFlight frames every set has the new image and the frames that used the old one are done
+        for (size_t i = 0; i < m_retiredTextureImages.GetSize();)
+        {
+            const auto& retired{ m_retiredTextureImages[i] };
+            if (m_textureStreamingFrame - retired.frame < m_framesInFlight)
+            {
+                ++i;
+                continue;
+            }
+
+            vkDestroyImageView(m_device, retired.imageView, nullptr);
+            vmaDestroyImage(m_allocator, retired.image, retired.allocation);
+            m_retiredTextureImages.RemoveAtIndex(i);
+        }
+
+        if (m_textureStreamingFrame % Ce_TextureStreamingInterval)
+        {
+            return;
+        }
+
+        auto streamedCount{ uint32_t(m_textureScreenSizes.GetSize()) };
+        BlitzenEngine::ComputeTextureScreenSizes(context.m_camera.viewData, context.m_meshes, context.m_textures, context.m_renders,
+            m_textureScreenSizes.Data(), streamedCount);
+
+        for (uint32_t i = 0; i < streamedCount; ++i)
+        {
+            const auto& state{ m_textureStreaming[i] };
+            auto mip{ BlitzenEngine::SelectStreamedMip(m_textureScreenSizes[i], state.width, state.height, state.mipCount) };
+            m_textureTargetMips[i] = mip < state.tailMip ? mip : state.tailMip;
+        }
+
+        // Every texture gets coarser by the same number of mips until the total fits the budget
+        for (uint8_t bias = 0; bias < 16; ++bias)
+        {
+            size_t totalSize{ 0 };
+            for (uint32_t i = 0; i < streamedCount; ++i)
+            {
+                const auto& state{ m_textureStreaming[i] };
+                auto mip{ m_textureTargetMips[i] + bias < state.tailMip ? uint8_t(m_textureTargetMips[i] + bias) : state.tailMip };
+                totalSize += GetStreamedMipsSize(state, mip);
+            }
+
+            if (totalSize <= Ce_TextureStreamingBudget)
+            {
+                for (uint32_t i = 0; i < streamedCount; ++i)
+                {
+                    const auto& state{ m_textureStreaming[i] };
+                    m_textureTargetMips[i] = m_textureTargetMips[i] + bias < state.tailMip ? uint8_t(m_textureTargetMips[i] + bias) : state.tailMip;
+                }
+                break;
+            }
+        }
+
+        // Evictions go first, so that memory is released before finer mips need it
+        uint32_t streamCount{ 0 };
+        if (StreamTargetMips(1, streamedCount, streamCount))
+        {
+            StreamTargetMips(0, streamedCount, streamCount);
+        }
+
+        if (!streamCount)
+        {
+            return;
+        }
+
+        // Submitted without waiting, the images are swapped in by a later update.
+        // A failed flush drops the pending uploads, so their slots and textures can be requested again
+        if (!FlushUploads())
+        {
+            BLIT_ERROR("Failed to submit streamed textures");
+            CancelDroppedStreamedImages();
+            return;
+        }
+        MarkSubmittedStreamedImages();
+    }
+}
@@ -0,0 +1,191 @@
+#include "vulkanRenderer.h"
+#include "Platform/Filesystem/blitCFILE.h"
+#include <algorithm>
+#include <cfloat>
+#include <cstdio>
+
+namespace BlitzenVulkan
+{
+    void VulkanRenderer::SetupGpuTimestamps()
+    {
+        VkPhysicalDeviceProperties props{};
+        vkGetPhysicalDeviceProperties(m_physicalDevice, &props);
+        m_timestampPeriod = props.limits.timestampPeriod;
+
+        uint32_t familyCount{ 0 };
+        vkGetPhysicalDeviceQueueFamilyProperties(m_physicalDevice, &familyCount, nullptr);
+        BlitCL::DynamicArray<VkQueueFamilyProperties> families{ familyCount };
+        vkGetPhysicalDeviceQueueFamilyProperties(m_physicalDevice, &familyCount, families.Data());
+
+        auto graphicsBits{ families[m_graphicsQueue.index].timestampValidBits };
+        if (!graphicsBits || m_timestampPeriod == 0.f)
+        {
+            BLIT_WARN("Graphics queue does not support timestamps, GPU pass timings are disabled");
+            return;
+        }
+
+        m_stats.bGpuTimestampsSupported = 1;
+        m_timestampMask = graphicsBits >= 64 ? UINT64_MAX : (uint64_t(1) << graphicsBits) - 1;
+
+        // The pre cluster pass is on the compute queue
+        m_bComputeTimestampsSupported = m_computeQueue.hasIndex && families[m_computeQueue.index].timestampValidBits == graphicsBits;
+    }
+
+    void VulkanRenderer::ResetGpuTimestamps(VkCommandBuffer commandBuffer)
+    {
+        if (!m_stats.bGpuTimestampsSupported)
+        {
+            return;
+        }
+
+        auto& tools{ m_frameToolsList[m_currentFrame] };
+        vkCmdResetQueryPool(commandBuffer, tools.timestampQueryPool.handle, 0, Ce_GpuTimestampQueryCount);
+        tools.bTimestampsWritten = 1;
+    }
+
+    void VulkanRenderer::BeginGpuPass(VkCommandBuffer commandBuffer, GpuPass pass)
+    {
+        if (!m_stats.bGpuTimestampsSupported || (pass == GpuPass::PreClusterCull && !m_bComputeTimestampsSupported))
+        {
+            return;
+        }
+
+        vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+            m_frameToolsList[m_currentFrame].timestampQueryPool.handle, uint32_t(pass) * 2);
+    }
+
+    void VulkanRenderer::EndGpuPass(VkCommandBuffer commandBuffer, GpuPass pass)
+    {
+        if (!m_stats.bGpuTimestampsSupported || (pass == GpuPass::PreClusterCull && !m_bComputeTimestampsSupported))
+        {
+            return;
+        }
+
+        vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+            m_frameToolsList[m_currentFrame].timestampQueryPool.handle, uint32_t(pass) * 2 + 1);
+    }
+
+    static void UpdateGpuPassTimings(GpuPassTimings& timings, const float (*pHistory)[Ce_GpuPassCount], uint32_t frameCount)
+    {
+        float samples[Ce_GpuTimingHistorySize];
+        for (uint32_t pass = 0; pass < Ce_GpuPassCount; ++pass)
+        {
+            uint32_t sampleCount{ 0 };
+            float sum{ 0.f };
+            float minMs{ FLT_MAX };
+            for (uint32_t frame = 0; frame < frameCount; ++frame)
+            {
+                auto ms{ pHistory[frame][pass] };
+                if (ms < 0.f)
+                {
+                    continue;
+                }
+
+                samples[sampleCount++] = ms;
+                sum += ms;
+                minMs = ms < minMs ? ms : minMs;
+            }
+
+            timings.sampleCount[pass] = sampleCount;
+            if (!sampleCount)
+            {
+                timings.minMs[pass] = timings.avgMs[pass] = timings.p99Ms[pass] = 0.f;
+                continue;
+            }
+
+            auto p99Index{ (sampleCount * 99 + 99) / 100 - 1 };
+            std::nth_element(samples, samples + p99Index, samples + sampleCount);
+
+            timings.minMs[pass] = minMs;
+            timings.avgMs[pass] = sum / float(sampleCount);
+            timings.p99Ms[pass] = samples[p99Index];
+        }
+    }
+
+    void VulkanRenderer::ReadGpuTimestamps(FrameTools& tools)
+    {
+        if (!m_stats.bGpuTimestampsSupported || !tools.bTimestampsWritten)
+        {
+            return;
+        }
+
+        // Timestamp and availability for each query. Passes that were skipped this frame stay unavailable after the reset
+        uint64_t results[Ce_GpuTimestampQueryCount][2]{};
+        auto res{ vkGetQueryPoolResults(m_device, tools.timestampQueryPool.handle, 0, Ce_GpuTimestampQueryCount, sizeof(results), results,
+            sizeof(results[0]), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT) };
+        if (res != VK_SUCCESS && res != VK_NOT_READY)
+        {
+            return;
+        }
+
+        auto& frameTimings{ m_gpuTimingHistory[m_gpuTimingFrameCount % Ce_GpuTimingHistorySize] };
+        for (uint32_t pass = 0; pass < Ce_GpuPassCount; ++pass)
+        {
+            auto& begin{ results[pass * 2] };
+            auto& end{ results[pass * 2 + 1] };
+            if (!begin[1] || !end[1])
+            {
+                frameTimings[pass] = -1.f;
+                continue;
+            }
+
+            auto ticks{ ((end[0] & m_timestampMask) - (begin[0] & m_timestampMask)) & m_timestampMask };
+            frameTimings[pass] = float(double(ticks) * double(m_timestampPeriod) * 1e-6);
+        }
+        ++m_gpuTimingFrameCount;
+
+        for (uint32_t pass = 0; pass < Ce_GpuPassCount; ++pass)
+        {
+            m_stats.gpuTimings.lastMs[pass] = frameTimings[pass] < 0.f ? 0.f : frameTimings[pass];
+        }
+        UpdateGpuPassTimings(m_stats.gpuTimings, m_gpuTimingHistory,
+            m_gpuTimingFrameCount < Ce_GpuTimingHistorySize ? m_gpuTimingFrameCount : Ce_GpuTimingHistorySize);
+    }
+
+    uint8_t VulkanRenderer::WriteGpuTimingsCsv(const char* filepath)
+    {
+        if (!m_stats.bGpuTimestampsSupported)
+        {
+            BLIT_ERROR("GPU timestamps are not supported, no timings to write");
+            return 0;
+        }
+
+        BlitzenPlatform::C_FILE_SCOPE file;
+        if (!file.Open(filepath, BlitzenPlatform::FileModes::Write, 0))
+        {
+            BLIT_ERROR("Failed to open %s", filepath);
+            return 0;
+        }
+
+        char line[512];
+        int lineSize{ snprintf(line, sizeof(line), "frame") };
+        for (auto pName : Ce_GpuPassNames)
+        {
+            lineSize += snprintf(line + lineSize, sizeof(line) - lineSize, ",%s", pName);
+        }
+        BlitzenPlatform::FilesystemWriteLine(file, line);
+
+        // Oldest frame in the ring first
+        auto frameCount{ m_gpuTimingFrameCount < Ce_GpuTimingHistorySize ? m_gpuTimingFrameCount : Ce_GpuTimingHistorySize };
+        auto firstFrame{ m_gpuTimingFrameCount - frameCount };
+        for (uint32_t frame = firstFrame; frame < m_gpuTimingFrameCount; ++frame)
+        {
+            auto& frameTimings{ m_gpuTimingHistory[frame % Ce_GpuTimingHistorySize] };
+            lineSize = snprintf(line, sizeof(line), "%u", frame);
+            for (uint32_t pass = 0; pass < Ce_GpuPassCount; ++pass)
+            {
+                lineSize += frameTimings[pass] < 0.f ? snprintf(line + lineSize, sizeof(line) - lineSize, ",") :
+                    snprintf(line + lineSize, sizeof(line) - lineSize, ",%.4f", frameTimings[pass]);
+            }
+
+            if (!BlitzenPlatform::FilesystemWriteLine(file, line))
+            {
+                BLIT_ERROR("Failed to write %s", filepath);
+                return 0;
+            }
+        }
+
+        BLIT_INFO("GPU pass timings written to %s", filepath);
+        return 1;
+    }
+}
@@ -34,6 +34,6 @@ void csMain(uint3 dispatchThreadID : SV_DispatchThreadID)
     ssbo_DrawCmd[cmdId].vertOffset = 0; // Already added to the index buffer
 
     // Instances
-    ssbo_DrawCmd[cmdId].instCount = rwssbo_InstCounter[lodId].instanceCount;
+    ssbo_DrawCmd[cmdId].instCount = min(rwssbo_InstCounter[lodId].instanceCount, rwssbo_InstCounter[lodId].instanceCapacity);
     ssbo_DrawCmd[cmdId].insOffset = 0;
 }
\ No newline at end of file
@@ -38,6 +38,10 @@ void csMain(uint3 dispatchThreadID : SV_DispatchThreadID, uint3 dispatchGroupID
         uint instanceId;
         InterlockedAdd(rwssbo_InstCounter[lodId].instanceCount, 1, instanceId);
 
-        rwssbo_instIndices[rwssbo_InstCounter[lodId].instanceOffset + instanceId] = objId;
+        // Instances past the LOD's range are dropped
+        if(instanceId < rwssbo_InstCounter[lodId].instanceCapacity)
+        {
+            rwssbo_instIndices[rwssbo_InstCounter[lodId].instanceOffset + instanceId] = objId;
+        }
     }
 }
\ No newline at end of file
@@ -60,6 +60,7 @@ struct InstanceCounter
 {
     uint instanceOffset;
     uint instanceCount;
+    uint instanceCapacity;
 };
 RWStructuredBuffer<InstanceCounter> rwssbo_InstCounter : register (u2);
 
@@ -77,21 +77,95 @@ bool OcclusionCheck(float4 aabb, Texture2D<float4> tex_HiZMap, uint pyramidWidth
 	return depthSphere > depth;
 }
 
+// The scale needs to match Ce_VertexUnorm8Scale on the CPU side
 float3 UnpackNormals(uint packed)
 {
-	float x = ((packed >> 24) & 0xFF) / 127.5f - 1.0f; 
-    float y = ((packed >> 16) & 0xFF) / 127.5f - 1.0f;
-    float z = ((packed >> 8) & 0xFF) / 127.5f - 1.0f;
+	float x = ((packed >> 24) & 0xFF) / 127.0f - 1.0f; 
+    float y = ((packed >> 16) & 0xFF) / 127.0f - 1.0f;
+    float z = ((packed >> 8) & 0xFF) / 127.0f - 1.0f;
 
     return float3(x, y, z); 
 }
 
 float4 UnpackTangents(uint packed)
 {
-	float x = ((packed >> 24) & 0xFF) / 127.5f - 1.0f; 
-    float y = ((packed >> 16) & 0xFF) / 127.5f - 1.0f;
-    float z = ((packed >> 8) & 0xFF) / 127.5f - 1.0f;
-	float w = (packed & 0xFF) / 127.5f - 1.0f;
+	float x = ((packed >> 24) & 0xFF) / 127.0f - 1.0f; 
+    float y = ((packed >> 16) & 0xFF) / 127.0f - 1.0f;
+    float z = ((packed >> 8) & 0xFF) / 127.0f - 1.0f;
+	float w = (packed & 0xFF) / 127.0f - 1.0f;
 
 	return float4(x, y, z, w);
-}
\ No newline at end of file
+}
+
+// Vertex unpacking, only for shaders that include vsBuffers.hlsl
+#ifdef VS_BUFFERS
+#ifdef COMPACT_VERTICES
+// Sign extends the selected bits and maps them to [-1, 1]
+float UnpackSnorm(uint packed, uint shift, uint bits)
+{
+    int value = int(packed << (32 - shift - bits)) >> (32 - bits);
+    return max(float(value) / float((1u << (bits - 1)) - 1), -1.0f);
+}
+
+float3 OctahedralDecode(float2 e)
+{
+    float3 v = float3(e, 1.0f - abs(e.x) - abs(e.y));
+    float t = max(-v.z, 0.0f);
+    v.x += v.x >= 0.0f ? -t : t;
+    v.y += v.y >= 0.0f ? -t : t;
+    return normalize(v);
+}
+
+Vertex FetchVertex(uint index, Surface surface)
+{
+    return ssbo_Vertices[index + surface.vertexOffset];
+}
+
+float3 UnpackPosition(Vertex vtx, Surface surface)
+{
+    float3 quantized = float3(UnpackSnorm(vtx.positionXY, 0, 16), UnpackSnorm(vtx.positionXY, 16, 16), UnpackSnorm(vtx.positionZNormal, 0, 16));
+    return surface.center + quantized * surface.radius;
+}
+
+float2 UnpackUv(Vertex vtx)
+{
+    return float2(f16tof32(vtx.uv & 0xFFFF), f16tof32(vtx.uv >> 16));
+}
+
+float3 UnpackNormal(Vertex vtx)
+{
+    return OctahedralDecode(float2(UnpackSnorm(vtx.positionZNormal, 16, 8), UnpackSnorm(vtx.positionZNormal, 24, 8)));
+}
+
+float4 UnpackTangent(Vertex vtx)
+{
+    float3 tangent = OctahedralDecode(float2(UnpackSnorm(vtx.tangent, 0, 8), UnpackSnorm(vtx.tangent, 8, 8)));
+    return float4(tangent, UnpackSnorm(vtx.tangent, 16, 8));
+}
+#else
+Vertex FetchVertex(uint index, Surface surface)
+{
+    return ssbo_Vertices[index];
+}
+
+float3 UnpackPosition(Vertex vtx, Surface surface)
+{
+    return vtx.position;
+}
+
+float2 UnpackUv(Vertex vtx)
+{
+    return float2(vtx.mappingU, vtx.mappingV);
+}
+
+float3 UnpackNormal(Vertex vtx)
+{
+    return UnpackNormals(vtx.normals);
+}
+
+float4 UnpackTangent(Vertex vtx)
+{
+    return UnpackTangents(vtx.tangents);
+}
+#endif
+#endif
\ No newline at end of file
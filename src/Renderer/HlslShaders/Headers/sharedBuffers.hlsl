@@ -12,7 +12,7 @@ struct Surface
     uint lodOffset;
     uint lodCount;
 
-    uint vertexOffset; // Not used in the shaders but can hold the offset when loading
+    uint vertexOffset; // Added to the (surface relative) index when vertices are compact
 };
 StructuredBuffer<Surface> ssbo_Surfaces : register(t2);
 
@@ -1,3 +1,17 @@
+#define VS_BUFFERS
+
+// COMPACT_VERTICES is defined by the build when BLIT_COMPACT_VERTICES is
+
+#ifdef COMPACT_VERTICES
+// Quantized vertex, same buffer as the Vulkan backend (unpacked in hlslMath.hlsl)
+struct Vertex
+{
+    uint positionXY;
+    uint positionZNormal;
+    uint uv;
+    uint tangent;
+};
+#else
 struct Vertex
 {
     float3 position;
@@ -5,6 +19,7 @@ struct Vertex
     uint normals, tangents;
     uint padding0;
 };
+#endif
 StructuredBuffer<Vertex> ssbo_Vertices : register(t0);
 
 cbuffer ObjId : register(b1)
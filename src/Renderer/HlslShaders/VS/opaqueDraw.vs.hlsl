@@ -5,29 +5,30 @@
 // The main vertex shader function
 VSOutput main(uint vertexIndex : SV_VERTEXID)
 {
-    Vertex vtx = ssbo_Vertices[vertexIndex];
     Render obj = ssbo_Renders[objId];
+    Surface surface = ssbo_Surfaces[obj.surfaceId];
+    Vertex vtx = FetchVertex(vertexIndex, surface);
     float4 orientation = ssbo_Transforms[obj.transformId].orientation;
     VSOutput output;
 
     // Position
-    float3 modelPos = RotateQuat(vtx.position, orientation) * ssbo_Transforms[obj.transformId].scale + ssbo_Transforms[obj.transformId].position;
+    float3 modelPos = RotateQuat(UnpackPosition(vtx, surface), orientation) * ssbo_Transforms[obj.transformId].scale + ssbo_Transforms[obj.transformId].position;
     output.position = mul(projectionView, (float4(modelPos, 1.0f))); 
     
     // Material index
-    output.materialId = ssbo_Surfaces[obj.surfaceId].materialId;
+    output.materialId = surface.materialId;
 
     // Normals(unpacking required)
-    float3 unpackedNormal = UnpackNormals(vtx.normals);
+    float3 unpackedNormal = UnpackNormal(vtx);
     output.normal = RotateQuat(unpackedNormal, orientation);
 
     // Tangents(unpacking required)
-    float4 unpackedTangent = UnpackTangents(vtx.tangents);
+    float4 unpackedTangent = UnpackTangent(vtx);
     output.tangent.xyz = RotateQuat(unpackedTangent.xyz, orientation);
     output.tangent.w = unpackedTangent.w;
 
     // Texture coordinates
-    output.uvMapping = float2(vtx.mappingU, vtx.mappingV);
+    output.uvMapping = UnpackUv(vtx);
 
     return output;
 }
\ No newline at end of file
@@ -10,6 +10,7 @@
 #endif
 #include <typeinfo>
 #include <cstring>
+#include <atomic>
 
 namespace BlitzenEngine
 {
@@ -20,6 +21,9 @@ namespace BlitzenEngine
 
         using RendererType = BlitzenVulkan::VulkanRenderer;
 
+        // Gltf files are published to the renderer one by one, while the main loop draws
+        constexpr uint8_t Ce_RendererSceneBatches = 1;
+
     #elif defined(_WIN32) && defined(BLIT_VK_FORCE)
 
         using Renderer = BlitCL::SmartPointer<BlitzenVulkan::VulkanRenderer, BlitzenCore::AllocationType::Renderer>;
@@ -28,6 +32,8 @@ namespace BlitzenEngine
 
         using RendererType = BlitzenVulkan::VulkanRenderer;
 
+        constexpr uint8_t Ce_RendererSceneBatches = 1;
+
     #elif defined(_WIN32) && defined(BLIT_GL_LEGACY_OVERRIDE) 
 
         using Renderer = BlitCL::SmartPointer<BlitzenGL::OpenglRenderer, BlitzenCore::AllocationType::Renderer>;
@@ -36,6 +42,8 @@ namespace BlitzenEngine
 
 		using RendererType = BlitzenGL::OpenglRenderer;
 
+        constexpr uint8_t Ce_RendererSceneBatches = 0;
+
     #elif defined(_WIN32)
 
         using Renderer = BlitCL::SmartPointer<BlitzenDX12::Dx12Renderer, BlitzenCore::AllocationType::Renderer>;
@@ -44,19 +52,33 @@ namespace BlitzenEngine
 
         using RendererType = BlitzenDX12::Dx12Renderer;
 
+        constexpr uint8_t Ce_RendererSceneBatches = 0;
+
     #else
 
         static_assert(true);
 
     #endif
 
+    // Shared by the loading thread and the main loop. The scene can be drawn from bSceneReady, more of it might follow until bLoadingDone
+    struct SceneLoadingState
+    {
+        std::atomic<bool> bSceneReady{ false };
+        std::atomic<bool> bLoadingDone{ false };
+        std::atomic<bool> bFailed{ false };
+        std::atomic<bool> bCancel{ false };// Set by the main loop, loading stops before the next gltf file
+    };
+
     bool RenderingResourcesInit(RenderingResources* pResources, RendererPtrType pRenderer);
 
     bool ManageGltf(const char* filepath, RenderingResources* pResources, BlitzenCore::EntityManager* pManager, RendererPtrType pRenderer);
 
     void CreateDynamicObjectRendererTest(BlitzenEngine::RenderContainer& renders, BlitzenEngine::MeshResources& meshes, BlitzenCore::EntityManager* pManager);
 
-    bool CreateSceneFromArguments(int argc, char** argv, BlitzenEngine::RenderingResources* pResources, BlitzenEngine::RendererPtrType pRenderer, BlitzenCore::EntityManager* pManager);
+    // Loads the scene and sets up the renderer for it. With scene batches the renderer is set up before the gltf files, 
+    // which are published to it one at a time
+    bool CreateSceneFromArguments(int argc, char** argv, BlitzenEngine::RenderingResources* pResources, BlitzenEngine::RendererPtrType pRenderer, 
+        BlitzenCore::EntityManager* pManager, BlitzenEngine::DrawContext& context, SceneLoadingState& loadingState);
 
     void UpdateDynamicObjects(RendererPtrType pRenderer, BlitzenCore::EntityManager* pEntityManager, BlitzenWorld::BlitzenWorldContext& blitzenContext);    
 }
\ No newline at end of file
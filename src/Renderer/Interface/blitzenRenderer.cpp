@@ -1,5 +1,6 @@
 #define CGLTF_IMPLEMENTATION
 #include "blitRenderer.h"
+#include "Core/DbLog/blitProfiler.h"
 
 namespace BlitzenEngine
 {
@@ -58,6 +59,8 @@ namespace BlitzenEngine
 
     bool ManageGltf(const char* filepath, RenderingResources* pResources, BlitzenCore::EntityManager* pManager, RendererPtrType pRenderer)
     {
+        BLIT_PROFILE_FUNCTION();
+
         auto& textureContext{ pResources->m_textureManager };
         auto& meshContext{ pResources->m_meshContext };
 		auto& objectContext{ pManager->m_renderContainer };
@@ -117,7 +120,7 @@ namespace BlitzenEngine
 
         // Meshes
         BLIT_INFO("Loading meshes for GLTF");
-        LoadGltfMeshes(meshContext, textureContext, cgltfScope, previousMaterialCount, surfaceIndices);
+        LoadGltfMeshes(meshContext, textureContext, cgltfScope, previousMaterialCount, surfaceIndices, filepath);
 
         BLIT_INFO("Loading scene nodes");
         LoadGltfNodes(objectContext, meshContext, cgltfScope, surfaceIndices);
@@ -149,8 +152,11 @@ namespace BlitzenEngine
         }
     }
 
-    bool CreateSceneFromArguments(int argc, char** argv, BlitzenEngine::RenderingResources* pResources, BlitzenEngine::RendererPtrType pRenderer, BlitzenCore::EntityManager* pManager)
+    bool CreateSceneFromArguments(int argc, char** argv, BlitzenEngine::RenderingResources* pResources, BlitzenEngine::RendererPtrType pRenderer, 
+        BlitzenCore::EntityManager* pManager, BlitzenEngine::DrawContext& context, SceneLoadingState& loadingState)
     {
+        BLIT_PROFILE_FUNCTION();
+
         LoadTestGeometry(pResources->m_meshContext);
 		CreateSingleRender(pManager->m_renderContainer, pResources->m_meshContext, BlitzenCore::Ce_DefaultMeshName, 5.f);
 
@@ -159,66 +165,97 @@ namespace BlitzenEngine
             CreateDynamicObjectRendererTest(pManager->m_renderContainer, pResources->m_meshContext, pManager);
         }
 
+        // Special arguments load a test scene, the following arguments are used as gltf filepaths
+        int32_t firstGltfArgument{ 1 };
         if (argc > 1)
         {
             // Special argument. Loads heavy scene to stress test the culling algorithms
             if (strcmp(argv[1], "RenderingStressTest") == 0)
             {
                 LoadGeometryStressTest(pManager->m_renderContainer, pResources->m_meshContext, 3'000.f);
-
-                // The following arguments are used as gltf filepaths
-                for (int32_t i = 2; i < argc; ++i)
-                {
-                    if (!ManageGltf(argv[i], pResources, pManager, pRenderer))
-                    {
-                        BLIT_ERROR("Failed to load gltf scene from file: %s", argv[i]);
-                        return false;
-                    }
-                }
+                firstGltfArgument = 2;
             }
 
             else if (strcmp(argv[1], "InstancingStressTest") == 0)
             {
                 LoadGeometryStressTest(pManager->m_renderContainer, pResources->m_meshContext, 2'000.f);
-
-                // The following arguments are used as gltf filepaths
-                for (int32_t i = 2; i < argc; ++i)
-                {
-                    if (!ManageGltf(argv[i], pResources, pManager, pRenderer))
-                    {
-                        BLIT_ERROR("Failed to load gltf scene from file: %s", argv[i]);
-                        return false;
-                    }
-                }
+                firstGltfArgument = 2;
             }
 
             // Special argument. Test oblique near-plane clipping technique. Not working yet.
             else if (strcmp(argv[1], "OnpcReflectionTest") == 0)
             {
                 CreateObliqueNearPlaneClippingTestObject(pManager->m_renderContainer, pResources->m_meshContext);
+                firstGltfArgument = 2;
+            }
+        }
 
-                // The following arguments are used as gltf filepaths
-                for (int32_t i = 2; i < argc; ++i)
-                {
-                    if (!ManageGltf(argv[i], pResources, pManager, pRenderer))
-                    {
-                        BLIT_ERROR("Failed to load gltf scene from file: %s", argv[i]);
-                        return false;
-                    }
-                }
+        auto& renders = pManager->m_renderContainer;
+        auto& meshes = pResources->m_meshContext;
+
+        // The built in objects are drawn while the gltf files load, every file is a scene batch
+        if constexpr (Ce_RendererSceneBatches)
+        {
+            SetLodInstanceRanges(meshes, renders.m_renders, renders.m_renderCount);
+            if (!pRenderer->SetupForRendering(context))
+            {
+                BLIT_ERROR("Renderer failed to setup");
+                return false;
             }
-            else
+            loadingState.bSceneReady = true;
+        }
+
+        for (int32_t i = firstGltfArgument; i < argc && !loadingState.bCancel; ++i)
+        {
+            if (!ManageGltf(argv[i], pResources, pManager, pRenderer))
             {
-                for (int32_t i = 1; i < argc; ++i)
+                BLIT_ERROR("Failed to load gltf scene from file: %s", argv[i]);
+                return false;
+            }
+
+            if constexpr (Ce_RendererSceneBatches)
+            {
+                SetLodInstanceRanges(meshes, renders.m_renders, renders.m_renderCount);
+                if (!pRenderer->PublishSceneBatch(context, 0))
                 {
-                    if (!ManageGltf(argv[i], pResources, pManager, pRenderer))
-                    {
-                        BLIT_ERROR("Failed to load gltf scene from file: %s", argv[i]);
-                        return false;
-                    }
+                    BLIT_ERROR("Failed to publish gltf scene from file: %s", argv[i]);
+                    return false;
                 }
             }
         }
+        if (loadingState.bCancel)
+        {
+            return true;
+        }
+
+        // Static render objects are sorted for spatial queries and node culling
+        if (!BuildRenderObjectBvh(renders.m_staticBvh, renders.m_renders, renders.m_renderCount, renders.m_transforms, meshes))
+        {
+            BLIT_ERROR("Failed to build the render object BVH");
+            return false;
+        }
+
+        // Instanced culling ranges, sized by the render objects that use each surface
+        SetLodInstanceRanges(meshes, renders.m_renders, renders.m_renderCount);
+
+        // The last batch has the sorted render objects and starts texture streaming
+        if constexpr (Ce_RendererSceneBatches)
+        {
+            if (!pRenderer->PublishSceneBatch(context, 1))
+            {
+                BLIT_ERROR("Failed to publish the sorted scene");
+                return false;
+            }
+        }
+        else
+        {
+            if (!pRenderer->SetupForRendering(context))
+            {
+                BLIT_ERROR("Renderer failed to setup");
+                return false;
+            }
+            loadingState.bSceneReady = true;
+        }
 
         return true;
     }
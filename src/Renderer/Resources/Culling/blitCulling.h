@@ -0,0 +1,56 @@
+#pragma once
+#include "Renderer/Resources/RenderObject/blitRender.h"
+#include "Game/blitCamera.h"
+
+namespace BlitzenEngine
+{
+    // Same layout as the GPU culling output (object id followed by the 5 indexed draw arguments, IndirectDrawData in Vulkan),
+    // so the array can be copied to an indirect buffer as is
+    struct IndirectDraw
+    {
+        uint32_t objectId;
+        uint32_t indexCount;
+        uint32_t instanceCount;
+        uint32_t firstIndex;
+        int32_t vertexOffset;
+        uint32_t firstInstance;
+    };
+    static_assert(sizeof(IndirectDraw) == 6 * sizeof(uint32_t));
+
+    // PreClusterDrawCull output, one element per cluster of every visible object
+    struct ClusterDispatch
+    {
+        uint32_t objectId;
+        uint32_t lodIndex;
+        uint32_t clusterId;
+    };
+
+    struct CullingStats
+    {
+        uint32_t testedCount{ 0 };
+        uint32_t visibleCount{ 0 };
+
+        // Visible objects per selected LOD (draw path only)
+        uint32_t lodHistogram[BlitzenCore::Ce_MaxLodCountPerSurface]{};
+    };
+
+    // CPU version of the draw cull shaders (IsObjectInsideViewFrustum and LODSelection, no occlusion).
+    // Runs on the task pool with SIMD, draws come out in render object order. Returns the draw count
+    uint32_t CullRenderObjects(const CameraViewData& view, const SurfaceResources& surfaces, const MeshTransform* pTransforms,
+        const RenderObject* pRenders, uint32_t renderCount, BlitCL::DynamicArray<IndirectDraw>& draws, CullingStats* pStats = nullptr);
+
+    // CPU version of PreClusterDrawCull. Every cluster of the first LOD (the whole DAG) of each visible object is emitted.
+    // Returns the dispatch count
+    uint32_t CullRenderObjectsForClusters(const CameraViewData& view, const SurfaceResources& surfaces, const MeshTransform* pTransforms,
+        const RenderObject* pRenders, uint32_t renderCount, BlitCL::DynamicArray<ClusterDispatch>& dispatches, CullingStats* pStats = nullptr);
+
+    // Same as CullRenderObjects on the given object ranges (BVH query results), draws come out in range order
+    uint32_t CullRenderObjectRanges(const CameraViewData& view, const SurfaceResources& surfaces, const MeshTransform* pTransforms,
+        const RenderObject* pRenders, const RenderObjectRange* pRanges, uint32_t rangeCount, BlitCL::DynamicArray<IndirectDraw>& draws,
+        CullingStats* pStats = nullptr);
+
+    // Culls the opaque render objects of the container. When the static BVH is built, only the objects of the nodes
+    // that touch the frustum are tested (testedCount in the stats)
+    uint32_t CullRenderContainer(const CameraViewData& view, const SurfaceResources& surfaces, const RenderContainer& renders,
+        BlitCL::DynamicArray<IndirectDraw>& draws, CullingStats* pStats = nullptr);
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include "blitCulling.h"
+
+namespace BlitzenEngine
+{
+    // Low resolution reversed depth buffer (zNear / viewZ, 0 is far) with its min depth pyramid, the CPU version of the GPU depth pyramid
+    struct SoftwareOcclusionBuffer
+    {
+        // Level 0 is the rasterized buffer, every next level is the min of 2x2 texels down to 1x1
+        BlitCL::DynamicArray<float> m_pyramid;
+        uint32_t m_levelOffsets[16];
+        uint32_t m_levelWidths[16];
+        uint32_t m_levelHeights[16];
+        uint32_t m_levelCount{ 0 };
+
+        uint32_t m_occluderCount{ 0 };
+        uint32_t m_triangleCount{ 0 };
+    };
+
+    // Picks the largest visible objects by projected bounding sphere (up to Ce_MaxSoftwareOccluders and the triangle budget),
+    // rasterizes the LOD that their draw uses and builds the pyramid. Draws come from CullRenderObjects
+    void BuildSoftwareOcclusion(SoftwareOcclusionBuffer& buffer, const CameraViewData& view, const SurfaceResources& surfaces,
+        const MeshTransform* pTransforms, const RenderObject* pRenders, const IndirectDraw* pDraws, uint32_t drawCount);
+
+    // Same test as OcclusionCullingPassed on a view space bounding sphere
+    bool IsSphereOccluded(const SoftwareOcclusionBuffer& buffer, const CameraViewData& view, const BlitML::vec3& center, float radius);
+
+    // Removes the draws whose bounding sphere is hidden by the occluders, keeps the order. Returns the new draw count
+    uint32_t SoftwareOcclusionCull(const SoftwareOcclusionBuffer& buffer, const CameraViewData& view, const SurfaceResources& surfaces,
+        const MeshTransform* pTransforms, const RenderObject* pRenders, BlitCL::DynamicArray<IndirectDraw>& draws);
+}
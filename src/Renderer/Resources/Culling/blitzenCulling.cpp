@@ -0,0 +1,380 @@
+#include "blitCulling.h"
+#include "Core/Threads/blitTaskPool.h"
+#include <cstring>
+
+namespace BlitzenEngine
+{
+    // Objects are gathered in blocks and tested 4 at a time, blocks live on the stack of the task
+    constexpr uint32_t Ce_CullingBlockSize = 64;
+
+    // Structure of arrays copy of a block of render objects (bounding sphere and transform)
+    struct CullingBlock
+    {
+        alignas(16) float centerX[Ce_CullingBlockSize];
+        alignas(16) float centerY[Ce_CullingBlockSize];
+        alignas(16) float centerZ[Ce_CullingBlockSize];
+        alignas(16) float radius[Ce_CullingBlockSize];
+
+        alignas(16) float quatX[Ce_CullingBlockSize];
+        alignas(16) float quatY[Ce_CullingBlockSize];
+        alignas(16) float quatZ[Ce_CullingBlockSize];
+        alignas(16) float quatW[Ce_CullingBlockSize];
+
+        alignas(16) float posX[Ce_CullingBlockSize];
+        alignas(16) float posY[Ce_CullingBlockSize];
+        alignas(16) float posZ[Ce_CullingBlockSize];
+        alignas(16) float scale[Ce_CullingBlockSize];
+
+        // LODSelection threshold, written by the test
+        alignas(16) float lodThreshold[Ce_CullingBlockSize];
+    };
+
+    static void GatherBlock(CullingBlock& block, const SurfaceResources& surfaces, const MeshTransform* pTransforms,
+        const RenderObject* pRenders, uint32_t first, uint32_t count)
+    {
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const auto& render = pRenders[first + i];
+            const auto& transform = pTransforms[render.transformId];
+            const auto& surface = surfaces.m_surfaces[render.surfaceId];
+
+            block.centerX[i] = surface.center.x;
+            block.centerY[i] = surface.center.y;
+            block.centerZ[i] = surface.center.z;
+            block.radius[i] = surface.radius;
+
+            block.quatX[i] = transform.orientation.x;
+            block.quatY[i] = transform.orientation.y;
+            block.quatZ[i] = transform.orientation.z;
+            block.quatW[i] = transform.orientation.w;
+
+            block.posX[i] = transform.pos.x;
+            block.posY[i] = transform.pos.y;
+            block.posZ[i] = transform.pos.z;
+            block.scale[i] = transform.scale;
+        }
+
+        // Padding lanes get a harmless transform, their results are masked out
+        for (uint32_t i = count; i < Ce_CullingBlockSize; ++i)
+        {
+            block.centerX[i] = block.centerY[i] = block.centerZ[i] = block.radius[i] = 0.f;
+            block.quatX[i] = block.quatY[i] = block.quatZ[i] = 0.f;
+            block.quatW[i] = 1.f;
+            block.posX[i] = block.posY[i] = block.posZ[i] = 0.f;
+            block.scale[i] = 1.f;
+        }
+    }
+
+    // IsObjectInsideViewFrustum for every object in the block. Returns the visibility bits and writes the LOD thresholds
+    static uint64_t TestBlock(CullingBlock& block, const CameraViewData& view, uint32_t count)
+    {
+        const float* m = view.viewMatrix.data;
+        uint64_t mask = 0;
+
+    #if defined(BLIT_ML_SSE2)
+        __m128 m0 = _mm_set1_ps(m[0]), m1 = _mm_set1_ps(m[1]), m2 = _mm_set1_ps(m[2]);
+        __m128 m4 = _mm_set1_ps(m[4]), m5 = _mm_set1_ps(m[5]), m6 = _mm_set1_ps(m[6]);
+        __m128 m8 = _mm_set1_ps(m[8]), m9 = _mm_set1_ps(m[9]), m10 = _mm_set1_ps(m[10]);
+        __m128 m12 = _mm_set1_ps(m[12]), m13 = _mm_set1_ps(m[13]), m14 = _mm_set1_ps(m[14]);
+        __m128 frustumRight = _mm_set1_ps(view.frustumRight), frustumLeft = _mm_set1_ps(view.frustumLeft);
+        __m128 frustumTop = _mm_set1_ps(view.frustumTop), frustumBottom = _mm_set1_ps(view.frustumBottom);
+        __m128 zNear = _mm_set1_ps(view.zNear), zFar = _mm_set1_ps(view.zFar);
+        __m128 lodTarget = _mm_set1_ps(view.lodTarget);
+        __m128 two = _mm_set1_ps(2.f);
+        __m128 zero = _mm_setzero_ps();
+        __m128 signMask = _mm_set1_ps(-0.f);
+
+        for (uint32_t i = 0; i < count; i += 4)
+        {
+            __m128 vx = _mm_load_ps(block.centerX + i), vy = _mm_load_ps(block.centerY + i), vz = _mm_load_ps(block.centerZ + i);
+            __m128 qx = _mm_load_ps(block.quatX + i), qy = _mm_load_ps(block.quatY + i), qz = _mm_load_ps(block.quatZ + i);
+            __m128 qw = _mm_load_ps(block.quatW + i);
+            __m128 scale = _mm_load_ps(block.scale + i);
+
+            // RotateQuat: v + 2 * cross(q.xyz, cross(q.xyz, v) + q.w * v)
+            __m128 tx = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(qy, vz), _mm_mul_ps(qz, vy)), _mm_mul_ps(qw, vx));
+            __m128 ty = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(qz, vx), _mm_mul_ps(qx, vz)), _mm_mul_ps(qw, vy));
+            __m128 tz = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(qx, vy), _mm_mul_ps(qy, vx)), _mm_mul_ps(qw, vz));
+            __m128 wx = _mm_add_ps(_mm_mul_ps(_mm_add_ps(vx, _mm_mul_ps(two, _mm_sub_ps(_mm_mul_ps(qy, tz), _mm_mul_ps(qz, ty)))), scale), _mm_load_ps(block.posX + i));
+            __m128 wy = _mm_add_ps(_mm_mul_ps(_mm_add_ps(vy, _mm_mul_ps(two, _mm_sub_ps(_mm_mul_ps(qz, tx), _mm_mul_ps(qx, tz)))), scale), _mm_load_ps(block.posY + i));
+            __m128 wz = _mm_add_ps(_mm_mul_ps(_mm_add_ps(vz, _mm_mul_ps(two, _mm_sub_ps(_mm_mul_ps(qx, ty), _mm_mul_ps(qy, tx)))), scale), _mm_load_ps(block.posZ + i));
+
+            // View space
+            __m128 cx = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m0, wx), _mm_mul_ps(wy, m4)), _mm_mul_ps(wz, m8)), m12);
+            __m128 cy = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m1, wx), _mm_mul_ps(wy, m5)), _mm_mul_ps(wz, m9)), m13);
+            __m128 cz = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m2, wx), _mm_mul_ps(wy, m6)), _mm_mul_ps(wz, m10)), m14);
+            __m128 radius = _mm_mul_ps(_mm_load_ps(block.radius + i), scale);
+            __m128 negRadius = _mm_sub_ps(zero, radius);
+
+            __m128 visible = _mm_cmpgt_ps(_mm_sub_ps(_mm_mul_ps(cz, frustumLeft), _mm_mul_ps(_mm_andnot_ps(signMask, cx), frustumRight)), negRadius);
+            visible = _mm_and_ps(visible, _mm_cmpgt_ps(_mm_sub_ps(_mm_mul_ps(cz, frustumBottom), _mm_mul_ps(_mm_andnot_ps(signMask, cy), frustumTop)), negRadius));
+            visible = _mm_and_ps(visible, _mm_cmpgt_ps(_mm_add_ps(cz, radius), zNear));
+            visible = _mm_and_ps(visible, _mm_cmplt_ps(_mm_sub_ps(cz, radius), zFar));
+            mask |= uint64_t(_mm_movemask_ps(visible)) << i;
+
+            __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, cx), _mm_mul_ps(cy, cy)), _mm_mul_ps(cz, cz)));
+            __m128 distance = _mm_max_ps(_mm_sub_ps(length, radius), zero);
+            _mm_store_ps(block.lodThreshold + i, _mm_div_ps(_mm_mul_ps(distance, lodTarget), scale));
+        }
+    #else
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            float vx = block.centerX[i], vy = block.centerY[i], vz = block.centerZ[i];
+            float qx = block.quatX[i], qy = block.quatY[i], qz = block.quatZ[i], qw = block.quatW[i];
+            float scale = block.scale[i];
+
+            float tx = (qy * vz - qz * vy) + qw * vx;
+            float ty = (qz * vx - qx * vz) + qw * vy;
+            float tz = (qx * vy - qy * vx) + qw * vz;
+            float wx = (vx + 2.f * (qy * tz - qz * ty)) * scale + block.posX[i];
+            float wy = (vy + 2.f * (qz * tx - qx * tz)) * scale + block.posY[i];
+            float wz = (vz + 2.f * (qx * ty - qy * tx)) * scale + block.posZ[i];
+
+            float cx = m[0] * wx + wy * m[4] + wz * m[8] + m[12];
+            float cy = m[1] * wx + wy * m[5] + wz * m[9] + m[13];
+            float cz = m[2] * wx + wy * m[6] + wz * m[10] + m[14];
+            float radius = block.radius[i] * scale;
+
+            bool visible = cz * view.frustumLeft - BlitML::Abs(cx) * view.frustumRight > -radius;
+            visible = visible && cz * view.frustumBottom - BlitML::Abs(cy) * view.frustumTop > -radius;
+            visible = visible && cz + radius > view.zNear && cz - radius < view.zFar;
+            mask |= uint64_t(visible) << i;
+
+            float distance = BlitML::Max(BlitML::Sqrt(cx * cx + cy * cy + cz * cz) - radius, 0.f);
+            block.lodThreshold[i] = distance * view.lodTarget / scale;
+        }
+    #endif
+
+        return count == 64 ? mask : mask & ((uint64_t(1) << count) - 1);
+    }
+
+    static uint32_t SelectLod(const SurfaceResources& surfaces, const PrimitiveSurface& surface, float threshold)
+    {
+        uint32_t lodIndex = 0;
+        for (uint32_t i = 1; i < surface.lodCount; ++i)
+        {
+            if (surfaces.m_LODs[surface.lodOffset + i].error < threshold)
+            {
+                lodIndex = i;
+            }
+        }
+        return lodIndex;
+    }
+
+    // Calls onVisible(objectId, blockThreshold) for every visible object in [first, first + count), in order
+    template<typename F>
+    static void CullBatch(const CameraViewData& view, const SurfaceResources& surfaces, const MeshTransform* pTransforms,
+        const RenderObject* pRenders, uint32_t first, uint32_t count, F&& onVisible)
+    {
+        CullingBlock block;
+        for (uint32_t blockStart = first; blockStart < first + count; blockStart += Ce_CullingBlockSize)
+        {
+            uint32_t blockCount = first + count - blockStart;
+            blockCount = blockCount < Ce_CullingBlockSize ? blockCount : Ce_CullingBlockSize;
+
+            GatherBlock(block, surfaces, pTransforms, pRenders, blockStart, blockCount);
+            uint64_t mask = TestBlock(block, view, blockCount);
+            for (uint32_t i = 0; mask != 0; ++i, mask >>= 1)
+            {
+                if (mask & 1)
+                {
+                    onVisible(blockStart + i, block.lodThreshold[i]);
+                }
+            }
+        }
+    }
+
+    // Moves every batch's output (written at the batch's first object) down to a contiguous range
+    template<typename T>
+    static uint32_t CompactBatches(T* pData, const BlitCL::DynamicArray<uint32_t>& batchFirst, const BlitCL::DynamicArray<uint32_t>& batchCounts)
+    {
+        uint32_t total = 0;
+        for (size_t b = 0; b < batchCounts.GetSize(); ++b)
+        {
+            if (total != batchFirst[b])
+            {
+                memmove(pData + total, pData + batchFirst[b], batchCounts[b] * sizeof(T));
+            }
+            total += batchCounts[b];
+        }
+        return total;
+    }
+
+    uint32_t CullRenderObjectRanges(const CameraViewData& view, const SurfaceResources& surfaces, const MeshTransform* pTransforms,
+        const RenderObject* pRenders, const RenderObjectRange* pRanges, uint32_t rangeCount, BlitCL::DynamicArray<IndirectDraw>& draws,
+        CullingStats* pStats /*=nullptr*/)
+    {
+        // Ranges are split into batches, each batch writes its draws from its first slot in the output
+        BlitCL::DynamicArray<RenderObjectRange> batches;
+        BlitCL::DynamicArray<uint32_t> batchFirst;
+        uint32_t objectCount = 0;
+        for (uint32_t r = 0; r < rangeCount; ++r)
+        {
+            for (uint32_t first = 0; first < pRanges[r].count; first += BlitzenCore::Ce_CpuCullingBatchSize)
+            {
+                uint32_t count = pRanges[r].count - first < BlitzenCore::Ce_CpuCullingBatchSize ? pRanges[r].count - first : BlitzenCore::Ce_CpuCullingBatchSize;
+                batches.PushBack(RenderObjectRange{ pRanges[r].first + first, count });
+                batchFirst.PushBack(objectCount);
+                objectCount += count;
+            }
+        }
+
+        draws.Resize(objectCount);
+        if (objectCount == 0)
+        {
+            if (pStats)
+            {
+                *pStats = CullingStats{};
+            }
+            return 0;
+        }
+
+        uint32_t batchCount = uint32_t(batches.GetSize());
+        BlitCL::DynamicArray<uint32_t> batchCounts{ batchCount, 0u };
+        BlitCL::DynamicArray<CullingStats> batchStats{ batchCount, CullingStats{} };
+
+        auto pDraws = draws.Data();
+        BlitzenCore::GetTaskPool().ParallelFor(batchCount, [&](size_t b)
+        {
+            uint32_t outFirst = batchFirst[b];
+            uint32_t drawCount = 0;
+            auto& stats = batchStats[b];
+            CullBatch(view, surfaces, pTransforms, pRenders, batches[b].first, batches[b].count, [&](uint32_t objectId, float threshold)
+            {
+                const auto& surface = surfaces.m_surfaces[pRenders[objectId].surfaceId];
+                uint32_t lodIndex = SelectLod(surfaces, surface, threshold);
+                const auto& lod = surfaces.m_LODs[surface.lodOffset + lodIndex];
+                ++stats.lodHistogram[lodIndex];
+
+                auto& draw = pDraws[outFirst + drawCount++];
+                draw.objectId = objectId;
+                draw.indexCount = lod.indexCount;
+                draw.instanceCount = 1;
+                draw.firstIndex = lod.firstIndex;
+                draw.vertexOffset = 0;
+                draw.firstInstance = 0;
+            });
+            batchCounts[b] = drawCount;
+        });
+
+        uint32_t drawCount = CompactBatches(pDraws, batchFirst, batchCounts);
+        draws.Resize(drawCount);
+
+        if (pStats)
+        {
+            *pStats = CullingStats{};
+            pStats->testedCount = objectCount;
+            pStats->visibleCount = drawCount;
+            for (uint32_t b = 0; b < batchCount; ++b)
+            {
+                for (uint32_t l = 0; l < BlitzenCore::Ce_MaxLodCountPerSurface; ++l)
+                {
+                    pStats->lodHistogram[l] += batchStats[b].lodHistogram[l];
+                }
+            }
+        }
+
+        return drawCount;
+    }
+
+    uint32_t CullRenderObjects(const CameraViewData& view, const SurfaceResources& surfaces, const MeshTransform* pTransforms,
+        const RenderObject* pRenders, uint32_t renderCount, BlitCL::DynamicArray<IndirectDraw>& draws, CullingStats* pStats /*=nullptr*/)
+    {
+        RenderObjectRange range{ 0, renderCount };
+        return CullRenderObjectRanges(view, surfaces, pTransforms, pRenders, &range, 1, draws, pStats);
+    }
+
+    uint32_t CullRenderContainer(const CameraViewData& view, const SurfaceResources& surfaces, const RenderContainer& renders,
+        BlitCL::DynamicArray<IndirectDraw>& draws, CullingStats* pStats /*=nullptr*/)
+    {
+        const auto& bvh = renders.m_staticBvh;
+        if (bvh.m_nodes.GetSize() == 0)
+        {
+            return CullRenderObjects(view, surfaces, renders.m_transforms, renders.m_renders, renders.m_renderCount, draws, pStats);
+        }
+
+        // Dynamic objects, the static nodes that touch the frustum and anything added after the hierarchy was built
+        BlitCL::DynamicArray<RenderObjectRange> ranges;
+        ranges.PushBack(RenderObjectRange{ 0, bvh.m_firstObject });
+        QueryBvhFrustum(bvh, view, ranges);
+        uint32_t bvhEnd = bvh.m_firstObject + bvh.m_objectCount;
+        ranges.PushBack(RenderObjectRange{ bvhEnd, renders.m_renderCount - bvhEnd });
+
+        return CullRenderObjectRanges(view, surfaces, renders.m_transforms, renders.m_renders, ranges.Data(), uint32_t(ranges.GetSize()), draws, pStats);
+    }
+
+    uint32_t CullRenderObjectsForClusters(const CameraViewData& view, const SurfaceResources& surfaces, const MeshTransform* pTransforms,
+        const RenderObject* pRenders, uint32_t renderCount, BlitCL::DynamicArray<ClusterDispatch>& dispatches, CullingStats* pStats /*=nullptr*/)
+    {
+        dispatches.Resize(0);
+        if (renderCount == 0)
+        {
+            return 0;
+        }
+
+        uint32_t batchCount = (renderCount + BlitzenCore::Ce_CpuCullingBatchSize - 1) / BlitzenCore::Ce_CpuCullingBatchSize;
+        BlitCL::DynamicArray<uint32_t> batchFirst{ batchCount };
+        BlitCL::DynamicArray<uint32_t> batchCounts{ batchCount, 0u };
+        BlitCL::DynamicArray<uint32_t> batchDispatchOffsets{ batchCount, 0u };
+        BlitCL::DynamicArray<uint32_t> visibleObjects{ renderCount };
+
+        // Visible objects first, the cluster counts give each batch its range of the output
+        auto pVisible = visibleObjects.Data();
+        BlitzenCore::GetTaskPool().ParallelFor(batchCount, [&](size_t b)
+        {
+            uint32_t first = uint32_t(b) * BlitzenCore::Ce_CpuCullingBatchSize;
+            uint32_t count = renderCount - first < BlitzenCore::Ce_CpuCullingBatchSize ? renderCount - first : BlitzenCore::Ce_CpuCullingBatchSize;
+            batchFirst[b] = first;
+
+            uint32_t visibleCount = 0;
+            uint32_t clusterCount = 0;
+            CullBatch(view, surfaces, pTransforms, pRenders, first, count, [&](uint32_t objectId, float)
+            {
+                pVisible[first + visibleCount++] = objectId;
+                clusterCount += surfaces.m_LODs[surfaces.m_surfaces[pRenders[objectId].surfaceId].lodOffset].clusterCount;
+            });
+            batchCounts[b] = visibleCount;
+            batchDispatchOffsets[b] = clusterCount;
+        });
+
+        uint32_t dispatchCount = 0;
+        for (uint32_t b = 0; b < batchCount; ++b)
+        {
+            uint32_t clusterCount = batchDispatchOffsets[b];
+            batchDispatchOffsets[b] = dispatchCount;
+            dispatchCount += clusterCount;
+        }
+        dispatches.Resize(dispatchCount);
+
+        auto pDispatches = dispatches.Data();
+        BlitzenCore::GetTaskPool().ParallelFor(batchCount, [&](size_t b)
+        {
+            auto pDispatch = pDispatches + batchDispatchOffsets[b];
+            for (uint32_t i = 0; i < batchCounts[b]; ++i)
+            {
+                uint32_t objectId = pVisible[batchFirst[b] + i];
+                uint32_t lodIndex = surfaces.m_surfaces[pRenders[objectId].surfaceId].lodOffset;
+                const auto& lod = surfaces.m_LODs[lodIndex];
+                for (uint32_t c = 0; c < lod.clusterCount; ++c)
+                {
+                    pDispatch->objectId = objectId;
+                    pDispatch->lodIndex = lodIndex;
+                    pDispatch->clusterId = lod.clusterOffset + c;
+                    ++pDispatch;
+                }
+            }
+        });
+
+        if (pStats)
+        {
+            *pStats = CullingStats{};
+            pStats->testedCount = renderCount;
+            for (uint32_t b = 0; b < batchCount; ++b)
+            {
+                pStats->visibleCount += batchCounts[b];
+            }
+        }
+
+        return dispatchCount;
+    }
+}
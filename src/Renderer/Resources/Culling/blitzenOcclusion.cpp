@@ -0,0 +1,350 @@
+#include "blitOcclusion.h"
+#include "Core/Threads/blitTaskPool.h"
+#include <algorithm>
+
+namespace BlitzenEngine
+{
+    struct OccluderCandidate
+    {
+        uint32_t drawId;
+        float screenSize;
+    };
+
+    // Model to view matrix of a transform. Columns are the rotated and scaled basis vectors, same as RotateQuat * scale + pos
+    static BlitML::mat4 GetModelViewMatrix(const CameraViewData& view, const MeshTransform& transform)
+    {
+        const auto& q = transform.orientation;
+        BlitML::vec3 axis{ q.x, q.y, q.z };
+
+        BlitML::mat4 model;
+        for (uint32_t i = 0; i < 3; ++i)
+        {
+            BlitML::vec3 basis{ 0.f };
+            basis.x = i == 0 ? 1.f : 0.f;
+            basis.y = i == 1 ? 1.f : 0.f;
+            basis.z = i == 2 ? 1.f : 0.f;
+            BlitML::vec3 rotated = basis + BlitML::Cross(axis, BlitML::Cross(axis, basis) + basis * q.w) * 2.f;
+            model.data[i * 4 + 0] = rotated.x * transform.scale;
+            model.data[i * 4 + 1] = rotated.y * transform.scale;
+            model.data[i * 4 + 2] = rotated.z * transform.scale;
+        }
+        model.data[12] = transform.pos.x;
+        model.data[13] = transform.pos.y;
+        model.data[14] = transform.pos.z;
+
+        BlitML::mat4 viewMatrix = view.viewMatrix;
+        return viewMatrix * model;
+    }
+
+    static BlitML::vec3 GetViewSpaceCenter(const CameraViewData& view, const PrimitiveSurface& surface, const MeshTransform& transform)
+    {
+        const auto& q = transform.orientation;
+        BlitML::vec3 axis{ q.x, q.y, q.z };
+        BlitML::vec3 rotated = surface.center + BlitML::Cross(axis, BlitML::Cross(axis, surface.center) + surface.center * q.w) * 2.f;
+        BlitML::vec3 world = rotated * transform.scale + transform.pos;
+
+        BlitML::mat4 viewMatrix = view.viewMatrix;
+        return BlitML::ToVec3(viewMatrix * BlitML::vec4{ world, 1.f });
+    }
+
+    // Half space rasterizer, keeps the closest (largest) depth. Vertices are screen x, y and depth
+    static void RasterizeTriangle(float* pDepth, uint32_t width, uint32_t height, const float* v0, const float* v1, const float* v2)
+    {
+        float area = (v1[0] - v0[0]) * (v2[1] - v0[1]) - (v1[1] - v0[1]) * (v2[0] - v0[0]);
+        if (area == 0.f)
+        {
+            return;
+        }
+        // Both windings are drawn, occluders are closed and the closest depth wins anyway
+        if (area < 0.f)
+        {
+            std::swap(v1, v2);
+            area = -area;
+        }
+
+        int32_t minX = int32_t(std::max(std::min({ v0[0], v1[0], v2[0] }), 0.f));
+        int32_t maxX = int32_t(std::min(std::max({ v0[0], v1[0], v2[0] }), float(width - 1)));
+        int32_t minY = int32_t(std::max(std::min({ v0[1], v1[1], v2[1] }), 0.f));
+        int32_t maxY = int32_t(std::min(std::max({ v0[1], v1[1], v2[1] }), float(height - 1)));
+        if (minX > maxX || minY > maxY)
+        {
+            return;
+        }
+        minX &= ~3;
+
+        // Edge i is opposite to vertex i, e(p) = a * x + b * y + c, positive inside
+        float a0 = v1[1] - v2[1], b0 = v2[0] - v1[0], c0 = v1[0] * v2[1] - v1[1] * v2[0];
+        float a1 = v2[1] - v0[1], b1 = v0[0] - v2[0], c1 = v2[0] * v0[1] - v2[1] * v0[0];
+        float a2 = v0[1] - v1[1], b2 = v1[0] - v0[0], c2 = v0[0] * v1[1] - v0[1] * v1[0];
+
+        // zNear / viewZ is linear in screen space
+        float invArea = 1.f / area;
+        float da = (a0 * v0[2] + a1 * v1[2] + a2 * v2[2]) * invArea;
+        float db = (b0 * v0[2] + b1 * v1[2] + b2 * v2[2]) * invArea;
+        float dc = (c0 * v0[2] + c1 * v1[2] + c2 * v2[2]) * invArea;
+
+    #if defined(BLIT_ML_SSE2)
+        __m128 pixelOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+        __m128 zero = _mm_setzero_ps();
+        for (int32_t y = minY; y <= maxY; ++y)
+        {
+            float py = float(y) + 0.5f;
+            __m128 e0Row = _mm_set1_ps(b0 * py + c0), e1Row = _mm_set1_ps(b1 * py + c1), e2Row = _mm_set1_ps(b2 * py + c2);
+            __m128 dRow = _mm_set1_ps(db * py + dc);
+            float* pRow = pDepth + size_t(y) * width;
+            for (int32_t x = minX; x <= maxX; x += 4)
+            {
+                __m128 px = _mm_add_ps(_mm_set1_ps(float(x)), pixelOffsets);
+                __m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(a0), px), e0Row), zero);
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(a1), px), e1Row), zero));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(a2), px), e2Row), zero));
+                if (_mm_movemask_ps(inside) == 0)
+                {
+                    continue;
+                }
+
+                __m128 depth = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(da), px), dRow);
+                __m128 previous = _mm_loadu_ps(pRow + x);
+                depth = _mm_max_ps(previous, depth);
+                _mm_storeu_ps(pRow + x, _mm_or_ps(_mm_and_ps(inside, depth), _mm_andnot_ps(inside, previous)));
+            }
+        }
+    #else
+        for (int32_t y = minY; y <= maxY; ++y)
+        {
+            float py = float(y) + 0.5f;
+            float* pRow = pDepth + size_t(y) * width;
+            for (int32_t x = minX; x <= maxX; ++x)
+            {
+                float px = float(x) + 0.5f;
+                if (a0 * px + b0 * py + c0 >= 0.f && a1 * px + b1 * py + c1 >= 0.f && a2 * px + b2 * py + c2 >= 0.f)
+                {
+                    pRow[x] = std::max(pRow[x], da * px + db * py + dc);
+                }
+            }
+        }
+    #endif
+    }
+
+    // Rasterizes the triangles of a draw. Triangles that cross the near plane are skipped, which only makes the occluder smaller
+    static uint32_t RasterizeOccluder(SoftwareOcclusionBuffer& buffer, const CameraViewData& view, const SurfaceResources& surfaces,
+        const MeshTransform& transform, const IndirectDraw& draw, BlitCL::DynamicArray<BlitML::vec3>& positions)
+    {
+        auto modelView = GetModelViewMatrix(view, transform);
+
+        positions.Resize(draw.indexCount);
+        for (uint32_t i = 0; i < draw.indexCount; ++i)
+        {
+            positions[i] = surfaces.m_vertices[surfaces.m_indices[draw.firstIndex + i]].position;
+        }
+        BlitML::TransformPoints(modelView, positions.Data(), positions.Data(), positions.GetSize());
+
+        float width = float(buffer.m_levelWidths[0]);
+        float height = float(buffer.m_levelHeights[0]);
+        uint32_t triangleCount = 0;
+        for (uint32_t t = 0; t + 2 < draw.indexCount; t += 3)
+        {
+            float screen[3][3];
+            bool bNearClipped = false;
+            for (uint32_t v = 0; v < 3; ++v)
+            {
+                const auto& p = positions[t + v];
+                if (p.z < view.zNear)
+                {
+                    bNearClipped = true;
+                    break;
+                }
+                float invZ = 1.f / p.z;
+                // Same uv convention as projectSphere
+                screen[v][0] = (p.x * view.proj0 * invZ * 0.5f + 0.5f) * width;
+                screen[v][1] = (-p.y * view.proj5 * invZ * 0.5f + 0.5f) * height;
+                screen[v][2] = view.zNear * invZ;
+            }
+            if (bNearClipped)
+            {
+                continue;
+            }
+
+            RasterizeTriangle(buffer.m_pyramid.Data(), buffer.m_levelWidths[0], buffer.m_levelHeights[0], screen[0], screen[1], screen[2]);
+            ++triangleCount;
+        }
+        return triangleCount;
+    }
+
+    static void BuildPyramid(SoftwareOcclusionBuffer& buffer)
+    {
+        for (uint32_t level = 1; level < buffer.m_levelCount; ++level)
+        {
+            const float* pSrc = buffer.m_pyramid.Data() + buffer.m_levelOffsets[level - 1];
+            float* pDst = buffer.m_pyramid.Data() + buffer.m_levelOffsets[level];
+            uint32_t srcWidth = buffer.m_levelWidths[level - 1];
+            uint32_t srcHeight = buffer.m_levelHeights[level - 1];
+            for (uint32_t y = 0; y < buffer.m_levelHeights[level]; ++y)
+            {
+                uint32_t y0 = y * 2;
+                uint32_t y1 = std::min(y0 + 1, srcHeight - 1);
+                for (uint32_t x = 0; x < buffer.m_levelWidths[level]; ++x)
+                {
+                    uint32_t x0 = x * 2;
+                    uint32_t x1 = std::min(x0 + 1, srcWidth - 1);
+                    pDst[y * buffer.m_levelWidths[level] + x] = std::min(std::min(pSrc[y0 * srcWidth + x0], pSrc[y0 * srcWidth + x1]),
+                        std::min(pSrc[y1 * srcWidth + x0], pSrc[y1 * srcWidth + x1]));
+                }
+            }
+        }
+    }
+
+    void BuildSoftwareOcclusion(SoftwareOcclusionBuffer& buffer, const CameraViewData& view, const SurfaceResources& surfaces,
+        const MeshTransform* pTransforms, const RenderObject* pRenders, const IndirectDraw* pDraws, uint32_t drawCount)
+    {
+        // Pyramid layout
+        uint32_t width = BlitzenCore::Ce_SoftwareOcclusionWidth;
+        uint32_t height = BlitzenCore::Ce_SoftwareOcclusionHeight;
+        uint32_t size = 0;
+        buffer.m_levelCount = 0;
+        while (true)
+        {
+            buffer.m_levelOffsets[buffer.m_levelCount] = size;
+            buffer.m_levelWidths[buffer.m_levelCount] = width;
+            buffer.m_levelHeights[buffer.m_levelCount] = height;
+            buffer.m_levelCount++;
+            size += width * height;
+            if (width == 1 && height == 1)
+            {
+                break;
+            }
+            width = std::max(width / 2, 1u);
+            height = std::max(height / 2, 1u);
+        }
+        buffer.m_pyramid.Resize(size);
+        std::fill(buffer.m_pyramid.Data(), buffer.m_pyramid.Data() + size, 0.f);
+        buffer.m_occluderCount = 0;
+        buffer.m_triangleCount = 0;
+
+        // Projected size of every visible object's bounding sphere
+        BlitCL::DynamicArray<float> screenSizes{ drawCount };
+        auto batchCount = (drawCount + BlitzenCore::Ce_CpuCullingBatchSize - 1) / BlitzenCore::Ce_CpuCullingBatchSize;
+        BlitzenCore::GetTaskPool().ParallelFor(batchCount, [&](size_t b)
+        {
+            uint32_t first = uint32_t(b) * BlitzenCore::Ce_CpuCullingBatchSize;
+            uint32_t last = std::min(first + BlitzenCore::Ce_CpuCullingBatchSize, drawCount);
+            for (uint32_t i = first; i < last; ++i)
+            {
+                const auto& render = pRenders[pDraws[i].objectId];
+                const auto& surface = surfaces.m_surfaces[render.surfaceId];
+                const auto& transform = pTransforms[render.transformId];
+                auto center = GetViewSpaceCenter(view, surface, transform);
+                float radius = surface.radius * transform.scale;
+                screenSizes[i] = center.z > radius + view.zNear ? radius * view.proj5 / center.z : 0.f;
+            }
+        });
+
+        BlitCL::DynamicArray<OccluderCandidate> candidates;
+        for (uint32_t i = 0; i < drawCount; ++i)
+        {
+            if (screenSizes[i] >= BlitzenCore::Ce_SoftwareOccluderMinScreenSize && pDraws[i].indexCount != 0)
+            {
+                candidates.PushBack({ i, screenSizes[i] });
+            }
+        }
+        std::sort(candidates.Data(), candidates.Data() + candidates.GetSize(),
+            [](const OccluderCandidate& a, const OccluderCandidate& b) { return a.screenSize > b.screenSize; });
+
+        BlitCL::DynamicArray<BlitML::vec3> positions;
+        for (size_t i = 0; i < candidates.GetSize() && buffer.m_occluderCount < BlitzenCore::Ce_MaxSoftwareOccluders; ++i)
+        {
+            const auto& draw = pDraws[candidates[i].drawId];
+            if (buffer.m_triangleCount + draw.indexCount / 3 > BlitzenCore::Ce_SoftwareOcclusionTriangleBudget)
+            {
+                continue;
+            }
+
+            const auto& transform = pTransforms[pRenders[draw.objectId].transformId];
+            buffer.m_triangleCount += RasterizeOccluder(buffer, view, surfaces, transform, draw, positions);
+            buffer.m_occluderCount++;
+        }
+
+        BuildPyramid(buffer);
+    }
+
+    bool IsSphereOccluded(const SoftwareOcclusionBuffer& buffer, const CameraViewData& view, const BlitML::vec3& c, float r)
+    {
+        // projectSphere, objects that cross the near plane are never occluded
+        if (c.z < r + view.zNear)
+        {
+            return false;
+        }
+        float czr2 = c.z * c.z - r * r;
+        float vx = BlitML::Sqrt(c.x * c.x + czr2);
+        float minx = (vx * c.x - c.z * r) / (vx * c.z + c.x * r);
+        float maxx = (vx * c.x + c.z * r) / (vx * c.z - c.x * r);
+        float vy = BlitML::Sqrt(c.y * c.y + czr2);
+        float miny = (vy * c.y - c.z * r) / (vy * c.z + c.y * r);
+        float maxy = (vy * c.y + c.z * r) / (vy * c.z - c.y * r);
+
+        float u0 = minx * view.proj0 * 0.5f + 0.5f;
+        float u1 = maxx * view.proj0 * 0.5f + 0.5f;
+        float v0 = maxy * view.proj5 * -0.5f + 0.5f;
+        float v1 = miny * view.proj5 * -0.5f + 0.5f;
+
+        // OcclusionCullingPassed, the min sampler reads the 2x2 texels around the center. The level is rounded up (floor in the shader),
+        // so the 2x2 footprint always covers the whole bounds
+        float width = (u1 - u0) * float(buffer.m_levelWidths[0]);
+        float height = (v1 - v0) * float(buffer.m_levelHeights[0]);
+        float levelF = ceilf(log2f(std::max(std::max(width, height), 1.f)));
+        uint32_t level = std::min(uint32_t(levelF), buffer.m_levelCount - 1);
+
+        uint32_t levelWidth = buffer.m_levelWidths[level];
+        uint32_t levelHeight = buffer.m_levelHeights[level];
+        float tx = (u0 + u1) * 0.5f * float(levelWidth) - 0.5f;
+        float ty = (v0 + v1) * 0.5f * float(levelHeight) - 0.5f;
+        int32_t x0 = std::min(std::max(int32_t(floorf(tx)), 0), int32_t(levelWidth - 1));
+        int32_t y0 = std::min(std::max(int32_t(floorf(ty)), 0), int32_t(levelHeight - 1));
+        int32_t x1 = std::min(x0 + 1, int32_t(levelWidth - 1));
+        int32_t y1 = std::min(y0 + 1, int32_t(levelHeight - 1));
+
+        const float* pLevel = buffer.m_pyramid.Data() + buffer.m_levelOffsets[level];
+        float depth = std::min(std::min(pLevel[y0 * levelWidth + x0], pLevel[y0 * levelWidth + x1]),
+            std::min(pLevel[y1 * levelWidth + x0], pLevel[y1 * levelWidth + x1]));
+
+        float depthSphere = view.zNear / (c.z - r);
+        return !(depthSphere > depth);
+    }
+
+    uint32_t SoftwareOcclusionCull(const SoftwareOcclusionBuffer& buffer, const CameraViewData& view, const SurfaceResources& surfaces,
+        const MeshTransform* pTransforms, const RenderObject* pRenders, BlitCL::DynamicArray<IndirectDraw>& draws)
+    {
+        uint32_t drawCount = uint32_t(draws.GetSize());
+        if (buffer.m_occluderCount == 0 || drawCount == 0)
+        {
+            return drawCount;
+        }
+
+        BlitCL::DynamicArray<uint8_t> occluded{ drawCount };
+        auto batchCount = (drawCount + BlitzenCore::Ce_CpuCullingBatchSize - 1) / BlitzenCore::Ce_CpuCullingBatchSize;
+        BlitzenCore::GetTaskPool().ParallelFor(batchCount, [&](size_t b)
+        {
+            uint32_t first = uint32_t(b) * BlitzenCore::Ce_CpuCullingBatchSize;
+            uint32_t last = std::min(first + BlitzenCore::Ce_CpuCullingBatchSize, drawCount);
+            for (uint32_t i = first; i < last; ++i)
+            {
+                const auto& render = pRenders[draws[i].objectId];
+                const auto& surface = surfaces.m_surfaces[render.surfaceId];
+                const auto& transform = pTransforms[render.transformId];
+                auto center = GetViewSpaceCenter(view, surface, transform);
+                occluded[i] = IsSphereOccluded(buffer, view, center, surface.radius * transform.scale);
+            }
+        });
+
+        uint32_t keptCount = 0;
+        for (uint32_t i = 0; i < drawCount; ++i)
+        {
+            if (!occluded[i])
+            {
+                draws[keptCount++] = draws[i];
+            }
+        }
+        draws.Resize(keptCount);
+        return keptCount;
+    }
+}
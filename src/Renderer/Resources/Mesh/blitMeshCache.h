@@ -0,0 +1,41 @@
+#pragma once
+#include <string>
+#include "blitMeshes.h"
+
+namespace BlitzenEngine
+{
+    // Layout of a cooked mesh file: header followed by the surface, vertex, index, lod, cluster and cluster index arrays.
+    // All offsets inside the arrays start at 0, like a private SurfaceResources
+    struct CookedMeshHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t paramsHash;
+        uint64_t sourceHash;
+
+        uint32_t surfaceCount;
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t lodCount;
+        uint32_t clusterCount;
+        uint32_t clusterIndexCount;
+    };
+
+    // FNV-1a, can be chained through the seed
+    uint64_t HashCookedMeshData(const void* pData, size_t size, uint64_t seed = 14695981039346656037ull);
+
+    // Hashes the bytes of a file on disk. Returns 0 if the file could not be read
+    uint64_t HashCookedMeshSourceFile(const char* filepath, uint64_t seed = 14695981039346656037ull);
+
+    // Hash of everything that affects the output of GenerateSurface
+    uint64_t GetCookedMeshParamsHash();
+
+    // Builds the cooked file path for a source asset (source path + Ce_CookedMeshExtension)
+    void GetCookedMeshPath(const char* sourcePath, std::string& cookedPath);
+
+    // Loads the cooked data into an empty container. Returns false on a missing or stale file
+    bool LoadCookedMesh(SurfaceResources& surfaces, const char* cookedPath, uint64_t sourceHash);
+
+    // Writes a 0 based container (as filled by import workers)
+    bool WriteCookedMesh(const SurfaceResources& surfaces, const char* cookedPath, uint64_t sourceHash);
+}
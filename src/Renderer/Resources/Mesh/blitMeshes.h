@@ -5,12 +5,10 @@
 
 namespace BlitzenEngine
 {
-    struct MeshResources
+    // Geometry arrays produced by surface generation.
+    // Import workers fill private instances (with offsets starting at 0), which are then appended to the global MeshResources
+    struct SurfaceResources
     {
-        Mesh m_meshes[BlitzenCore::Ce_MaxMeshCount];
-        BlitCL::HashMap<Mesh> m_meshMap;
-        size_t m_meshCount = 0;
-
         // Mesh has one or more surfaces / Primitives
         BlitCL::DynamicArray<PrimitiveSurface> m_surfaces;
         BlitCL::DynamicArray<IsPrimitiveTransparent> m_bTransparencyList;
@@ -21,30 +19,67 @@ namespace BlitzenEngine
 
         // Lod has one or more clusters (if they are generated)
         BlitCL::DynamicArray<Cluster> m_clusters;
-        // Index buffer for cluster modes
+        // Cluster data, at each cluster's data offset: its vertices (relative to the surface vertex offset),
+        // then its local triangle indices, 8 bits each and packed 4 per element
         BlitCL::DynamicArray<uint32_t> m_clusterIndices;
 
         // Lod and cluster have multiple vertices
         BlitCL::DynamicArray<Vertex> m_vertices;
         BlitCL::DynamicArray<HlslVtx> m_hlslVtxs;
-        // Index buffer for surface / draw modes
+        // Index buffer for surface / draw modes (left empty when Ce_BuildLodIndices is 0)
         BlitCL::DynamicArray<uint32_t> m_indices;
 
         BlitCL::DynamicArray<uint32_t> m_primitiveVertexCounts;
 
+        // Compact geometry (BLIT_COMPACT_VERTICES), generated after loading and shared by the backends. Surfaces loaded later are appended.
+        // Indices are relative to the surface vertex offset and 16 bit, unless a surface has too many vertices
+        BlitCL::DynamicArray<CompactVertex> m_compactVertices;
+        BlitCL::DynamicArray<uint8_t> m_compactIndices;
+        uint32_t m_compactIndexSize{ sizeof(uint32_t) };
+        uint32_t m_compactSurfaceCount{ 0 };
+    };
+
+    struct MeshResources : public SurfaceResources
+    {
+        Mesh m_meshes[BlitzenCore::Ce_MaxMeshCount];
+        BlitCL::HashMap<Mesh> m_meshMap;
+        size_t m_meshCount = 0;
+
+        // Size of the instance index buffer, the sum of every LOD's instance range
+        uint32_t m_lodInstanceIndexCount{ 0 };
+
         bool AddMesh(uint32_t firstSurface, uint32_t surfaceCount, const char* meshName = "BLIT_DO_NOT_ADD_TO_MESH_TABLE");
     };
 
+    // Appends surfaces that were generated into a private (0 based) container, offsets are fixed up to the end of the destination arrays
+    void AppendSurfaces(SurfaceResources& dst, SurfaceResources& src);
+
+    // Every LOD of a surface can hold each render object of the surface, the ranges are packed by a prefix sum of those counts
+    void SetLodInstanceRanges(MeshResources& context, const RenderObject* pRenders, uint32_t renderCount);
+
+    // Parses, optimizes and clusterizes an obj file into a private container (uses the cooked mesh cache when possible). Thread safe
+    bool LoadObjSurfaces(SurfaceResources& surfaces, const char* filename);
+
+    // Parses an obj file into one vertex per index (before remapping), without the cooked mesh cache
+    bool LoadObjTriangleVertices(const char* filename, BlitCL::DynamicArray<Vertex>& triangleVertices);
+
     bool LoadMeshFromObj(MeshResources& context, const char* filename, const char* meshName);
 
+    // Imports the obj files on the task pool. Meshes are added in the order of the arrays
+    bool LoadMeshesFromObj(MeshResources& context, const char* const* filenames, const char* const* meshNames, size_t meshCount);
+
     // Loads a single primitive and adds it to the global array
-    void GenerateSurface(MeshResources& context, BlitCL::DynamicArray<Vertex>& vertices, BlitCL::DynamicArray<uint32_t>& indices);
+    void GenerateSurface(SurfaceResources& context, BlitCL::DynamicArray<Vertex>& vertices, BlitCL::DynamicArray<uint32_t>& indices);
 
     // Generates LODs for the vertices of a given surface
-    void GenerateLODs(MeshResources& context, PrimitiveSurface& surface, BlitCL::DynamicArray<Vertex>& surfaceVertices, BlitCL::DynamicArray<uint32_t>& surfaceIndices);
+    void GenerateLODs(SurfaceResources& context, PrimitiveSurface& surface, BlitCL::DynamicArray<Vertex>& surfaceVertices, BlitCL::DynamicArray<uint32_t>& surfaceIndices);
 
     // Generates clusters for a given array of vertices and indices
-    size_t GenerateClusters(MeshResources& context, BlitCL::DynamicArray<Vertex>& vertices, BlitCL::DynamicArray<uint32_t>& indices, uint32_t vertexOffset);
+    size_t GenerateClusters(SurfaceResources& context, BlitCL::DynamicArray<Vertex>& vertices, BlitCL::DynamicArray<uint32_t>& indices);
+
+    // Builds the cluster DAG of a surface: full detail clusters, then neighbouring clusters are grouped, simplified with locked borders
+    // and clusterized again, level after level. Returns the number of clusters added (every level, in one range)
+    size_t GenerateClusterHierarchy(SurfaceResources& context, BlitCL::DynamicArray<Vertex>& surfaceVertices, BlitCL::DynamicArray<uint32_t>& surfaceIndices);
 
     // Generates bounding sphere for primitive based on given vertices and indices
     void GenerateBoundingSphere(PrimitiveSurface& surface, BlitCL::DynamicArray<Vertex>& surfaceVertices, BlitCL::DynamicArray<uint32_t>& surfaceIndices);
@@ -53,6 +88,10 @@ namespace BlitzenEngine
 
     void GenerateHlslVertices(MeshResources& context);
 
+    // Quantizes the global vertex buffer and converts the indices to surface relative ones. 
+    // Only the surfaces added since the last call are converted, unless their indices need 32 bits and the earlier ones were 16 bit
+    void GenerateCompactVertices(MeshResources& context);
+
     // Tester. Loads kitten, stanford dragon and a male human
     void LoadTestGeometry(MeshResources& context);
 }
\ No newline at end of file
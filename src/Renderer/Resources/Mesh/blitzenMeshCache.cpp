@@ -0,0 +1,201 @@
+#include "blitMeshCache.h"
+#include "Platform/Filesystem/blitCFILE.h"
+
+namespace BlitzenEngine
+{
+    uint64_t HashCookedMeshData(const void* pData, size_t size, uint64_t seed)
+    {
+        constexpr uint64_t prime = 1099511628211ull;
+
+        auto pBytes = reinterpret_cast<const uint8_t*>(pData);
+        uint64_t hash = seed;
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash ^= pBytes[i];
+            hash *= prime;
+        }
+        return hash;
+    }
+
+    uint64_t HashCookedMeshSourceFile(const char* filepath, uint64_t seed)
+    {
+        BlitzenPlatform::C_FILE_SCOPE file;
+        if (!file.Open(filepath, BlitzenPlatform::FileModes::Read, 1))
+        {
+            return 0;
+        }
+
+        // Streams the file in chunks so that large assets are not loaded twice
+        constexpr size_t chunkSize = 64 * 1024;
+        BlitCL::DynamicArray<uint8_t> chunk{ chunkSize };
+        uint64_t hash = seed;
+        size_t bytesRead = 0;
+        while ((bytesRead = fread(chunk.Data(), 1, chunkSize, file.m_pHandle)) != 0)
+        {
+            hash = HashCookedMeshData(chunk.Data(), bytesRead, hash);
+        }
+        return hash;
+    }
+
+    uint64_t GetCookedMeshParamsHash()
+    {
+        struct CookedMeshParams
+        {
+            uint32_t version = BlitzenCore::Ce_CookedMeshVersion;
+            uint32_t bClusters = BlitzenCore::Ce_BuildClusters;
+            uint32_t bLodIndices = BlitzenCore::Ce_BuildLodIndices;
+            uint32_t maxLodCount = BlitzenCore::Ce_MaxLodCountPerSurface;
+            uint32_t clusterMaxVertices = BlitzenCore::Ce_ClusterMaxVertices;
+            uint32_t clusterMaxTriangles = BlitzenCore::Ce_ClusterMaxTriangles;
+            float clusterConeWeight = BlitzenCore::Ce_ClusterConeWeight;
+            uint32_t clusterGroupSize = BlitzenCore::Ce_ClusterGroupSize;
+            float clusterGroupMinReduction = float(BlitzenCore::Ce_ClusterGroupMinReduction);
+            float lodMaxError = BlitzenCore::Ce_LodMaxError;
+            float lodIndexReduction = float(BlitzenCore::Ce_LodIndexReduction);
+
+            uint32_t surfaceSize = sizeof(PrimitiveSurface);
+            uint32_t vertexSize = sizeof(Vertex);
+            uint32_t lodSize = sizeof(LodData);
+            uint32_t clusterSize = sizeof(Cluster);
+        };
+        CookedMeshParams params{};
+        return HashCookedMeshData(&params, sizeof(params));
+    }
+
+    void GetCookedMeshPath(const char* sourcePath, std::string& cookedPath)
+    {
+        cookedPath = sourcePath;
+        cookedPath += BlitzenCore::Ce_CookedMeshExtension;
+    }
+
+    // Reads count elements straight to the end of the array
+    template<typename T>
+    static bool ReadCookedArray(BlitzenPlatform::C_FILE_SCOPE& file, BlitCL::DynamicArray<T>& array, size_t count)
+    {
+        auto previousSize = array.GetSize();
+        if (count == 0)
+        {
+            return true;
+        }
+
+        array.Resize(previousSize + count);
+        return fread(array.Data() + previousSize, sizeof(T), count, file.m_pHandle) == count;
+    }
+
+    template<typename T>
+    static bool WriteCookedArray(BlitzenPlatform::C_FILE_SCOPE& file, const T* pData, size_t count)
+    {
+        if (count == 0)
+        {
+            return true;
+        }
+
+        size_t bytesWritten = 0;
+        return BlitzenPlatform::FilesystemWrite(file, count * sizeof(T), pData, &bytesWritten);
+    }
+
+    bool LoadCookedMesh(SurfaceResources& surfaces, const char* cookedPath, uint64_t sourceHash)
+    {
+        BLIT_ASSERT(surfaces.m_surfaces.GetSize() == 0);
+
+        if (!BlitzenPlatform::FilepathExists(cookedPath))
+        {
+            return false;
+        }
+
+        BlitzenPlatform::C_FILE_SCOPE file;
+        if (!file.Open(cookedPath, BlitzenPlatform::FileModes::Read, 1))
+        {
+            return false;
+        }
+
+        CookedMeshHeader header{};
+        if (fread(&header, sizeof(CookedMeshHeader), 1, file.m_pHandle) != 1)
+        {
+            BLIT_WARN("Cooked mesh file: %s has an invalid header", cookedPath);
+            return false;
+        }
+        if (header.magic != BlitzenCore::Ce_CookedMeshMagic || header.version != BlitzenCore::Ce_CookedMeshVersion ||
+            header.paramsHash != GetCookedMeshParamsHash() || header.sourceHash != sourceHash)
+        {
+            BLIT_INFO("Cooked mesh file: %s is out of date", cookedPath);
+            return false;
+        }
+
+        bool bRead = ReadCookedArray(file, surfaces.m_surfaces, header.surfaceCount) &&
+            ReadCookedArray(file, surfaces.m_vertices, header.vertexCount) &&
+            ReadCookedArray(file, surfaces.m_indices, header.indexCount) &&
+            ReadCookedArray(file, surfaces.m_LODs, header.lodCount) &&
+            ReadCookedArray(file, surfaces.m_clusters, header.clusterCount) &&
+            ReadCookedArray(file, surfaces.m_clusterIndices, header.clusterIndexCount);
+
+        // Leaves the container empty, the caller will fall back to processing the source
+        if (!bRead)
+        {
+            BLIT_WARN("Cooked mesh file: %s is truncated", cookedPath);
+            surfaces.m_surfaces.Resize(0);
+            surfaces.m_vertices.Resize(0);
+            surfaces.m_indices.Resize(0);
+            surfaces.m_LODs.Resize(0);
+            surfaces.m_clusters.Resize(0);
+            surfaces.m_clusterIndices.Resize(0);
+            return false;
+        }
+
+        BLIT_INFO("Loading cooked mesh from file: %s", cookedPath);
+
+        // Per surface bookkeeping that GenerateSurface would have done
+        for (size_t i = 0; i < surfaces.m_LODs.GetSize(); ++i)
+        {
+            surfaces.m_lodInstanceList.PushBack(LodInstanceCounter{});
+        }
+        for (size_t i = 0; i < surfaces.m_surfaces.GetSize(); ++i)
+        {
+            auto vertexEnd = i + 1 < surfaces.m_surfaces.GetSize() ? surfaces.m_surfaces[i + 1].vertexOffset : uint32_t(surfaces.m_vertices.GetSize());
+            surfaces.m_primitiveVertexCounts.PushBack(vertexEnd);
+            surfaces.m_bTransparencyList.PushBack({ false });
+        }
+
+        return true;
+    }
+
+    bool WriteCookedMesh(const SurfaceResources& surfaces, const char* cookedPath, uint64_t sourceHash)
+    {
+        CookedMeshHeader header{};
+        header.magic = BlitzenCore::Ce_CookedMeshMagic;
+        header.version = BlitzenCore::Ce_CookedMeshVersion;
+        header.paramsHash = GetCookedMeshParamsHash();
+        header.sourceHash = sourceHash;
+        header.surfaceCount = uint32_t(surfaces.m_surfaces.GetSize());
+        header.vertexCount = uint32_t(surfaces.m_vertices.GetSize());
+        header.indexCount = uint32_t(surfaces.m_indices.GetSize());
+        header.lodCount = uint32_t(surfaces.m_LODs.GetSize());
+        header.clusterCount = uint32_t(surfaces.m_clusters.GetSize());
+        header.clusterIndexCount = uint32_t(surfaces.m_clusterIndices.GetSize());
+
+        BlitzenPlatform::C_FILE_SCOPE file;
+        if (!file.Open(cookedPath, BlitzenPlatform::FileModes::Write, 1))
+        {
+            BLIT_WARN("Failed to create cooked mesh file: %s", cookedPath);
+            return false;
+        }
+
+        bool bWritten = WriteCookedArray(file, &header, 1) &&
+            WriteCookedArray(file, surfaces.m_surfaces.Data(), header.surfaceCount) &&
+            WriteCookedArray(file, surfaces.m_vertices.Data(), header.vertexCount) &&
+            WriteCookedArray(file, surfaces.m_indices.Data(), header.indexCount) &&
+            WriteCookedArray(file, surfaces.m_LODs.Data(), header.lodCount) &&
+            WriteCookedArray(file, surfaces.m_clusters.Data(), header.clusterCount) &&
+            WriteCookedArray(file, surfaces.m_clusterIndices.Data(), header.clusterIndexCount);
+        if (!bWritten)
+        {
+            // A partial file would fail the header check anyway, but it should not stay around
+            file.Close();
+            remove(cookedPath);
+            BLIT_WARN("Failed to write cooked mesh file: %s", cookedPath);
+            return false;
+        }
+
+        return true;
+    }
+}
@@ -1,4 +1,11 @@
 #include "blitMeshes.h"
+#include "blitMeshCache.h"
+#include "Core/Threads/blitTaskPool.h"
+#include "BlitCL/blitArray.h"
+#include "Core/DbLog/blitProfiler.h"
+#include <cfloat>
+#include <cstring>
+#include <algorithm>
 // Algorithms for building meshlets, loading LODs, optimizing vertex caches etc.
 // https://github.com/zeux/meshoptimizer
 #include "Meshoptimizer/meshoptimizer.h"
@@ -26,7 +33,7 @@ namespace BlitzenEngine
 
         m_meshCount++;
 
-		if (meshName != "BLIT_DO_NOT_ADD_TO_MESH_TABLE")
+		if (strcmp(meshName, "BLIT_DO_NOT_ADD_TO_MESH_TABLE") != 0)
 		{
 			m_meshMap.Insert(meshName, mesh);
 		}
@@ -34,20 +41,116 @@ namespace BlitzenEngine
         return true;
     }
 
-    bool LoadMeshFromObj(MeshResources& context, const char* filename, const char* meshName)
+    void SetLodInstanceRanges(MeshResources& context, const RenderObject* pRenders, uint32_t renderCount)
     {
-        // The function should return if the engine will go over the max allowed mesh assets
-        if (context.m_meshCount > BlitzenCore::Ce_MaxMeshCount)
+        BlitCL::DynamicArray<uint32_t> surfaceRenderCounts{ context.m_surfaces.GetSize(), 0u };
+        for (uint32_t i = 0; i < renderCount; ++i)
         {
-            BLIT_ERROR("Max mesh count: ( %i ) reached!", BlitzenCore::Ce_MaxMeshCount);
-            return 0;
+            surfaceRenderCounts[pRenders[i].surfaceId]++;
+        }
+
+        uint32_t instanceOffset = 0;
+        for (size_t i = 0; i < context.m_surfaces.GetSize(); ++i)
+        {
+            const auto& surface = context.m_surfaces[i];
+            for (auto lod = surface.lodOffset; lod < surface.lodOffset + surface.lodCount; ++lod)
+            {
+                auto& counter = context.m_lodInstanceList[lod];
+                counter.instanceOffset = instanceOffset;
+                counter.instanceCapacity = surfaceRenderCounts[i];
+                instanceOffset += surfaceRenderCounts[i];
+            }
         }
+        context.m_lodInstanceIndexCount = instanceOffset;
+    }
+
+    void AppendSurfaces(SurfaceResources& dst, SurfaceResources& src)
+    {
+        auto vertexBase = uint32_t(dst.m_vertices.GetSize());
+        auto indexBase = uint32_t(dst.m_indices.GetSize());
+        auto lodBase = uint32_t(dst.m_LODs.GetSize());
+        auto clusterBase = uint32_t(dst.m_clusters.GetSize());
+        auto clusterIndexBase = uint32_t(dst.m_clusterIndices.GetSize());
+
+        for (auto& surface : src.m_surfaces)
+        {
+            surface.vertexOffset += vertexBase;
+            surface.lodOffset += lodBase;
+        }
+        for (auto& lod : src.m_LODs)
+        {
+            lod.firstIndex += indexBase;
+            lod.clusterOffset += clusterBase;
+        }
+        for (auto& cluster : src.m_clusters)
+        {
+            cluster.dataOffset += clusterIndexBase;
+        }
+        for (auto& index : src.m_indices)
+        {
+            index += vertexBase;
+        }
+        for (auto& count : src.m_primitiveVertexCounts)
+        {
+            count += vertexBase;
+        }
+
+        dst.m_surfaces.AppendArray(src.m_surfaces);
+        dst.m_bTransparencyList.AppendArray(src.m_bTransparencyList);
+        dst.m_LODs.AppendArray(src.m_LODs);
+        dst.m_lodInstanceList.AppendArray(src.m_lodInstanceList);
+        dst.m_clusters.AppendArray(src.m_clusters);
+        dst.m_clusterIndices.AppendArray(src.m_clusterIndices);
+        dst.m_vertices.AppendArray(src.m_vertices);
+        dst.m_indices.AppendArray(src.m_indices);
+        dst.m_primitiveVertexCounts.AppendArray(src.m_primitiveVertexCounts);
+    }
+
+    bool LoadObjSurfaces(SurfaceResources& surfaces, const char* filename)
+    {
+        BLIT_PROFILE_FUNCTION();
 
         BLIT_INFO("Loading obj model form file: %s", filename);
 
-        // Get the current mesh and give it the size surface array as its first surface index
-        uint32_t previousSurfaceCount{ (uint32_t)context.m_surfaces.GetSize() };
+        // Skips parsing and meshoptimizer processing if the file was cooked with the same source and parameters
+        std::string cookedPath;
+        GetCookedMeshPath(filename, cookedPath);
+        auto sourceHash = HashCookedMeshSourceFile(filename);
+        if (sourceHash && LoadCookedMesh(surfaces, cookedPath.c_str(), sourceHash))
+        {
+            return 1;
+        }
 
+        BlitCL::DynamicArray<Vertex> triangleVertices;
+        if (!LoadObjTriangleVertices(filename, triangleVertices))
+        {
+            return 0;
+        }
+        size_t indexCount = triangleVertices.GetSize();
+
+        // Creates indices for the obj's vertices using meshopt
+        BlitCL::DynamicArray<uint32_t> remap(indexCount);
+        size_t vertexCount = meshopt_generateVertexRemap(remap.Data(), 0, indexCount, triangleVertices.Data(), indexCount, sizeof(Vertex));
+        BlitCL::DynamicArray<uint32_t> indices(indexCount);
+        BlitCL::DynamicArray<Vertex> vertices(vertexCount);
+        meshopt_remapVertexBuffer(vertices.Data(), triangleVertices.Data(), indexCount, sizeof(Vertex), remap.Data());
+        meshopt_remapIndexBuffer(indices.Data(), 0, indexCount, remap.Data());
+
+        GenerateTangents(vertices, indices);
+
+        BLIT_INFO("Creating surface");
+        GenerateSurface(surfaces, vertices, indices);
+
+        if (sourceHash)
+        {
+            WriteCookedMesh(surfaces, cookedPath.c_str(), sourceHash);
+        }
+
+        return 1;
+    }
+
+    bool LoadObjTriangleVertices(const char* filename, BlitCL::DynamicArray<Vertex>& triangleVertices)
+    {
         ObjFile file;
         if (!objParseFile(file, filename))
         {
@@ -56,7 +159,9 @@ namespace BlitzenEngine
 
         size_t indexCount = file.f_size / 3;
 
-        BlitCL::DynamicArray<Vertex> triangleVertices(indexCount);
+        triangleVertices.Resize(indexCount);
+        // Unused bytes take part in the vertex remap comparison, zeroed so that results do not depend on garbage
+        BlitzenCore::BlitZeroMemory(triangleVertices.Data(), indexCount);
 
         BLIT_INFO("Loading vertices and indices");
 
@@ -76,9 +181,9 @@ namespace BlitzenEngine
             float normalX = vertexNormalIndex < 0 ? 0.f : file.vn[vertexNormalIndex * 3 + 0];
             float normalY = vertexNormalIndex < 0 ? 0.f : file.vn[vertexNormalIndex * 3 + 1];
             float normalZ = vertexNormalIndex < 0 ? 1.f : file.vn[vertexNormalIndex * 3 + 2];
-            vtx.normalX = static_cast<uint8_t>(normalX * 127.f + 127.5f);
-            vtx.normalY = static_cast<uint8_t>(normalY * 127.f + 127.5f);
-            vtx.normalZ = static_cast<uint8_t>(normalZ * 127.f + 127.5f);
+            vtx.normalX = EncodeVertexUnorm8(normalX);
+            vtx.normalY = EncodeVertexUnorm8(normalY);
+            vtx.normalZ = EncodeVertexUnorm8(normalZ);
 
             vtx.tangentX = vtx.tangentY = vtx.tangentZ = 127;
             vtx.tangentW = 254;
@@ -87,41 +192,96 @@ namespace BlitzenEngine
             vtx.uvY = vertexTextureIndex < 0 ? 0.f : file.vt[vertexTextureIndex * 3 + 1];
         }
 
-        // Creates indices for the obj's vertices using meshopt
-        BlitCL::DynamicArray<uint32_t> remap(indexCount);
-        size_t vertexCount = meshopt_generateVertexRemap(remap.Data(), 0, indexCount, triangleVertices.Data(), indexCount, sizeof(Vertex));
-        BlitCL::DynamicArray<uint32_t> indices(indexCount);
-        BlitCL::DynamicArray<Vertex> vertices(vertexCount);
-        meshopt_remapVertexBuffer(vertices.Data(), triangleVertices.Data(), indexCount, sizeof(Vertex), remap.Data());
-        meshopt_remapIndexBuffer(indices.Data(), 0, indexCount, remap.Data());
+        return 1;
+    }
 
-        GenerateTangents(vertices, indices);
+    bool LoadMeshFromObj(MeshResources& context, const char* filename, const char* meshName)
+    {
+        // The function should return if the engine will go over the max allowed mesh assets
+        if (context.m_meshCount >= BlitzenCore::Ce_MaxMeshCount)
+        {
+            BLIT_ERROR("Max mesh count: ( %i ) reached!", BlitzenCore::Ce_MaxMeshCount);
+            return 0;
+        }
 
-        BLIT_INFO("Creating surface");
-        GenerateSurface(context, vertices, indices);
+        SurfaceResources surfaces;
+        if (!LoadObjSurfaces(surfaces, filename))
+        {
+            return 0;
+        }
 
-        context.AddMesh(previousSurfaceCount, uint32_t(context.m_surfaces.GetSize() - previousSurfaceCount), meshName);
+        // Get the current mesh and give it the size surface array as its first surface index
+        uint32_t previousSurfaceCount{ (uint32_t)context.m_surfaces.GetSize() };
+        AppendSurfaces(context, surfaces);
 
-        return 1;
+        return context.AddMesh(previousSurfaceCount, uint32_t(context.m_surfaces.GetSize() - previousSurfaceCount), meshName);
     }
 
-    void GenerateSurface(MeshResources& context, BlitCL::DynamicArray<Vertex>& surfaceVertices, BlitCL::DynamicArray<uint32_t>& surfaceIndices)
+    bool LoadMeshesFromObj(MeshResources& context, const char* const* filenames, const char* const* meshNames, size_t meshCount)
     {
+        if (context.m_meshCount + meshCount > BlitzenCore::Ce_MaxMeshCount)
+        {
+            BLIT_ERROR("Max mesh count: ( %i ) reached!", BlitzenCore::Ce_MaxMeshCount);
+            return 0;
+        }
+
+        // Every file is imported by a worker into its own container (constructed in place, dynamic array does not call constructors)
+        BlitCL::DynamicArray<SurfaceResources> results{ meshCount };
+        BlitCL::DynamicArray<uint8_t> loaded{ meshCount, 0 };
+        for (size_t i = 0; i < meshCount; ++i)
+        {
+            new (&results[i]) SurfaceResources{};
+        }
+        BlitzenCore::GetTaskPool().ParallelFor(meshCount, [&](size_t i)
+            {
+                loaded[i] = LoadObjSurfaces(results[i], filenames[i]);
+            });
+
+        // Committed in the order of the arguments, so surface and mesh ids do not depend on thread timing
+        bool bAllLoaded = true;
+        for (size_t i = 0; i < meshCount; ++i)
+        {
+            if (!loaded[i])
+            {
+                BLIT_ERROR("Failed to load obj file: %s", filenames[i]);
+                bAllLoaded = false;
+                continue;
+            }
+
+            auto previousSurfaceCount = uint32_t(context.m_surfaces.GetSize());
+            AppendSurfaces(context, results[i]);
+            bAllLoaded = context.AddMesh(previousSurfaceCount, uint32_t(context.m_surfaces.GetSize() - previousSurfaceCount), meshNames[i]) && bAllLoaded;
+        }
+
+        return bAllLoaded;
+    }
+
+    void GenerateSurface(SurfaceResources& context, BlitCL::DynamicArray<Vertex>& surfaceVertices, BlitCL::DynamicArray<uint32_t>& surfaceIndices)
+    {
+        BLIT_PROFILE_FUNCTION();
+
         // Optimize vertices and indices using meshoptimizer
-        meshopt_optimizeVertexCache(surfaceIndices.Data(), surfaceIndices.Data(), surfaceIndices.GetSize(), surfaceVertices.GetSize());
-        meshopt_optimizeVertexFetch(surfaceVertices.Data(), surfaceIndices.Data(), surfaceIndices.GetSize(), surfaceVertices.Data(),
-            surfaceVertices.GetSize(), sizeof(Vertex));
+        {
+            BLIT_PROFILE_ZONE("OptimizeVertexCache");
+            meshopt_optimizeVertexCache(surfaceIndices.Data(), surfaceIndices.Data(), surfaceIndices.GetSize(), surfaceVertices.GetSize());
+        }
+        {
+            BLIT_PROFILE_ZONE("OptimizeVertexFetch");
+            meshopt_optimizeVertexFetch(surfaceVertices.Data(), surfaceIndices.Data(), surfaceIndices.GetSize(), surfaceVertices.Data(),
+                surfaceVertices.GetSize(), sizeof(Vertex));
+        }
 
         PrimitiveSurface newSurface{};
         newSurface.vertexOffset = uint32_t(context.m_vertices.GetSize());
         context.m_vertices.AppendArray(surfaceVertices);
 
-        BLIT_INFO("Generating LODs");
-        GenerateLODs(context, newSurface, surfaceVertices, surfaceIndices);
-
+        // The cluster DAG bounds are measured from the surface center
         BLIT_INFO("Generating bounding sphere");
         GenerateBoundingSphere(newSurface, surfaceVertices, surfaceIndices);
 
+        BLIT_INFO("Generating LODs");
+        GenerateLODs(context, newSurface, surfaceVertices, surfaceIndices);
+
         // TODO: Add logic for material without relying on gltf
         newSurface.materialId = 0;
 
@@ -133,14 +293,16 @@ namespace BlitzenEngine
         context.m_bTransparencyList.PushBack({ false });
     }
 
-    void GenerateLODs(MeshResources& context, PrimitiveSurface& surface, BlitCL::DynamicArray<Vertex>& surfaceVertices, BlitCL::DynamicArray<uint32_t>& surfaceIndices)
+    void GenerateLODs(SurfaceResources& context, PrimitiveSurface& surface, BlitCL::DynamicArray<Vertex>& surfaceVertices, BlitCL::DynamicArray<uint32_t>& surfaceIndices)
     {
+        BLIT_PROFILE_FUNCTION();
+
         // Automatic LOD generation helpers
         BlitCL::DynamicArray<BlitML::vec3> normals{ surfaceVertices.GetSize() };
         for (size_t i = 0; i < surfaceVertices.GetSize(); ++i)
         {
             auto& v = surfaceVertices[i];
-            normals[i] = BlitML::vec3(v.normalX / 127.f - 1.f, v.normalY / 127.f - 1.f, v.normalZ / 127.f - 1.f);
+            normals[i] = BlitML::vec3(DecodeVertexUnorm8(v.normalX), DecodeVertexUnorm8(v.normalY), DecodeVertexUnorm8(v.normalZ));
         }
         float lodScale = meshopt_simplifyScale(&surfaceVertices[0].position.x, surfaceVertices.GetSize(), sizeof(Vertex));
         float lodError = 0.f;
@@ -155,30 +317,51 @@ namespace BlitzenEngine
         {
             surface.lodCount++;
 
-            // Instancing
-            LodInstanceCounter lodInstanceCounter{};
-            lodInstanceCounter.instanceOffset = uint32_t(context.m_LODs.GetSize() * BlitzenCore::Ce_MaxInstanceCountPerLOD);
-            context.m_lodInstanceList.PushBack(lodInstanceCounter);
+            // Instancing, the range is set once the render objects are known
+            context.m_lodInstanceList.PushBack(LodInstanceCounter{});
 
             LodData lod{};
-            lod.firstIndex = static_cast<uint32_t>(context.m_indices.GetSize() + allLodIndices.GetSize());
-            lod.indexCount = static_cast<uint32_t>(lodIndices.GetSize());
+            if constexpr (BlitzenCore::Ce_BuildLodIndices)
+            {
+                lod.firstIndex = static_cast<uint32_t>(context.m_indices.GetSize() + allLodIndices.GetSize());
+                lod.indexCount = static_cast<uint32_t>(lodIndices.GetSize());
+            }
 
-            // TODO: Might want to make LODs include one or the other, indices and clusters are not used together
+            // Clusters do not use the discrete levels, the first LOD holds the whole cluster DAG of the surface
             lod.clusterOffset = static_cast<uint32_t>(context.m_clusters.GetSize());
-            lod.clusterCount = BlitzenCore::Ce_BuildClusters ? static_cast<uint32_t>(GenerateClusters(context, surfaceVertices, lodIndices, surface.vertexOffset)) : 0;
+            if (BlitzenCore::Ce_BuildClusters && surface.lodCount == 1)
+            {
+                lod.clusterCount = static_cast<uint32_t>(GenerateClusterHierarchy(context, surfaceVertices, lodIndices));
+
+                // Encloses every DAG sphere, so the object's distance bounds the distance of each cluster's error test
+                for (auto i = lod.clusterOffset; i < lod.clusterOffset + lod.clusterCount; ++i)
+                {
+                    const auto& cluster = context.m_clusters[i];
+                    lod.clusterBoundsRadius = BlitML::Max(lod.clusterBoundsRadius, 
+                        BlitML::Distance(surface.center, cluster.lodCenter) + cluster.lodRadius);
+                }
+            }
 
             lod.error = lodError * lodScale;
             context.m_LODs.PushBack(lod);
 
             // Adds current lod indices
-            allLodIndices.AppendArray(lodIndices);
+            if constexpr (BlitzenCore::Ce_BuildLodIndices)
+            {
+                allLodIndices.AppendArray(lodIndices);
+            }
+
+            // Discrete levels are only needed by the index stream
+            if constexpr (!BlitzenCore::Ce_BuildLodIndices)
+            {
+                break;
+            }
 
             // Starts generating the next level of detail
             if (surface.lodCount < BlitzenCore::Ce_MaxLodCountPerSurface)
             {
-                auto nextIndicesTarget = static_cast<size_t>((double(lodIndices.GetSize()) * 0.65) / 3) * 3;
-                const float maxError = 1e-1f;
+                auto nextIndicesTarget = static_cast<size_t>((double(lodIndices.GetSize()) * BlitzenCore::Ce_LodIndexReduction) / 3) * 3;
+                const float maxError = BlitzenCore::Ce_LodMaxError;
                 float nextError = 0.f;
 
                 // Gets the size of the next level of detail
@@ -227,11 +410,13 @@ namespace BlitzenEngine
     }
 
     // Loads cluster using the meshoptimizer library
-    size_t GenerateClusters(MeshResources& context, BlitCL::DynamicArray<Vertex>& inVertices, BlitCL::DynamicArray<uint32_t>& inIndices, uint32_t vertexOffset)
+    size_t GenerateClusters(SurfaceResources& context, BlitCL::DynamicArray<Vertex>& inVertices, BlitCL::DynamicArray<uint32_t>& inIndices)
     {
-        const size_t maxVertices = 64;
-        const size_t maxTriangles = 124;
-        const float coneWeight = 0.25f;
+        BLIT_PROFILE_FUNCTION();
+
+        const size_t maxVertices = BlitzenCore::Ce_ClusterMaxVertices;
+        const size_t maxTriangles = BlitzenCore::Ce_ClusterMaxTriangles;
+        const float coneWeight = BlitzenCore::Ce_ClusterConeWeight;
 
         BlitCL::DynamicArray<meshopt_Meshlet> akMeshlets{ meshopt_buildMeshletsBound(inIndices.GetSize(), maxVertices, maxTriangles) };
         BlitCL::DynamicArray<unsigned int> meshletVertices{ akMeshlets.GetSize() * maxVertices };
@@ -249,31 +434,23 @@ namespace BlitzenEngine
                 &meshletTriangles[meshlet.triangle_offset],
                 meshlet.triangle_count, meshlet.vertex_count);
 
-            /*auto dataOffset = m_clusterIndices.GetSize();
-            for(unsigned int i = 0; i < meshlet.vertex_count; ++i)
+            // Meshlet vertex list (relative to the surface), followed by the local triangle indices packed 4 per uint
+            auto dataOffset = context.m_clusterIndices.GetSize();
+            for (unsigned int v = 0; v < meshlet.vertex_count; ++v)
             {
-                m_clusterIndices.PushBack(meshletVertices[meshlet.vertex_offset + i]);
+                context.m_clusterIndices.PushBack(meshletVertices[meshlet.vertex_offset + v]);
             }
-            auto indexGroups = reinterpret_cast<unsigned int*>(
-                &meshletTriangles[0] + meshlet.triangle_offset);
-            unsigned int indexGroupCount = meshlet.triangle_count * 3;
-            for(unsigned int i = 0; i < indexGroupCount; ++i)
-            {
-                m_clusterIndices.PushBack(indexGroups[size_t(i)]);
-            }*/
 
-            const unsigned int* vertexLookup = &meshletVertices[meshlet.vertex_offset];
             const unsigned char* triangles = &meshletTriangles[meshlet.triangle_offset];
-            auto dataOffset = context.m_clusterIndices.GetSize();
-            for (unsigned int t = 0; t < meshlet.triangle_count; ++t)
+            unsigned int cornerCount = meshlet.triangle_count * 3;
+            for (unsigned int c = 0; c < cornerCount; c += 4)
             {
-                // Each triangle has 3 indices into the local meshlet vertex array
-                for (int j = 0; j < 3; ++j)
+                uint32_t packed = 0;
+                for (unsigned int j = 0; j < 4 && c + j < cornerCount; ++j)
                 {
-                    unsigned int localIndex = triangles[t * 3 + j];
-                    unsigned int globalIndex = vertexLookup[localIndex] + vertexOffset;
-                    context.m_clusterIndices.PushBack(globalIndex);
+                    packed |= uint32_t(triangles[c + j]) << (j * 8);
                 }
+                context.m_clusterIndices.PushBack(packed);
             }
 
             auto bounds = meshopt_computeMeshletBounds(&meshletVertices[meshlet.vertex_offset],
@@ -291,14 +468,265 @@ namespace BlitzenEngine
             cluster.coneAxisZ = bounds.cone_axis_s8[2];
             cluster.coneCutoff = bounds.cone_cutoff_s8;
 
+            // A lone cluster is its own full detail root, GenerateClusterHierarchy overwrites this
+            cluster.lodError = 0.f;
+            cluster.lodCenter = cluster.center;
+            cluster.lodRadius = cluster.radius;
+            cluster.parentCenter = cluster.center;
+            cluster.parentRadius = cluster.radius;
+            cluster.parentError = FLT_MAX;
+
             context.m_clusters.PushBack(cluster);
         }
 
         return akMeshlets.GetSize();
     }
 
+    // Appends the triangles of a cluster as indices into the surface vertices
+    static void GetClusterTriangles(const SurfaceResources& context, const Cluster& cluster, BlitCL::DynamicArray<uint32_t>& indices)
+    {
+        const uint32_t* pVertices = &context.m_clusterIndices[cluster.dataOffset];
+        const uint32_t* pTriangles = pVertices + cluster.vertexCount;
+        for (uint32_t c = 0; c < uint32_t(cluster.triangleCount) * 3; ++c)
+        {
+            auto localIndex = (pTriangles[c / 4] >> ((c % 4) * 8)) & 0xFF;
+            indices.PushBack(pVertices[localIndex]);
+        }
+    }
+
+    // Grows sphere (center, radius) so that it encloses the other sphere
+    static void MergeBoundingSpheres(BlitML::vec3& center, float& radius, const BlitML::vec3& otherCenter, float otherRadius)
+    {
+        auto distance = BlitML::Distance(center, otherCenter);
+        if (distance + otherRadius <= radius)
+        {
+            return;
+        }
+        if (distance + radius <= otherRadius)
+        {
+            center = otherCenter;
+            radius = otherRadius;
+            return;
+        }
+
+        auto newRadius = (distance + radius + otherRadius) * 0.5f;
+        center = center + (otherCenter - center) * ((newRadius - radius) / distance);
+        radius = newRadius;
+    }
+
+    // Greedy partition of clusters into groups of up to Ce_ClusterGroupSize neighbours (clusters that share vertex positions).
+    // Writes the cluster ids ordered by group and the first element of each group (plus one past the end)
+    static void PartitionClusters(const SurfaceResources& context, const BlitCL::DynamicArray<uint32_t>& clusterIds, 
+        const BlitCL::DynamicArray<uint32_t>& positionRemap, BlitCL::DynamicArray<uint32_t>& groupedIds, BlitCL::DynamicArray<uint32_t>& groupOffsets)
+    {
+        auto clusterCount = clusterIds.GetSize();
+        auto vertexCount = positionRemap.GetSize();
+
+        // Vertex position to pending cluster table, in compressed rows
+        BlitCL::DynamicArray<uint32_t> vertexClusterOffsets{ vertexCount + 1, 0u };
+        for (size_t i = 0; i < clusterCount; ++i)
+        {
+            const auto& cluster = context.m_clusters[clusterIds[i]];
+            for (uint32_t v = 0; v < cluster.vertexCount; ++v)
+            {
+                vertexClusterOffsets[positionRemap[context.m_clusterIndices[cluster.dataOffset + v]] + 1]++;
+            }
+        }
+        for (size_t v = 0; v < vertexCount; ++v)
+        {
+            vertexClusterOffsets[v + 1] += vertexClusterOffsets[v];
+        }
+        BlitCL::DynamicArray<uint32_t> vertexClusters{ vertexClusterOffsets[vertexCount] };
+        BlitCL::DynamicArray<uint32_t> vertexClusterFill{ vertexCount, 0u };
+        for (size_t i = 0; i < clusterCount; ++i)
+        {
+            const auto& cluster = context.m_clusters[clusterIds[i]];
+            for (uint32_t v = 0; v < cluster.vertexCount; ++v)
+            {
+                auto position = positionRemap[context.m_clusterIndices[cluster.dataOffset + v]];
+                vertexClusters[vertexClusterOffsets[position] + vertexClusterFill[position]++] = uint32_t(i);
+            }
+        }
+
+        // Shared vertex count between the current group and every candidate
+        BlitCL::DynamicArray<uint32_t> weights{ clusterCount, 0u };
+        BlitCL::DynamicArray<uint8_t> grouped{ clusterCount, uint8_t(0) };
+        BlitCL::DynamicArray<uint32_t> candidates;
+        groupedIds.Resize(0);
+        groupOffsets.Resize(0);
+
+        for (size_t seed = 0; seed < clusterCount; ++seed)
+        {
+            if (grouped[seed])
+            {
+                continue;
+            }
+            groupOffsets.PushBack(uint32_t(groupedIds.GetSize()));
+            candidates.Resize(0);
+
+            auto member = uint32_t(seed);
+            for (uint32_t groupSize = 0; groupSize < BlitzenCore::Ce_ClusterGroupSize; ++groupSize)
+            {
+                grouped[member] = 1;
+                groupedIds.PushBack(clusterIds[member]);
+
+                // Every unassigned cluster that touches the new member becomes a better candidate
+                const auto& cluster = context.m_clusters[clusterIds[member]];
+                for (uint32_t v = 0; v < cluster.vertexCount; ++v)
+                {
+                    auto position = positionRemap[context.m_clusterIndices[cluster.dataOffset + v]];
+                    for (uint32_t i = vertexClusterOffsets[position]; i < vertexClusterOffsets[position + 1]; ++i)
+                    {
+                        auto neighbour = vertexClusters[i];
+                        if (!grouped[neighbour])
+                        {
+                            if (weights[neighbour]++ == 0)
+                            {
+                                candidates.PushBack(neighbour);
+                            }
+                        }
+                    }
+                }
+
+                uint32_t best = UINT32_MAX;
+                uint32_t bestWeight = 0;
+                for (auto candidate : candidates)
+                {
+                    if (!grouped[candidate] && weights[candidate] > bestWeight)
+                    {
+                        best = candidate;
+                        bestWeight = weights[candidate];
+                    }
+                }
+                if (best == UINT32_MAX)
+                {
+                    break;
+                }
+                member = best;
+            }
+
+            for (auto candidate : candidates)
+            {
+                weights[candidate] = 0;
+            }
+        }
+        groupOffsets.PushBack(uint32_t(groupedIds.GetSize()));
+    }
+
+    size_t GenerateClusterHierarchy(SurfaceResources& context, BlitCL::DynamicArray<Vertex>& surfaceVertices, BlitCL::DynamicArray<uint32_t>& surfaceIndices)
+    {
+        BLIT_PROFILE_FUNCTION();
+
+        auto firstCluster = context.m_clusters.GetSize();
+        auto vertexCount = surfaceVertices.GetSize();
+
+        // Vertices that only differ in attributes (uv seams etc.) still connect neighbouring clusters
+        // (the identity "index buffer" is padded to whole triangles, as meshoptimizer expects)
+        BlitCL::DynamicArray<uint32_t> positionRemap{ (vertexCount + 2) / 3 * 3 };
+        for (size_t i = 0; i < positionRemap.GetSize(); ++i)
+        {
+            positionRemap[i] = uint32_t(i < vertexCount ? i : vertexCount - 1);
+        }
+        meshopt_generateShadowIndexBuffer(positionRemap.Data(), positionRemap.Data(), positionRemap.GetSize(), &surfaceVertices[0].position.x, 
+            vertexCount, sizeof(BlitML::vec3), sizeof(Vertex));
+        positionRemap.Resize(vertexCount);
+
+        // Full detail level
+        GenerateClusters(context, surfaceVertices, surfaceIndices);
+        BlitCL::DynamicArray<uint32_t> pending;
+        for (auto i = firstCluster; i < context.m_clusters.GetSize(); ++i)
+        {
+            pending.PushBack(uint32_t(i));
+        }
+
+        BlitCL::DynamicArray<uint32_t> groupedIds;
+        BlitCL::DynamicArray<uint32_t> groupOffsets;
+        BlitCL::DynamicArray<uint32_t> groupIndices;
+        BlitCL::DynamicArray<uint32_t> simplifiedIndices;
+        BlitCL::DynamicArray<uint32_t> nextPending;
+        while (pending.GetSize() > 1)
+        {
+            PartitionClusters(context, pending, positionRemap, groupedIds, groupOffsets);
+            nextPending.Resize(0);
+
+            for (size_t g = 0; g + 1 < groupOffsets.GetSize(); ++g)
+            {
+                auto groupBegin = groupOffsets[g];
+                auto groupEnd = groupOffsets[g + 1];
+
+                // Merges the group, its bounds enclose the bounds of every cluster under it
+                groupIndices.Resize(0);
+                auto groupCenter = context.m_clusters[groupedIds[groupBegin]].lodCenter;
+                auto groupRadius = context.m_clusters[groupedIds[groupBegin]].lodRadius;
+                float childError = 0.f;
+                for (auto i = groupBegin; i < groupEnd; ++i)
+                {
+                    const auto& cluster = context.m_clusters[groupedIds[i]];
+                    GetClusterTriangles(context, cluster, groupIndices);
+                    MergeBoundingSpheres(groupCenter, groupRadius, cluster.lodCenter, cluster.lodRadius);
+                    childError = BlitML::Max(childError, cluster.lodError);
+                }
+
+                // The group border is locked, so that neighbouring groups keep matching edges whatever level they are drawn at
+                auto targetIndexCount = (groupIndices.GetSize() / 6) * 3;
+                simplifiedIndices.Resize(groupIndices.GetSize());
+                float simplifyError = 0.f;
+                auto simplifiedSize = meshopt_simplify(simplifiedIndices.Data(), groupIndices.Data(), groupIndices.GetSize(), 
+                    &surfaceVertices[0].position.x, vertexCount, sizeof(Vertex), targetIndexCount, FLT_MAX,
+                    meshopt_SimplifyLockBorder | meshopt_SimplifySparse | meshopt_SimplifyErrorAbsolute, &simplifyError);
+
+                // These clusters stay roots of the DAG
+                if (simplifiedSize == 0 || simplifiedSize > size_t(double(groupIndices.GetSize()) * BlitzenCore::Ce_ClusterGroupMinReduction))
+                {
+                    continue;
+                }
+                simplifiedIndices.Resize(simplifiedSize);
+
+                // The error has to grow with every level, otherwise the cut could draw a parent and a child together
+                float groupError = BlitML::Max(simplifyError, childError);
+                for (auto i = groupBegin; i < groupEnd; ++i)
+                {
+                    auto& cluster = context.m_clusters[groupedIds[i]];
+                    cluster.parentCenter = groupCenter;
+                    cluster.parentRadius = groupRadius;
+                    cluster.parentError = groupError;
+                }
+
+                auto parentOffset = context.m_clusters.GetSize();
+                GenerateClusters(context, surfaceVertices, simplifiedIndices);
+                for (auto i = parentOffset; i < context.m_clusters.GetSize(); ++i)
+                {
+                    auto& cluster = context.m_clusters[i];
+                    cluster.lodCenter = groupCenter;
+                    cluster.lodRadius = groupRadius;
+                    cluster.lodError = groupError;
+                    nextPending.PushBack(uint32_t(i));
+                }
+            }
+
+            pending.Resize(0);
+            pending.AppendArray(nextPending);
+        }
+
+        // Sorted by error, so that the pre cluster shader can limit an object to the range that holds its cut.
+        // Parents are referenced by bounds and error, not by index, so the order is free
+        auto pClusters = context.m_clusters.Data() + firstCluster;
+        auto clusterCount = context.m_clusters.GetSize() - firstCluster;
+        std::sort(pClusters, pClusters + clusterCount, [](const Cluster& a, const Cluster& b) { return a.lodError < b.lodError; });
+        float parentErrorBound = 0.f;
+        for (size_t i = 0; i < clusterCount; ++i)
+        {
+            parentErrorBound = BlitML::Max(parentErrorBound, pClusters[i].parentError);
+            pClusters[i].parentErrorBound = parentErrorBound;
+        }
+
+        return clusterCount;
+    }
+
     void GenerateBoundingSphere(PrimitiveSurface& surface, BlitCL::DynamicArray<Vertex>& surfaceVertices, BlitCL::DynamicArray<uint32_t>& surfaceIndices)
     {
+        BLIT_PROFILE_FUNCTION();
+
         BlitML::vec3 center{ 0.f };
         for (size_t i = 0; i < surfaceVertices.GetSize(); ++i)
         {
@@ -356,20 +784,20 @@ namespace BlitzenEngine
 
             BlitML::vec4 t4{ tangent, handedness };
 
-            vertices[i0].tangentX = uint8_t(t4.x * 127.f + 127.5f);
-            vertices[i0].tangentY = uint8_t(t4.y * 127.f + 127.5f);
-            vertices[i0].tangentZ = uint8_t(t4.z * 127.f + 127.5f);
-            vertices[i0].tangentW = uint8_t(t4.w * 127.f + 127.5f);
+            vertices[i0].tangentX = EncodeVertexUnorm8(t4.x);
+            vertices[i0].tangentY = EncodeVertexUnorm8(t4.y);
+            vertices[i0].tangentZ = EncodeVertexUnorm8(t4.z);
+            vertices[i0].tangentW = EncodeVertexUnorm8(t4.w);
 
-            vertices[i1].tangentX = uint8_t(t4.x * 127.f + 127.5f);
-            vertices[i1].tangentY = uint8_t(t4.y * 127.f + 127.5f);
-            vertices[i1].tangentZ = uint8_t(t4.z * 127.f + 127.5f);
-            vertices[i1].tangentW = uint8_t(t4.w * 127.f + 127.5f);
+            vertices[i1].tangentX = EncodeVertexUnorm8(t4.x);
+            vertices[i1].tangentY = EncodeVertexUnorm8(t4.y);
+            vertices[i1].tangentZ = EncodeVertexUnorm8(t4.z);
+            vertices[i1].tangentW = EncodeVertexUnorm8(t4.w);
 
-            vertices[i2].tangentX = uint8_t(t4.x * 127.f + 127.5f);
-            vertices[i2].tangentY = uint8_t(t4.y * 127.f + 127.5f);
-            vertices[i2].tangentZ = uint8_t(t4.z * 127.f + 127.5f);
-            vertices[i2].tangentW = uint8_t(t4.w * 127.f + 127.5f);
+            vertices[i2].tangentX = EncodeVertexUnorm8(t4.x);
+            vertices[i2].tangentY = EncodeVertexUnorm8(t4.y);
+            vertices[i2].tangentZ = EncodeVertexUnorm8(t4.z);
+            vertices[i2].tangentW = EncodeVertexUnorm8(t4.w);
         }
     }
 
@@ -397,10 +825,111 @@ namespace BlitzenEngine
         }
     }
 
+    // Octahedral mapping of a unit vector to two snorm8 values (low byte x, high byte y)
+    static uint32_t EncodeOctahedral(float x, float y, float z)
+    {
+        float length = BlitML::Abs(x) + BlitML::Abs(y) + BlitML::Abs(z);
+        float u = length > 0.f ? x / length : 0.f;
+        float v = length > 0.f ? y / length : 0.f;
+        if (z < 0.f)
+        {
+            float foldedU = (1.f - BlitML::Abs(v)) * (u >= 0.f ? 1.f : -1.f);
+            float foldedV = (1.f - BlitML::Abs(u)) * (v >= 0.f ? 1.f : -1.f);
+            u = foldedU;
+            v = foldedV;
+        }
+
+        return uint32_t(meshopt_quantizeSnorm(u, 8) & 0xFF) | uint32_t(meshopt_quantizeSnorm(v, 8) & 0xFF) << 8;
+    }
+
+    void GenerateCompactVertices(MeshResources& context)
+    {
+        const auto& vertices = context.m_vertices;
+        const auto& surfaces = context.m_surfaces;
+        auto firstSurface = context.m_compactSurfaceCount;
+        if (firstSurface == surfaces.GetSize())
+        {
+            return;
+        }
+        context.m_compactVertices.Resize(vertices.GetSize());
+
+        // 16 bit indices are only possible if every surface can address its vertices with them
+        bool b16BitIndices = !firstSurface || context.m_compactIndexSize == sizeof(uint16_t);
+        for (size_t s = firstSurface; s < surfaces.GetSize(); ++s)
+        {
+            const auto& surface = surfaces[s];
+            auto vertexEnd = context.m_primitiveVertexCounts[s];
+            if (vertexEnd - surface.vertexOffset >= 65536)
+            {
+                b16BitIndices = false;
+            }
+
+            float invRadius = surface.radius > 0.f ? 1.f / surface.radius : 0.f;
+            for (uint32_t i = surface.vertexOffset; i < vertexEnd; ++i)
+            {
+                const auto& vtx = vertices[i];
+                auto& compact = context.m_compactVertices[i];
+
+                auto x = meshopt_quantizeSnorm((vtx.position.x - surface.center.x) * invRadius, 16);
+                auto y = meshopt_quantizeSnorm((vtx.position.y - surface.center.y) * invRadius, 16);
+                auto z = meshopt_quantizeSnorm((vtx.position.z - surface.center.z) * invRadius, 16);
+
+                auto normal = EncodeOctahedral(DecodeVertexUnorm8(vtx.normalX), DecodeVertexUnorm8(vtx.normalY), DecodeVertexUnorm8(vtx.normalZ));
+                auto tangent = EncodeOctahedral(DecodeVertexUnorm8(vtx.tangentX), DecodeVertexUnorm8(vtx.tangentY), DecodeVertexUnorm8(vtx.tangentZ));
+                uint32_t handedness = vtx.tangentW >= 127 ? 127 : uint32_t(-127 & 0xFF);
+
+                compact.positionXY = uint32_t(x & 0xFFFF) | uint32_t(y & 0xFFFF) << 16;
+                compact.positionZNormal = uint32_t(z & 0xFFFF) | normal << 16;
+                compact.uv = uint32_t(meshopt_quantizeHalf(vtx.uvX)) | uint32_t(meshopt_quantizeHalf(vtx.uvY)) << 16;
+                compact.tangent = tangent | handedness << 16;
+            }
+        }
+
+        uint32_t indexSize = b16BitIndices ? sizeof(uint16_t) : sizeof(uint32_t);
+        if (!b16BitIndices && (!firstSurface || context.m_compactIndexSize != indexSize))
+        {
+            BLIT_WARN("A surface has more than 65535 vertices, compact geometry will use 32 bit indices");
+        }
+        // The indices of the earlier surfaces are converted again when they have to be widened
+        if (context.m_compactIndexSize != indexSize)
+        {
+            firstSurface = 0;
+        }
+        context.m_compactIndexSize = indexSize;
+        context.m_compactIndices.Resize(context.m_indices.GetSize() * context.m_compactIndexSize);
+        context.m_compactSurfaceCount = uint32_t(surfaces.GetSize());
+
+        // The vertex shaders add the surface vertex offset, so the indices only need to address the surface's vertices
+        for (size_t s = firstSurface; s < surfaces.GetSize(); ++s)
+        {
+            const auto& surface = surfaces[s];
+            for (uint32_t l = surface.lodOffset; l < surface.lodOffset + surface.lodCount; ++l)
+            {
+                const auto& lod = context.m_LODs[l];
+                for (uint32_t i = lod.firstIndex; i < lod.firstIndex + lod.indexCount; ++i)
+                {
+                    auto relativeIndex = context.m_indices[i] - surface.vertexOffset;
+                    if (b16BitIndices)
+                    {
+                        reinterpret_cast<uint16_t*>(context.m_compactIndices.Data())[i] = uint16_t(relativeIndex);
+                    }
+                    else
+                    {
+                        reinterpret_cast<uint32_t*>(context.m_compactIndices.Data())[i] = relativeIndex;
+                    }
+                }
+            }
+        }
+
+        BLIT_INFO("Compact geometry: %i KB of vertices and indices (uncompressed: %i KB)",
+            int((context.m_compactVertices.GetSize() * sizeof(CompactVertex) + context.m_compactIndices.GetSize()) / 1024),
+            int((vertices.GetSize() * sizeof(Vertex) + context.m_indices.GetSize() * sizeof(uint32_t)) / 1024));
+    }
+
     void LoadTestGeometry(MeshResources& context)
     {
-        LoadMeshFromObj(context, "Assets/Meshes/dragon.obj", "dragon");
-        LoadMeshFromObj(context, "Assets/Meshes/kitten.obj", "kitten");
-        LoadMeshFromObj(context, "Assets/Meshes/FinalBaseMesh.obj", "human");
+        const char* filenames[] = { "Assets/Meshes/dragon.obj", "Assets/Meshes/kitten.obj", "Assets/Meshes/FinalBaseMesh.obj" };
+        const char* meshNames[] = { "dragon", "kitten", "human" };
+        LoadMeshesFromObj(context, filenames, meshNames, BLIT_ARRAY_SIZE(filenames));
     }
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 #include "Renderer/Resources/blitRenderingResources.h"
+#include "blitRenderBvh.h"
 
 namespace BlitzenEngine
 {
@@ -14,6 +15,9 @@ namespace BlitzenEngine
 		BlitzenEngine::RenderObject m_renders[BlitzenCore::Ce_MaxRenderObjects];
 		uint32_t m_renderCount{ 0 };
 
+		// Built once the scene is loaded, static objects in m_renders are sorted by it
+		RenderObjectBvh m_staticBvh;
+
 		BlitzenEngine::RenderObject m_transparentRenders[BlitzenCore::Ce_MaxTransparentRenderObjects];
 		uint32_t m_transparentRenderCount{ 0 };
 
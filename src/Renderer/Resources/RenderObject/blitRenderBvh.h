@@ -0,0 +1,48 @@
+#pragma once
+#include "Renderer/Resources/blitRenderingResources.h"
+#include "Game/blitCamera.h"
+
+namespace BlitzenEngine
+{
+    // Every node covers a contiguous range of render objects, children split their parent's range in two
+    struct BvhNode
+    {
+        BlitML::vec3 boundsMin;
+        uint32_t firstObject;
+        BlitML::vec3 boundsMax;
+        uint32_t objectCount;
+        // The first child is the next node (depth first order). 0 for leaves
+        uint32_t secondChild;
+    };
+
+    struct RenderObjectBvh
+    {
+        BlitCL::DynamicArray<BvhNode> m_nodes;
+
+        // Static render objects, sorted so that each node's objects are adjacent. Dynamic objects come before them
+        uint32_t m_firstObject{ 0 };
+        uint32_t m_objectCount{ 0 };
+    };
+
+    struct RenderObjectRange
+    {
+        uint32_t first;
+        uint32_t count;
+    };
+
+    // Reorders the render objects (dynamic first, then static in BVH order) and builds the hierarchy over the static ones.
+    // Bounds are the surface bounding spheres in world space. Runs on the task pool
+    bool BuildRenderObjectBvh(RenderObjectBvh& bvh, RenderObject* pRenders, uint32_t renderCount, const MeshTransform* pTransforms,
+        const SurfaceResources& surfaces);
+
+    // Queries append the object ranges of the nodes that pass (adjacent ranges are merged) and return the object count.
+    // Objects inside a range still need their own test, a node fully inside the volume is not split further
+
+    // Same sphere test as IsObjectInsideViewFrustum, on the node bounds
+    uint32_t QueryBvhFrustum(const RenderObjectBvh& bvh, const CameraViewData& view, BlitCL::DynamicArray<RenderObjectRange>& ranges);
+
+    uint32_t QueryBvhSphere(const RenderObjectBvh& bvh, const BlitML::vec3& center, float radius, BlitCL::DynamicArray<RenderObjectRange>& ranges);
+
+    uint32_t QueryBvhAabb(const RenderObjectBvh& bvh, const BlitML::vec3& boundsMin, const BlitML::vec3& boundsMax,
+        BlitCL::DynamicArray<RenderObjectRange>& ranges);
+}
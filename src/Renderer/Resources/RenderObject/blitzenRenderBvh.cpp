@@ -0,0 +1,300 @@
+#include "blitRenderBvh.h"
+#include "Core/Threads/blitTaskPool.h"
+#include "Core/DbLog/blitProfiler.h"
+#include <algorithm>
+
+namespace BlitzenEngine
+{
+    // Roughly how many tasks build the lower levels of the tree
+    constexpr uint32_t Ce_BvhTaskCount = 64;
+
+    // World space bounding sphere of a static render object. Sorted in place while splitting, so that every pass reads memory in order
+    struct BvhObject
+    {
+        float center[3];
+        float radius;
+        uint32_t renderIndex;
+    };
+
+    struct BvhBuildContext
+    {
+        BlitCL::DynamicArray<BvhObject> objects;
+        uint32_t taskThreshold;
+    };
+
+    struct BvhTask
+    {
+        uint32_t nodeIndex;
+        uint32_t first;
+        uint32_t count;
+    };
+
+    static void ComputeBounds(const BvhBuildContext& ctx, uint32_t first, uint32_t count, BvhNode& node, BlitML::vec3& centroidMin, BlitML::vec3& centroidMax)
+    {
+        float boundsMin[3], boundsMax[3], cMin[3], cMax[3];
+        const auto& firstObject = ctx.objects[first];
+        for (uint32_t a = 0; a < 3; ++a)
+        {
+            cMin[a] = cMax[a] = firstObject.center[a];
+            boundsMin[a] = firstObject.center[a] - firstObject.radius;
+            boundsMax[a] = firstObject.center[a] + firstObject.radius;
+        }
+
+        for (uint32_t i = first; i < first + count; ++i)
+        {
+            const auto& object = ctx.objects[i];
+            for (uint32_t a = 0; a < 3; ++a)
+            {
+                boundsMin[a] = std::min(boundsMin[a], object.center[a] - object.radius);
+                boundsMax[a] = std::max(boundsMax[a], object.center[a] + object.radius);
+                cMin[a] = std::min(cMin[a], object.center[a]);
+                cMax[a] = std::max(cMax[a], object.center[a]);
+            }
+        }
+
+        node.boundsMin = BlitML::vec3{ boundsMin[0], boundsMin[1], boundsMin[2] };
+        node.boundsMax = BlitML::vec3{ boundsMax[0], boundsMax[1], boundsMax[2] };
+        centroidMin = BlitML::vec3{ cMin[0], cMin[1], cMin[2] };
+        centroidMax = BlitML::vec3{ cMax[0], cMax[1], cMax[2] };
+    }
+
+    // Median split on the longest centroid axis
+    static uint32_t SplitObjects(BvhBuildContext& ctx, uint32_t first, uint32_t count, const BlitML::vec3& centroidMin, const BlitML::vec3& centroidMax)
+    {
+        BlitML::vec3 extent = centroidMax - centroidMin;
+        uint32_t axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+
+        auto pObjects = ctx.objects.Data();
+        uint32_t half = count / 2;
+        std::nth_element(pObjects + first, pObjects + first + half, pObjects + first + count,
+            [axis](const BvhObject& a, const BvhObject& b) { return a.center[axis] < b.center[axis]; });
+        return half;
+    }
+
+    // Splits always happen at the middle, so the node count of a range only depends on its size
+    static uint32_t GetBvhNodeCount(uint32_t count)
+    {
+        if (count <= BlitzenCore::Ce_BvhMaxLeafObjects)
+        {
+            return 1;
+        }
+        return 1 + GetBvhNodeCount(count / 2) + GetBvhNodeCount(count - count / 2);
+    }
+
+    // Writes the subtree of the range in depth first order starting at nodeIndex.
+    // When tasks are given, ranges small enough for a single task are left to them
+    static void BuildNode(BvhBuildContext& ctx, BvhNode* pNodes, uint32_t nodeIndex, uint32_t first, uint32_t count,
+        BlitCL::DynamicArray<BvhTask>* pTasks)
+    {
+        if (pTasks && count <= ctx.taskThreshold)
+        {
+            pTasks->PushBack(BvhTask{ nodeIndex, first, count });
+            return;
+        }
+
+        auto& node = pNodes[nodeIndex];
+        BlitML::vec3 centroidMin, centroidMax;
+        ComputeBounds(ctx, first, count, node, centroidMin, centroidMax);
+        node.firstObject = first;
+        node.objectCount = count;
+        node.secondChild = 0;
+        if (count <= BlitzenCore::Ce_BvhMaxLeafObjects)
+        {
+            return;
+        }
+
+        uint32_t half = SplitObjects(ctx, first, count, centroidMin, centroidMax);
+        node.secondChild = nodeIndex + 1 + GetBvhNodeCount(half);
+        BuildNode(ctx, pNodes, nodeIndex + 1, first, half, pTasks);
+        BuildNode(ctx, pNodes, node.secondChild, first + half, count - half, pTasks);
+    }
+
+    bool BuildRenderObjectBvh(RenderObjectBvh& bvh, RenderObject* pRenders, uint32_t renderCount, const MeshTransform* pTransforms,
+        const SurfaceResources& surfaces)
+    {
+        BLIT_PROFILE_FUNCTION();
+
+        // Dynamic objects move, they are kept out of the hierarchy at the start of the array
+        BlitCL::DynamicArray<RenderObject> staticRenders;
+        uint32_t dynamicCount = 0;
+        for (uint32_t i = 0; i < renderCount; ++i)
+        {
+            if (pRenders[i].transformId < BlitzenCore::Ce_MaxDynamicObjectCount)
+            {
+                pRenders[dynamicCount++] = pRenders[i];
+            }
+            else
+            {
+                staticRenders.PushBack(pRenders[i]);
+            }
+        }
+
+        bvh.m_nodes.Resize(0);
+        bvh.m_firstObject = dynamicCount;
+        bvh.m_objectCount = uint32_t(staticRenders.GetSize());
+        if (bvh.m_objectCount == 0)
+        {
+            return true;
+        }
+
+        BvhBuildContext ctx;
+        ctx.objects.Resize(bvh.m_objectCount);
+        ctx.taskThreshold = std::max(bvh.m_objectCount / Ce_BvhTaskCount, BlitzenCore::Ce_BvhMaxLeafObjects);
+
+        // Same transform as the cull shaders
+        uint32_t batchCount = (bvh.m_objectCount + BlitzenCore::Ce_CpuCullingBatchSize - 1) / BlitzenCore::Ce_CpuCullingBatchSize;
+        BlitzenCore::GetTaskPool().ParallelFor(batchCount, [&](size_t b)
+        {
+            uint32_t first = uint32_t(b) * BlitzenCore::Ce_CpuCullingBatchSize;
+            uint32_t last = std::min(first + BlitzenCore::Ce_CpuCullingBatchSize, bvh.m_objectCount);
+            for (uint32_t i = first; i < last; ++i)
+            {
+                const auto& surface = surfaces.m_surfaces[staticRenders[i].surfaceId];
+                const auto& transform = pTransforms[staticRenders[i].transformId];
+                const auto& q = transform.orientation;
+                BlitML::vec3 axis{ q.x, q.y, q.z };
+                BlitML::vec3 rotated = surface.center + BlitML::Cross(axis, BlitML::Cross(axis, surface.center) + surface.center * q.w) * 2.f;
+
+                BlitML::vec3 center = rotated * transform.scale + transform.pos;
+                ctx.objects[i] = BvhObject{ { center.x, center.y, center.z }, surface.radius * transform.scale, i };
+            }
+        });
+
+        // The top of the tree is split here, the rest in parallel. Tasks sort disjoint ranges of the object array
+        bvh.m_nodes.Resize(GetBvhNodeCount(bvh.m_objectCount));
+        BlitCL::DynamicArray<BvhTask> tasks;
+        BuildNode(ctx, bvh.m_nodes.Data(), 0, 0, bvh.m_objectCount, &tasks);
+        BlitzenCore::GetTaskPool().ParallelFor(tasks.GetSize(), [&](size_t t)
+        {
+            BuildNode(ctx, bvh.m_nodes.Data(), tasks[t].nodeIndex, tasks[t].first, tasks[t].count, nullptr);
+        });
+
+        // Object ranges of the nodes point to the render object array
+        for (auto& node : bvh.m_nodes)
+        {
+            node.firstObject += dynamicCount;
+        }
+        BlitzenCore::GetTaskPool().ParallelFor(batchCount, [&](size_t b)
+        {
+            uint32_t first = uint32_t(b) * BlitzenCore::Ce_CpuCullingBatchSize;
+            uint32_t last = std::min(first + BlitzenCore::Ce_CpuCullingBatchSize, bvh.m_objectCount);
+            for (uint32_t i = first; i < last; ++i)
+            {
+                pRenders[dynamicCount + i] = staticRenders[ctx.objects[i].renderIndex];
+            }
+        });
+
+        BLIT_INFO("Render object BVH: %u static objects, %u nodes", bvh.m_objectCount, uint32_t(bvh.m_nodes.GetSize()));
+        return true;
+    }
+
+    static float GetAxis(const BlitML::vec3& v, uint32_t axis)
+    {
+        return axis == 0 ? v.x : axis == 1 ? v.y : v.z;
+    }
+
+    // Classify returns 0 when the node is outside, 1 when it intersects and 2 when it is fully inside
+    template<typename F>
+    static uint32_t QueryBvh(const RenderObjectBvh& bvh, BlitCL::DynamicArray<RenderObjectRange>& ranges, F&& classify)
+    {
+        if (bvh.m_nodes.GetSize() == 0)
+        {
+            return 0;
+        }
+
+        uint32_t objectCount = 0;
+        uint32_t stack[64];
+        uint32_t stackSize = 0;
+        stack[stackSize++] = 0;
+        while (stackSize)
+        {
+            const auto& node = bvh.m_nodes[stack[--stackSize]];
+            uint32_t result = classify(node);
+            if (result == 0)
+            {
+                continue;
+            }
+
+            if (result == 1 && node.secondChild)
+            {
+                // First child on top, ranges come out in object order
+                stack[stackSize++] = node.secondChild;
+                stack[stackSize++] = uint32_t(&node - bvh.m_nodes.Data()) + 1;
+                continue;
+            }
+
+            if (ranges.GetSize() && ranges.Back().first + ranges.Back().count == node.firstObject)
+            {
+                ranges.Back().count += node.objectCount;
+            }
+            else
+            {
+                ranges.PushBack(RenderObjectRange{ node.firstObject, node.objectCount });
+            }
+            objectCount += node.objectCount;
+        }
+
+        return objectCount;
+    }
+
+    uint32_t QueryBvhFrustum(const RenderObjectBvh& bvh, const CameraViewData& view, BlitCL::DynamicArray<RenderObjectRange>& ranges)
+    {
+        BlitML::mat4 viewMatrix = view.viewMatrix;
+        return QueryBvh(bvh, ranges, [&](const BvhNode& node)
+        {
+            BlitML::vec3 center = (node.boundsMin + node.boundsMax) * 0.5f;
+            float radius = BlitML::Length(node.boundsMax - center);
+            BlitML::vec3 c = BlitML::ToVec3(viewMatrix * BlitML::vec4{ center, 1.f });
+
+            float side = c.z * view.frustumLeft - BlitML::Abs(c.x) * view.frustumRight;
+            float vertical = c.z * view.frustumBottom - BlitML::Abs(c.y) * view.frustumTop;
+            if (side <= -radius || vertical <= -radius || c.z + radius <= view.zNear || c.z - radius >= view.zFar)
+            {
+                return 0u;
+            }
+            return side > radius && vertical > radius && c.z - radius > view.zNear && c.z + radius < view.zFar ? 2u : 1u;
+        });
+    }
+
+    uint32_t QueryBvhSphere(const RenderObjectBvh& bvh, const BlitML::vec3& center, float radius, BlitCL::DynamicArray<RenderObjectRange>& ranges)
+    {
+        float radiusSquared = radius * radius;
+        return QueryBvh(bvh, ranges, [&](const BvhNode& node)
+        {
+            float nearest = 0.f;
+            float farthest = 0.f;
+            for (uint32_t a = 0; a < 3; ++a)
+            {
+                float c = GetAxis(center, a);
+                float d = std::max(std::max(GetAxis(node.boundsMin, a) - c, c - GetAxis(node.boundsMax, a)), 0.f);
+                nearest += d * d;
+                float f = std::max(c - GetAxis(node.boundsMin, a), GetAxis(node.boundsMax, a) - c);
+                farthest += f * f;
+            }
+            return nearest > radiusSquared ? 0u : farthest <= radiusSquared ? 2u : 1u;
+        });
+    }
+
+    uint32_t QueryBvhAabb(const RenderObjectBvh& bvh, const BlitML::vec3& boundsMin, const BlitML::vec3& boundsMax,
+        BlitCL::DynamicArray<RenderObjectRange>& ranges)
+    {
+        return QueryBvh(bvh, ranges, [&](const BvhNode& node)
+        {
+            uint32_t result = 2;
+            for (uint32_t a = 0; a < 3; ++a)
+            {
+                float nodeMin = GetAxis(node.boundsMin, a);
+                float nodeMax = GetAxis(node.boundsMax, a);
+                if (nodeMin > GetAxis(boundsMax, a) || nodeMax < GetAxis(boundsMin, a))
+                {
+                    return 0u;
+                }
+                if (nodeMin < GetAxis(boundsMin, a) || nodeMax > GetAxis(boundsMax, a))
+                {
+                    result = 1;
+                }
+            }
+            return result;
+        });
+    }
+}
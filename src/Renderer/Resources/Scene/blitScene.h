@@ -19,9 +19,19 @@ namespace BlitzenEngine
 
     void LoadGltfMaterials(TextureManager& textureContext, const CgltfScope& cgltfScope, uint32_t previousTextureCount);
 
-    void LoadGltfMeshes(MeshResources& meshContext, TextureManager& textureContext, const CgltfScope& cgltfScope, uint32_t previousMaterialCount, BlitCL::DynamicArray<uint32_t>& surfaceIndices);
+    // Loads the meshes from the cooked mesh file of gltfPath if it is up to date, and cooks it otherwise
+    void LoadGltfMeshes(MeshResources& meshContext, TextureManager& textureContext, const CgltfScope& cgltfScope, uint32_t previousMaterialCount, BlitCL::DynamicArray<uint32_t>& surfaceIndices, 
+        const char* gltfPath);
 
-    void LoadGltfMeshPrimitives(MeshResources& meshContext, TextureManager& textureContext, const CgltfScope& cgltfScope, const cgltf_mesh& gltfMesh, uint32_t previousMaterialCount);
+    // Generates the surfaces of every supported primitive on the task pool. Surfaces are stored in primitive order
+    void LoadGltfSurfaces(SurfaceResources& surfaces, const CgltfScope& cgltfScope);
+
+    // Assigns materials to the mesh's surfaces, starting from currentSurface
+    void LoadGltfMeshPrimitives(MeshResources& meshContext, TextureManager& textureContext, const CgltfScope& cgltfScope, const cgltf_mesh& gltfMesh, uint32_t previousMaterialCount, 
+        uint32_t& currentSurface);
+
+    // Unpacks the primitive's attributes and generates a surface for it
+    void LoadGltfPrimitiveGeometry(SurfaceResources& surfaces, const cgltf_primitive& prim);
 
     // Generates render objects for a gltf scene
     void LoadGltfNodes(RenderContainer& renders, MeshResources& meshContext, const CgltfScope& cgltfScope, const BlitCL::DynamicArray<uint32_t>& surfaceIndices);
@@ -1,4 +1,7 @@
 #include "blitScene.h"
+#include "Renderer/Resources/Mesh/blitMeshCache.h"
+#include "Core/Threads/blitTaskPool.h"
+#include "Core/DbLog/blitProfiler.h"
 
 namespace BlitzenEngine
 {
@@ -12,6 +15,8 @@ namespace BlitzenEngine
 
     bool LoadGltfFile(const char* path, CgltfScope& cgltf)
     {
+        BLIT_PROFILE_FUNCTION();
+
         cgltf_options options{};
 
         cgltf.pData = nullptr;
@@ -82,13 +87,42 @@ namespace BlitzenEngine
         return true;
 	}
 
-    void LoadGltfMeshes(MeshResources& meshContext, TextureManager& textureContext, const CgltfScope& cgltfScope, uint32_t previousMaterialCount, BlitCL::DynamicArray<uint32_t>& surfaceIndices)
+    void LoadGltfMeshes(MeshResources& meshContext, TextureManager& textureContext, const CgltfScope& cgltfScope, uint32_t previousMaterialCount, BlitCL::DynamicArray<uint32_t>& surfaceIndices, 
+        const char* gltfPath)
     {
+        BLIT_PROFILE_FUNCTION();
+
+        // The cooked file is keyed on the gltf file and every buffer it references
+        std::string cookedPath;
+        GetCookedMeshPath(gltfPath, cookedPath);
+        auto sourceHash = HashCookedMeshSourceFile(gltfPath);
+        for (size_t i = 0; i < cgltfScope.pData->buffers_count && sourceHash; ++i)
+        {
+            const auto& buffer = cgltfScope.pData->buffers[i];
+            if (buffer.data)
+            {
+                sourceHash = HashCookedMeshData(buffer.data, buffer.size, sourceHash);
+            }
+        }
+
+        SurfaceResources gltfSurfaces;
+        if (!sourceHash || !LoadCookedMesh(gltfSurfaces, cookedPath.c_str(), sourceHash))
+        {
+            LoadGltfSurfaces(gltfSurfaces, cgltfScope);
+            if (sourceHash)
+            {
+                WriteCookedMesh(gltfSurfaces, cookedPath.c_str(), sourceHash);
+            }
+        }
+
+        auto currentSurface = uint32_t(meshContext.m_surfaces.GetSize());
+        AppendSurfaces(meshContext, gltfSurfaces);
+
         for (size_t i = 0; i < cgltfScope.pData->meshes_count; ++i)
         {
             const auto& gltfMesh = cgltfScope.pData->meshes[i];
 
-            auto firstSurface = uint32_t(meshContext.m_surfaces.GetSize());
+            auto firstSurface = currentSurface;
 
             if (!meshContext.AddMesh(firstSurface, uint32_t(gltfMesh.primitives_count)))
             {
@@ -99,99 +133,145 @@ namespace BlitzenEngine
             // Saves surface indices for nodes
             surfaceIndices[i] = firstSurface;
 
-            LoadGltfMeshPrimitives(meshContext, textureContext, cgltfScope, gltfMesh, previousMaterialCount);
+            LoadGltfMeshPrimitives(meshContext, textureContext, cgltfScope, gltfMesh, previousMaterialCount, currentSurface);
         }
     }
 
-    void LoadGltfMeshPrimitives(MeshResources& meshContext, TextureManager& textureContext, const CgltfScope& cgltfScope, const cgltf_mesh& gltfMesh, uint32_t previousMaterialCount)
+    // Primitives that are skipped by both surface generation and material assignment
+    static bool IsGltfPrimitiveSupported(const cgltf_primitive& prim)
+    {
+        return prim.type == cgltf_primitive_type_triangles && prim.indices;
+    }
+
+    void LoadGltfSurfaces(SurfaceResources& surfaces, const CgltfScope& cgltfScope)
+    {
+        BlitCL::DynamicArray<const cgltf_primitive*> primitives;
+        for (size_t i = 0; i < cgltfScope.pData->meshes_count; ++i)
+        {
+            const auto& gltfMesh = cgltfScope.pData->meshes[i];
+            for (size_t j = 0; j < gltfMesh.primitives_count; ++j)
+            {
+                if (IsGltfPrimitiveSupported(gltfMesh.primitives[j]))
+                {
+                    primitives.PushBack(&gltfMesh.primitives[j]);
+                }
+            }
+        }
+
+        // Each primitive is processed by a worker into its own container (constructed in place, dynamic array does not call constructors)
+        BlitCL::DynamicArray<SurfaceResources> results{ primitives.GetSize() };
+        for (size_t i = 0; i < results.GetSize(); ++i)
+        {
+            new (&results[i]) SurfaceResources{};
+        }
+        BlitzenCore::GetTaskPool().ParallelFor(primitives.GetSize(), [&](size_t i)
+            {
+                LoadGltfPrimitiveGeometry(results[i], *primitives[i]);
+            });
+
+        // Merged in primitive order, so surface ids match the gltf layout
+        for (size_t i = 0; i < results.GetSize(); ++i)
+        {
+            AppendSurfaces(surfaces, results[i]);
+        }
+    }
+
+    void LoadGltfMeshPrimitives(MeshResources& meshContext, TextureManager& textureContext, const CgltfScope& cgltfScope, const cgltf_mesh& gltfMesh, uint32_t previousMaterialCount, 
+        uint32_t& currentSurface)
     {
         for (size_t j = 0; j < gltfMesh.primitives_count; ++j)
         {
             const cgltf_primitive& prim = gltfMesh.primitives[j];
 
             // Skips primitives that do not consist of triangles
-            if (prim.type != cgltf_primitive_type_triangles || !prim.indices)
+            if (!IsGltfPrimitiveSupported(prim))
             {
                 BLIT_ERROR("Blitzen supports only primitives with cgltf_primitive_type_triangles flags set and with indices");
                 continue;
             }
 
-            size_t vertexCount = prim.attributes[0].data->count;
-            BlitCL::DynamicArray<Vertex> vertices{ vertexCount };
-            BlitCL::DynamicArray<float> scratch{ vertexCount * 4 };
-
-            // Vertex positions
-            if (const cgltf_accessor* pos = cgltf_find_accessor(&prim, cgltf_attribute_type_position, 0))
+            // Get the material index and pass it to the surface if there is material index
+            if (prim.material)
             {
-                BLIT_ASSERT(cgltf_num_components(pos->type) == 3);
+                meshContext.m_surfaces[currentSurface].materialId = textureContext.m_materials[previousMaterialCount + cgltf_material_index(cgltfScope.pData, prim.material)].materialId;
 
-                cgltf_accessor_unpack_floats(pos, scratch.Data(), vertexCount * 3);
-                for (size_t j = 0; j < vertexCount; ++j)
+                if (prim.material->alpha_mode != cgltf_alpha_mode_opaque)
                 {
-                    vertices[j].position = BlitML::vec3(scratch[j * 3 + 0], scratch[j * 3 + 1], scratch[j * 3 + 2]);
+                    meshContext.m_bTransparencyList[currentSurface].isTransparent = true;
                 }
             }
+            ++currentSurface;
+        }
+    }
 
-            // Vertex normals
-            if (const cgltf_accessor* nrm = cgltf_find_accessor(&prim, cgltf_attribute_type_normal, 0))
-            {
-                BLIT_ASSERT(cgltf_num_components(nrm->type) == 3);
+    void LoadGltfPrimitiveGeometry(SurfaceResources& surfaces, const cgltf_primitive& prim)
+    {
+        size_t vertexCount = prim.attributes[0].data->count;
+        BlitCL::DynamicArray<Vertex> vertices{ vertexCount };
+        BlitCL::DynamicArray<float> scratch{ vertexCount * 4 };
 
-                cgltf_accessor_unpack_floats(nrm, scratch.Data(), vertexCount * 3);
-                for (size_t j = 0; j < vertexCount; ++j)
-                {
-                    vertices[j].normalX = static_cast<uint8_t>(scratch[j * 3 + 0] * 127.f + 127.5f);
-                    vertices[j].normalY = static_cast<uint8_t>(scratch[j * 3 + 1] * 127.f + 127.5f);
-                    vertices[j].normalZ = static_cast<uint8_t>(scratch[j * 3 + 2] * 127.f + 127.5f);
-                }
-            }
+        // Vertex positions
+        if (const cgltf_accessor* pos = cgltf_find_accessor(&prim, cgltf_attribute_type_position, 0))
+        {
+            BLIT_ASSERT(cgltf_num_components(pos->type) == 3);
 
-            // Vertex tangents
-            if (const cgltf_accessor* tang = cgltf_find_accessor(&prim, cgltf_attribute_type_tangent, 0))
+            cgltf_accessor_unpack_floats(pos, scratch.Data(), vertexCount * 3);
+            for (size_t j = 0; j < vertexCount; ++j)
             {
-                BLIT_ASSERT(cgltf_num_components(tang->type) == 4)
-
-                    cgltf_accessor_unpack_floats(tang, scratch.Data(), vertexCount * 4);
-                for (size_t j = 0; j < vertexCount; ++j)
-                {
-                    vertices[j].tangentX = uint8_t(scratch[j * 4 + 0] * 127.f + 127.5f);
-                    vertices[j].tangentY = uint8_t(scratch[j * 4 + 1] * 127.f + 127.5f);
-                    vertices[j].tangentZ = uint8_t(scratch[j * 4 + 2] * 127.f + 127.5f);
-                    vertices[j].tangentW = uint8_t(scratch[j * 4 + 3] * 127.f + 127.5f);
-                }
+                vertices[j].position = BlitML::vec3(scratch[j * 3 + 0], scratch[j * 3 + 1], scratch[j * 3 + 2]);
             }
+        }
+
+        // Vertex normals
+        if (const cgltf_accessor* nrm = cgltf_find_accessor(&prim, cgltf_attribute_type_normal, 0))
+        {
+            BLIT_ASSERT(cgltf_num_components(nrm->type) == 3);
 
-            if (const cgltf_accessor* tex = cgltf_find_accessor(&prim, cgltf_attribute_type_texcoord, 0))
+            cgltf_accessor_unpack_floats(nrm, scratch.Data(), vertexCount * 3);
+            for (size_t j = 0; j < vertexCount; ++j)
             {
-                BLIT_ASSERT(cgltf_num_components(tex->type) == 2);
-                cgltf_accessor_unpack_floats(tex, scratch.Data(), vertexCount * 2);
-                for (size_t j = 0; j < vertexCount; ++j)
-                {
-                    vertices[j].uvX = scratch[j * 2 + 0];
-                    vertices[j].uvY = scratch[j * 2 + 1];
-                }
+                vertices[j].normalX = EncodeVertexUnorm8(scratch[j * 3 + 0]);
+                vertices[j].normalY = EncodeVertexUnorm8(scratch[j * 3 + 1]);
+                vertices[j].normalZ = EncodeVertexUnorm8(scratch[j * 3 + 2]);
             }
+        }
 
-            BlitCL::DynamicArray<uint32_t> indices(prim.indices->count);
-            cgltf_accessor_unpack_indices(prim.indices, indices.Data(), 4, indices.GetSize());
-
-            GenerateSurface(meshContext, vertices, indices);
+        // Vertex tangents
+        if (const cgltf_accessor* tang = cgltf_find_accessor(&prim, cgltf_attribute_type_tangent, 0))
+        {
+            BLIT_ASSERT(cgltf_num_components(tang->type) == 4);
 
-            // Get the material index and pass it to the surface if there is material index
-            if (prim.material)
+            cgltf_accessor_unpack_floats(tang, scratch.Data(), vertexCount * 4);
+            for (size_t j = 0; j < vertexCount; ++j)
             {
-                meshContext.m_surfaces.Back().materialId = textureContext.m_materials[previousMaterialCount + cgltf_material_index(cgltfScope.pData, prim.material)].materialId;
+                vertices[j].tangentX = EncodeVertexUnorm8(scratch[j * 4 + 0]);
+                vertices[j].tangentY = EncodeVertexUnorm8(scratch[j * 4 + 1]);
+                vertices[j].tangentZ = EncodeVertexUnorm8(scratch[j * 4 + 2]);
+                vertices[j].tangentW = EncodeVertexUnorm8(scratch[j * 4 + 3]);
+            }
+        }
 
-                if (prim.material->alpha_mode != cgltf_alpha_mode_opaque)
-                {
-                    meshContext.m_bTransparencyList[meshContext.m_surfaces.GetSize() - 1].isTransparent = true;
-                }
+        if (const cgltf_accessor* tex = cgltf_find_accessor(&prim, cgltf_attribute_type_texcoord, 0))
+        {
+            BLIT_ASSERT(cgltf_num_components(tex->type) == 2);
+            cgltf_accessor_unpack_floats(tex, scratch.Data(), vertexCount * 2);
+            for (size_t j = 0; j < vertexCount; ++j)
+            {
+                vertices[j].uvX = scratch[j * 2 + 0];
+                vertices[j].uvY = scratch[j * 2 + 1];
             }
         }
+
+        BlitCL::DynamicArray<uint32_t> indices(prim.indices->count);
+        cgltf_accessor_unpack_indices(prim.indices, indices.Data(), 4, indices.GetSize());
+
+        GenerateSurface(surfaces, vertices, indices);
     }
 
     void LoadGltfNodes(RenderContainer& renders, MeshResources& meshContext, const CgltfScope& cgltfScope, const BlitCL::DynamicArray<uint32_t>& surfaceIndices)
     {
+        BLIT_PROFILE_FUNCTION();
+
         for (size_t i = 0; i < cgltfScope.pData->nodes_count; ++i)
         {
             auto node = &cgltfScope.pData->nodes[i];
@@ -244,6 +324,8 @@ namespace BlitzenEngine
 
     void LoadGltfMaterials(TextureManager& textureContext, const CgltfScope& cgltfScope, uint32_t previousTextureCount)
     {
+        BLIT_PROFILE_FUNCTION();
+
         for (size_t i = 0; i < cgltfScope.pData->materials_count; ++i)
         {
             auto& cgltfMaterial = cgltfScope.pData->materials[i];
@@ -0,0 +1,26 @@
+#pragma once
+#include "blitTextures.h"
+#include "Renderer/Resources/Mesh/blitMeshes.h"
+#include "Renderer/Resources/RenderObject/blitRender.h"
+#include "Game/blitCamera.h"
+
+namespace BlitzenEngine
+{
+    // For every texture, the largest on screen diameter in pixels of a visible object whose material uses it (0 when none).
+    // Objects are tested against the frustum, no occlusion
+    void ComputeTextureScreenSizes(const CameraViewData& view, const SurfaceResources& surfaces, const TextureManager& textures,
+        const RenderContainer& renders, float* pScreenSizes, uint32_t textureCount);
+
+    // Finest mip worth keeping for a texture that covers screenSize pixels (one texel per pixel across the object)
+    inline uint8_t SelectStreamedMip(float screenSize, uint32_t width, uint32_t height, uint8_t mipCount)
+    {
+        auto size{ float(width > height ? width : height) };
+        uint8_t mip{ 0 };
+        while (mip + 1 < mipCount && size * 0.5f >= screenSize)
+        {
+            size *= 0.5f;
+            ++mip;
+        }
+        return mip;
+    }
+}
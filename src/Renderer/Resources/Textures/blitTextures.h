@@ -28,6 +28,9 @@ namespace BlitzenEngine
 
     uint8_t OpenDDSImageFile(const char* filepath, DDS_HEADER& header, DDS_HEADER_DXT10& header10, BlitzenPlatform::C_FILE_SCOPE& handle);
 
+    // Same checks as above, for a DDS file that is already in memory (mapped file). The mip chain starts at dataOffset
+    uint8_t ParseDDSHeaders(const char* filepath, const uint8_t* pFileData, size_t fileSize, DDS_HEADER& header, DDS_HEADER_DXT10& header10, size_t& dataOffset);
+
     // Returns the amount of data needed to be allocated for the image data
     size_t GetDDSImageSizeBC(unsigned int width, unsigned int height, unsigned int levels, unsigned int blockSize);
 
@@ -0,0 +1,71 @@
+#include "blitTextureStreaming.h"
+#include "Core/DbLog/blitProfiler.h"
+
+namespace BlitzenEngine
+{
+    static void AddRenderObjects(const CameraViewData& view, const SurfaceResources& surfaces, const TextureManager& textures,
+        const MeshTransform* pTransforms, const RenderObject* pRenders, uint32_t renderCount, float* pScreenSizes, uint32_t textureCount)
+    {
+        const float* m = view.viewMatrix.data;
+        for (uint32_t i = 0; i < renderCount; ++i)
+        {
+            const auto& render{ pRenders[i] };
+            const auto& transform{ pTransforms[render.transformId] };
+            const auto& surface{ surfaces.m_surfaces[render.surfaceId] };
+
+            // Same sphere transform and frustum test as the draw cull
+            float vx = surface.center.x, vy = surface.center.y, vz = surface.center.z;
+            float qx = transform.orientation.x, qy = transform.orientation.y, qz = transform.orientation.z, qw = transform.orientation.w;
+            float tx = (qy * vz - qz * vy) + qw * vx;
+            float ty = (qz * vx - qx * vz) + qw * vy;
+            float tz = (qx * vy - qy * vx) + qw * vz;
+            float wx = (vx + 2.f * (qy * tz - qz * ty)) * transform.scale + transform.pos.x;
+            float wy = (vy + 2.f * (qz * tx - qx * tz)) * transform.scale + transform.pos.y;
+            float wz = (vz + 2.f * (qx * ty - qy * tx)) * transform.scale + transform.pos.z;
+
+            float cx = m[0] * wx + wy * m[4] + wz * m[8] + m[12];
+            float cy = m[1] * wx + wy * m[5] + wz * m[9] + m[13];
+            float cz = m[2] * wx + wy * m[6] + wz * m[10] + m[14];
+            float radius = surface.radius * transform.scale;
+
+            bool visible = cz * view.frustumLeft - BlitML::Abs(cx) * view.frustumRight > -radius;
+            visible = visible && cz * view.frustumBottom - BlitML::Abs(cy) * view.frustumTop > -radius;
+            visible = visible && cz + radius > view.zNear && cz - radius < view.zFar;
+            if (!visible)
+            {
+                continue;
+            }
+
+            // lodTarget is the world size of a pixel at distance 1
+            float distance = BlitML::Max(BlitML::Sqrt(cx * cx + cy * cy + cz * cz) - radius, view.zNear);
+            float screenSize = 2.f * radius / (distance * view.lodTarget);
+
+            const auto& material{ textures.m_materials[surface.materialId] };
+            uint32_t tags[] = { material.albedoTag, material.normalTag, material.specularTag, material.emissiveTag };
+            for (auto tag : tags)
+            {
+                if (tag < textureCount && pScreenSizes[tag] < screenSize)
+                {
+                    pScreenSizes[tag] = screenSize;
+                }
+            }
+        }
+    }
+
+    void ComputeTextureScreenSizes(const CameraViewData& view, const SurfaceResources& surfaces, const TextureManager& textures,
+        const RenderContainer& renders, float* pScreenSizes, uint32_t textureCount)
+    {
+        BLIT_PROFILE_FUNCTION();
+
+        for (uint32_t i = 0; i < textureCount; ++i)
+        {
+            pScreenSizes[i] = 0.f;
+        }
+
+        AddRenderObjects(view, surfaces, textures, renders.m_transforms, renders.m_renders, renders.m_renderCount, pScreenSizes, textureCount);
+        AddRenderObjects(view, surfaces, textures, renders.m_transforms, renders.m_transparentRenders, renders.m_transparentRenderCount,
+            pScreenSizes, textureCount);
+        AddRenderObjects(view, surfaces, textures, renders.m_transforms, renders.m_onpcRenders, renders.m_onpcRenderCount,
+            pScreenSizes, textureCount);
+    }
+}
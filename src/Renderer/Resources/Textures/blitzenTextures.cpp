@@ -1,4 +1,5 @@
 #include "blitTextures.h"
+#include <cstring>
 
 namespace BlitzenEngine
 {
@@ -32,7 +33,7 @@ namespace BlitzenEngine
 
 		pMaterial->materialId = m_materialCount;
 
-		if (name != "BLIT_DO_NOT_ADD_TO_MATERIAL_MAP")
+		if (strcmp(name, "BLIT_DO_NOT_ADD_TO_MATERIAL_MAP") != 0)
 		{
 			m_pMaterialTable.Insert(name, pMaterial);
 		}
@@ -41,6 +42,27 @@ namespace BlitzenEngine
 		return true;
 	}
 
+	static uint8_t ValidateDDSHeaders(const char* filepath, const DDS_HEADER& header, const DDS_HEADER_DXT10& header10)
+	{
+		if (header.dwSize != sizeof(header) || header.ddspf.dwSize != sizeof(header.ddspf))
+		{
+			BLIT_ERROR("Invalid DDS header size for file: %s", filepath);
+			return 0;
+		}
+
+		// These could be removed later, they seem to be ignoring certain types of textures
+		if (header.dwCaps2 & (BlitzenCore::DDSCAPS2_CUBEMAP | BlitzenCore::DDSCAPS2_VOLUME))
+		{
+			return 0;
+		}
+		if (header.ddspf.dwFourCC == FourCC("DX10") && header10.resourceDimension != BlitzenCore::DDS_DIMENSION_TEXTURE2D)
+		{
+			return 0;
+		}
+
+		return 1;
+	}
+
 	uint8_t OpenDDSImageFile(const char* filepath, DDS_HEADER& header, DDS_HEADER_DXT10& header10, BlitzenPlatform::C_FILE_SCOPE& scopedFILE)
 	{
 		if (!scopedFILE.Open(filepath, BlitzenPlatform::FileModes::Read, 1))
@@ -70,23 +92,42 @@ namespace BlitzenEngine
 			return 0;
 		}
 
-		if (header.dwSize != sizeof(header) || header.ddspf.dwSize != sizeof(header.ddspf))
+		return ValidateDDSHeaders(filepath, header, header10);
+	}
+
+	uint8_t ParseDDSHeaders(const char* filepath, const uint8_t* pFileData, size_t fileSize, DDS_HEADER& header, DDS_HEADER_DXT10& header10, size_t& dataOffset)
+	{
+		unsigned int magic = 0;
+		if (fileSize < sizeof(magic) + sizeof(header))
 		{
-			BLIT_ERROR("Invalid DDS header size for file: %s", filepath);
+			BLIT_ERROR("DDS file too small: %s", filepath);
 			return 0;
 		}
 
-		// These could be removed later, they seem to be ignoring certain types of textures
-		if (header.dwCaps2 & (BlitzenCore::DDSCAPS2_CUBEMAP | BlitzenCore::DDSCAPS2_VOLUME))
+		BlitzenPlatform::PlatformMemCopy(&magic, const_cast<uint8_t*>(pFileData), sizeof(magic));
+		if (magic != FourCC("DDS "))
 		{
+			BLIT_ERROR("Invalid DDS signature in file: %s", filepath);
 			return 0;
 		}
-		if (header.ddspf.dwFourCC == FourCC("DX10") && header10.resourceDimension != BlitzenCore::DDS_DIMENSION_TEXTURE2D)
+		dataOffset = sizeof(magic);
+
+		BlitzenPlatform::PlatformMemCopy(&header, const_cast<uint8_t*>(pFileData + dataOffset), sizeof(header));
+		dataOffset += sizeof(header);
+
+		if (header.ddspf.dwFourCC == FourCC("DX10"))
 		{
-			return 0;
+			if (fileSize < dataOffset + sizeof(header10))
+			{
+				BLIT_ERROR("Failed to readd DDS header10 data from file: %s", filepath);
+				return 0;
+			}
+
+			BlitzenPlatform::PlatformMemCopy(&header10, const_cast<uint8_t*>(pFileData + dataOffset), sizeof(header10));
+			dataOffset += sizeof(header10);
 		}
 
-		return 1;
+		return ValidateDDSHeaders(filepath, header, header10);
 	}
 
 	size_t GetDDSImageSizeBC(unsigned int width, unsigned int height, unsigned int levels, unsigned int blockSize)
@@ -15,6 +15,20 @@ namespace BlitzenEngine
     };
     static_assert(sizeof(Vertex) % 16 == 0);
 
+    // Vertex normals and tangents are stored as x * scale + 127.5 in 8 bits.
+    // The shaders decode them as value / 127 - 1 and need to match this scale
+    constexpr float Ce_VertexUnorm8Scale = 127.f;
+
+    inline uint8_t EncodeVertexUnorm8(float value)
+    {
+        return static_cast<uint8_t>(value * Ce_VertexUnorm8Scale + 127.5f);
+    }
+
+    inline float DecodeVertexUnorm8(uint8_t value)
+    {
+        return value / Ce_VertexUnorm8Scale - 1.f;
+    }
+
     struct alignas(16) HlslVtx
     {
         BlitML::vec3 position;
@@ -24,6 +38,18 @@ namespace BlitzenEngine
     };
     static_assert(sizeof(HlslVtx) % 16 == 0);
 
+    // Quantized vertex used by every backend when BLIT_COMPACT_VERTICES is defined.
+    // Position is snorm16 inside the surface bounding sphere (center + q * radius),
+    // normal and tangent are octahedral snorm8 and the texture coordinates are half floats
+    struct alignas(16) CompactVertex
+    {
+        uint32_t positionXY;
+        uint32_t positionZNormal; // z in the low 16 bits, octahedral normal in the high 16 bits
+        uint32_t uv;
+        uint32_t tangent; // octahedral tangent in the low 16 bits, handedness in the 3rd byte
+    };
+    static_assert(sizeof(CompactVertex) == 16);
+
     struct alignas(16) Cluster
     {
         // Bounding sphere
@@ -44,7 +70,19 @@ namespace BlitzenEngine
     	uint8_t triangleCount;
         uint8_t padding0;
         uint8_t padding1;
+
+        // Cluster DAG. The cluster is drawn when its own error is acceptable but its parent group's error is not.
+        // Both errors are in object space and measured on a sphere that encloses every cluster under it
+        float lodError;
+        BlitML::vec3 lodCenter;
+        float lodRadius;
+        BlitML::vec3 parentCenter;
+        float parentRadius;
+        float parentError;// FLT_MAX for roots
+        float parentErrorBound;// Max parent error of this and every earlier cluster of the DAG, which is sorted by lodError
+        uint32_t padding3;
     };
+    static_assert(sizeof(Cluster) % 16 == 0);
 
     struct HCluster
     {
@@ -83,8 +121,10 @@ namespace BlitzenEngine
         // Used for more accurate LOD selection
         float error;
 
+        // Cluster path, radius around the surface center that encloses every sphere of the DAG
+        float clusterBoundsRadius{ 0.f };
+
         // Padding
-        uint32_t padding0;  
         uint32_t padding1;
         uint32_t padding2;
 
@@ -95,10 +135,12 @@ namespace BlitzenEngine
         // uint32_t padding0;
     };
 
+    // Range of a LOD in the instance index buffer, set by SetLodInstanceRanges once the render objects exist
     struct LodInstanceCounter
     {
-        uint32_t instanceOffset;
+        uint32_t instanceOffset{ 0 };
         uint32_t instanceCount{ 0 };
+        uint32_t instanceCapacity{ 0 };
     };
 
     struct alignas(16) PrimitiveSurface
@@ -114,6 +156,7 @@ namespace BlitzenEngine
 
         uint32_t vertexOffset; // Not used in the shaders but can hold the offset when loading
     };
+    static_assert(std::is_trivially_copyable_v<PrimitiveSurface>);
 
     struct IsPrimitiveTransparent
     {
@@ -157,4 +200,7 @@ namespace BlitzenEngine
         uint32_t transformId;
         uint32_t surfaceId;
     };
+
+    // Copied in bulk into staging buffers and the BVH
+    static_assert(std::is_trivially_copyable_v<Vertex> && std::is_trivially_copyable_v<Cluster> && std::is_trivially_copyable_v<MeshTransform>);
 }
\ No newline at end of file
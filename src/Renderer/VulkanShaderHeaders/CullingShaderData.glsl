@@ -85,8 +85,10 @@ struct Lod
     // Used for more accurate LOD selection
     float error;
 
+    // Cluster path, radius around the surface center that encloses every sphere of the DAG
+    float clusterBoundsRadius;
+
     // Pad to 32 bytes total
-    uint padding0;
     uint padding1;
     uint padding2;
 };
@@ -115,6 +117,23 @@ uint LODSelection(vec3 center, float radius, float scale, float lodTarget, uint
     return lodIndex;
 }
 
+// Cluster DAG version of LODSelection. The error of a DAG node is acceptable 
+// when it is under the same threshold at the closest point of its bounding sphere
+bool IsClusterErrorAcceptable(vec3 lodCenter, float lodRadius, float lodError, Transform transform, mat4 view, float lodTarget)
+{
+    vec3 center = RotateQuat(lodCenter, transform.orientation) * transform.scale + transform.pos;
+    center = (view * vec4(center, 1)).xyz;
+    float distance = max(length(center) - lodRadius * transform.scale, 0);
+    return lodError <= distance * lodTarget / transform.scale;
+}
+
+// A cluster is part of the cut when its own error is fine but its parent group would be too coarse
+bool IsClusterInLodCut(Cluster cluster, Transform transform, mat4 view, float lodTarget)
+{
+    return IsClusterErrorAcceptable(cluster.lodCenter, cluster.lodRadius, cluster.lodError, transform, view, lodTarget) &&
+        !IsClusterErrorAcceptable(cluster.parentCenter, cluster.parentRadius, cluster.parentError, transform, view, lodTarget);
+}
+
 struct ClusterDispatchData
 {
     uint objectId;
@@ -134,8 +153,12 @@ layout(buffer_reference, std430) readonly buffer ClusterDispatchBuffer
 };
 #endif
 
-layout(buffer_reference, std430) writeonly buffer ClusterCountBuffer
+// Starts with the indirect dispatch of cluster culling (VkDispatchIndirectCommand), the pre cluster shader grows it with the count
+layout(buffer_reference, std430) buffer ClusterCountBuffer
 {
+	uint groupCountX;
+	uint groupCountY;
+	uint groupCountZ;
 	uint count;
 };
 
@@ -151,6 +174,19 @@ layout(set = 0, binding = 10, std430) buffer VisibilityBuffer
     uint visibilities[];
 }visibilityBuffer;
 
+// Instanced culling. Each LOD owns instanceCapacity elements of the instance index buffer, starting at instanceOffset
+struct LodInstanceCounter
+{
+    uint instanceOffset;
+    uint instanceCount;
+    uint instanceCapacity;
+};
+
+layout(set = 0, binding = 16, std430) buffer LodInstanceCounterBuffer
+{
+    LodInstanceCounter counters[];
+}lodInstanceCounterBuffer;
+
 #ifdef CLUSTER_CULLING
 layout (push_constant) uniform PushConstants
 {
@@ -158,7 +194,7 @@ layout (push_constant) uniform PushConstants
     ClusterDispatchBuffer clusterDispatchBuffer;
     ClusterCountBuffer clusterCountBuffer;
     uint drawCount;
-	uint padding0;
+	uint clusterCapacity;// Pre cluster pass only
 }pushConstant;
 #else
 layout (push_constant) uniform CullingConstants
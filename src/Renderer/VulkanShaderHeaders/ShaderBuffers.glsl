@@ -1,7 +1,19 @@
 #extension GL_EXT_buffer_reference2 : require
 #extension GL_EXT_shader_explicit_arithmetic_types : require
 
+// COMPACT_VERTICES is defined by the build when BLIT_COMPACT_VERTICES is
+
 // Mutliple vertices are passed to the GPU for each surface, so that the surface can be drawn
+#ifdef COMPACT_VERTICES
+// Quantized vertex, unpacked with the functions at the end of this file
+struct Vertex
+{
+    uint positionXY;
+    uint positionZNormal;
+    uint uv;
+    uint tangent;
+};
+#else
 struct Vertex
 {
     vec3 position;
@@ -10,6 +22,7 @@ struct Vertex
     uint8_t tangentX, tangentY, tangentZ, tangentW;
     uint padding0;
 };
+#endif
 
 // This is the single vertex buffer for the main graphics pipeline, accessed by draw indirect through index offset, index count and vertex offset
 layout(set = 0, binding = 1, std430) readonly buffer VertexBuffer
@@ -36,6 +49,16 @@ struct Cluster
     uint8_t triangleCount;
     uint8_t padding0;
     uint8_t padding1;
+
+    // Cluster DAG, the cluster is drawn when its own error is acceptable but its parent's is not
+    float lodError;
+    vec3 lodCenter;
+    float lodRadius;
+    vec3 parentCenter;
+    float parentRadius;
+    float parentError;
+    float parentErrorBound; // Clusters of a DAG are sorted by lodError, this is the max parentError up to this one
+    uint padding3;
 };
 
 // The single buffer that holds all meshlet data in the scene
@@ -62,7 +85,7 @@ struct Surface
     uint lodOffset;
     uint lodCount;
 
-    uint vertexOffset; // Not used in the shaders but is useful on the CPU (NOT CRUCIAL)
+    uint vertexOffset; // Added to the (surface relative) index when vertices are compact
 };
 
 layout(set = 0, binding = 2, std430) readonly buffer SurfaceBuffer
@@ -103,6 +126,12 @@ struct IndirectTask
     {
         IndirectTask tasks[];
     }indirectTaskBuffer;
+
+    // Instanced culling, render object ids of the visible instances, grouped by LOD
+    layout(set = 0, binding = 17, std430) writeonly buffer InstanceIndexBuffer
+    {
+        uint indices[];
+    }instanceIndexBuffer;
 #else
     layout(set = 0, binding = 7, std430) readonly buffer IndirectDrawBuffer
     {
@@ -113,6 +142,11 @@ struct IndirectTask
     {
         IndirectTask tasks[];
     }indirectTaskBuffer;
+
+    layout(set = 0, binding = 17, std430) readonly buffer InstanceIndexBuffer
+    {
+        uint indices[];
+    }instanceIndexBuffer;
 #endif
 
 struct RenderObject
@@ -199,6 +233,70 @@ vec3 RotateQuat(vec3 v, vec4 quat)
 	return v + 2.0 * cross(quat.xyz, cross(quat.xyz, v) + quat.w * v);
 }
 
+// Vertex fetch and unpacking, shared by every vertex shader so that both layouts work
+#ifdef COMPACT_VERTICES
+Vertex FetchVertex(uint index, Surface surface)
+{
+    return vertexBuffer.vertices[index + surface.vertexOffset];
+}
+
+vec3 OctahedralDecode(vec2 e)
+{
+    vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-v.z, 0.0);
+    v.xy += vec2(v.x >= 0.0 ? -t : t, v.y >= 0.0 ? -t : t);
+    return normalize(v);
+}
+
+vec3 UnpackPosition(Vertex vertex, Surface surface)
+{
+    vec3 quantized = vec3(unpackSnorm2x16(vertex.positionXY), unpackSnorm2x16(vertex.positionZNormal).x);
+    return surface.center + quantized * surface.radius;
+}
+
+vec2 UnpackUv(Vertex vertex)
+{
+    return unpackHalf2x16(vertex.uv);
+}
+
+vec3 UnpackNormal(Vertex vertex)
+{
+    return OctahedralDecode(unpackSnorm4x8(vertex.positionZNormal).zw);
+}
+
+vec4 UnpackTangent(Vertex vertex)
+{
+    vec4 packed = unpackSnorm4x8(vertex.tangent);
+    return vec4(OctahedralDecode(packed.xy), packed.z);
+}
+#else
+Vertex FetchVertex(uint index, Surface surface)
+{
+    return vertexBuffer.vertices[index];
+}
+
+vec3 UnpackPosition(Vertex vertex, Surface surface)
+{
+    return vertex.position;
+}
+
+vec2 UnpackUv(Vertex vertex)
+{
+    return vec2(vertex.uvX, vertex.uvY);
+}
+
+// The scale needs to match Ce_VertexUnorm8Scale on the CPU side
+vec3 UnpackNormal(Vertex vertex)
+{
+    return vec3(vertex.normalX, vertex.normalY, vertex.normalZ) / 127.0 - 1.0;
+}
+
+vec4 UnpackTangent(Vertex vertex)
+{
+    return vec4(vertex.tangentX, vertex.tangentY, vertex.tangentZ, vertex.tangentW) / 127.0 - 1.0;
+}
+#endif
+
 // Struct used for mesh shaders
 struct MeshTaskPayload
 {
@@ -0,0 +1,53 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+#extension GL_ARB_shader_draw_parameters : require
+
+#define GRAPHICS_PIPELINE
+#include "../VulkanShaderHeaders/ShaderBuffers.glsl"
+
+// All the values needed by the fragment shader
+layout(location = 0) out vec2 outUv;
+layout(location = 1) out vec3 outNormal;
+layout(location = 2) out vec4 outTangent;
+layout(location = 3) out uint outMaterialTag;
+layout(location = 4) out vec3 outModel;
+
+layout(push_constant) uniform Constants
+{
+    RenderObjectBuffer renderObjects;
+}rodvpc;
+
+// Cluster mode vertex shader. Draws are not indexed, the cluster culling shaders put the cluster id in first vertex
+void main()
+{
+    RenderObject object = rodvpc.renderObjects.objects[indirectDrawBuffer.draws[gl_DrawIDARB].objectId];
+    Transform transform = transformBuffer.instances[object.meshInstanceId];
+    Surface surface = surfaceBuffer.surfaces[object.surfaceId];
+
+    // Meshlet data: vertex list, followed by 8 bit local triangle indices packed in groups of 4
+    uint clusterId = uint(gl_BaseVertexARB);
+    uint corner = uint(gl_VertexIndex - gl_BaseVertexARB);
+    uint dataOffset = clusterBuffer.clusters[clusterId].dataOffset;
+    uint indexOffset = dataOffset + uint(clusterBuffer.clusters[clusterId].vertexCount);
+    uint localIndex = (meshletDataBuffer.data[indexOffset + corner / 4] >> ((corner % 4) * 8)) & 0xff;
+    Vertex vertex = vertexBuffer.vertices[meshletDataBuffer.data[dataOffset + localIndex] + surface.vertexOffset];
+
+    // Model position. Will be used for gl_position and exported to frag
+    vec3 modelPosition = RotateQuat(UnpackPosition(vertex, surface), transform.orientation) * transform.scale + transform.pos;
+    gl_Position = viewData.projectionView * vec4(modelPosition, 1.0);
+    outModel = modelPosition;
+
+    // Uv map for frag
+    outUv = UnpackUv(vertex);
+    // Material tag for frag
+    outMaterialTag = surface.materialId;
+
+    // Unpacks surface normals for frag
+    vec3 normal = UnpackNormal(vertex);
+    outNormal =  RotateQuat(normal, transform.orientation);
+
+    // Unpacks tangents for frag
+    vec4 tangent = UnpackTangent(vertex);
+    tangent.xyz = RotateQuat(tangent.xyz, transform.orientation);
+    outTangent = tangent;
+}
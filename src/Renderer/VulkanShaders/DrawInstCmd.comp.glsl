@@ -0,0 +1,33 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+#define COMPUTE_PIPELINE
+#include "../VulkanShaderHeaders/ShaderBuffers.glsl"
+#include "../VulkanShaderHeaders/CullingShaderData.glsl"
+
+layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+
+// One thread per LOD (the draw count push constant holds the LOD count), one instanced command for every LOD with visible instances
+void main()
+{
+    uint lodIndex = gl_GlobalInvocationID.x;
+    if(pushConstant.drawCount <= lodIndex)
+    {
+        return;
+    }
+
+    uint instanceCount = min(lodInstanceCounterBuffer.counters[lodIndex].instanceCount, lodInstanceCounterBuffer.counters[lodIndex].instanceCapacity);
+    if(instanceCount == 0)
+    {
+        return;
+    }
+    Lod currentLod = lodBuffer.levels[lodIndex];
+
+    uint drawID = atomicAdd(indirectDrawCountBuffer.drawCount, 1);
+    // The vertex shader adds the instance index to this offset, to find the render object in the instance index buffer
+    indirectDrawBuffer.draws[drawID].objectId = lodInstanceCounterBuffer.counters[lodIndex].instanceOffset;
+    indirectDrawBuffer.draws[drawID].indexCount = currentLod.indexCount;
+    indirectDrawBuffer.draws[drawID].instanceCount = instanceCount;
+    indirectDrawBuffer.draws[drawID].firstIndex = currentLod.firstIndex;
+    indirectDrawBuffer.draws[drawID].vertexOffset = 0;
+    indirectDrawBuffer.draws[drawID].firstInstance = 0;
+}
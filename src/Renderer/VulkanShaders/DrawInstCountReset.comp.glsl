@@ -0,0 +1,19 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+#define COMPUTE_PIPELINE
+#include "../VulkanShaderHeaders/ShaderBuffers.glsl"
+#include "../VulkanShaderHeaders/CullingShaderData.glsl"
+
+layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+
+// The draw count push constant holds the LOD count for this shader
+void main()
+{
+    uint lodIndex = gl_GlobalInvocationID.x;
+    if(pushConstant.drawCount <= lodIndex)
+    {
+        return;
+    }
+
+    lodInstanceCounterBuffer.counters[lodIndex].instanceCount = 0;
+}
@@ -0,0 +1,46 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+#define COMPUTE_PIPELINE
+#include "../VulkanShaderHeaders/ShaderBuffers.glsl"
+#include "../VulkanShaderHeaders/CullingShaderData.glsl"
+
+layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+
+void main()
+{
+    uint objectIndex = gl_GlobalInvocationID.x;
+    if(pushConstant.drawCount <= objectIndex)
+    {
+        return;
+    }
+    RenderObject obj = pushConstant.renderObjectBuffer.objects[objectIndex];
+    Transform transform = transformBuffer.instances[obj.meshInstanceId];
+
+    // Frustum culling
+    vec3 center;
+	float radius;
+	bool visible = IsObjectInsideViewFrustum(center, radius, 
+        surfaceBuffer.surfaces[obj.surfaceId].center, surfaceBuffer.surfaces[obj.surfaceId].radius, // bounding sphere
+        transform.scale, transform.pos, transform.orientation, // object transform
+        viewData.view, // view matrix
+        viewData.frustumRight, viewData.frustumLeft, // frustum planes
+        viewData.frustumTop, viewData.frustumBottom, // frustum planes part 2
+        viewData.zNear, viewData.zFar // zFar and zNear
+    );
+
+    // Visible objects are added to the instance list of the selected LOD. DrawInstCmd creates the commands
+    if(visible)
+    {
+        uint lodOffset = surfaceBuffer.surfaces[obj.surfaceId].lodOffset;
+        uint lodCount = surfaceBuffer.surfaces[obj.surfaceId].lodCount;
+        uint lodIndex = LODSelection(center, radius, transform.scale, viewData.lodTarget, lodOffset, lodCount);
+        lodIndex += lodOffset;
+
+        uint instanceId = atomicAdd(lodInstanceCounterBuffer.counters[lodIndex].instanceCount, 1);
+        // Instances past the LOD's range are dropped (the command shader clamps the count)
+        if(instanceId < lodInstanceCounterBuffer.counters[lodIndex].instanceCapacity)
+        {
+            instanceIndexBuffer.indices[lodInstanceCounterBuffer.counters[lodIndex].instanceOffset + instanceId] = objectIndex;
+        }
+    }
+}
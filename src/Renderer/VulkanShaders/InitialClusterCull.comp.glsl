@@ -13,7 +13,8 @@ void main()
 {
     
     uint objectIndex = gl_GlobalInvocationID.x;
-    if(pushConstant.drawCount <= objectIndex)
+    // Dispatched indirectly, the count was written by the pre cluster shader
+    if(pushConstant.clusterCountBuffer.count <= objectIndex)
     {
         return;
     }
@@ -21,6 +22,12 @@ void main()
     RenderObject obj = pushConstant.renderObjectBuffer.objects[data.objectId];
     Transform transform = transformBuffer.instances[obj.meshInstanceId];
 
+    // Only the clusters on the DAG cut of this view are drawn
+    if (!IsClusterInLodCut(clusterBuffer.clusters[data.clusterId], transform, viewData.view, viewData.lodTarget))
+    {
+        return;
+    }
+
     // TEMP: Hardcoded camera position, replace later
     /*const vec3 cameraPosition = vec3(0.0, 0.0, -10.0);
     // Estimate cluster center (you can replace this if you already have it precomputed)
@@ -46,10 +53,11 @@ void main()
     Lod currentLod = lodBuffer.levels[data.lodIndex];
     // The object index is needed to know which element to access in the per object data buffer
     indirectDrawBuffer.draws[drawID].objectId = data.objectId;
-    // Setup the indirect draw commands based on the selected LODs and the vertex offset of the current surface
+    // Non indexed command: one vertex per triangle corner and the cluster id as the first vertex.
+    // The vertex shader decodes the corner from the meshlet data (so firstInstance lands on the vertexOffset slot)
     indirectDrawBuffer.draws[drawID].indexCount = clusterBuffer.clusters[data.clusterId].triangleCount * 3;
     indirectDrawBuffer.draws[drawID].instanceCount = 1;
-    indirectDrawBuffer.draws[drawID].firstIndex = clusterBuffer.clusters[data.clusterId].dataOffset;
-    indirectDrawBuffer.draws[drawID].vertexOffset =  0;
+    indirectDrawBuffer.draws[drawID].firstIndex = data.clusterId;
+    indirectDrawBuffer.draws[drawID].vertexOffset = 0;
     indirectDrawBuffer.draws[drawID].firstInstance = 0;
 }
\ No newline at end of file
@@ -0,0 +1,40 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+#extension GL_ARB_shader_draw_parameters : require
+
+#define GRAPHICS_PIPELINE 
+#include "../VulkanShaderHeaders/ShaderBuffers.glsl"
+
+// Same outputs as MainObjectShader.vert
+layout(location = 0) out vec2 outUv;
+layout(location = 1) out vec3 outNormal;
+layout(location = 2) out vec4 outTangent;
+layout(location = 3) out uint outMaterialTag;
+layout(location = 4) out vec3 outModel;
+
+layout(push_constant) uniform Constants
+{
+    RenderObjectBuffer renderObjects;
+}rodvpc;
+
+void main()
+{
+    // Each command draws every visible instance of one LOD. Its object id is the LOD's offset in the instance index buffer
+    uint objectId = instanceIndexBuffer.indices[indirectDrawBuffer.draws[gl_DrawIDARB].objectId + gl_InstanceIndex];
+    RenderObject object = rodvpc.renderObjects.objects[objectId];
+    Transform transform = transformBuffer.instances[object.meshInstanceId];
+    Surface surface = surfaceBuffer.surfaces[object.surfaceId];
+    Vertex vertex = FetchVertex(uint(gl_VertexIndex), surface);
+
+    vec3 modelPosition = RotateQuat(UnpackPosition(vertex, surface), transform.orientation) * transform.scale + transform.pos;
+    gl_Position = viewData.projectionView * vec4(modelPosition, 1.0);
+    outModel = modelPosition;
+
+    outUv = UnpackUv(vertex);
+    outMaterialTag = surface.materialId;
+    outNormal = RotateQuat(UnpackNormal(vertex), transform.orientation);
+
+    vec4 tangent = UnpackTangent(vertex);
+    tangent.xyz = RotateQuat(tangent.xyz, transform.orientation);
+    outTangent = tangent;
+}
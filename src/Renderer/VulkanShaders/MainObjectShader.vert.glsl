@@ -22,26 +22,27 @@ layout(push_constant) uniform Constants
 #ifndef MESH_TEST
 void main()
 {
-    Vertex vertex = vertexBuffer.vertices[gl_VertexIndex];
     RenderObject object = rodvpc.renderObjects.objects[indirectDrawBuffer.draws[gl_DrawIDARB].objectId];
     Transform transform = transformBuffer.instances[object.meshInstanceId];
+    Surface surface = surfaceBuffer.surfaces[object.surfaceId];
+    Vertex vertex = FetchVertex(uint(gl_VertexIndex), surface);
 
     // Model position. Will be used for gl_position and exported to frag
-    vec3 modelPosition = RotateQuat(vertex.position, transform.orientation) * transform.scale + transform.pos;
+    vec3 modelPosition = RotateQuat(UnpackPosition(vertex, surface), transform.orientation) * transform.scale + transform.pos;
     gl_Position = viewData.projectionView * vec4(modelPosition, 1.0);
     outModel = modelPosition;
 
     // Uv map for frag
-    outUv = vec2(vertex.uvX, vertex.uvY);
+    outUv = UnpackUv(vertex);
     // Material tag for frag
-    outMaterialTag = surfaceBuffer.surfaces[object.surfaceId].materialId;
+    outMaterialTag = surface.materialId;
     
     // Unpacks surface normals for frag
-    vec3 normal = vec3(vertex.normalX, vertex.normalY, vertex.normalZ) / 127.5 - 1.0;
+    vec3 normal = UnpackNormal(vertex);
     outNormal =  RotateQuat(normal, transform.orientation);
 
     // Unpacks tangents for frag
-    vec4 tangent = vec4(vertex.tangentX, vertex.tangentY, vertex.tangentZ, vertex.tangentW) / 127.5 - 1.0;
+    vec4 tangent = UnpackTangent(vertex);
     tangent.xyz = RotateQuat(tangent.xyz, transform.orientation);
     outTangent = tangent;
 }
@@ -39,10 +39,10 @@ void main()
         uint vertexIndex = meshletDataBuffer.data[vertexOffset + i] + currentSurface.vertexOffset;
         Vertex currentVertex = vertexBuffer.vertices[vertexIndex];
 
-        vec3 position = currentVertex.position;
-        vec3 n = vec3(currentVertex.normalX, currentVertex.normalY, currentVertex.normalZ);
+        vec3 position = UnpackPosition(currentVertex, currentSurface);
+        vec3 n = UnpackNormal(currentVertex);
 		vec3 normal = RotateQuat(n, currentInstance.orientation);
-		vec2 uv = vec2(currentVertex.uvX, currentVertex.uvY);
+		vec2 uv = UnpackUv(currentVertex);
 
         gl_MeshVerticesEXT[i].gl_Position = viewData.projectionView * 
         vec4(RotateQuat(position, currentInstance.orientation) * currentInstance.scale + currentInstance.pos, 1);
@@ -50,10 +50,16 @@ void main()
         outNormal[i] = normal;
     }
 
+    // Local triangle indices are 8 bit, packed 4 per uint
     for(uint i = threadId; i < triangleCount; i += 64)
     {
-        uint triangle = meshletDataBuffer.data[indexOffset + i];
-        gl_PrimitiveTriangleIndicesEXT[i] = uvec3((triangle >> 16) & 0xff, (triangle >> 8) & 0xff, triangle & 0xff);
+        uvec3 corners = uvec3(i * 3, i * 3 + 1, i * 3 + 2);
+        uvec3 triangle;
+        for(uint c = 0; c < 3; ++c)
+        {
+            triangle[c] = (meshletDataBuffer.data[indexOffset + corners[c] / 4] >> ((corners[c] % 4) * 8)) & 0xff;
+        }
+        gl_PrimitiveTriangleIndicesEXT[i] = triangle;
     }
 
     SetMeshOutputsEXT(vertexCount, triangleCount);
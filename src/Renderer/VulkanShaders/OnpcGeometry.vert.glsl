@@ -19,30 +19,31 @@ layout(location = 4) out vec3 outModel;
 
 void main()
 {
-    // Accesses the current vertex
-    Vertex vertex = vertexBuffer.vertices[gl_VertexIndex];
-
     // Accesses the current object data
     RenderObject object = onpcReflectiveObjectBuffer.objects[indirectDrawBuffer.draws[gl_DrawIDARB].objectId];
     Transform transform = transformBuffer.instances[object.meshInstanceId];
+    Surface surface = surfaceBuffer.surfaces[object.surfaceId];
+
+    // Accesses the current vertex
+    Vertex vertex = FetchVertex(uint(gl_VertexIndex), surface);
 
     // Calculate the model position by using the current transform data(the model position will be passed to the fragment shader and for gl_position)
-    vec3 modelPosition = RotateQuat(vertex.position, transform.orientation) * transform.scale + transform.pos;
+    vec3 modelPosition = RotateQuat(UnpackPosition(vertex, surface), transform.orientation) * transform.scale + transform.pos;
     // Calculate final gl_position by projecting model position to clip coordinates
     gl_Position = onpcMat * viewData.view * vec4(modelPosition, 1.0);
 
     // Create a vec2 from the uvMap halfFloats to be passed to the fragment shader
-    outUv = vec2(float(vertex.uvX), float(vertex.uvY));
+    outUv = UnpackUv(vertex);
 
-    outMaterialTag = surfaceBuffer.surfaces[object.surfaceId].materialId;
+    outMaterialTag = surface.materialId;
     
     // Unpack surface normals
-    vec3 normal = vec3(vertex.normalX, vertex.normalY, vertex.normalZ) / 127.0 - 1.0;
+    vec3 normal = UnpackNormal(vertex);
     // Pass the normal after promoting it to model coordinates
     outNormal =  RotateQuat(normal, transform.orientation);
 
     // Unpack tangents
-    vec4 tangent = vec4(vertex.tangentX, vertex.tangentY, vertex.tangentZ, vertex.tangentW) / 127.0 - 1.0;
+    vec4 tangent = UnpackTangent(vertex);
     tangent.xyz = RotateQuat(tangent.xyz, transform.orientation);
     outTangent = tangent;
 
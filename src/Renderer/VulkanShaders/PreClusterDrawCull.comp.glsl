@@ -10,6 +10,25 @@
 
 layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
 
+// Binary search over a sorted DAG range, returns the first cluster whose lodError (or parentErrorBound) is over the threshold
+uint FindFirstCluster(uint first, uint last, float threshold, bool bParentError)
+{
+    while (first < last)
+    {
+        uint middle = first + (last - first) / 2;
+        float error = bParentError ? clusterBuffer.clusters[middle].parentErrorBound : clusterBuffer.clusters[middle].lodError;
+        if (error > threshold)
+        {
+            last = middle;
+        }
+        else
+        {
+            first = middle + 1;
+        }
+    }
+    return first;
+}
+
 void main()
 {
     uint objectIndex = gl_GlobalInvocationID.x;
@@ -30,16 +49,38 @@ void main()
 
     if (visible)
     {
-        uint lodOffset = surfaceBuffer.surfaces[obj.surfaceId].lodOffset;
-        uint lodCount = surfaceBuffer.surfaces[obj.surfaceId].lodCount;
-        uint lodIndex = LODSelection(center, radius, transform.scale, viewData.lodTarget, lodOffset, lodCount);
-        lodIndex += lodOffset;
+        // The first LOD holds the whole cluster DAG, the cluster culling shader picks the cut
+        uint lodIndex = surfaceBuffer.surfaces[obj.surfaceId].lodOffset;
         Lod lod = lodBuffer.levels[lodIndex];
 
-        uint dispatchIndex = atomicAdd(pushConstant.clusterCountBuffer.count, lod.clusterCount);
-        for(uint i = 0; i < lod.clusterCount; ++i)
+        // Every DAG sphere is inside the bounds sphere, so each cluster's error threshold is between these two
+        float boundsRadius = lod.clusterBoundsRadius * transform.scale;
+        float minThreshold = max(length(center) - boundsRadius, 0) * viewData.lodTarget / transform.scale;
+        float maxThreshold = (length(center) + boundsRadius) * viewData.lodTarget / transform.scale;
+
+        // The DAG is sorted by lodError, clusters past the last acceptable error can not be on the cut
+        uint clusterEnd = FindFirstCluster(lod.clusterOffset, lod.clusterOffset + lod.clusterCount, maxThreshold, false);
+        // Clusters before the first parent error over the lowest threshold have a parent that is always acceptable
+        uint clusterBegin = FindFirstCluster(lod.clusterOffset, clusterEnd, minThreshold, true);
+        uint clusterCount = clusterEnd - clusterBegin;
+        if (clusterCount == 0)
+        {
+            return;
+        }
+
+        uint dispatchIndex = atomicAdd(pushConstant.clusterCountBuffer.count, clusterCount);
+        // The dispatch buffer and the group count limit hold a whole number of groups, anything over them is dropped
+        if (dispatchIndex >= pushConstant.clusterCapacity)
+        {
+            return;
+        }
+        clusterCount = min(clusterCount, pushConstant.clusterCapacity - dispatchIndex);
+
+        // Enough groups for every cluster up to this object's last one
+        atomicMax(pushConstant.clusterCountBuffer.groupCountX, (dispatchIndex + clusterCount + 63) / 64);
+        for(uint i = 0; i < clusterCount; ++i)
         {
-            pushConstant.clusterDispatchBuffer.data[i + dispatchIndex].clusterId = lod.clusterOffset + i;
+            pushConstant.clusterDispatchBuffer.data[i + dispatchIndex].clusterId = clusterBegin + i;
             pushConstant.clusterDispatchBuffer.data[i + dispatchIndex].lodIndex = lodIndex;
             pushConstant.clusterDispatchBuffer.data[i + dispatchIndex].objectId = objectIndex;
         }